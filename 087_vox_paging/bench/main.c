@@ -0,0 +1,293 @@
+// headless meshing benchmark for the CPU chunk code (no GL context required)
+// C99
+// usage: voxbench [results.json]
+// meshes the middle chunk of a few canonical 3x3 chunk worlds with every mesher and level of detail, and prints throughput, output size, and the
+// mesher's peak scratch memory for each. the same as JSON if a filename is given, so CI can track every mesher change.
+// vertex_hash is a hash of the vertices emitted. it only changes when the mesher's output does, so a change to it that wasn't meant is a regression
+// then samples a chunk's worth of the 3D noise that chunk_generate() digs caves with, on every SIMD path the CPU has. their value_hash must all match
+
+#include "../chunk.h"
+#include "../diamond_square.h"
+#include "../noise.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// each case is meshed over and over for at least this long, so that the clock's resolution doesn't matter
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_SEED 1234
+
+/*-------------------------------------------------CANONICAL WORLDS-----------------------------------------------------*/
+
+// all air, so the world's generator only has to set the solid voxels. light is worked out by _finish_chunks()
+static chunk_t _empty_chunk() {
+  chunk_t chunk;
+  memset( &chunk, 0, sizeof( chunk_t ) );
+  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
+  assert( chunk.voxels );
+  return chunk;
+}
+
+// sky light down each column, then compressed like resident chunks are
+static void _finish_chunks( chunk_t* chunks ) {
+  for ( int i = 0; i < 9; i++ ) {
+    chunk_init_sky_light( &chunks[i] );
+    chunk_compress( &chunks[i] );
+  }
+}
+
+// grass on dirt on stone, level at y 64
+static void _flat_world( chunk_t* chunks ) {
+  for ( int i = 0; i < 9; i++ ) {
+    chunks[i] = _empty_chunk();
+    for ( int y = 0; y <= 64; y++ ) {
+      const block_type_t type = 0 == y ? BLOCK_TYPE_CRUST : ( y < 60 ? BLOCK_TYPE_STONE : ( y < 64 ? BLOCK_TYPE_DIRT : BLOCK_TYPE_GRASS ) );
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &chunks[i], x, y, z, type ); }
+      }
+    }
+  }
+  _finish_chunks( chunks );
+}
+
+// cut out of one diamond-square heightmap, like the tests' terrain
+static void _diamond_square_world( chunk_t* chunks ) {
+  srand( BENCH_SEED );
+  dsquare_heightmap_t dshm = dsquare_heightmap_alloc( CHUNK_X * 4, 63 );
+  dsquare_heightmap_gen( &dshm, 64, 64, 64 );
+  for ( int cz = 0; cz < 3; cz++ ) {
+    for ( int cx = 0; cx < 3; cx++ ) { chunks[cz * 3 + cx] = chunk_generate_from_heightmap( dshm.filtered_heightmap, dshm.w, cx * CHUNK_X, cz * CHUNK_Z ); }
+  }
+  dsquare_heightmap_free( &dshm );
+}
+
+/* chunk_generate() terrain with caves dug out of it. a voxel well under the ground is a cave where three 2D noises, across each pair of axes,
+are all high, which makes twisting tunnels that cross chunk borders */
+static void _noise_caves_world( chunk_t* chunks ) {
+  for ( int i = 0; i < 9; i++ ) {
+    const int cx = i % 3, cz = i / 3;
+    chunks[i]    = chunk_generate( BENCH_SEED, cx, cz );
+    chunk_decompress( &chunks[i] );
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        const int wx = cx * CHUNK_X + x, wz = cz * CHUNK_Z + z;
+        for ( int y = 2; y < chunks[i].heightmap[CHUNK_X * z + x] - 4; y++ ) {
+          const float xz = noise_value2( BENCH_SEED + 1, wx, wz, 16 );
+          const float xy = noise_value2( BENCH_SEED + 2, wx, y, 16 );
+          const float zy = noise_value2( BENCH_SEED + 3, wz, y, 16 );
+          if ( xz > 0.0f && xy > 0.0f && zy > 0.0f ) { set_block_type_in_chunk( &chunks[i], x, y, z, BLOCK_TYPE_AIR ); }
+        }
+      }
+    }
+  }
+  _finish_chunks( chunks );
+}
+
+// every other voxel solid in all 3 directions, with mixed types. every face of every solid voxel is exposed and nothing merges: the worst case
+static void _checkerboard_world( chunk_t* chunks ) {
+  for ( int i = 0; i < 9; i++ ) {
+    chunks[i] = _empty_chunk();
+    for ( int y = 0; y < CHUNK_Y; y++ ) {
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) {
+          if ( ( x + y + z ) % 2 ) { set_block_type_in_chunk( &chunks[i], x, y, z, (block_type_t)( BLOCK_TYPE_CRUST + ( x + z ) % 4 ) ); }
+        }
+      }
+    }
+  }
+  _finish_chunks( chunks );
+}
+
+typedef struct bench_world_t {
+  const char* name;
+  void ( *generate )( chunk_t* chunks ); // 3x3 chunks, z then x
+} bench_world_t;
+
+/*-------------------------------------------------BENCHMARK-----------------------------------------------------*/
+
+typedef struct bench_mode_t {
+  const char* name;
+  chunk_mesher_t mesher;
+  int lod; // 0 is full detail with mesher. otherwise chunk_gen_lod_vertex_data_in_arena()
+} bench_mode_t;
+
+typedef struct bench_result_t {
+  const char* world;
+  const char* mode;
+  double ms_per_chunk;
+  double voxels_per_sec;
+  size_t n_vertices;
+  size_t bytes_per_chunk;
+  size_t peak_arena_bytes; // the mesher's scratch memory after meshing. it only grows, so this is its peak
+  uint64_t vertex_hash;
+  int n_runs;
+} bench_result_t;
+
+// 64-bit FNV-1a of the packed vertices
+static uint64_t _vertex_hash( const chunk_vertex_data_t* vertex_data ) {
+  const uint8_t* bytes = (const uint8_t*)vertex_data->packed_ptr;
+  const size_t n_bytes = vertex_data->n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t );
+  uint64_t hash        = 0xCBF29CE484222325ull;
+  for ( size_t i = 0; i < n_bytes; i++ ) { hash = ( hash ^ bytes[i] ) * 0x100000001B3ull; }
+  return hash;
+}
+
+/* meshes the middle chunk the same way a mesh job does: the chunk decompressed, its neighbours left compressed, into an arena reused between runs.
+the arena starts empty for each mode so its size is that mode's peak */
+static bench_result_t _bench_mode( const char* world_name, const chunk_t* chunk, const chunk_neighbours_t* neighbours, bench_mode_t mode ) {
+  chunk_mesh_arena_t arena = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+  chunk_vertex_data_t vertex_data;
+  int n_runs          = 0;
+  const clock_t start = clock();
+  clock_t end         = start;
+  do {
+    chunk_mesh_arena_reset( &arena );
+    vertex_data = mode.lod ? chunk_gen_lod_vertex_data_in_arena( &arena, chunk, neighbours, mode.lod ) :
+                             chunk_gen_vertex_data_in_arena( &arena, chunk, neighbours, 0, CHUNK_Y, mode.mesher );
+    n_runs++;
+    end = clock();
+  } while ( (double)( end - start ) / CLOCKS_PER_SEC < BENCH_MIN_SECONDS );
+
+  const double seconds  = (double)( end - start ) / CLOCKS_PER_SEC;
+  bench_result_t result = ( bench_result_t ){ .world = world_name,
+    .mode                                           = mode.name,
+    .ms_per_chunk                                   = seconds * 1000.0 / n_runs,
+    .voxels_per_sec                                 = (double)CHUNK_X * CHUNK_Y * CHUNK_Z * n_runs / seconds,
+    .n_vertices                                     = vertex_data.n_vertices,
+    .bytes_per_chunk                                = vertex_data.n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ),
+    .peak_arena_bytes                               = arena.max_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ),
+    .vertex_hash                                    = _vertex_hash( &vertex_data ),
+    .n_runs                                         = n_runs };
+  chunk_mesh_arena_free( &arena );
+  return result;
+}
+
+/*-------------------------------------------------NOISE-----------------------------------------------------*/
+
+typedef struct bench_noise_result_t {
+  const char* path;
+  double ms_per_chunk;
+  double voxels_per_sec;
+  uint64_t value_hash; // of a chunk's noise values. the same for every path or one of them is wrong
+  int n_runs;
+} bench_noise_result_t;
+
+// 64-bit FNV-1a of a chunk's noise values at chunk cx,0, a row at a time
+static uint64_t _noise_hash( noise_simd_t simd, int cx, int spacing ) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int y = 0; y < CHUNK_Y; y++ ) {
+      float values[NOISE_ROW_W];
+      noise_gradient3_row( simd, BENCH_SEED, cx * CHUNK_X, y, z, spacing, values );
+      const uint8_t* bytes = (const uint8_t*)values;
+      for ( size_t i = 0; i < sizeof( values ); i++ ) { hash = ( hash ^ bytes[i] ) * 0x100000001B3ull; }
+    }
+  }
+  return hash;
+}
+
+// every voxel of a chunk, a row at a time, with the tunnels' lattice spacing. a new chunk each run
+static bench_noise_result_t _bench_noise( noise_simd_t simd ) {
+  const int spacing   = 48;
+  float sum           = 0.0f; // so that the values are used
+  int n_runs          = 0;
+  const clock_t start = clock();
+  clock_t end         = start;
+  do {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int y = 0; y < CHUNK_Y; y++ ) {
+        float values[NOISE_ROW_W];
+        noise_gradient3_row( simd, BENCH_SEED, n_runs * CHUNK_X, y, z, spacing, values );
+        sum += values[0];
+      }
+    }
+    n_runs++;
+    end = clock();
+  } while ( (double)( end - start ) / CLOCKS_PER_SEC < BENCH_MIN_SECONDS );
+  (void)sum;
+
+  const double seconds = (double)( end - start ) / CLOCKS_PER_SEC;
+  return ( bench_noise_result_t ){ .path = noise_simd_name( simd ),
+    .ms_per_chunk                        = seconds * 1000.0 / n_runs,
+    .voxels_per_sec                      = (double)CHUNK_X * CHUNK_Y * CHUNK_Z * n_runs / seconds,
+    .value_hash                          = _noise_hash( simd, 0, spacing ),
+    .n_runs                              = n_runs };
+}
+
+static bool _write_json( const char* filename, const bench_result_t* results, int n_results, const bench_noise_result_t* noise_results, int n_noise_results ) {
+  FILE* fptr = fopen( filename, "w" );
+  if ( !fptr ) { return false; }
+  fprintf( fptr, "{\n  \"chunk_dims\": [%i, %i, %i],\n  \"min_seconds_per_case\": %.2f,\n  \"results\": [\n", CHUNK_X, CHUNK_Y, CHUNK_Z, BENCH_MIN_SECONDS );
+  for ( int i = 0; i < n_results; i++ ) {
+    const bench_result_t* r = &results[i];
+    fprintf( fptr,
+      "    { \"world\": \"%s\", \"mode\": \"%s\", \"ms_per_chunk\": %.4f, \"voxels_per_sec\": %.0f, \"vertices\": %zu, \"bytes_per_chunk\": %zu, "
+      "\"peak_arena_bytes\": %zu, \"vertex_hash\": \"%016llx\", \"runs\": %i }%s\n",
+      r->world, r->mode, r->ms_per_chunk, r->voxels_per_sec, r->n_vertices, r->bytes_per_chunk, r->peak_arena_bytes, (unsigned long long)r->vertex_hash,
+      r->n_runs, i < n_results - 1 ? "," : "" );
+  }
+  fprintf( fptr, "  ],\n  \"noise\": [\n" );
+  for ( int i = 0; i < n_noise_results; i++ ) {
+    const bench_noise_result_t* r = &noise_results[i];
+    fprintf( fptr, "    { \"path\": \"%s\", \"ms_per_chunk\": %.4f, \"voxels_per_sec\": %.0f, \"value_hash\": \"%016llx\", \"runs\": %i }%s\n", r->path,
+      r->ms_per_chunk, r->voxels_per_sec, (unsigned long long)r->value_hash, r->n_runs, i < n_noise_results - 1 ? "," : "" );
+  }
+  fprintf( fptr, "  ]\n}\n" );
+  return 0 == fclose( fptr );
+}
+
+int main( int argc, char** argv ) {
+  const bench_world_t worlds[] = {
+    { "flat", _flat_world }, { "diamond_square", _diamond_square_world }, { "noise_caves", _noise_caves_world }, { "checkerboard", _checkerboard_world } };
+  const bench_mode_t modes[] = { { "per_face", CHUNK_MESHER_PER_FACE, 0 }, { "greedy", CHUNK_MESHER_GREEDY, 0 }, { "lod1", CHUNK_MESHER_GREEDY, 1 },
+    { "lod2", CHUNK_MESHER_GREEDY, 2 }, { "lod3", CHUNK_MESHER_GREEDY, 3 } };
+  const int n_worlds = (int)( sizeof( worlds ) / sizeof( worlds[0] ) ), n_modes = (int)( sizeof( modes ) / sizeof( modes[0] ) );
+  bench_result_t* results = calloc( n_worlds * n_modes, sizeof( bench_result_t ) );
+  assert( results );
+
+  int n_results = 0;
+  for ( int w = 0; w < n_worlds; w++ ) {
+    chunk_t chunks[9];
+    worlds[w].generate( chunks );
+    const chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] },
+      .diagonal                                                          = { &chunks[0], &chunks[2], &chunks[6], &chunks[8] } };
+    chunk_t middle = chunk_copy( &chunks[4] );
+    chunk_decompress( &middle );
+    for ( int m = 0; m < n_modes; m++ ) {
+      const bench_result_t* r = &results[n_results];
+      results[n_results++]    = _bench_mode( worlds[w].name, &middle, &neighbours, modes[m] );
+      printf( "%-14s %-8s %8.3f ms/chunk %7.1f Mvoxels/s | %7zu verts %8zu bytes | arena %8zu bytes | hash %016llx\n", r->world, r->mode, r->ms_per_chunk,
+        r->voxels_per_sec / 1e6, r->n_vertices, r->bytes_per_chunk, r->peak_arena_bytes, (unsigned long long)r->vertex_hash );
+    }
+    chunk_free( &middle );
+    for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+  }
+
+  bench_noise_result_t noise_results[NOISE_SIMD_N];
+  int n_noise_results = 0;
+  bool noise_matches  = true;
+  for ( int simd = NOISE_SIMD_SCALAR; simd < NOISE_SIMD_N; simd++ ) {
+    if ( !noise_simd_supported( (noise_simd_t)simd ) ) { continue; }
+    const bench_noise_result_t* r    = &noise_results[n_noise_results];
+    noise_results[n_noise_results++] = _bench_noise( (noise_simd_t)simd );
+    noise_matches                    = noise_matches && r->value_hash == noise_results[0].value_hash;
+    printf( "noise 3d       %-8s %8.3f ms/chunk %7.1f Mvoxels/s | x%.1f scalar | hash %016llx\n", r->path, r->ms_per_chunk, r->voxels_per_sec / 1e6,
+      r->voxels_per_sec / noise_results[0].voxels_per_sec, (unsigned long long)r->value_hash );
+  }
+  if ( !noise_matches ) { fprintf( stderr, "ERROR: noise paths gave different values\n" ); }
+
+  if ( argc > 1 ) {
+    if ( !_write_json( argv[1], results, n_results, noise_results, n_noise_results ) ) {
+      fprintf( stderr, "ERROR: could not write `%s`\n", argv[1] );
+      free( results );
+      return 1;
+    }
+    printf( "wrote `%s`\n", argv[1] );
+  }
+  free( results );
+  return noise_matches ? 0 : 1;
+}
@@ -3,8 +3,16 @@ gcc -Wno-attributes -g -o glew.o -c ..\common\src\GL\glew.c -I ..\common\include
 
 REM Compile main program with strict warnings
 gcc -g -Wfatal-errors -Wall -Wextra -pedantic -DGLEW_STATIC ^
-main.c voxels.c apg_ply.c apg_pixfont.c gl_utils.c input.c camera.c diamond_square.c ^
+main.c voxels.c chunk.c chunk_cache.c chunk_quadtree.c region.c threads.c visibility.c raycast.c light.c noise.c fluid.c mesh_export.c mesh_cache.c range_alloc.c apg_ply.c apg_pixfont.c gl_utils.c input.c camera.c ^
 -I ..\common\include\ -I ..\common\include\stb\ -L ..\common\win64_gcc\ ^
 glew.o ..\common\win64_gcc\libglfw3dll.a ^
--lm -lOpenGL32
-copy ..\common\win64_gcc\glfw3.dll .\
\ No newline at end of file
+-lm -lOpenGL32 -lpthread
+copy ..\common\win64_gcc\glfw3.dll .\
+
+REM headless tests for the CPU chunk code
+gcc -g -Wfatal-errors -Wall -Wextra -pedantic -o voxtests.exe ^
+tests\main.c chunk.c chunk_cache.c chunk_quadtree.c region.c threads.c visibility.c raycast.c light.c noise.c fluid.c mesh_export.c mesh_cache.c range_alloc.c diamond_square.c -I ..\common\include\ -I ..\common\include\stb\ -lm -lpthread
+
+REM headless meshing benchmark. optimised and without sanitisers so that the timings mean something. voxbench.exe results.json
+gcc -O2 -Wfatal-errors -Wall -Wextra -pedantic -o voxbench.exe ^
+bench\main.c chunk.c noise.c diamond_square.c -I ..\common\include\ -I ..\common\include\stb\ -lm
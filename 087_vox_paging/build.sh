@@ -1,4 +1,12 @@
 #!/bin/bash
 clang -fsanitize=address -fsanitize=undefined -Wall -Wextra -Wfatal-errors -pedantic -g \
-main.c voxels.c apg_ply.c apg_pixfont.c camera.c input.c gl_utils.c diamond_square.c \
-../common/src/GL/glew.c -I../common/include/ -I ../common/include/stb/ -lm -lglfw -lGL
+main.c voxels.c chunk.c chunk_cache.c chunk_quadtree.c region.c threads.c visibility.c raycast.c light.c noise.c fluid.c mesh_export.c mesh_cache.c range_alloc.c apg_ply.c apg_pixfont.c camera.c input.c gl_utils.c \
+../common/src/GL/glew.c -I../common/include/ -I ../common/include/stb/ -lm -lglfw -lGL -lpthread
+
+# headless tests for the CPU chunk code
+clang -fsanitize=address -fsanitize=undefined -Wall -Wextra -Wfatal-errors -pedantic -g -o voxtests \
+tests/main.c chunk.c chunk_cache.c chunk_quadtree.c region.c threads.c visibility.c raycast.c light.c noise.c fluid.c mesh_export.c mesh_cache.c range_alloc.c diamond_square.c -I../common/include/ -I ../common/include/stb/ -lm -lpthread
+
+# headless meshing benchmark. optimised and without sanitisers so that the timings mean something. ./voxbench results.json
+clang -O2 -Wall -Wextra -Wfatal-errors -pedantic -o voxbench \
+bench/main.c chunk.c noise.c diamond_square.c -I../common/include/ -I ../common/include/stb/ -lm
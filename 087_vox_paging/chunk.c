@@ -0,0 +1,1446 @@
+#include "chunk.h"
+#include "noise.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// clang-format off
+//                                     x   y   z   x   y   z   x   y   z | x   y   z   x   y   z   x   y   z
+static const float _west_face[]   = { -1,  1, -1, -1, -1, -1, -1,  1,  1, -1,  1,  1, -1, -1, -1, -1, -1,  1 };
+static const float _east_face[]   = {  1,  1,  1,  1, -1,  1,  1,  1, -1,  1,  1, -1,  1, -1,  1,  1, -1, -1 };
+static const float _bottom_face[] = { -1, -1,  1, -1, -1, -1,  1, -1,  1,  1, -1,  1, -1, -1, -1,  1, -1, -1 };
+static const float _top_face[]    = { -1,  1, -1, -1,  1,  1,  1,  1, -1,  1,  1, -1, -1,  1,  1,  1,  1,  1 };
+static const float _north_face[]  = {  1,  1, -1,  1, -1, -1, -1,  1, -1, -1,  1, -1,  1, -1, -1, -1, -1, -1 };
+static const float _south_face[]  = { -1,  1,  1, -1, -1,  1,  1,  1,  1,  1,  1,  1, -1, -1,  1,  1, -1,  1 };
+// per face_idx: axis of the face normal, then the axes that texcoords s and t run along in the tables above. 0=x 1=y 2=z
+static const int _face_axes[6][3] = { { 0, 2, 1 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 0, 2 }, { 2, 0, 1 }, { 2, 0, 1 } };
+/* the order the vertices of the tables above are emitted in, with the same winding. 2 and 3 are both the texcoord (1,1) corner, so this puts it last in
+both triangles, where flat attributes come from. see VOXEL_QUAD_AO_EDGES_SHIFT */
+static const int _face_vert_order[6] = { 0, 1, 2, 4, 5, 3 };
+// clang-format on
+
+static const int palette_grass = 0;
+static const int palette_stone = 1;
+static const int palette_dirt  = 2;
+static const int palette_crust = 3;
+static const int palette_lamp  = 4;
+static const int palette_ore   = 5;
+static const int palette_water = 6;
+static const int palette_lava  = 7;
+
+// largest slice of faces the greedy mesher works on at once. assumes CHUNK_Y is the tallest dimension
+#define GREEDY_MASK_MAX ( CHUNK_Y * ( CHUNK_X > CHUNK_Z ? CHUNK_X : CHUNK_Z ) )
+// greedy mask keys are 1 + palette index, with the packed light of the face above that. ambient occlusion is kept apart from the key - see _greedy_sweep()
+#define GREEDY_MASK_LIGHT_SHIFT 8
+// ambient occlusion of a face with every corner open
+#define FACE_AO_OPEN 0xFF
+
+bool set_block_type_in_chunk( chunk_t* chunk, int x, int y, int z, block_type_t type ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) );
+
+  bool changed = false;
+
+  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return changed; }
+
+  int idx = CHUNK_X * CHUNK_Z * y + CHUNK_X * z + x;
+
+  block_type_t prev_type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, x, y, z, &prev_type );
+  if ( prev_type == type ) { return changed; } // no change!
+  chunk_decompress( chunk );                   // edits go to a plain working copy
+  chunk->stays_plain = false;
+  if ( prev_type == BLOCK_TYPE_AIR && type != BLOCK_TYPE_AIR ) { chunk->n_non_air_voxels++; }
+  if ( prev_type != BLOCK_TYPE_AIR && type == BLOCK_TYPE_AIR ) {
+    assert( chunk->n_non_air_voxels > 0 );
+    chunk->n_non_air_voxels--;
+  }
+  chunk->voxels[idx].type = type;
+
+  int prev_height = chunk->heightmap[CHUNK_X * z + x];
+  if ( y > prev_height && type != BLOCK_TYPE_AIR ) { // higher than before
+    chunk->heightmap[CHUNK_X * z + x] = y;
+  } else if ( y == prev_height && type == BLOCK_TYPE_AIR ) { // lowering
+    for ( int yy = y; yy >= 0; yy-- ) {
+      int idx = CHUNK_X * CHUNK_Z * yy + CHUNK_X * z + x;
+      if ( chunk->voxels[idx].type != BLOCK_TYPE_AIR ) {
+        chunk->heightmap[CHUNK_X * z + x] = yy;
+        break;
+      }
+    }
+  }
+
+  assert( chunk->n_non_air_voxels <= CHUNK_X * CHUNK_Y * CHUNK_Z );
+
+  changed = true;
+  return changed;
+}
+
+int block_type_light_emission( block_type_t type ) {
+  if ( BLOCK_TYPE_LAMP == type ) { return VOXEL_LIGHT_MAX; }
+  // lava glows a little dimmer than a lamp, flowing or not
+  if ( BLOCK_TYPE_LAVA == type || BLOCK_TYPE_LAVA_FLOWING == type ) { return VOXEL_LIGHT_MAX - 2; }
+  return 0;
+}
+
+uint8_t chunk_get_light( const chunk_t* chunk, int x, int y, int z ) {
+  assert( chunk );
+  assert( x >= 0 && x < CHUNK_X && y >= 0 && y < CHUNK_Y && z >= 0 && z < CHUNK_Z );
+
+  const int section = y / CHUNK_SECTION_Y;
+  if ( !chunk->light[section] ) { return chunk->light_fill[section]; }
+  return chunk->light[section][CHUNK_X * CHUNK_Z * ( y - section * CHUNK_SECTION_Y ) + CHUNK_X * z + x];
+}
+
+bool chunk_set_light( chunk_t* chunk, int x, int y, int z, uint8_t light ) {
+  assert( chunk );
+  assert( x >= 0 && x < CHUNK_X && y >= 0 && y < CHUNK_Y && z >= 0 && z < CHUNK_Z );
+
+  const int section = y / CHUNK_SECTION_Y;
+  if ( !chunk->light[section] ) {
+    if ( chunk->light_fill[section] == light ) { return false; }
+    chunk->light[section] = malloc( CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+    assert( chunk->light[section] );
+    memset( chunk->light[section], chunk->light_fill[section], CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+  }
+  uint8_t* voxel_light = &chunk->light[section][CHUNK_X * CHUNK_Z * ( y - section * CHUNK_SECTION_Y ) + CHUNK_X * z + x];
+  if ( *voxel_light == light ) { return false; }
+  *voxel_light = light;
+  return true;
+}
+
+uint8_t chunk_get_fluid_level( const chunk_t* chunk, int x, int y, int z ) {
+  assert( chunk );
+  assert( x >= 0 && x < CHUNK_X && y >= 0 && y < CHUNK_Y && z >= 0 && z < CHUNK_Z );
+
+  const int section = y / CHUNK_SECTION_Y;
+  if ( !chunk->fluid_levels[section] ) { return 0; }
+  return chunk->fluid_levels[section][CHUNK_X * CHUNK_Z * ( y - section * CHUNK_SECTION_Y ) + CHUNK_X * z + x];
+}
+
+bool chunk_set_fluid_level( chunk_t* chunk, int x, int y, int z, uint8_t level ) {
+  assert( chunk );
+  assert( x >= 0 && x < CHUNK_X && y >= 0 && y < CHUNK_Y && z >= 0 && z < CHUNK_Z );
+
+  const int section = y / CHUNK_SECTION_Y;
+  if ( !chunk->fluid_levels[section] ) {
+    if ( 0 == level ) { return false; }
+    chunk->fluid_levels[section] = calloc( CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y, 1 );
+    assert( chunk->fluid_levels[section] );
+  }
+  uint8_t* voxel_level = &chunk->fluid_levels[section][CHUNK_X * CHUNK_Z * ( y - section * CHUNK_SECTION_Y ) + CHUNK_X * z + x];
+  if ( *voxel_level == level ) { return false; }
+  chunk->n_fluid_levels[section] += ( 0 != level ) - ( 0 != *voxel_level );
+  *voxel_level = level;
+  // fluid drains away, and sections it left shouldn't keep an array of 0s
+  if ( 0 == chunk->n_fluid_levels[section] ) {
+    free( chunk->fluid_levels[section] );
+    chunk->fluid_levels[section] = NULL;
+  }
+  return true;
+}
+
+void chunk_init_sky_light( chunk_t* chunk ) {
+  assert( chunk );
+
+  const uint8_t sky = VOXEL_LIGHT_PACK( VOXEL_LIGHT_MAX, 0 );
+  int min_height = CHUNK_Y, max_height = -1;
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+    min_height = chunk->heightmap[column] < min_height ? chunk->heightmap[column] : min_height;
+    max_height = chunk->heightmap[column] > max_height ? chunk->heightmap[column] : max_height;
+  }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    free( chunk->light[section] );
+    chunk->light[section] = NULL;
+    const int section_y   = section * CHUNK_SECTION_Y;
+    // most sections are wholly above or below the surface and don't need an array
+    if ( max_height < section_y ) {
+      chunk->light_fill[section] = sky;
+      continue;
+    }
+    chunk->light_fill[section] = 0;
+    if ( min_height >= section_y + CHUNK_SECTION_Y - 1 ) { continue; }
+    for ( int y = section_y; y < section_y + CHUNK_SECTION_Y; y++ ) {
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) {
+          if ( y > chunk->heightmap[CHUNK_X * z + x] ) { chunk_set_light( chunk, x, y, z, sky ); }
+        }
+      }
+    }
+  }
+}
+
+bool get_block_type_in_chunk( const chunk_t* chunk, int x, int y, int z, block_type_t* block_type ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) && block_type );
+  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return false; }
+
+  if ( chunk->rle ) {
+    // walk up the column's runs. terrain columns are only a handful of runs
+    const chunk_rle_t* rle = chunk->rle;
+    const int column       = CHUNK_X * z + x;
+    int run_top            = 0;
+    for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+      run_top += ( rle->runs[r] & 0xFF ) + 1;
+      if ( y < run_top ) {
+        *block_type = rle->palette[rle->runs[r] >> 8];
+        return true;
+      }
+    }
+    assert( false && "RLE column shorter than CHUNK_Y" );
+    return false;
+  }
+
+  int idx     = CHUNK_X * CHUNK_Z * y + CHUNK_X * z + x;
+  *block_type = chunk->voxels[idx].type;
+  return true;
+}
+
+bool is_voxel_above_surface( const chunk_t* chunk, int x, int y, int z ) {
+  assert( chunk );
+  // edges of chunk will be lit by sunlight
+  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return true; }
+
+  int idx    = CHUNK_X * z + x;
+  int height = chunk->heightmap[idx];
+  if ( y > height ) { return true; }
+  return false;
+}
+
+bool is_voxel_face_exposed_to_sun( const chunk_t* chunk, int x, int y, int z, int face_idx ) {
+  assert( chunk );
+
+  switch ( face_idx ) {
+  case 0: return is_voxel_above_surface( chunk, x - 1, y, z );
+  case 1: return is_voxel_above_surface( chunk, x + 1, y, z );
+  case 2: return is_voxel_above_surface( chunk, x, y - 1, z );
+  case 3: return is_voxel_above_surface( chunk, x, y + 1, z );
+  case 4: return is_voxel_above_surface( chunk, x, y, z - 1 );
+  case 5: return is_voxel_above_surface( chunk, x, y, z + 1 );
+  default: assert( false ); break;
+  }
+  return false;
+}
+
+uint32_t chunk_sections_changed_by_edit( int y, int prev_height, int new_height ) {
+  assert( y >= 0 && y < CHUNK_Y );
+
+  int lo = y - 1, hi = y + 1;
+  if ( prev_height != new_height ) {
+    // air voxels in ( min height, max height ] changed sunlight. their faces belong to the voxels from one below to one above
+    const int min_height = prev_height < new_height ? prev_height : new_height;
+    const int max_height = prev_height > new_height ? prev_height : new_height;
+    lo                   = min_height < lo ? min_height : lo;
+    hi                   = max_height + 1 > hi ? max_height + 1 : hi;
+  }
+  lo = lo < 0 ? 0 : lo;
+  hi = hi > CHUNK_Y - 1 ? CHUNK_Y - 1 : hi;
+
+  uint32_t mask = 0;
+  for ( int section = lo / CHUNK_SECTION_Y; section <= hi / CHUNK_SECTION_Y; section++ ) { mask |= 1u << section; }
+  return mask;
+}
+
+// bit of the connectivity mask for faces a,b. pairs are numbered 0-14 in order (0,1),(0,2)..(0,5),(1,2)..(4,5)
+static int _face_pair_bit( int face_a, int face_b ) {
+  assert( face_a != face_b && face_a >= 0 && face_a < 6 && face_b >= 0 && face_b < 6 );
+  const int lo = face_a < face_b ? face_a : face_b;
+  const int hi = face_a < face_b ? face_b : face_a;
+  return lo * ( 11 - lo ) / 2 + hi - lo - 1;
+}
+
+bool chunk_section_faces_connected( uint16_t connectivity, int face_a, int face_b ) {
+  if ( face_a == face_b ) { return false; }
+  return ( connectivity >> _face_pair_bit( face_a, face_b ) ) & 1;
+}
+
+uint16_t chunk_section_connectivity( const chunk_t* chunk, int section ) {
+  assert( chunk && section >= 0 && section < CHUNK_SECTIONS );
+  if ( 0 == chunk->n_non_air_voxels ) { return CHUNK_SECTION_ALL_CONNECTED; }
+
+  // section voxels indexed x, then z, then y. visited is true for solid voxels and air already flooded
+#define SECTION_VOXELS ( CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y )
+  bool visited[SECTION_VOXELS];
+  uint16_t stack[SECTION_VOXELS];
+  const int from_y = section * CHUNK_SECTION_Y;
+  int n_air        = 0;
+  for ( int i = 0; i < SECTION_VOXELS; i++ ) {
+    block_type_t block_type = BLOCK_TYPE_AIR;
+    get_block_type_in_chunk( chunk, i % CHUNK_X, from_y + i / ( CHUNK_X * CHUNK_Z ), ( i / CHUNK_X ) % CHUNK_Z, &block_type );
+    visited[i] = BLOCK_TYPE_AIR != block_type;
+    n_air += !visited[i];
+  }
+  if ( 0 == n_air ) { return 0; }
+  if ( SECTION_VOXELS == n_air ) { return CHUNK_SECTION_ALL_CONNECTED; }
+
+  // flood fill each pocket of air and connect every pair of faces it touches
+  uint16_t connectivity = 0;
+  for ( int seed = 0; seed < SECTION_VOXELS && connectivity != CHUNK_SECTION_ALL_CONNECTED; seed++ ) {
+    if ( visited[seed] ) { continue; }
+    int n_stack        = 0;
+    uint32_t face_mask = 0;
+    stack[n_stack++]   = (uint16_t)seed;
+    visited[seed]      = true;
+    while ( n_stack > 0 ) {
+      const int i = stack[--n_stack];
+      const int x = i % CHUNK_X, z = ( i / CHUNK_X ) % CHUNK_Z, y = i / ( CHUNK_X * CHUNK_Z );
+      face_mask |= ( 0 == x ) << 0 | ( CHUNK_X - 1 == x ) << 1 | ( 0 == y ) << 2 | ( CHUNK_SECTION_Y - 1 == y ) << 3 | ( 0 == z ) << 4 | ( CHUNK_Z - 1 == z ) << 5;
+      const int neighbours[6] = { x > 0 ? i - 1 : -1, x < CHUNK_X - 1 ? i + 1 : -1, y > 0 ? i - CHUNK_X * CHUNK_Z : -1,
+        y < CHUNK_SECTION_Y - 1 ? i + CHUNK_X * CHUNK_Z : -1, z > 0 ? i - CHUNK_X : -1, z < CHUNK_Z - 1 ? i + CHUNK_X : -1 };
+      for ( int n = 0; n < 6; n++ ) {
+        if ( neighbours[n] < 0 || visited[neighbours[n]] ) { continue; }
+        visited[neighbours[n]] = true;
+        stack[n_stack++]       = (uint16_t)neighbours[n];
+      }
+    }
+    for ( int a = 0; a < 6; a++ ) {
+      for ( int b = a + 1; b < 6; b++ ) {
+        if ( ( face_mask >> a & 1 ) && ( face_mask >> b & 1 ) ) { connectivity |= 1u << _face_pair_bit( a, b ); }
+      }
+    }
+  }
+#undef SECTION_VOXELS
+  return connectivity;
+}
+
+// grass on top, a layer of dirt, stone, then crust at the bottom of the world
+static void _generate_column( chunk_t* chunk, int x, int z, int height ) {
+  set_block_type_in_chunk( chunk, x, height, z, BLOCK_TYPE_GRASS );
+  set_block_type_in_chunk( chunk, x, height - 1, z, BLOCK_TYPE_DIRT );
+  for ( int y = height - 2; y > 0; y-- ) { set_block_type_in_chunk( chunk, x, y, z, BLOCK_TYPE_STONE ); }
+  set_block_type_in_chunk( chunk, x, 0, z, BLOCK_TYPE_CRUST );
+}
+
+static chunk_t _alloc_chunk() {
+  chunk_t chunk;
+  memset( &chunk, 0, sizeof( chunk_t ) );
+  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
+  assert( chunk.voxels );
+  return chunk;
+}
+
+chunk_t chunk_generate_from_heightmap( const uint8_t* heightmap, int hm_dims, int x_offset, int z_offset ) {
+  assert( heightmap );
+
+  chunk_t chunk = _alloc_chunk();
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      int xx                       = x_offset + x;
+      int zz                       = z_offset + z;
+      int idx                      = hm_dims * zz + xx; // uses offsets and width/height of map
+      const int underground_height = 16;
+      const int heightmap_sample   = heightmap[idx]; // uint8_t to int to avoid overflow when adding a hm sample of 255 to underground height > 0
+
+      uint8_t height = CLAMP( heightmap_sample + underground_height, 1, CHUNK_Y - 1 ); // -1 because chunk_y is 256 which would wrap around to 0 in a uint8
+      _generate_column( &chunk, x, z, height );
+    } // x
+  }   // z
+  chunk_init_sky_light( &chunk );
+
+  return chunk;
+}
+
+int chunk_generate_height( uint32_t seed, int x, int z ) {
+  // rolling hills with lattice points 128 voxels apart, and detail down to 4 voxels
+  const int sea_level = 80, hill_height = 96, spacing = 128, n_octaves = 6;
+  const float noise   = noise_fbm2( seed, x, z, spacing, n_octaves );
+  return CLAMP( sea_level + (int)floorf( noise * hill_height ), 1, CHUNK_Y - 1 );
+}
+
+/* tunnels are where two gradient noises are both near 0. each is near 0 on a wavy sheet, and two sheets cross along a wavy line.
+ore is in blobs where a finer noise is high, and only replaces stone. a row of a chunk at a time, which is what noise_gradient3_row() samples */
+static void _generate_caves( chunk_t* chunk, uint32_t seed, int cx, int cz ) {
+  const int tunnel_spacing  = 48, ore_spacing = 5;
+  const float tunnel_radius = 0.06f, ore_threshold = 0.42f;
+  const noise_simd_t simd   = noise_simd_best();
+  const uint32_t seed_a     = noise_hash2( seed, 1, 0 ), seed_b = noise_hash2( seed, 2, 0 ), seed_ore = noise_hash2( seed, 3, 0 );
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    int top_y = 0;
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      const int cave_top_y = chunk->heightmap[CHUNK_X * z + x] - CHUNK_CAVE_ROOF;
+      top_y                = cave_top_y > top_y ? cave_top_y : top_y;
+    }
+    for ( int y = CHUNK_CAVE_FLOOR; y <= top_y; y++ ) {
+      float a[NOISE_ROW_W], b[NOISE_ROW_W], ore[NOISE_ROW_W];
+      noise_gradient3_row( simd, seed_a, cx * CHUNK_X, y, cz * CHUNK_Z + z, tunnel_spacing, a );
+      noise_gradient3_row( simd, seed_b, cx * CHUNK_X, y, cz * CHUNK_Z + z, tunnel_spacing, b );
+      noise_gradient3_row( simd, seed_ore, cx * CHUNK_X, y, cz * CHUNK_Z + z, ore_spacing, ore );
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        if ( y > chunk->heightmap[CHUNK_X * z + x] - CHUNK_CAVE_ROOF ) { continue; }
+        if ( fabsf( a[x] ) < tunnel_radius && fabsf( b[x] ) < tunnel_radius ) {
+          set_block_type_in_chunk( chunk, x, y, z, BLOCK_TYPE_AIR );
+        } else if ( ore[x] > ore_threshold ) {
+          set_block_type_in_chunk( chunk, x, y, z, BLOCK_TYPE_ORE );
+        }
+      }
+    }
+  }
+}
+
+chunk_t chunk_generate( uint32_t seed, int cx, int cz ) {
+  chunk_t chunk = _alloc_chunk();
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) { _generate_column( &chunk, x, z, chunk_generate_height( seed, cx * CHUNK_X + x, cz * CHUNK_Z + z ) ); }
+  }
+  _generate_caves( &chunk, seed, cx, cz );
+  chunk_init_sky_light( &chunk );
+
+  return chunk;
+}
+
+#if 0
+static chunk_t _chunk_generate_flat() {
+  chunk_t chunk;
+
+  memset( &chunk, 0, sizeof( chunk_t ) );
+  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
+  assert( chunk.voxels );
+
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      uint8_t height = 0;
+      set_block_type_in_chunk( &chunk, x, height, z, BLOCK_TYPE_CRUST );
+    } // x
+  }   // z
+
+  return chunk;
+}
+
+// NOTE(Anton) needs apg_tga.h
+static bool chunk_write_heightmap( const char* filename, const chunk_t* chunk ) {
+  assert( filename && chunk && chunk->voxels );
+  uint8_t* img = malloc( CHUNK_X * CHUNK_Z * 3 );
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      img[( CHUNK_X * z + x ) * 3] = img[( CHUNK_X * z + x ) * 3 + 1] = img[( CHUNK_X * z + x ) * 3 + 2] = chunk->heightmap[CHUNK_X * z + x];
+    }
+  }
+  bool result = (bool)apg_tga_write_file( filename, img, CHUNK_X, CHUNK_Z, 3 );
+  free( img );
+  return result;
+}
+#endif
+
+void chunk_free( chunk_t* chunk ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) );
+
+  free( chunk->voxels );
+  if ( chunk->rle ) { free( chunk->rle->runs ); }
+  free( chunk->rle );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    free( chunk->light[section] );
+    free( chunk->fluid_levels[section] );
+  }
+  memset( chunk, 0, sizeof( chunk_t ) );
+}
+
+chunk_t chunk_copy( const chunk_t* chunk ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) );
+
+  chunk_t copy = *chunk;
+  if ( chunk->voxels ) {
+    copy.voxels = malloc( CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) );
+    assert( copy.voxels );
+    memcpy( copy.voxels, chunk->voxels, CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) );
+  }
+  if ( chunk->rle ) {
+    copy.rle = malloc( sizeof( chunk_rle_t ) );
+    assert( copy.rle );
+    *copy.rle      = *chunk->rle;
+    copy.rle->runs = malloc( chunk->rle->n_runs * sizeof( uint16_t ) );
+    assert( copy.rle->runs );
+    memcpy( copy.rle->runs, chunk->rle->runs, chunk->rle->n_runs * sizeof( uint16_t ) );
+  }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    if ( chunk->light[section] ) {
+      copy.light[section] = malloc( CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+      assert( copy.light[section] );
+      memcpy( copy.light[section], chunk->light[section], CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+    }
+    if ( chunk->fluid_levels[section] ) {
+      copy.fluid_levels[section] = malloc( CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+      assert( copy.fluid_levels[section] );
+      memcpy( copy.fluid_levels[section], chunk->fluid_levels[section], CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+    }
+  }
+  return copy;
+}
+
+chunk_t chunk_copy_columns( const chunk_t* chunk, int min_x, int min_z, int max_x, int max_z ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) );
+  assert( min_x >= 0 && min_x <= max_x && max_x < CHUNK_X && min_z >= 0 && min_z <= max_z && max_z < CHUNK_Z );
+
+  chunk_t copy = _alloc_chunk();
+  for ( int z = min_z; z <= max_z; z++ ) {
+    for ( int x = min_x; x <= max_x; x++ ) {
+      for ( int y = 0; y < CHUNK_Y; y++ ) {
+        block_type_t type = BLOCK_TYPE_AIR;
+        get_block_type_in_chunk( chunk, x, y, z, &type );
+        if ( BLOCK_TYPE_AIR != type ) { set_block_type_in_chunk( &copy, x, y, z, type ); }
+      }
+    }
+  }
+  chunk_compress( &copy );
+
+  // a section whose copied columns all have one light level is just a fill. only the others get an array
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const int y0       = section * CHUNK_SECTION_Y;
+    const uint8_t fill = chunk_get_light( chunk, min_x, y0, min_z );
+    copy.light_fill[section] = fill;
+    if ( !chunk->light[section] ) { continue; }
+    for ( int y = y0; y < y0 + CHUNK_SECTION_Y; y++ ) {
+      for ( int z = min_z; z <= max_z; z++ ) {
+        for ( int x = min_x; x <= max_x; x++ ) { chunk_set_light( &copy, x, y, z, chunk_get_light( chunk, x, y, z ) ); }
+      }
+    }
+  }
+  return copy;
+}
+
+static chunk_rle_t* _rle_from_voxels( const voxel_t* voxels ) {
+  chunk_rle_t* rle = calloc( 1, sizeof( chunk_rle_t ) );
+  assert( rle );
+  int palidx_for_type[256];
+  for ( int i = 0; i < 256; i++ ) { palidx_for_type[i] = -1; }
+
+  // first pass counts runs and builds the palette, so that the runs array is allocated at its exact size
+  for ( int pass = 0; pass < 2; pass++ ) {
+    uint32_t n_runs = 0;
+    for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+      rle->column_starts[column] = n_runs;
+      for ( int y = 0; y < CHUNK_Y; ) {
+        const uint8_t type = voxels[CHUNK_X * CHUNK_Z * y + column].type;
+        int run_len        = 1;
+        while ( y + run_len < CHUNK_Y && run_len < 256 && voxels[CHUNK_X * CHUNK_Z * ( y + run_len ) + column].type == type ) { run_len++; }
+        if ( palidx_for_type[type] < 0 ) {
+          palidx_for_type[type]          = (int)rle->n_palette;
+          rle->palette[rle->n_palette++] = type;
+        }
+        if ( 1 == pass ) { rle->runs[n_runs] = (uint16_t)( palidx_for_type[type] << 8 | ( run_len - 1 ) ); }
+        n_runs++;
+        y += run_len;
+      }
+    }
+    rle->column_starts[CHUNK_X * CHUNK_Z] = n_runs;
+    if ( 0 == pass ) {
+      rle->n_runs = n_runs;
+      rle->runs   = malloc( n_runs * sizeof( uint16_t ) );
+      assert( rle->runs );
+    }
+  }
+  return rle;
+}
+
+static size_t _rle_bytes( const chunk_rle_t* rle ) { return sizeof( chunk_rle_t ) + rle->n_runs * sizeof( uint16_t ); }
+
+static void _rle_free( chunk_rle_t* rle ) {
+  free( rle->runs );
+  free( rle );
+}
+
+void chunk_compress( chunk_t* chunk ) {
+  assert( chunk );
+  if ( !chunk->voxels || chunk->stays_plain ) { return; }
+
+  chunk_rle_t* rle = _rle_from_voxels( chunk->voxels );
+  // a chunk that changes type every few voxels up each column is more runs than voxels. it's left as it is
+  if ( _rle_bytes( rle ) >= CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) ) {
+    _rle_free( rle );
+    chunk->stays_plain = true;
+    return;
+  }
+  chunk->rle = rle;
+  free( chunk->voxels );
+  chunk->voxels = NULL;
+}
+
+void chunk_decompress( chunk_t* chunk ) {
+  assert( chunk );
+  if ( !chunk->rle ) { return; }
+
+  const chunk_rle_t* rle = chunk->rle;
+  chunk->voxels          = malloc( CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) );
+  assert( chunk->voxels );
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+    int y = 0;
+    for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+      const uint8_t type = rle->palette[rle->runs[r] >> 8];
+      const int run_top  = y + ( rle->runs[r] & 0xFF ) + 1;
+      for ( ; y < run_top; y++ ) { chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type = type; }
+    }
+    assert( CHUNK_Y == y );
+  }
+  _rle_free( chunk->rle );
+  chunk->rle = NULL;
+}
+
+size_t chunk_resident_bytes( const chunk_t* chunk ) {
+  assert( chunk );
+
+  size_t n_bytes = sizeof( chunk_t );
+  if ( chunk->voxels ) { n_bytes += CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ); }
+  if ( chunk->rle ) { n_bytes += _rle_bytes( chunk->rle ); }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    if ( chunk->light[section] ) { n_bytes += CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y; }
+    if ( chunk->fluid_levels[section] ) { n_bytes += CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y; }
+  }
+  return n_bytes;
+}
+
+// bits per voxel of the bit-packed form for a palette this big. powers of 2 so that no index straddles a byte
+static int _packed_bits( uint32_t n_palette ) {
+  int bits = 1;
+  while ( ( 1u << bits ) < n_palette ) { bits *= 2; }
+  return bits;
+}
+
+size_t chunk_save_to_mem( const chunk_t* chunk, uint8_t* dest, size_t dest_sz ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) && dest );
+
+  chunk_rle_t* tmp_rle   = chunk->rle ? NULL : _rle_from_voxels( chunk->voxels );
+  const chunk_rle_t* rle = chunk->rle ? chunk->rle : tmp_rle;
+
+  // whichever form is smaller. the palette is the same for both
+  const uint16_t n_palette = (uint16_t)rle->n_palette;
+  const int bits           = _packed_bits( n_palette );
+  const size_t rle_bytes   = sizeof( uint16_t ) + n_palette + sizeof( uint32_t ) + rle->n_runs * sizeof( uint16_t );
+  const size_t bits_bytes  = sizeof( uint16_t ) + n_palette + CHUNK_X * CHUNK_Y * CHUNK_Z * bits / 8;
+  const bool packed        = bits_bytes < rle_bytes;
+  const size_t n_bytes     = packed ? bits_bytes : rle_bytes;
+  if ( dest_sz >= n_bytes ) {
+    uint8_t* ptr          = dest;
+    const uint16_t header = n_palette | ( packed ? CHUNK_SAVE_PACKED_FLAG : 0 );
+    memcpy( ptr, &header, sizeof( uint16_t ) );
+    ptr += sizeof( uint16_t );
+    memcpy( ptr, rle->palette, n_palette );
+    ptr += n_palette;
+    if ( packed ) {
+      // each voxel's palette index, voxels in the same order as the voxels array, low bits first
+      int palidx_for_type[256] = { 0 };
+      for ( uint32_t i = 0; i < rle->n_palette; i++ ) { palidx_for_type[rle->palette[i]] = (int)i; }
+      memset( ptr, 0, CHUNK_X * CHUNK_Y * CHUNK_Z * bits / 8 );
+      for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+        int y = 0;
+        for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+          const uint8_t palidx = (uint8_t)palidx_for_type[rle->palette[rle->runs[r] >> 8]];
+          for ( const int run_top = y + ( rle->runs[r] & 0xFF ) + 1; y < run_top; y++ ) {
+            const int bit = ( CHUNK_X * CHUNK_Z * y + column ) * bits;
+            ptr[bit / 8] |= (uint8_t)( palidx << ( bit % 8 ) );
+          }
+        }
+      }
+    } else {
+      memcpy( ptr, &rle->n_runs, sizeof( uint32_t ) );
+      ptr += sizeof( uint32_t );
+      memcpy( ptr, rle->runs, rle->n_runs * sizeof( uint16_t ) );
+    }
+  }
+
+  if ( tmp_rle ) { _rle_free( tmp_rle ); }
+  return dest_sz >= n_bytes ? n_bytes : 0;
+}
+
+/* the bit-packed form after its palette. unpacks it into a voxels array then compresses that, so the chunk comes out in the smaller form
+RETURNS false if it's the wrong size or an index is past the palette */
+static bool _load_packed( const uint8_t* ptr, size_t n_bytes, const uint8_t* palette, uint32_t n_palette, chunk_t* chunk ) {
+  const int bits = _packed_bits( n_palette );
+  if ( n_bytes != (size_t)CHUNK_X * CHUNK_Y * CHUNK_Z * bits / 8 ) { return false; }
+
+  chunk->voxels = malloc( CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) );
+  assert( chunk->voxels );
+  const uint32_t mask = ( 1u << bits ) - 1;
+  for ( int i = 0; i < CHUNK_X * CHUNK_Y * CHUNK_Z; i++ ) {
+    const uint32_t palidx = ( ptr[i * bits / 8] >> ( i * bits % 8 ) ) & mask;
+    if ( palidx >= n_palette ) {
+      free( chunk->voxels );
+      memset( chunk, 0, sizeof( chunk_t ) );
+      return false;
+    }
+    chunk->voxels[i].type = palette[palidx];
+  }
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+    for ( int y = 0; y < CHUNK_Y; y++ ) {
+      if ( BLOCK_TYPE_AIR == chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type ) { continue; }
+      chunk->heightmap[column] = y;
+      chunk->n_non_air_voxels++;
+    }
+  }
+  chunk_compress( chunk );
+  chunk_init_sky_light( chunk );
+  return true;
+}
+
+bool chunk_load_from_mem( const uint8_t* src, size_t n_bytes, chunk_t* chunk ) {
+  assert( src && chunk );
+
+  memset( chunk, 0, sizeof( chunk_t ) );
+  const uint8_t* ptr = src;
+  const uint8_t* end = src + n_bytes;
+
+  uint16_t header = 0;
+  if ( end - ptr < (ptrdiff_t)sizeof( uint16_t ) ) { return false; }
+  memcpy( &header, ptr, sizeof( uint16_t ) );
+  ptr += sizeof( uint16_t );
+  const uint16_t n_palette = header & ~CHUNK_SAVE_PACKED_FLAG;
+  if ( 0 == n_palette || n_palette > 256 || end - ptr < n_palette ) { return false; }
+  uint8_t palette[256];
+  memcpy( palette, ptr, n_palette );
+  ptr += n_palette;
+  for ( int i = 0; i < n_palette; i++ ) {
+    if ( palette[i] >= BLOCK_TYPE_N ) { return false; }
+  }
+  if ( header & CHUNK_SAVE_PACKED_FLAG ) { return _load_packed( ptr, (size_t)( end - ptr ), palette, n_palette, chunk ); }
+
+  uint32_t n_runs = 0;
+  if ( end - ptr < (ptrdiff_t)sizeof( uint32_t ) ) { return false; }
+  memcpy( &n_runs, ptr, sizeof( uint32_t ) );
+  ptr += sizeof( uint32_t );
+  // every column is at least one run
+  if ( n_runs < CHUNK_X * CHUNK_Z || n_runs > CHUNK_X * CHUNK_Y * CHUNK_Z || (size_t)( end - ptr ) != n_runs * sizeof( uint16_t ) ) { return false; }
+
+  chunk_rle_t* rle = calloc( 1, sizeof( chunk_rle_t ) );
+  assert( rle );
+  memcpy( rle->palette, palette, n_palette );
+  rle->n_palette = n_palette;
+  rle->n_runs    = n_runs;
+  rle->runs      = malloc( n_runs * sizeof( uint16_t ) );
+  assert( rle->runs );
+  memcpy( rle->runs, ptr, n_runs * sizeof( uint16_t ) );
+
+  // columns are implicit in the file. rebuild their starts, the heightmap, and the non-air count while checking every column is CHUNK_Y tall
+  uint32_t r = 0;
+  bool valid = true;
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z && valid; column++ ) {
+    rle->column_starts[column] = r;
+    int y                      = 0;
+    while ( y < CHUNK_Y && r < n_runs && valid ) {
+      const uint16_t run = rle->runs[r++];
+      const int run_len  = ( run & 0xFF ) + 1;
+      valid              = ( run >> 8 ) < n_palette;
+      if ( valid && palette[run >> 8] != BLOCK_TYPE_AIR ) {
+        chunk->heightmap[column] = y + run_len - 1;
+        chunk->n_non_air_voxels += run_len;
+      }
+      y += run_len;
+    }
+    valid = valid && CHUNK_Y == y;
+  }
+  rle->column_starts[CHUNK_X * CHUNK_Z] = r;
+  if ( !valid || r != n_runs ) {
+    _rle_free( rle );
+    memset( chunk, 0, sizeof( chunk_t ) );
+    return false;
+  }
+
+  chunk->rle = rle;
+  // runs smaller on disk than bit-packed can still take more memory than the voxels array, with a big palette
+  if ( _rle_bytes( rle ) >= CHUNK_X * CHUNK_Y * CHUNK_Z * sizeof( voxel_t ) ) { chunk_decompress( chunk ); }
+  chunk_init_sky_light( chunk );
+  return true;
+}
+
+static uint32_t _palidx_for_block_type( block_type_t block_type ) {
+  uint32_t palidx = 0;
+  switch ( block_type ) {
+  case BLOCK_TYPE_CRUST: {
+    palidx = palette_crust;
+  } break;
+  case BLOCK_TYPE_GRASS: {
+    palidx = palette_grass;
+  } break;
+  case BLOCK_TYPE_DIRT: {
+    palidx = palette_dirt;
+  } break;
+  case BLOCK_TYPE_STONE: {
+    palidx = palette_stone;
+  } break;
+  case BLOCK_TYPE_LAMP: {
+    palidx = palette_lamp;
+  } break;
+  case BLOCK_TYPE_ORE: {
+    palidx = palette_ore;
+  } break;
+  case BLOCK_TYPE_WATER:
+  case BLOCK_TYPE_WATER_FLOWING: {
+    palidx = palette_water;
+  } break;
+  case BLOCK_TYPE_LAVA:
+  case BLOCK_TYPE_LAVA_FLOWING: {
+    palidx = palette_lava;
+  } break;
+  default: {
+    assert( false );
+  } break;
+  }
+  return palidx;
+}
+
+void voxel_vertex_pack( voxel_vertex_t vertex, uint32_t* dest ) {
+  assert( dest );
+  assert( vertex.x >= 0 && vertex.x <= CHUNK_X && vertex.y >= 0 && vertex.y <= CHUNK_Y && vertex.z >= 0 && vertex.z <= CHUNK_Z );
+  assert( vertex.face_idx >= 0 && vertex.face_idx < 6 && vertex.palidx <= VOXEL_VPACKED_PALIDX_MASK );
+  assert( vertex.s >= 0 && vertex.s <= VOXEL_VPACKED_S_MASK && vertex.t >= 0 && vertex.t <= VOXEL_VPACKED_T_MASK );
+  assert( vertex.sky_light >= 0 && vertex.sky_light <= VOXEL_LIGHT_MAX && vertex.block_light >= 0 && vertex.block_light <= VOXEL_LIGHT_MAX );
+  assert( vertex.quad_ao <= VOXEL_VPACKED_QUAD_AO_MASK );
+
+  dest[0] = (uint32_t)vertex.x << VOXEL_VPACKED_X_SHIFT | (uint32_t)vertex.y << VOXEL_VPACKED_Y_SHIFT | (uint32_t)vertex.z << VOXEL_VPACKED_Z_SHIFT |
+            (uint32_t)vertex.s << VOXEL_VPACKED_S_SHIFT | (uint32_t)vertex.sky_light << VOXEL_VPACKED_SKY_LIGHT_SHIFT |
+            (uint32_t)vertex.block_light << VOXEL_VPACKED_BLOCK_LIGHT_SHIFT;
+  dest[1] = vertex.palidx << VOXEL_VPACKED_PALIDX_SHIFT | (uint32_t)vertex.face_idx << VOXEL_VPACKED_FACE_SHIFT |
+            (uint32_t)vertex.t << VOXEL_VPACKED_T_SHIFT | vertex.quad_ao << VOXEL_VPACKED_QUAD_AO_SHIFT;
+}
+
+voxel_vertex_t voxel_vertex_unpack( const uint32_t* src ) {
+  assert( src );
+
+  voxel_vertex_t vertex;
+  vertex.x           = ( src[0] >> VOXEL_VPACKED_X_SHIFT ) & VOXEL_VPACKED_XZ_MASK;
+  vertex.y           = ( src[0] >> VOXEL_VPACKED_Y_SHIFT ) & VOXEL_VPACKED_Y_MASK;
+  vertex.z           = ( src[0] >> VOXEL_VPACKED_Z_SHIFT ) & VOXEL_VPACKED_XZ_MASK;
+  vertex.s           = ( src[0] >> VOXEL_VPACKED_S_SHIFT ) & VOXEL_VPACKED_S_MASK;
+  vertex.sky_light   = ( src[0] >> VOXEL_VPACKED_SKY_LIGHT_SHIFT ) & VOXEL_VPACKED_LIGHT_MASK;
+  vertex.block_light = ( src[0] >> VOXEL_VPACKED_BLOCK_LIGHT_SHIFT ) & VOXEL_VPACKED_LIGHT_MASK;
+  vertex.palidx      = ( src[1] >> VOXEL_VPACKED_PALIDX_SHIFT ) & VOXEL_VPACKED_PALIDX_MASK;
+  vertex.face_idx    = ( src[1] >> VOXEL_VPACKED_FACE_SHIFT ) & VOXEL_VPACKED_FACE_MASK;
+  vertex.t           = ( src[1] >> VOXEL_VPACKED_T_SHIFT ) & VOXEL_VPACKED_T_MASK;
+  vertex.quad_ao     = ( src[1] >> VOXEL_VPACKED_QUAD_AO_SHIFT ) & VOXEL_VPACKED_QUAD_AO_MASK;
+  return vertex;
+}
+
+// grows the arena's buffer, by doubling, until n_more_vertices fit after the ones in use. once an arena has meshed a few chunks this stops allocating
+static void _arena_reserve( chunk_mesh_arena_t* arena, size_t n_more_vertices ) {
+  const size_t n_needed = arena->n_vertices + n_more_vertices;
+  if ( arena->packed_ptr && n_needed <= arena->max_vertices ) { return; }
+
+  size_t max_vertices = arena->max_vertices > 0 ? arena->max_vertices : CHUNK_MESH_ARENA_MIN_VERTICES;
+  while ( max_vertices < n_needed ) { max_vertices *= 2; }
+  uint32_t* packed_ptr = realloc( arena->packed_ptr, max_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ) );
+  assert( packed_ptr );
+  arena->packed_ptr   = packed_ptr;
+  arena->max_vertices = max_vertices;
+}
+
+// RETURNS quad_ao, packed like VOXEL_QUAD_AO_EDGES_SHIFT, with s reversed if flip_s and t reversed if flip_t
+static uint32_t _flip_quad_ao( uint32_t quad_ao, bool flip_s, bool flip_t ) {
+  uint32_t flipped = 0;
+  for ( int t = 0; t < 2; t++ ) {
+    for ( int s = 0; s < 2; s++ ) {
+      const int from = ( flip_s ? 1 - s : s ) + 2 * ( flip_t ? 1 - t : t );
+      flipped |= ( quad_ao >> ( 2 * from ) & VOXEL_AO_MAX ) << ( 2 * ( s + 2 * t ) );
+    }
+  }
+  // the s = 0 and s = w edges, then t = 0 and t = h
+  for ( int side = 0; side < 2; side++ ) {
+    const int from_s = flip_s ? 1 - side : side, from_t = flip_t ? 1 - side : side;
+    flipped |= ( quad_ao >> ( VOXEL_QUAD_AO_EDGES_SHIFT + 2 * from_s ) & VOXEL_AO_MAX ) << ( VOXEL_QUAD_AO_EDGES_SHIFT + 2 * side );
+    flipped |= ( quad_ao >> ( VOXEL_QUAD_AO_EDGES_SHIFT + 4 + 2 * from_t ) & VOXEL_AO_MAX ) << ( VOXEL_QUAD_AO_EDGES_SHIFT + 4 + 2 * side );
+  }
+  return flipped;
+}
+
+/* append one face spanning the voxels mins to maxs (inclusive) to the arena.
+the face tables are stretched so that a -1 component lands on the mins voxel's near edge and a +1 component on the maxs voxel's far edge.
+the per-face mesher calls this with mins == maxs. quad_ao is packed like VOXEL_QUAD_AO_EDGES_SHIFT, but with s and t going from mins to maxs */
+static void _memcpy_face_packed( chunk_mesh_arena_t* arena, int face_idx, const int* mins, const int* maxs, uint32_t palidx, uint8_t light, uint32_t quad_ao ) {
+  const float* faces[6] = { _west_face, _east_face, _bottom_face, _top_face, _north_face, _south_face };
+  // texcoords (s,t) per the 6 vertices in the face tables
+  const int base_st[] = { 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0 };
+  const int s_axis    = _face_axes[face_idx][1];
+  const int t_axis    = _face_axes[face_idx][2];
+  _arena_reserve( arena, VOXEL_FACE_VERTS );
+  uint32_t* dest = &arena->packed_ptr[arena->n_vertices * VOXEL_VPACKED_COMPS];
+
+  const int s_tiles = maxs[s_axis] - mins[s_axis] + 1;
+  const int t_tiles = maxs[t_axis] - mins[t_axis] + 1;
+  // on some faces the texcoords run from maxs to mins
+  const bool flip_s = ( faces[face_idx][s_axis] > 0.0f ) != ( base_st[0] > 0 );
+  const bool flip_t = ( faces[face_idx][t_axis] > 0.0f ) != ( base_st[1] > 0 );
+  quad_ao           = _flip_quad_ao( quad_ao, flip_s, flip_t );
+  for ( int i = 0; i < VOXEL_FACE_VERTS; i++ ) {
+    const int v = _face_vert_order[i];
+    int corner[3];
+    for ( int c = 0; c < 3; c++ ) { corner[c] = faces[face_idx][v * 3 + c] < 0.0f ? mins[c] : maxs[c] + 1; }
+    const voxel_vertex_t vertex = ( voxel_vertex_t ){ .x = corner[0],
+      .y                                                 = corner[1],
+      .z                                                 = corner[2],
+      .face_idx                                          = face_idx,
+      .palidx                                            = palidx,
+      .s                                                 = base_st[v * 2] * s_tiles,
+      .t                                                 = base_st[v * 2 + 1] * t_tiles,
+      .sky_light                                         = VOXEL_LIGHT_SKY( light ),
+      .block_light                                       = VOXEL_LIGHT_BLOCK( light ),
+      .quad_ao                                           = quad_ao };
+    voxel_vertex_pack( vertex, &dest[i * VOXEL_VPACKED_COMPS] );
+  }
+  arena->n_vertices += VOXEL_FACE_VERTS;
+}
+
+/* finds which chunk x,y,z falls in when it may be up to one voxel over a border of chunk. x and z are changed to be local to the returned chunk.
+RETURNS NULL if outside the world */
+static const chunk_t* _chunk_across_border( const chunk_t* chunk, const chunk_neighbours_t* neighbours, int* x, int y, int* z ) {
+  if ( y < 0 || y >= CHUNK_Y ) { return NULL; }
+  if ( *x >= 0 && *x < CHUNK_X && *z >= 0 && *z < CHUNK_Z ) { return chunk; }
+  if ( !neighbours ) { return NULL; }
+
+  int adjacent_idx = -1;
+  if ( *x < 0 ) {
+    adjacent_idx = 0;
+    *x += CHUNK_X;
+  } else if ( *x >= CHUNK_X ) {
+    adjacent_idx = 1;
+    *x -= CHUNK_X;
+  } else if ( *z < 0 ) {
+    adjacent_idx = 2;
+    *z += CHUNK_Z;
+  } else {
+    adjacent_idx = 3;
+    *z -= CHUNK_Z;
+  }
+  // diagonal neighbours are never needed for face culling
+  assert( *x >= 0 && *x < CHUNK_X && *z >= 0 && *z < CHUNK_Z );
+  return neighbours->adjacent[adjacent_idx];
+}
+
+// RETURNS the light of the voxel in front of face face_idx of voxel x,y,z, which may be in a neighbour. only meaningful if the face is exposed
+static uint8_t _face_light( const chunk_t* chunk, const chunk_neighbours_t* neighbours, int x, int y, int z, int face_idx ) {
+  // clang-format off
+  const int xs[6] = { -1,  1,  0,  0,  0,  0 };
+  const int ys[6] = {  0,  0, -1,  1,  0,  0 };
+  const int zs[6] = {  0,  0,  0,  0, -1,  1 };
+  // clang-format on
+  int nx                         = x + xs[face_idx], ny = y + ys[face_idx], nz = z + zs[face_idx];
+  const chunk_t* neighbour_chunk = _chunk_across_border( chunk, neighbours, &nx, ny, &nz );
+  // edges of the world are lit by sunlight, same as is_voxel_above_surface()
+  if ( !neighbour_chunk ) { return VOXEL_LIGHT_PACK( VOXEL_LIGHT_MAX, 0 ); }
+  return chunk_get_light( neighbour_chunk, nx, ny, nz );
+}
+
+/*-------------------------------------------------OCCUPANCY MASKS-----------------------------------------------------*/
+
+/* a bit per voxel, set if it's solid, for each column of CHUNK_Y voxels. bit y of a column is bit y % 64 of word y / 64.
+faces are culled a whole column at a time with shifts and ANDs: a voxel's +y face is exposed if its bit is set and the bit above isn't, and its -x face
+if its bit is set and the same bit in the column to the -x isn't. the mesher then only visits the set bits of the result */
+#define OCCUPANCY_WORDS ( CHUNK_Y / 64 )
+
+// sets bits from_y to to_y - 1
+static void _occupancy_set_range( uint64_t* words, int from_y, int to_y ) {
+  for ( int w = from_y / 64; w < OCCUPANCY_WORDS && w * 64 < to_y; w++ ) {
+    const int lo = from_y > w * 64 ? from_y - w * 64 : 0;
+    const int hi = to_y < ( w + 1 ) * 64 ? to_y - w * 64 : 64;
+    words[w] |= ( hi - lo == 64 ? ~0ull : ( ( 1ull << ( hi - lo ) ) - 1 ) ) << lo;
+  }
+}
+
+static void _column_occupancy( const chunk_t* chunk, int x, int z, uint64_t* words ) {
+  memset( words, 0, OCCUPANCY_WORDS * sizeof( uint64_t ) );
+  const int column = CHUNK_X * z + x;
+  if ( chunk->rle ) {
+    // a few runs per column, set a word at a time
+    const chunk_rle_t* rle = chunk->rle;
+    int y                  = 0;
+    for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+      const int run_top = y + ( rle->runs[r] & 0xFF ) + 1;
+      if ( rle->palette[rle->runs[r] >> 8] != BLOCK_TYPE_AIR ) { _occupancy_set_range( words, y, run_top ); }
+      y = run_top;
+    }
+    return;
+  }
+  for ( int y = 0; y < CHUNK_Y; y++ ) { words[y / 64] |= (uint64_t)( chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type != BLOCK_TYPE_AIR ) << ( y % 64 ); }
+}
+
+/* every column of the chunk plus a border one column wide from the neighbours. the corners come from the diagonal neighbours, for ambient occlusion.
+missing neighbours are left empty so that faces against them are exposed like the edge of the world */
+typedef struct chunk_occupancy_t {
+  uint64_t columns[CHUNK_Z + 2][CHUNK_X + 2][OCCUPANCY_WORDS]; // [z + 1][x + 1]
+} chunk_occupancy_t;
+
+static void _chunk_occupancy( const chunk_t* chunk, const chunk_neighbours_t* neighbours, chunk_occupancy_t* occupancy ) {
+  memset( occupancy, 0, sizeof( chunk_occupancy_t ) );
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) { _column_occupancy( chunk, x, z, occupancy->columns[z + 1][x + 1] ); }
+  }
+  if ( !neighbours ) { return; }
+  for ( int i = 0; i < CHUNK_Z; i++ ) {
+    if ( neighbours->adjacent[0] ) { _column_occupancy( neighbours->adjacent[0], CHUNK_X - 1, i, occupancy->columns[i + 1][0] ); }
+    if ( neighbours->adjacent[1] ) { _column_occupancy( neighbours->adjacent[1], 0, i, occupancy->columns[i + 1][CHUNK_X + 1] ); }
+  }
+  for ( int i = 0; i < CHUNK_X; i++ ) {
+    if ( neighbours->adjacent[2] ) { _column_occupancy( neighbours->adjacent[2], i, CHUNK_Z - 1, occupancy->columns[0][i + 1] ); }
+    if ( neighbours->adjacent[3] ) { _column_occupancy( neighbours->adjacent[3], i, 0, occupancy->columns[CHUNK_Z + 1][i + 1] ); }
+  }
+  for ( int i = 0; i < 4; i++ ) {
+    const int x = i % 2 ? CHUNK_X - 1 : 0, z = i / 2 ? CHUNK_Z - 1 : 0; // the diagonal's column nearest to us
+    if ( !neighbours->diagonal[i] ) { continue; }
+    _column_occupancy( neighbours->diagonal[i], CHUNK_X - 1 - x, CHUNK_Z - 1 - z, occupancy->columns[z ? CHUNK_Z + 1 : 0][x ? CHUNK_X + 1 : 0] );
+  }
+}
+
+/* exposed faces of each direction for the column x,z of the chunk. the y faces shift the column by one voxel, carrying bits between words.
+nothing is shifted in at the top or the bottom, so faces there are exposed like the edge of the world */
+static void _column_exposed_faces( const chunk_occupancy_t* occupancy, int x, int z, uint64_t exposed[6][OCCUPANCY_WORDS] ) {
+  const uint64_t* ours = occupancy->columns[z + 1][x + 1];
+  const uint64_t* adjacent[6] = { occupancy->columns[z + 1][x], occupancy->columns[z + 1][x + 2], NULL, NULL, occupancy->columns[z][x + 1],
+    occupancy->columns[z + 2][x + 1] };
+  for ( int w = 0; w < OCCUPANCY_WORDS; w++ ) {
+    const uint64_t below = ours[w] << 1 | ( w > 0 ? ours[w - 1] >> 63 : 0 );                    // bit y is voxel y - 1
+    const uint64_t above = ours[w] >> 1 | ( w < OCCUPANCY_WORDS - 1 ? ours[w + 1] << 63 : 0 ); // bit y is voxel y + 1
+    exposed[0][w]        = ours[w] & ~adjacent[0][w];
+    exposed[1][w]        = ours[w] & ~adjacent[1][w];
+    exposed[2][w]        = ours[w] & ~below;
+    exposed[3][w]        = ours[w] & ~above;
+    exposed[4][w]        = ours[w] & ~adjacent[4][w];
+    exposed[5][w]        = ours[w] & ~adjacent[5][w];
+  }
+}
+
+// x and z may be one over the chunk's border. above and below the chunk is air
+static bool _is_occupied( const chunk_occupancy_t* occupancy, int x, int y, int z ) {
+  if ( y < 0 || y >= CHUNK_Y ) { return false; }
+  return occupancy->columns[z + 1][x + 1][y / 64] >> ( y % 64 ) & 1;
+}
+
+/* RETURNS the ambient occlusion of the 4 corners of face face_idx of voxel x,y,z, each 0..VOXEL_AO_MAX in 2 bits: corner (s,t) at bit 2 * ( s + 2t ),
+where s and t are 0 on the face's low side along _face_axes and 1 on its high side. a corner between 2 solid voxels is fully occluded whatever is
+in the diagonal, otherwise each of the 3 takes a step off */
+static uint8_t _face_ao( const chunk_occupancy_t* occupancy, int x, int y, int z, int face_idx ) {
+  const int n_axis = _face_axes[face_idx][0];
+  const int s_axis = _face_axes[face_idx][1];
+  const int t_axis = _face_axes[face_idx][2];
+  int front[3]     = { x, y, z };
+  front[n_axis] += face_idx % 2 ? 1 : -1;
+
+  // the ring of 8 voxels around the one in front of the face, in the face's plane, [t][s]
+  bool solid[3][3];
+  for ( int t = 0; t < 3; t++ ) {
+    for ( int s = 0; s < 3; s++ ) {
+      int p[3] = { front[0], front[1], front[2] };
+      p[s_axis] += s - 1;
+      p[t_axis] += t - 1;
+      solid[t][s] = ( 1 != s || 1 != t ) && _is_occupied( occupancy, p[0], p[1], p[2] );
+    }
+  }
+  uint8_t ao = 0;
+  for ( int corner = 0; corner < 4; corner++ ) {
+    const int s = ( corner % 2 ) * 2, t = ( corner / 2 ) * 2;
+    const bool s_side = solid[1][s], t_side = solid[t][1];
+    const int corner_ao = s_side && t_side ? 0 : VOXEL_AO_MAX - s_side - t_side - solid[t][s];
+    ao |= (uint8_t)( corner_ao << ( 2 * corner ) );
+  }
+  return ao;
+}
+
+// RETURNS the occlusion of corner (s,t) of a face, where ao is packed like _face_ao() returns it
+static int _corner_ao( uint8_t ao, int s, int t ) { return ao >> ( 2 * ( s + 2 * t ) ) & VOXEL_AO_MAX; }
+
+/* RETURNS the ambient occlusion of a rectangle of w by h faces, packed like VOXEL_QUAD_AO_EDGES_SHIFT with s and t along _face_axes, low to high.
+ao is the occlusion of each face, packed like _face_ao() returns it, in rows of stride along t. the corners along each edge must all match already */
+static uint32_t _rect_quad_ao( const uint8_t* ao, int stride, int w, int h ) {
+  const uint8_t* last_row = &ao[( h - 1 ) * stride];
+  uint32_t quad_ao        = (uint32_t)( _corner_ao( ao[0], 0, 0 ) | _corner_ao( ao[w - 1], 1, 0 ) << 2 | _corner_ao( last_row[0], 0, 1 ) << 4 |
+                                 _corner_ao( last_row[w - 1], 1, 1 ) << 6 );
+  // an edge one face long has no corners between its ends
+  const int edges[4] = { h > 1 ? _corner_ao( ao[stride], 0, 0 ) : VOXEL_AO_MAX, h > 1 ? _corner_ao( ao[stride + w - 1], 1, 0 ) : VOXEL_AO_MAX,
+    w > 1 ? _corner_ao( ao[1], 0, 0 ) : VOXEL_AO_MAX, w > 1 ? _corner_ao( last_row[1], 0, 1 ) : VOXEL_AO_MAX };
+  for ( int e = 0; e < 4; e++ ) { quad_ao |= (uint32_t)edges[e] << ( VOXEL_QUAD_AO_EDGES_SHIFT + 2 * e ); }
+  return quad_ao;
+}
+
+// keeps only bits from_y to to_y - 1
+static void _mask_layers( uint64_t* words, int from_y, int to_y ) {
+  uint64_t range[OCCUPANCY_WORDS] = { 0 };
+  _occupancy_set_range( range, from_y, to_y );
+  for ( int w = 0; w < OCCUPANCY_WORDS; w++ ) { words[w] &= range[w]; }
+}
+
+static void _gen_vertex_data_per_face(
+  chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours, int from_y_inclusive, int to_y_exclusive ) {
+  chunk_occupancy_t occupancy;
+  _chunk_occupancy( chunk, neighbours, &occupancy );
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      uint64_t exposed[6][OCCUPANCY_WORDS];
+      _column_exposed_faces( &occupancy, x, z, exposed );
+      for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
+        _mask_layers( exposed[face_idx], from_y_inclusive, to_y_exclusive );
+        for ( int w = 0; w < OCCUPANCY_WORDS; w++ ) {
+          // one face's worth of vertex data for each set bit
+          for ( uint64_t bits = exposed[face_idx][w]; bits; bits &= bits - 1 ) {
+            const int y                 = w * 64 + __builtin_ctzll( bits );
+            const int xyz[3]            = { x, y, z };
+            block_type_t our_block_type = BLOCK_TYPE_AIR;
+            get_block_type_in_chunk( chunk, x, y, z, &our_block_type );
+            const uint8_t ao = _face_ao( &occupancy, x, y, z, face_idx );
+            _memcpy_face_packed( arena, face_idx, xyz, xyz, _palidx_for_block_type( our_block_type ), _face_light( chunk, neighbours, x, y, z, face_idx ),
+              _rect_quad_ao( &ao, 1, 1, 1 ) );
+          }
+        }
+      } // endfor face_idx
+    }   // endfor x
+  }     // endfor z
+}
+
+// RETURNS the greedy mask key of a face: 1 + palette index, with the light in front of the face above that. 0 is no face
+static uint32_t _greedy_key( block_type_t block_type, uint8_t light ) {
+  return ( 1 + _palidx_for_block_type( block_type ) ) | (uint32_t)light << GREEDY_MASK_LIGHT_SHIFT;
+}
+
+/* fills mask with the greedy mask keys of the faces face_idx of the cells of grid in one slice along the face normal, between lo and hi, s along rows
+and t down them, and 0 where there's no face. ao gets the ambient occlusion of each face, packed like _face_ao() returns it. a cell is a voxel for
+full detail meshes and a block of voxels for LOD meshes
+RETURNS the number of faces, so that empty slices can be skipped */
+typedef int ( *greedy_fill_slice_fn )( const void* grid, int face_idx, int slice, const int* lo, const int* hi, uint32_t* mask, uint8_t* ao );
+
+/* for each face direction, sweep slices along the face normal. each slice builds a 2D mask of exposed faces keyed by palette index and light,
+then repeatedly takes the first unmerged face, grows it along s as far as the key matches, then along t while whole rows match.
+the corners inside a rectangle of exposed faces are never occluded, so only the corners along each of its edges have to match to shade it exactly.
+see VOXEL_QUAD_AO_EDGES_SHIFT. the first row's top edge is checked too so that it's a rectangle on its own, and the rectangle stops at the tallest
+row whose top edge matches. lo and hi are in cells of cell_size voxels along each side */
+static void _greedy_sweep( chunk_mesh_arena_t* arena, const int* lo, const int* hi, int cell_size, greedy_fill_slice_fn fill_slice, const void* grid ) {
+  uint32_t mask[GREEDY_MASK_MAX];
+  uint8_t mask_ao[GREEDY_MASK_MAX];
+
+  for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
+    const int n_axis = _face_axes[face_idx][0];
+    const int s_axis = _face_axes[face_idx][1];
+    const int t_axis = _face_axes[face_idx][2];
+    const int s_len  = hi[s_axis] - lo[s_axis];
+    const int t_len  = hi[t_axis] - lo[t_axis];
+    assert( s_len * t_len <= GREEDY_MASK_MAX );
+
+    for ( int slice = lo[n_axis]; slice < hi[n_axis]; slice++ ) {
+      if ( !fill_slice( grid, face_idx, slice, lo, hi, mask, mask_ao ) ) { continue; }
+
+      for ( int t = 0; t < t_len; t++ ) {
+        for ( int s = 0; s < s_len; s++ ) {
+          const uint32_t key = mask[t * s_len + s];
+          if ( !key ) { continue; }
+          const uint8_t* ao = &mask_ao[t * s_len + s];
+          int w = 1, h = 1;
+          while ( s + w < s_len && mask[t * s_len + s + w] == key && _corner_ao( ao[w], 0, 0 ) == _corner_ao( ao[1], 0, 0 ) &&
+                  _corner_ao( ao[w], 0, 1 ) == _corner_ao( ao[1], 0, 1 ) ) {
+            w++;
+          }
+          for ( int rows = 1; t + rows < t_len; rows++ ) {
+            bool row_matches = true;
+            for ( int k = 0; k < w && row_matches; k++ ) { row_matches = mask[( t + rows ) * s_len + s + k] == key; }
+            // the corners it adds to the sides
+            const uint8_t* row_ao = &ao[rows * s_len];
+            if ( !row_matches || _corner_ao( row_ao[0], 0, 0 ) != _corner_ao( ao[s_len], 0, 0 ) ||
+                 _corner_ao( row_ao[w - 1], 1, 0 ) != _corner_ao( ao[s_len + w - 1], 1, 0 ) ) {
+              break;
+            }
+            bool top_matches = true;
+            for ( int k = 2; k < w; k++ ) { top_matches &= _corner_ao( row_ao[k], 0, 1 ) == _corner_ao( row_ao[1], 0, 1 ); }
+            if ( top_matches ) { h = rows + 1; }
+          }
+          for ( int tt = t; tt < t + h; tt++ ) { memset( &mask[tt * s_len + s], 0, sizeof( uint32_t ) * w ); }
+
+          // back to voxels. the face spans the whole cell along the normal so that _memcpy_face_packed() puts it on the right side
+          int mins[3], maxs[3];
+          mins[n_axis] = slice * cell_size;
+          maxs[n_axis] = ( slice + 1 ) * cell_size - 1;
+          mins[s_axis] = ( lo[s_axis] + s ) * cell_size;
+          maxs[s_axis] = ( lo[s_axis] + s + w ) * cell_size - 1;
+          mins[t_axis] = ( lo[t_axis] + t ) * cell_size;
+          maxs[t_axis] = ( lo[t_axis] + t + h ) * cell_size - 1;
+          const uint32_t palidx = ( key & ( ( 1u << GREEDY_MASK_LIGHT_SHIFT ) - 1 ) ) - 1;
+          _memcpy_face_packed( arena, face_idx, mins, maxs, palidx, (uint8_t)( key >> GREEDY_MASK_LIGHT_SHIFT ), _rect_quad_ao( ao, s_len, w, h ) );
+        } // endfor s
+      }   // endfor t
+    }     // endfor slice
+  }       // endfor face_idx
+}
+
+typedef struct voxel_grid_t {
+  const chunk_t* chunk;
+  const chunk_neighbours_t* neighbours;
+  const chunk_occupancy_t* occupancy;
+  uint64_t exposed[CHUNK_X * CHUNK_Z][6][OCCUPANCY_WORDS]; // of each column, z then x. see _column_exposed_faces()
+} voxel_grid_t;
+
+static bool _is_exposed( const voxel_grid_t* grid, int x, int y, int z, int face_idx ) {
+  return grid->exposed[CHUNK_X * z + x][face_idx][y / 64] >> ( y % 64 ) & 1;
+}
+
+// of a face that's exposed
+static uint32_t _voxel_face_key( const voxel_grid_t* grid, int x, int y, int z, int face_idx ) {
+  block_type_t our_block_type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( grid->chunk, x, y, z, &our_block_type );
+  return _greedy_key( our_block_type, _face_light( grid->chunk, grid->neighbours, x, y, z, face_idx ) );
+}
+
+static int _voxel_fill_slice( const void* grid_ptr, int face_idx, int slice, const int* lo, const int* hi, uint32_t* mask, uint8_t* ao ) {
+  const voxel_grid_t* grid = grid_ptr;
+  const int n_axis         = _face_axes[face_idx][0];
+  const int s_axis         = _face_axes[face_idx][1];
+  const int s_len          = hi[s_axis] - lo[s_axis];
+  int n_faces              = 0;
+  if ( 1 == n_axis ) {
+    // a layer across the columns, so one bit from each
+    for ( int z = lo[2]; z < hi[2]; z++ ) {
+      for ( int x = lo[0]; x < hi[0]; x++ ) {
+        const bool exposed = _is_exposed( grid, x, slice, z, face_idx );
+        const int i        = ( z - lo[2] ) * s_len + ( x - lo[0] );
+        mask[i]            = exposed ? _voxel_face_key( grid, x, slice, z, face_idx ) : 0;
+        if ( exposed ) { ao[i] = _face_ao( grid->occupancy, x, slice, z, face_idx ); }
+        n_faces += exposed;
+      }
+    }
+    return n_faces;
+  }
+
+  // the columns in the slice lie along t, so only their set bits are visited
+  memset( mask, 0, sizeof( uint32_t ) * s_len * ( hi[1] - lo[1] ) );
+  for ( int s = lo[s_axis]; s < hi[s_axis]; s++ ) {
+    const int x = 0 == n_axis ? slice : s, z = 0 == n_axis ? s : slice;
+    uint64_t words[OCCUPANCY_WORDS];
+    memcpy( words, grid->exposed[CHUNK_X * z + x][face_idx], sizeof( words ) );
+    _mask_layers( words, lo[1], hi[1] );
+    for ( int w = 0; w < OCCUPANCY_WORDS; w++ ) {
+      for ( uint64_t bits = words[w]; bits; bits &= bits - 1 ) {
+        const int y = w * 64 + __builtin_ctzll( bits );
+        const int i = ( y - lo[1] ) * s_len + ( s - lo[s_axis] );
+        mask[i]     = _voxel_face_key( grid, x, y, z, face_idx );
+        ao[i]       = _face_ao( grid->occupancy, x, y, z, face_idx );
+        n_faces++;
+      }
+    }
+  }
+  return n_faces;
+}
+
+static void _gen_vertex_data_greedy(
+  chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours, int from_y_inclusive, int to_y_exclusive ) {
+  const int lo[3] = { 0, from_y_inclusive, 0 };
+  const int hi[3] = { CHUNK_X, to_y_exclusive, CHUNK_Z };
+  chunk_occupancy_t occupancy;
+  _chunk_occupancy( chunk, neighbours, &occupancy );
+  voxel_grid_t grid;
+  grid.chunk      = chunk;
+  grid.neighbours = neighbours;
+  grid.occupancy  = &occupancy;
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+    _column_exposed_faces( &occupancy, column % CHUNK_X, column / CHUNK_X, grid.exposed[column] );
+  }
+  _greedy_sweep( arena, lo, hi, 1, _voxel_fill_slice, &grid );
+}
+
+/* a chunk downsampled into cells of scale voxels along each side. a cell is solid if any voxel in it is, so the LOD surface never falls inside the
+full detail one and there are no holes where it meets a neighbour drawn at another LOD. it takes the type of its top-most solid voxel, so grass
+stays on top of hills */
+typedef struct lod_grid_t {
+  const chunk_t* chunk;
+  const chunk_neighbours_t* neighbours;
+  int scale;
+  int dims[3];
+  uint8_t cells[( CHUNK_X / 2 ) * ( CHUNK_Y / 2 ) * ( CHUNK_Z / 2 )]; // block_type_t of each cell, x then z then y like voxels
+} lod_grid_t;
+
+static int _lod_cell_idx( const lod_grid_t* grid, int x, int y, int z ) { return grid->dims[0] * grid->dims[2] * y + grid->dims[0] * z + x; }
+
+static void _lod_downsample( lod_grid_t* grid ) {
+  for ( int y = 0; y < grid->dims[1]; y++ ) {
+    for ( int z = 0; z < grid->dims[2]; z++ ) {
+      for ( int x = 0; x < grid->dims[0]; x++ ) {
+        block_type_t cell_type = BLOCK_TYPE_AIR;
+        // top-down so the first solid voxel found is the top-most
+        for ( int vy = ( y + 1 ) * grid->scale - 1; vy >= y * grid->scale && BLOCK_TYPE_AIR == cell_type; vy-- ) {
+          for ( int vz = z * grid->scale; vz < ( z + 1 ) * grid->scale && BLOCK_TYPE_AIR == cell_type; vz++ ) {
+            for ( int vx = x * grid->scale; vx < ( x + 1 ) * grid->scale && BLOCK_TYPE_AIR == cell_type; vx++ ) {
+              get_block_type_in_chunk( grid->chunk, vx, vy, vz, &cell_type );
+            }
+          }
+        }
+        grid->cells[_lod_cell_idx( grid, x, y, z )] = (uint8_t)cell_type;
+      } // endfor x
+    }   // endfor z
+  }     // endfor y
+}
+
+/* a LOD cell face is exposed if the cell in front of it is air. across a chunk border the test uses the neighbour's voxels at full detail instead: the
+face is there if any of the voxels touching it is air. whatever LOD the neighbour is drawn at, its own downsampling only adds solid voxels, so where
+it has a gap this face fills it. the face takes the brightest light of the air voxels touching it */
+static uint32_t _lod_face_key( const void* grid_ptr, int x, int y, int z, int face_idx ) {
+  // clang-format off
+  const int xs[6] = { -1,  1,  0,  0,  0,  0 };
+  const int ys[6] = {  0,  0, -1,  1,  0,  0 };
+  const int zs[6] = {  0,  0,  0,  0, -1,  1 };
+  // clang-format on
+  const lod_grid_t* grid            = grid_ptr;
+  const block_type_t our_block_type = grid->cells[_lod_cell_idx( grid, x, y, z )];
+  if ( BLOCK_TYPE_AIR == our_block_type ) { return 0; }
+  const int nx = x + xs[face_idx], ny = y + ys[face_idx], nz = z + zs[face_idx];
+  if ( ny < 0 || ny >= grid->dims[1] ) { return _greedy_key( our_block_type, VOXEL_LIGHT_PACK( VOXEL_LIGHT_MAX, 0 ) ); }
+  const bool in_chunk = nx >= 0 && nx < grid->dims[0] && nz >= 0 && nz < grid->dims[2];
+  if ( in_chunk && grid->cells[_lod_cell_idx( grid, nx, ny, nz )] != BLOCK_TYPE_AIR ) { return 0; }
+
+  // the layer of voxels in front of the face, in this chunk's voxel coords
+  const int n_axis = _face_axes[face_idx][0];
+  int mins[3] = { x * grid->scale, y * grid->scale, z * grid->scale }, maxs[3];
+  for ( int a = 0; a < 3; a++ ) { maxs[a] = mins[a] + grid->scale - 1; }
+  mins[n_axis] = maxs[n_axis] = face_idx % 2 ? maxs[n_axis] + 1 : mins[n_axis] - 1;
+
+  bool exposed = in_chunk;
+  int sky = 0, block = 0;
+  for ( int vy = mins[1]; vy <= maxs[1]; vy++ ) {
+    for ( int vz = mins[2]; vz <= maxs[2]; vz++ ) {
+      for ( int vx = mins[0]; vx <= maxs[0]; vx++ ) {
+        int lx = vx, lz = vz;
+        const chunk_t* chunk = _chunk_across_border( grid->chunk, grid->neighbours, &lx, vy, &lz );
+        if ( !chunk ) {
+          exposed = true;
+          sky     = VOXEL_LIGHT_MAX; // edges of the world are lit by sunlight, same as _face_light()
+          continue;
+        }
+        block_type_t block_type = BLOCK_TYPE_AIR;
+        get_block_type_in_chunk( chunk, lx, vy, lz, &block_type );
+        if ( block_type != BLOCK_TYPE_AIR ) { continue; }
+        exposed             = true;
+        const uint8_t light = chunk_get_light( chunk, lx, vy, lz );
+        if ( VOXEL_LIGHT_SKY( light ) > sky ) { sky = VOXEL_LIGHT_SKY( light ); }
+        if ( VOXEL_LIGHT_BLOCK( light ) > block ) { block = VOXEL_LIGHT_BLOCK( light ); }
+      }
+    }
+  }
+  if ( !exposed ) { return 0; }
+  return _greedy_key( our_block_type, VOXEL_LIGHT_PACK( sky, block ) );
+}
+
+// LOD cells are drawn without ambient occlusion
+static int _lod_fill_slice( const void* grid_ptr, int face_idx, int slice, const int* lo, const int* hi, uint32_t* mask, uint8_t* ao ) {
+  const int n_axis = _face_axes[face_idx][0];
+  const int s_axis = _face_axes[face_idx][1];
+  const int t_axis = _face_axes[face_idx][2];
+  const int s_len  = hi[s_axis] - lo[s_axis];
+  int n_faces      = 0;
+  for ( int t = 0; t < hi[t_axis] - lo[t_axis]; t++ ) {
+    for ( int s = 0; s < s_len; s++ ) {
+      int xyz[3];
+      xyz[n_axis]         = slice;
+      xyz[s_axis]         = lo[s_axis] + s;
+      xyz[t_axis]         = lo[t_axis] + t;
+      mask[t * s_len + s] = _lod_face_key( grid_ptr, xyz[0], xyz[1], xyz[2], face_idx );
+      ao[t * s_len + s]   = FACE_AO_OPEN;
+      n_faces += mask[t * s_len + s] != 0;
+    } // endfor s
+  }   // endfor t
+  return n_faces;
+}
+
+void chunk_mesh_arena_reset( chunk_mesh_arena_t* arena ) {
+  assert( arena );
+  arena->n_vertices = 0;
+}
+
+void chunk_mesh_arena_free( chunk_mesh_arena_t* arena ) {
+  assert( arena );
+  free( arena->packed_ptr );
+  memset( arena, 0, sizeof( chunk_mesh_arena_t ) );
+}
+
+chunk_vertex_data_t chunk_mesh_arena_vertex_data( const chunk_mesh_arena_t* arena, size_t first_vertex, size_t n_vertices ) {
+  assert( arena && arena->packed_ptr );
+  assert( first_vertex + n_vertices <= arena->n_vertices );
+
+  return ( chunk_vertex_data_t ){ .packed_ptr = &arena->packed_ptr[first_vertex * VOXEL_VPACKED_COMPS],
+    .n_vertices                               = n_vertices,
+    .n_vpacked_comps                          = VOXEL_VPACKED_COMPS,
+    .vpacked_buffer_sz                        = n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ) };
+}
+
+int chunk_face_layer( const uint32_t* face_packed ) {
+  assert( face_packed );
+
+  int min_y = CHUNK_Y;
+  for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) {
+    const int y = ( face_packed[v * VOXEL_VPACKED_COMPS] >> VOXEL_VPACKED_Y_SHIFT ) & VOXEL_VPACKED_Y_MASK;
+    if ( y < min_y ) { min_y = y; }
+  }
+  // corners are voxel edges. a top face's corners are all on the top edge of its voxels
+  const int face_idx = ( face_packed[1] >> VOXEL_VPACKED_FACE_SHIFT ) & VOXEL_VPACKED_FACE_MASK;
+  return 3 == face_idx ? min_y - 1 : min_y;
+}
+
+void chunk_vertex_data_layer_ends( const chunk_vertex_data_t* vertex_data, int from_y_inclusive, int n_layers, uint32_t* layer_ends ) {
+  assert( vertex_data && layer_ends && n_layers >= 0 );
+  assert( 0 == vertex_data->n_vertices % VOXEL_FACE_VERTS );
+
+  size_t v = 0;
+  for ( int i = 0; i < n_layers; i++ ) {
+    while ( v < vertex_data->n_vertices && chunk_face_layer( &vertex_data->packed_ptr[v * VOXEL_VPACKED_COMPS] ) <= from_y_inclusive + i ) {
+      v += VOXEL_FACE_VERTS;
+    }
+    layer_ends[i] = (uint32_t)v;
+  }
+}
+
+/* stable counting sort of the faces appended since first_vertex by chunk_face_layer(). the meshers sweep by face direction, not height, so this is
+what puts them in layer order. sorts through the arena's space past the vertices in use, so it only allocates while the arena is growing */
+static void _sort_faces_by_layer( chunk_mesh_arena_t* arena, size_t first_vertex, int from_y_inclusive, int to_y_exclusive ) {
+  const size_t n_faces = ( arena->n_vertices - first_vertex ) / VOXEL_FACE_VERTS;
+  if ( n_faces < 2 ) { return; }
+
+  _arena_reserve( arena, n_faces * VOXEL_FACE_VERTS );
+  uint32_t* faces  = &arena->packed_ptr[first_vertex * VOXEL_VPACKED_COMPS];
+  uint32_t* sorted = &arena->packed_ptr[arena->n_vertices * VOXEL_VPACKED_COMPS];
+  size_t layer_starts[CHUNK_Y + 1];
+  memset( layer_starts, 0, sizeof( layer_starts ) );
+  for ( size_t f = 0; f < n_faces; f++ ) {
+    const int layer = chunk_face_layer( &faces[f * VOXEL_FACE_VPACKED_UINTS] );
+    assert( layer >= from_y_inclusive && layer < to_y_exclusive );
+    layer_starts[layer - from_y_inclusive + 1]++;
+  }
+  for ( int layer = 1; layer <= to_y_exclusive - from_y_inclusive; layer++ ) { layer_starts[layer] += layer_starts[layer - 1]; }
+  for ( size_t f = 0; f < n_faces; f++ ) {
+    const int layer = chunk_face_layer( &faces[f * VOXEL_FACE_VPACKED_UINTS] ) - from_y_inclusive;
+    memcpy( &sorted[layer_starts[layer]++ * VOXEL_FACE_VPACKED_UINTS], &faces[f * VOXEL_FACE_VPACKED_UINTS], VOXEL_FACE_VPACKED_BYTES );
+  }
+  memcpy( faces, sorted, n_faces * VOXEL_FACE_VPACKED_BYTES );
+}
+
+chunk_vertex_data_t chunk_gen_vertex_data_in_arena( chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours,
+  int from_y_inclusive, int to_y_exclusive, chunk_mesher_t mesher ) {
+  assert( arena && chunk );
+  assert( from_y_inclusive >= 0 && to_y_exclusive <= CHUNK_Y );
+
+  _arena_reserve( arena, 0 ); // so that an empty result still has a valid pointer
+  const size_t first_vertex = arena->n_vertices;
+  if ( CHUNK_MESHER_GREEDY == mesher ) {
+    _gen_vertex_data_greedy( arena, chunk, neighbours, from_y_inclusive, to_y_exclusive );
+  } else {
+    _gen_vertex_data_per_face( arena, chunk, neighbours, from_y_inclusive, to_y_exclusive );
+  }
+  _sort_faces_by_layer( arena, first_vertex, from_y_inclusive, to_y_exclusive );
+  return chunk_mesh_arena_vertex_data( arena, first_vertex, arena->n_vertices - first_vertex );
+}
+
+chunk_vertex_data_t chunk_gen_lod_vertex_data_in_arena( chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours, int lod ) {
+  assert( arena && chunk );
+  assert( lod > 0 && lod < CHUNK_LOD_LEVELS );
+
+  lod_grid_t grid = ( lod_grid_t ){ .chunk = chunk, .neighbours = neighbours, .scale = 1 << lod };
+  grid.dims[0]    = CHUNK_X >> lod;
+  grid.dims[1]    = CHUNK_Y >> lod;
+  grid.dims[2]    = CHUNK_Z >> lod;
+  _lod_downsample( &grid );
+
+  _arena_reserve( arena, 0 );
+  const size_t first_vertex = arena->n_vertices;
+  const int lo[3]           = { 0, 0, 0 };
+  _greedy_sweep( arena, lo, grid.dims, grid.scale, _lod_fill_slice, &grid );
+  return chunk_mesh_arena_vertex_data( arena, first_vertex, arena->n_vertices - first_vertex );
+}
+
+chunk_vertex_data_t chunk_gen_vertex_data(
+  const chunk_t* chunk, const chunk_neighbours_t* neighbours, int from_y_inclusive, int to_y_exclusive, chunk_mesher_t mesher ) {
+  // a one-off arena whose buffer is handed over to the caller as-is. no worst-case sizing and no shrinking
+  chunk_mesh_arena_t arena = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+  return chunk_gen_vertex_data_in_arena( &arena, chunk, neighbours, from_y_inclusive, to_y_exclusive, mesher );
+}
+
+void chunk_free_vertex_data( chunk_vertex_data_t* chunk_vertex_data ) {
+  assert( chunk_vertex_data && chunk_vertex_data->packed_ptr );
+
+  free( chunk_vertex_data->packed_ptr );
+  memset( chunk_vertex_data, 0, sizeof( chunk_vertex_data_t ) );
+}
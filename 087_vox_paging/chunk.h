@@ -0,0 +1,333 @@
+/* CPU-side chunk storage, generation, and vertex data (meshing).
+No GL in here so that this can be built and tested headless. See voxels.h for the chunks world that draws these. */
+
+#pragma once
+
+#include "apg_maths.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// dimensions of chunk in voxels
+#define CHUNK_X 16  // 32
+#define CHUNK_Y 256 // 256
+#define CHUNK_Z 16  // 32
+
+/* chunks are meshed and drawn in vertical sections of CHUNK_SECTION_Y layers, so that an edit only remeshes the sections it touches.
+must divide CHUNK_Y, and CHUNK_SECTIONS must fit in a uint32_t bitmask */
+#define CHUNK_SECTION_Y 16
+#define CHUNK_SECTIONS ( CHUNK_Y / CHUNK_SECTION_Y )
+
+#define VOXEL_FACE_VERTS 6
+#define VOXEL_VPACKED_COMPS 2
+#define VOXEL_FACE_VPACKED_UINTS ( VOXEL_FACE_VERTS * VOXEL_VPACKED_COMPS )
+#define VOXEL_FACE_VPACKED_BYTES ( VOXEL_FACE_VPACKED_UINTS * sizeof( uint32_t ) )
+#define VOXEL_CUBE_VPACKED_UINTS ( VOXEL_FACE_VPACKED_UINTS * 6 )
+#define VOXEL_CUBE_VPACKED_BYTES ( VOXEL_FACE_VPACKED_BYTES * 6 )
+
+/* packed vertex layout - 2x uint32 (8 bytes) per vertex. unpacked by the voxel shaders in voxels.c so keep those in sync
+word 0: bits  0-4  x corner 0..CHUNK_X
+        bits  5-13 y corner 0..CHUNK_Y
+        bits 14-18 z corner 0..CHUNK_Z
+        bits 19-23 texcoord s in whole voxels. s runs along x or z on every face, so 0..CHUNK_X or CHUNK_Z
+        bits 24-27 sky light 0..VOXEL_LIGHT_MAX of the air in front of the face
+        bits 28-31 block light 0..VOXEL_LIGHT_MAX of the air in front of the face
+word 1: bits  0-3  palette index
+        bits  4-6  face index 0-5 (normal and picking face are derived from this)
+        bits  7-15 texcoord t in whole voxels 0..CHUNK_Y
+        bits 16-31 ambient occlusion of the whole quad, the same in all its vertices. see VOXEL_QUAD_AO_EDGES_SHIFT
+corners are voxel edges, so corner x spans voxel x-1 and voxel x. the old float positions were corner * 2 - 1 */
+#define VOXEL_VPACKED_X_SHIFT 0
+#define VOXEL_VPACKED_Y_SHIFT 5
+#define VOXEL_VPACKED_Z_SHIFT 14
+#define VOXEL_VPACKED_S_SHIFT 19
+#define VOXEL_VPACKED_SKY_LIGHT_SHIFT 24
+#define VOXEL_VPACKED_BLOCK_LIGHT_SHIFT 28
+#define VOXEL_VPACKED_PALIDX_SHIFT 0
+#define VOXEL_VPACKED_FACE_SHIFT 4
+#define VOXEL_VPACKED_T_SHIFT 7
+#define VOXEL_VPACKED_QUAD_AO_SHIFT 16
+#define VOXEL_VPACKED_XZ_MASK 0x1F
+#define VOXEL_VPACKED_Y_MASK 0x1FF
+#define VOXEL_VPACKED_FACE_MASK 0x7
+#define VOXEL_VPACKED_PALIDX_MASK 0xF
+#define VOXEL_VPACKED_S_MASK 0x1F
+#define VOXEL_VPACKED_T_MASK 0x1FF
+#define VOXEL_VPACKED_LIGHT_MASK 0xF
+#define VOXEL_VPACKED_QUAD_AO_MASK 0xFFFF
+
+/* ambient occlusion is baked per corner of each face from the 3 voxels in front of the face that touch the corner: the 2 along its edges and the
+diagonal one. 0 is a corner boxed in by both edge voxels and VOXEL_AO_MAX is a corner with nothing around it */
+#define VOXEL_AO_MAX 3
+
+/* a quad only covers exposed faces, and a corner with exposed faces all round it has nothing in front to occlude it, so only the corners on a quad's
+border can be darker than VOXEL_AO_MAX. a quad's ambient occlusion is 2 bits for each of its 4 corners, corner (s,t) at bit 2 * ( s + 2t ) where s and
+t are 0 at texcoord 0 and 1 at the far end, then 2 bits for the corners along each of its 4 edges in between, which are all the same: the s = 0 edge,
+s = w, t = 0, then t = h. the fragment shader interpolates between the 4 corners of the voxel face it's in, so a merged quad shades exactly like the
+faces it covers. the last vertex of each triangle, which flat attributes come from, is the s = w, t = h corner, so that the shader knows w and h */
+#define VOXEL_QUAD_AO_EDGES_SHIFT 8
+#define VOXEL_QUAD_AO_OPEN 0xFFFF
+
+/* light levels are 0 (dark) to VOXEL_LIGHT_MAX, one byte per voxel: sky light in the high 4 bits and block light, from lamps, in the low 4 bits.
+see light.h for how light spreads */
+#define VOXEL_LIGHT_MAX 15
+#define VOXEL_LIGHT_SKY( light ) ( ( light ) >> 4 )
+#define VOXEL_LIGHT_BLOCK( light ) ( ( light ) & 0xF )
+#define VOXEL_LIGHT_PACK( sky, block ) ( (uint8_t)( ( sky ) << 4 | ( block ) ) )
+
+// BLOCK_TYPE_N is the number of types, not a type
+typedef enum block_type_t {
+  BLOCK_TYPE_AIR = 0,
+  BLOCK_TYPE_CRUST,
+  BLOCK_TYPE_GRASS,
+  BLOCK_TYPE_DIRT,
+  BLOCK_TYPE_STONE,
+  BLOCK_TYPE_LAMP,
+  BLOCK_TYPE_ORE,
+  BLOCK_TYPE_WATER, // fluid sources. see fluid.h
+  BLOCK_TYPE_LAVA,
+  BLOCK_TYPE_WATER_FLOWING, // made and removed by the fluid sim, rather than placed
+  BLOCK_TYPE_LAVA_FLOWING,
+  BLOCK_TYPE_N
+} block_type_t;
+
+/* PER_FACE emits 2 triangles for every exposed voxel face.
+GREEDY merges coplanar faces with the same palette index and light into maximal rectangles. texcoords run 0..w and 0..h across a merged rectangle so
+the texture must use a repeating wrap mode. faces merge whatever their ambient occlusion, as long as the corners along each edge of the rectangle all
+have the same occlusion. see VOXEL_QUAD_AO_EDGES_SHIFT */
+typedef enum chunk_mesher_t { CHUNK_MESHER_PER_FACE = 0, CHUNK_MESHER_GREEDY } chunk_mesher_t;
+
+// levels of detail for far away chunks. level n draws cells of 2^n voxels along each side. 0 is full detail
+#define CHUNK_LOD_LEVELS 4
+
+#pragma pack( push, 1 )
+typedef struct voxel_t {
+  uint8_t type;
+} voxel_t;
+
+#pragma pack( pop )
+
+/* palette + run-length encoded voxels. typically 10-20x smaller than the voxels array for terrain.
+each column of CHUNK_Y voxels is stored as runs going up from y=0. a run is a uint16 with (length - 1) in the low byte and a palette index in the
+high byte. the palette keeps runs at 2 bytes regardless of what voxel_t grows to */
+typedef struct chunk_rle_t {
+  uint32_t column_starts[CHUNK_X * CHUNK_Z + 1]; // index of each column's first run. columns go z then x. the last entry is n_runs
+  uint16_t* runs;
+  uint32_t n_runs;
+  uint8_t palette[256]; // block types
+  uint32_t n_palette;
+} chunk_rle_t;
+
+#pragma pack( push, 1 )
+/* a chunk is held either as a plain voxels array or compressed. exactly one of voxels and rle is non-NULL.
+reading works on either form. writing decompresses first, so a chunk being edited has a plain working copy until chunk_compress() is called again
+light is kept per section, apart from the voxels, so that compressing doesn't touch it. a section that is all one light level, such as open sky or solid
+rock, has no array and is just its light_fill value. flowing fluid levels are kept the same way, and only sections with flowing fluid in them have an
+array */
+typedef struct chunk_t {
+  voxel_t* voxels;
+  chunk_rle_t* rle;
+  uint8_t* light[CHUNK_SECTIONS]; // CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y bytes, x then z then y, or NULL
+  uint8_t light_fill[CHUNK_SECTIONS];
+  uint8_t* fluid_levels[CHUNK_SECTIONS]; // laid out like light, or NULL for all 0
+  uint16_t n_fluid_levels[CHUNK_SECTIONS]; // non-zero levels in each fluid_levels array. the array is freed when this goes back to 0
+  int heightmap[CHUNK_X * CHUNK_Z];
+  uint32_t n_non_air_voxels;
+  bool stays_plain; // set when chunk_compress() found the runs no smaller, so it isn't tried again until the next edit
+} chunk_t;
+#pragma pack( pop )
+
+typedef struct chunk_vertex_data_t {
+  uint32_t* packed_ptr; // VOXEL_VPACKED_COMPS uints per vertex
+  size_t n_vertices;
+  size_t n_vpacked_comps;
+  size_t vpacked_buffer_sz;
+} chunk_vertex_data_t;
+
+/* reusable vertex buffer for meshing. a zeroed arena is valid and empty. it grows as needed, and is never shrunk, so after the first few chunks meshing
+doesn't allocate. buffers are sized by the faces actually emitted rather than a worst case. not thread safe - use one arena per thread */
+typedef struct chunk_mesh_arena_t {
+  uint32_t* packed_ptr; // VOXEL_VPACKED_COMPS uints per vertex
+  size_t n_vertices;    // in use since the last reset
+  size_t max_vertices;  // capacity of packed_ptr
+} chunk_mesh_arena_t;
+
+#define CHUNK_MESH_ARENA_MIN_VERTICES ( 1024 * VOXEL_FACE_VERTS )
+
+// unpacked form of one vertex, for CPU-side users of chunk vertex data such as exporters and tests
+typedef struct voxel_vertex_t {
+  int x, y, z;  // corner. 0..CHUNK_X etc.
+  int face_idx; // 0-5 is -x,+x,-y,+y,-z,+z
+  uint32_t palidx;
+  int s, t; // texcoords in whole voxels. the texture repeats once per voxel
+  int sky_light, block_light; // 0..VOXEL_LIGHT_MAX
+  uint32_t quad_ao;           // see VOXEL_QUAD_AO_EDGES_SHIFT
+} voxel_vertex_t;
+
+/* the 4 chunks sharing a border with a chunk being meshed. faces against a solid neighbour voxel are culled, and light on border faces is
+looked up in the neighbour. a NULL entry is the edge of the world, where faces are always emitted, in full sky light.
+the diagonal chunks only touch at a corner column, which ambient occlusion on the corner's faces reads. NULL ones count as air */
+typedef struct chunk_neighbours_t {
+  const chunk_t* adjacent[4]; // -x, +x, -z, +z
+  const chunk_t* diagonal[4]; // -x-z, +x-z, -x+z, +x+z
+} chunk_neighbours_t;
+
+// caves in chunk_generate() chunks stay this many voxels under the grass, so they never change the heightmap, and this far up from the bottom
+#define CHUNK_CAVE_ROOF 4
+#define CHUNK_CAVE_FLOOR 2
+
+/* generates chunk cx,cz of the world with this seed from noise - see noise.h. hills from 2D noise, then tunnels and ore veins from 3D noise.
+only depends on its arguments, so chunks can be generated in any order, on any thread, at any coords, and still line up with their neighbours */
+chunk_t chunk_generate( uint32_t seed, int cx, int cz );
+
+// RETURNS the height of the ground at world voxel coords x,z that chunk_generate() uses. world voxel x is cx * CHUNK_X + the voxel's x in the chunk
+int chunk_generate_height( uint32_t seed, int x, int z );
+
+/* PARAMS
+- heightmap - square heightmap covering the whole world
+- hm_dims   - width or height of heightmap in pixels
+- x_offset, z_offset - position of this chunk's first column in the heightmap */
+chunk_t chunk_generate_from_heightmap( const uint8_t* heightmap, int hm_dims, int x_offset, int z_offset );
+
+void chunk_free( chunk_t* chunk );
+
+// RETURNS a deep copy of chunk in the same form, compressed or not. call chunk_free() on it
+chunk_t chunk_copy( const chunk_t* chunk );
+
+/* RETURNS a compressed copy of just the columns x,z from min to max inclusive, with their light. every other voxel is air, and dark unless its section
+takes the light of the first copied voxel in its section. enough of a neighbour for meshing a chunk: pass the border column line of an adjacent chunk, or the corner column of a
+diagonal one, to chunk_gen_vertex_data() and mesh_cache_key() as the full chunk would be. fluid levels aren't copied. call chunk_free() on it */
+chunk_t chunk_copy_columns( const chunk_t* chunk, int min_x, int min_z, int max_x, int max_z );
+
+/* converts the voxels to the palette + RLE form and frees the voxels array. does nothing if already compressed, or if the runs would take more memory
+than the voxels array, such as for a chunk whose type changes every voxel or two up each column. that sets stays_plain, and until an edit clears it
+the runs aren't built again */
+void chunk_compress( chunk_t* chunk );
+
+// converts back to a voxels array. does nothing if not compressed
+void chunk_decompress( chunk_t* chunk );
+
+// heap memory held by the chunk's voxels in their current form, plus the struct itself
+size_t chunk_resident_bytes( const chunk_t* chunk );
+
+/* upper bound on the bytes chunk_save_to_mem() writes: a byte per voxel, bit-packed with a full palette. the runs are only written when they're
+smaller than that. terrain is a few KB */
+#define CHUNK_SAVE_MAX_BYTES ( sizeof( uint16_t ) + 256 + CHUNK_X * CHUNK_Y * CHUNK_Z )
+// set in the first uint16 of a saved chunk for the bit-packed form
+#define CHUNK_SAVE_PACKED_FLAG 0x8000
+
+/* serialise a chunk's voxels for a file in whichever of two forms is smaller. both start with uint16 n_palette, uint8 palette[n_palette]
+- runs: uint32 n_runs, uint16 runs[n_runs], as in chunk_rle_t. terrain is a few hundred runs
+- bit-packed: CHUNK_SAVE_PACKED_FLAG is set in n_palette, then each voxel's palette index in 1, 2, 4, or 8 bits, enough for the palette, in the order
+  of the voxels array. for chunks too busy for runs, such as one whose type changes every voxel up each column
+the heightmap, counts, and light are derived data and are rebuilt on load. light is only rebuilt down each column - see chunk_init_sky_light()
+RETURNS the number of bytes written to dest, or 0 if dest_sz is too small */
+size_t chunk_save_to_mem( const chunk_t* chunk, uint8_t* dest, size_t dest_sz );
+
+/* creates a chunk from memory written by chunk_save_to_mem(), compressed unless that wouldn't be smaller. call chunk_free() afterwards
+RETURNS false if src isn't a valid saved chunk, in which case nothing is allocated and chunk is zeroed */
+bool chunk_load_from_mem( const uint8_t* src, size_t n_bytes, chunk_t* chunk );
+
+/*
+block_type must not be NULL
+RETURNS false if xyz is out of bounds */
+bool get_block_type_in_chunk( const chunk_t* chunk, int x, int y, int z, block_type_t* block_type );
+
+/* doesn't update light. see light_block_changed()
+RETURNS
+- true if block was changed
+- false if no change was required since type is the same as before
+- false and does nothing if coords are out of chunk bounds */
+bool set_block_type_in_chunk( chunk_t* chunk, int x, int y, int z, block_type_t type );
+
+// RETURNS the light level, 0..VOXEL_LIGHT_MAX, that a block of this type gives off. 0 for most blocks
+int block_type_light_emission( block_type_t type );
+
+// RETURNS the packed light of voxel x,y,z - see VOXEL_LIGHT_PACK(). solid voxels are 0, apart from lamps which hold their own light
+uint8_t chunk_get_light( const chunk_t* chunk, int x, int y, int z );
+
+/* sets the packed light of voxel x,y,z, giving its section a light array if it didn't have one
+RETURNS true if the light changed */
+bool chunk_set_light( chunk_t* chunk, int x, int y, int z, uint8_t light );
+
+// RETURNS the level of flowing fluid voxel x,y,z, or 0 if it doesn't have one. see fluid.h for what levels mean
+uint8_t chunk_get_fluid_level( const chunk_t* chunk, int x, int y, int z );
+
+/* sets the level of fluid voxel x,y,z, giving its section a level array if it didn't have one and the level isn't 0, and freeing it when the last
+non-zero level in it is cleared. levels are derived data, like light, so they aren't saved. fluid_chunk_loaded() rebuilds them
+RETURNS true if the level changed */
+bool chunk_set_fluid_level( chunk_t* chunk, int x, int y, int z, uint8_t level );
+
+/* resets the chunk's light to full sky light above the heightmap in each column and dark below it. doesn't spread light sideways, under overhangs,
+or out of lamps. done by chunk_generate() and chunk_load_from_mem(). light_chunk_loaded() does the rest */
+void chunk_init_sky_light( chunk_t* chunk );
+
+// returns true if x,y,z is out of bounds of chunk
+// returns true if y > heightmap at (x,z). if equal returns false.
+bool is_voxel_above_surface( const chunk_t* chunk, int x, int y, int z );
+
+bool is_voxel_face_exposed_to_sun( const chunk_t* chunk, int x, int y, int z, int face_idx );
+
+/* bitmask of the sections ( bit n is layers n * CHUNK_SECTION_Y up to the next section ) whose vertex data can change after set_block_type_in_chunk()
+changed voxel layer y, and the column's heightmap went from prev_height to new_height. the same sections of a neighbouring chunk sharing the border
+are affected too. covers:
+- faces of the voxels directly above and below the edit, which can be over a section boundary
+- sunlight on faces next to the air voxels between the old and new column height, which can span many sections
+when light is spread with light.h it reports the sections whose light changed itself, so pass y for both heights to get just the faces */
+uint32_t chunk_sections_changed_by_edit( int y, int prev_height, int new_height );
+
+// every pair of section faces connected. also what a section that hasn't been looked at yet should be assumed to be
+#define CHUNK_SECTION_ALL_CONNECTED 0x7FFF
+
+/* which pairs of a section's 6 faces ( -x,+x,-y,+y,-z,+z like face_idx ) are joined by a path through air inside the section. found by flood filling
+each pocket of air. a bit per pair of faces - test it with chunk_section_faces_connected(). a solid section is 0
+used to cull sections that can't be seen from the camera through caves and over hills - see visibility.h */
+uint16_t chunk_section_connectivity( const chunk_t* chunk, int section );
+
+// RETURNS true if air joins face_a and face_b of a section with this connectivity. false if they are the same face
+bool chunk_section_faces_connected( uint16_t connectivity, int face_a, int face_b );
+
+/* generate vertex data for the layers of a chunk between from_y_inclusive and to_y_exclusive
+faces come sorted by chunk_face_layer(), lowest first, so the faces below any height are a prefix of the vertices - see chunk_vertex_data_layer_ends()
+neighbours may be NULL, in which case every face on the chunk's border is emitted
+call chunk_free_vertex_data() when done with it
+PERFORMANCE WARNING: allocates a new buffer every call. use chunk_gen_vertex_data_in_arena() when meshing repeatedly */
+chunk_vertex_data_t chunk_gen_vertex_data(
+  const chunk_t* chunk, const chunk_neighbours_t* neighbours, int from_y_inclusive, int to_y_exclusive, chunk_mesher_t mesher );
+
+// only for vertex data from chunk_gen_vertex_data(). vertex data from an arena belongs to the arena
+void chunk_free_vertex_data( chunk_vertex_data_t* chunk_vertex_data );
+
+/* the same as chunk_gen_vertex_data() but appends the vertices to the arena's buffer, after any written since the last chunk_mesh_arena_reset().
+RETURNS a view into the arena. the buffer can move when it grows, so the view is only valid until the next append, reset, or free.
+to keep several results, note arena->n_vertices before each call and get views with chunk_mesh_arena_vertex_data() when done appending */
+chunk_vertex_data_t chunk_gen_vertex_data_in_arena( chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours,
+  int from_y_inclusive, int to_y_exclusive, chunk_mesher_t mesher );
+
+/* the same as chunk_gen_vertex_data_in_arena() but for the whole chunk at level of detail lod, 1 to CHUNK_LOD_LEVELS - 1. always greedy.
+a cell is solid if any of its voxels is, with the type of its top-most solid voxel. faces on the chunk's border test the neighbours at full detail,
+so a LOD chunk next to a chunk at any other LOD, or a missing one, has no cracks between them and needs no skirts.
+textures still tile once per voxel. there's no ambient occlusion at these distances - every corner is VOXEL_AO_MAX */
+chunk_vertex_data_t chunk_gen_lod_vertex_data_in_arena( chunk_mesh_arena_t* arena, const chunk_t* chunk, const chunk_neighbours_t* neighbours, int lod );
+
+/* RETURNS the lowest voxel layer the face covers. face_packed is the face's first vertex. faces merged up a wall cover several layers
+- so a wall face can reach above a height its layer is below */
+int chunk_face_layer( const uint32_t* face_packed );
+
+/* layer_ends[i] is set to the number of vertices in the faces of layers from_y_inclusive to from_y_inclusive + i. drawing that many vertices from the
+start shows everything below layer from_y_inclusive + i + 1. vertex_data must be sorted by layer, like chunk_gen_vertex_data() output, and start
+at or above from_y_inclusive */
+void chunk_vertex_data_layer_ends( const chunk_vertex_data_t* vertex_data, int from_y_inclusive, int n_layers, uint32_t* layer_ends );
+
+// RETURNS a view of n_vertices already in the arena starting at first_vertex, eg to upload straight from the arena
+chunk_vertex_data_t chunk_mesh_arena_vertex_data( const chunk_mesh_arena_t* arena, size_t first_vertex, size_t n_vertices );
+
+// empties the arena for the next chunk. keeps its buffer
+void chunk_mesh_arena_reset( chunk_mesh_arena_t* arena );
+
+void chunk_mesh_arena_free( chunk_mesh_arena_t* arena );
+
+// dest must have space for VOXEL_VPACKED_COMPS uints
+void voxel_vertex_pack( voxel_vertex_t vertex, uint32_t* dest );
+
+voxel_vertex_t voxel_vertex_unpack( const uint32_t* src );
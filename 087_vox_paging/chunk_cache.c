@@ -0,0 +1,114 @@
+#include "chunk_cache.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t _hash( int cx, int cz ) {
+  // mix both coords so that rows and columns of chunks don't land in runs of neighbouring entries
+  uint32_t h = (uint32_t)cx * 0x9E3779B1u ^ (uint32_t)cz * 0x85EBCA77u;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  return h;
+}
+
+chunk_cache_t chunk_cache_alloc( int max_slots ) {
+  assert( max_slots > 0 );
+
+  chunk_cache_t cache = ( chunk_cache_t ){ .max_slots = max_slots, .n_free = max_slots };
+  uint32_t n_entries  = 1;
+  while ( n_entries < (uint32_t)max_slots * 2 ) { n_entries *= 2; }
+  cache.table_mask = n_entries - 1;
+  cache.slots      = calloc( max_slots, sizeof( chunk_cache_slot_t ) );
+  cache.free_slots = malloc( max_slots * sizeof( int ) );
+  cache.table      = malloc( n_entries * sizeof( int ) );
+  assert( cache.slots && cache.free_slots && cache.table );
+  for ( uint32_t i = 0; i < n_entries; i++ ) { cache.table[i] = -1; }
+  // popped from the end, so slot 0 is handed out first
+  for ( int i = 0; i < max_slots; i++ ) { cache.free_slots[i] = max_slots - 1 - i; }
+  return cache;
+}
+
+void chunk_cache_free( chunk_cache_t* cache ) {
+  assert( cache );
+
+  free( cache->slots );
+  free( cache->free_slots );
+  free( cache->table );
+  memset( cache, 0, sizeof( chunk_cache_t ) );
+}
+
+// RETURNS the table entry holding cx,cz, or the empty entry where it would go
+static uint32_t _probe( const chunk_cache_t* cache, int cx, int cz ) {
+  uint32_t entry = _hash( cx, cz ) & cache->table_mask;
+  while ( 1 ) {
+    const int slot = cache->table[entry];
+    if ( slot < 0 ) { return entry; }
+    if ( cache->slots[slot].cx == cx && cache->slots[slot].cz == cz ) { return entry; }
+    entry = ( entry + 1 ) & cache->table_mask;
+  }
+}
+
+int chunk_cache_find( const chunk_cache_t* cache, int cx, int cz ) {
+  assert( cache );
+  return cache->table[_probe( cache, cx, cz )];
+}
+
+int chunk_cache_insert( chunk_cache_t* cache, int cx, int cz ) {
+  assert( cache );
+  if ( 0 == cache->n_free ) { return -1; }
+
+  const uint32_t entry = _probe( cache, cx, cz );
+  assert( cache->table[entry] < 0 ); // already in the cache
+
+  const int slot      = cache->free_slots[--cache->n_free];
+  cache->slots[slot]  = ( chunk_cache_slot_t ){ .cx = cx, .cz = cz, .last_used = ++cache->tick, .in_use = true };
+  cache->table[entry] = slot;
+  cache->n_used++;
+  return slot;
+}
+
+void chunk_cache_remove( chunk_cache_t* cache, int slot ) {
+  assert( cache && slot >= 0 && slot < cache->max_slots && cache->slots[slot].in_use );
+
+  uint32_t hole = _probe( cache, cache->slots[slot].cx, cache->slots[slot].cz );
+  assert( cache->table[hole] == slot );
+  cache->table[hole] = -1;
+  // backward shift: move up any later entry in the run that can't be reached past the hole any more
+  uint32_t entry = ( hole + 1 ) & cache->table_mask;
+  while ( cache->table[entry] >= 0 ) {
+    const int moving    = cache->table[entry];
+    const uint32_t home = _hash( cache->slots[moving].cx, cache->slots[moving].cz ) & cache->table_mask;
+    // distances along the probe run, wrapping around the end of the table
+    const uint32_t home_to_entry = ( entry - home ) & cache->table_mask;
+    const uint32_t home_to_hole  = ( hole - home ) & cache->table_mask;
+    if ( home_to_hole < home_to_entry ) {
+      cache->table[hole]  = moving;
+      cache->table[entry] = -1;
+      hole                = entry;
+    }
+    entry = ( entry + 1 ) & cache->table_mask;
+  }
+
+  cache->slots[slot].in_use          = false;
+  cache->free_slots[cache->n_free++] = slot;
+  cache->n_used--;
+}
+
+void chunk_cache_touch( chunk_cache_t* cache, int slot ) {
+  assert( cache && slot >= 0 && slot < cache->max_slots && cache->slots[slot].in_use );
+  cache->slots[slot].last_used = ++cache->tick;
+}
+
+int chunk_cache_lru_slot( const chunk_cache_t* cache, bool ( *can_evict )( int slot, void* user_ptr ), void* user_ptr ) {
+  assert( cache );
+
+  int lru_slot = -1;
+  for ( int i = 0; i < cache->max_slots; i++ ) {
+    if ( !cache->slots[i].in_use ) { continue; }
+    if ( lru_slot >= 0 && cache->slots[i].last_used >= cache->slots[lru_slot].last_used ) { continue; }
+    if ( can_evict && !can_evict( i, user_ptr ) ) { continue; }
+    lru_slot = i;
+  }
+  return lru_slot;
+}
@@ -0,0 +1,49 @@
+/* Chunk cache - maps chunk coordinates to a fixed set of slots, so the world has no size limit and only the chunks near the camera are resident.
+A slot index is a chunk id: the world keeps its per-chunk arrays ( voxels, meshes, dirty flags ) indexed by slot, and the id is what picking
+encodes. No GL or file IO in here so that this can be tested headless. See voxels.c for the streaming that uses it.
+
+Design:
+  open addressing hash table with linear probing, keyed by (cx,cz), holding slot indices. twice as many entries as slots so probes stay short
+  removal shifts later entries of the probe run back rather than leaving tombstones, so lookups never slow down as chunks come and go
+  every slot has a last-used tick. chunk_cache_lru_slot() picks the least recently used slot the caller allows to be evicted
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct chunk_cache_slot_t {
+  int cx, cz;
+  uint32_t last_used; // tick of the last chunk_cache_touch()
+  bool in_use;
+} chunk_cache_slot_t;
+
+typedef struct chunk_cache_t {
+  chunk_cache_slot_t* slots;
+  int max_slots, n_used;
+  int* free_slots; // stack of unused slot indices
+  int n_free;
+  int* table; // slot index per entry, or -1 if empty
+  uint32_t table_mask;
+  uint32_t tick;
+} chunk_cache_t;
+
+chunk_cache_t chunk_cache_alloc( int max_slots );
+
+void chunk_cache_free( chunk_cache_t* cache );
+
+// RETURNS the slot holding chunk cx,cz, or -1 if it isn't in the cache
+int chunk_cache_find( const chunk_cache_t* cache, int cx, int cz );
+
+/* takes a free slot for chunk cx,cz, which must not be in the cache already. the slot counts as just used
+RETURNS the slot, or -1 if all slots are in use */
+int chunk_cache_insert( chunk_cache_t* cache, int cx, int cz );
+
+void chunk_cache_remove( chunk_cache_t* cache, int slot );
+
+// marks a slot as the most recently used
+void chunk_cache_touch( chunk_cache_t* cache, int slot );
+
+/* finds the least recently used slot for which can_evict( slot, user_ptr ) returns true. can_evict may be NULL to consider every slot in use
+RETURNS the slot or -1 if there is none */
+int chunk_cache_lru_slot( const chunk_cache_t* cache, bool ( *can_evict )( int slot, void* user_ptr ), void* user_ptr );
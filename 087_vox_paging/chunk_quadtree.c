@@ -0,0 +1,176 @@
+#include "chunk_quadtree.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct chunk_quadtree_heap_item_t {
+  float sqdist;
+  int node;
+  int x, z, size; // chunks the node covers, from the tree's origin at -CHUNK_QUADTREE_HALF_W
+} chunk_quadtree_heap_item_t;
+
+chunk_quadtree_t chunk_quadtree_alloc( int max_chunks ) {
+  assert( max_chunks > 0 );
+
+  // a leaf per chunk and about a third as many again above them, plus the paths down from the root
+  chunk_quadtree_t tree = ( chunk_quadtree_t ){ .max_nodes = max_chunks + max_chunks / 2 + CHUNK_QUADTREE_LEVELS * 4, .root = -1 };
+  tree.nodes            = malloc( tree.max_nodes * sizeof( chunk_quadtree_node_t ) );
+  tree.free_nodes       = malloc( tree.max_nodes * sizeof( int ) );
+  assert( tree.nodes && tree.free_nodes );
+  return tree;
+}
+
+void chunk_quadtree_free( chunk_quadtree_t* tree ) {
+  assert( tree );
+
+  free( tree->nodes );
+  free( tree->free_nodes );
+  free( tree->heap );
+  memset( tree, 0, sizeof( chunk_quadtree_t ) );
+  tree->root = -1;
+}
+
+static int _alloc_node( chunk_quadtree_t* tree ) {
+  int node = -1;
+  if ( tree->n_free > 0 ) {
+    node = tree->free_nodes[--tree->n_free];
+  } else {
+    if ( tree->n_nodes == tree->max_nodes ) {
+      tree->max_nodes *= 2;
+      tree->nodes      = realloc( tree->nodes, tree->max_nodes * sizeof( chunk_quadtree_node_t ) );
+      tree->free_nodes = realloc( tree->free_nodes, tree->max_nodes * sizeof( int ) );
+      assert( tree->nodes && tree->free_nodes );
+    }
+    node = tree->n_nodes++;
+  }
+  tree->nodes[node] = ( chunk_quadtree_node_t ){ .children = { -1, -1, -1, -1 }, .n_chunks = 0, .chunk_id = -1 };
+  return node;
+}
+
+// which child of a node at depth holds chunk x,z. x and z are from the tree's origin
+static int _quadrant( uint32_t x, uint32_t z, int depth ) {
+  const int bit = CHUNK_QUADTREE_LEVELS - 1 - depth;
+  return (int)( ( ( z >> bit ) & 1 ) << 1 | ( ( x >> bit ) & 1 ) );
+}
+
+void chunk_quadtree_insert( chunk_quadtree_t* tree, int cx, int cz, int chunk_id ) {
+  assert( tree && tree->nodes );
+  assert( cx >= -CHUNK_QUADTREE_HALF_W && cx < CHUNK_QUADTREE_HALF_W && cz >= -CHUNK_QUADTREE_HALF_W && cz < CHUNK_QUADTREE_HALF_W );
+
+  const uint32_t x = (uint32_t)( cx + CHUNK_QUADTREE_HALF_W ), z = (uint32_t)( cz + CHUNK_QUADTREE_HALF_W );
+  if ( tree->root < 0 ) { tree->root = _alloc_node( tree ); }
+  int node = tree->root;
+  tree->nodes[node].n_chunks++;
+  for ( int depth = 0; depth < CHUNK_QUADTREE_LEVELS; depth++ ) {
+    const int quadrant = _quadrant( x, z, depth );
+    int child          = tree->nodes[node].children[quadrant];
+    if ( child < 0 ) {
+      child                                = _alloc_node( tree ); // may move the pool
+      tree->nodes[node].children[quadrant] = child;
+    }
+    node = child;
+    tree->nodes[node].n_chunks++;
+  }
+  assert( 1 == tree->nodes[node].n_chunks ); // already in the tree
+  tree->nodes[node].chunk_id = chunk_id;
+}
+
+bool chunk_quadtree_remove( chunk_quadtree_t* tree, int cx, int cz ) {
+  assert( tree && tree->nodes );
+  if ( cx < -CHUNK_QUADTREE_HALF_W || cx >= CHUNK_QUADTREE_HALF_W || cz < -CHUNK_QUADTREE_HALF_W || cz >= CHUNK_QUADTREE_HALF_W ) { return false; }
+  if ( tree->root < 0 ) { return false; }
+
+  const uint32_t x = (uint32_t)( cx + CHUNK_QUADTREE_HALF_W ), z = (uint32_t)( cz + CHUNK_QUADTREE_HALF_W );
+  int path[CHUNK_QUADTREE_LEVELS + 1];
+  path[0] = tree->root;
+  for ( int depth = 0; depth < CHUNK_QUADTREE_LEVELS; depth++ ) {
+    path[depth + 1] = tree->nodes[path[depth]].children[_quadrant( x, z, depth )];
+    if ( path[depth + 1] < 0 ) { return false; }
+  }
+  // from the leaf up, freeing nodes with nothing left under them
+  for ( int depth = CHUNK_QUADTREE_LEVELS; depth >= 0; depth-- ) {
+    const int node = path[depth];
+    if ( --tree->nodes[node].n_chunks > 0 ) { continue; }
+    tree->free_nodes[tree->n_free++] = node;
+    if ( depth > 0 ) {
+      tree->nodes[path[depth - 1]].children[_quadrant( x, z, depth - 1 )] = -1;
+    } else {
+      tree->root = -1;
+    }
+  }
+  return true;
+}
+
+// closest the centre of any of the size x size chunks from x,z could be to the camera, squared. x,z are in world chunk coords
+static float _area_sqdist( const chunk_quadtree_query_t* query, int x, int z, int size ) {
+  const float min_x = x + 0.5f, max_x = x + size - 0.5f, min_z = z + 0.5f, max_z = z + size - 0.5f;
+  const float dx = query->cam_cx < min_x ? min_x - query->cam_cx : ( query->cam_cx > max_x ? query->cam_cx - max_x : 0.0f );
+  const float dz = query->cam_cz < min_z ? min_z - query->cam_cz : ( query->cam_cz > max_z ? query->cam_cz - max_z : 0.0f );
+  return dx * dx + dz * dz;
+}
+
+static void _heap_push( chunk_quadtree_t* tree, int* n_items, chunk_quadtree_heap_item_t item ) {
+  if ( *n_items == tree->heap_max ) {
+    tree->heap_max = tree->heap_max > 0 ? tree->heap_max * 2 : 1024;
+    tree->heap     = realloc( tree->heap, tree->heap_max * sizeof( chunk_quadtree_heap_item_t ) );
+    assert( tree->heap );
+  }
+  int i = ( *n_items )++;
+  while ( i > 0 && tree->heap[( i - 1 ) / 2].sqdist > item.sqdist ) {
+    tree->heap[i] = tree->heap[( i - 1 ) / 2];
+    i             = ( i - 1 ) / 2;
+  }
+  tree->heap[i] = item;
+}
+
+static chunk_quadtree_heap_item_t _heap_pop( chunk_quadtree_t* tree, int* n_items ) {
+  const chunk_quadtree_heap_item_t top  = tree->heap[0];
+  const chunk_quadtree_heap_item_t last = tree->heap[--( *n_items )];
+  int i                                 = 0;
+  while ( 1 ) {
+    int child = 2 * i + 1;
+    if ( child >= *n_items ) { break; }
+    if ( child + 1 < *n_items && tree->heap[child + 1].sqdist < tree->heap[child].sqdist ) { child++; }
+    if ( tree->heap[child].sqdist >= last.sqdist ) { break; }
+    tree->heap[i] = tree->heap[child];
+    i             = child;
+  }
+  if ( *n_items > 0 ) { tree->heap[i] = last; }
+  return top;
+}
+
+// pushes the node if any of it is in view and in range
+static void _push_node( chunk_quadtree_t* tree, const chunk_quadtree_query_t* query, int* n_items, int node, int x, int z, int size ) {
+  const int cx = x - CHUNK_QUADTREE_HALF_W, cz = z - CHUNK_QUADTREE_HALF_W;
+  const float sqdist = _area_sqdist( query, cx, cz, size );
+  if ( sqdist > query->max_sqdist ) { return; }
+  if ( query->is_area_in_view && !query->is_area_in_view( cx, cz, size, query->user_ptr ) ) { return; }
+  _heap_push( tree, n_items, ( chunk_quadtree_heap_item_t ){ .sqdist = sqdist, .node = node, .x = x, .z = z, .size = size } );
+}
+
+int chunk_quadtree_front_to_back( chunk_quadtree_t* tree, const chunk_quadtree_query_t* query, int* chunk_ids, float* sqdists, int max_chunks ) {
+  assert( tree && query && chunk_ids );
+
+  tree->n_nodes_visited = 0;
+  if ( tree->root < 0 ) { return 0; }
+
+  int n_items = 0, n_chunks = 0;
+  _push_node( tree, query, &n_items, tree->root, 0, 0, 1 << CHUNK_QUADTREE_LEVELS );
+  while ( n_items > 0 && n_chunks < max_chunks ) {
+    const chunk_quadtree_heap_item_t item = _heap_pop( tree, &n_items );
+    const chunk_quadtree_node_t* node     = &tree->nodes[item.node];
+    tree->n_nodes_visited++;
+    // a leaf's key is its own centre, so everything still in the heap is at least as far away
+    if ( 1 == item.size ) {
+      if ( sqdists ) { sqdists[n_chunks] = item.sqdist; }
+      chunk_ids[n_chunks++] = node->chunk_id;
+      continue;
+    }
+    const int half = item.size / 2;
+    for ( int quadrant = 0; quadrant < 4; quadrant++ ) {
+      if ( node->children[quadrant] < 0 ) { continue; }
+      _push_node( tree, query, &n_items, node->children[quadrant], item.x + ( quadrant & 1 ) * half, item.z + ( quadrant >> 1 ) * half, half );
+    }
+  }
+  return n_chunks;
+}
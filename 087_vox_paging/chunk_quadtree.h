@@ -0,0 +1,60 @@
+/* Chunk quadtree - spatial index of the resident chunks, so that the draw queue comes out nearest first without testing and sorting every chunk.
+No GL in here so that it can be tested headless. See voxels.c for the draw queue built from it.
+
+Design:
+  a fixed-depth quadtree over chunk coords. the root covers 2^CHUNK_QUADTREE_LEVELS chunks a side, centred on chunk 0,0, and each leaf is one chunk.
+  nodes are only made along the paths to chunks that are in the tree, and freed again when the last chunk under them is removed
+  nodes live in one pool indexed by int, with a free list, so inserting and removing only allocates while the pool is still growing
+  chunk_quadtree_front_to_back() is a best-first search: a min-heap of nodes keyed by the closest any chunk centre under them could be to the camera,
+  and of chunks keyed by their own centre. a chunk comes off the heap before anything further away, so the chunks come out exactly in order of
+  distance and nothing is sorted. nodes outside the view or past the max distance aren't pushed at all, and nor is anything under them
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// about 500 thousand chunks either side of 0,0. float positions run out of precision long before then
+#define CHUNK_QUADTREE_LEVELS 20
+#define CHUNK_QUADTREE_HALF_W ( 1 << ( CHUNK_QUADTREE_LEVELS - 1 ) )
+
+typedef struct chunk_quadtree_node_t {
+  int children[4]; // node indices or -1. index is ( z bit << 1 ) | x bit of the child's quadrant
+  int n_chunks;    // in the tree under this node
+  int chunk_id;    // leaves only
+} chunk_quadtree_node_t;
+
+typedef struct chunk_quadtree_query_t {
+  float cam_cx, cam_cz; // camera in chunk units. chunk cx,cz spans cx to cx + 1
+  float max_sqdist;     // chunks with centres further than this, squared and in chunk units, are left out
+  // RETURNS false if none of the size x size chunks from cx,cz can be seen, eg a frustum check. called for nodes and single chunks. may be NULL
+  bool ( *is_area_in_view )( int cx, int cz, int size, void* user_ptr );
+  void* user_ptr;
+} chunk_quadtree_query_t;
+
+typedef struct chunk_quadtree_t {
+  chunk_quadtree_node_t* nodes;
+  int n_nodes, max_nodes; // in the pool, including freed ones
+  int* free_nodes;        // stack of freed node indices
+  int n_free;
+  int root; // -1 when empty
+  // front to back search memory. kept between searches
+  struct chunk_quadtree_heap_item_t* heap;
+  int heap_max;
+  int n_nodes_visited; // by the last search, for stats
+} chunk_quadtree_t;
+
+// max_chunks sizes the node pool to start with. it grows if needed
+chunk_quadtree_t chunk_quadtree_alloc( int max_chunks );
+
+void chunk_quadtree_free( chunk_quadtree_t* tree );
+
+// chunk cx,cz must not be in the tree already, and must be within CHUNK_QUADTREE_HALF_W of 0,0
+void chunk_quadtree_insert( chunk_quadtree_t* tree, int cx, int cz, int chunk_id );
+
+// RETURNS false if chunk cx,cz wasn't in the tree
+bool chunk_quadtree_remove( chunk_quadtree_t* tree, int cx, int cz );
+
+/* writes the ids of the chunks in view, nearest centre first, to chunk_ids and their squared distances to sqdists, which may be NULL
+RETURNS the number written, at most max_chunks. the nearest are kept if there are more */
+int chunk_quadtree_front_to_back( chunk_quadtree_t* tree, const chunk_quadtree_query_t* query, int* chunk_ids, float* sqdists, int max_chunks );
@@ -0,0 +1,374 @@
+#include "fluid.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct fluid_update_t {
+  uint32_t tick; // due. unused in the relevel queue
+  int x, y, z;   // world voxel coords
+} fluid_update_t;
+
+typedef struct fluid_kind_t {
+  block_type_t source, flowing;
+  int max_level;
+  uint32_t delay; // ticks between steps
+} fluid_kind_t;
+
+static const fluid_kind_t _kinds[2] = { { BLOCK_TYPE_WATER, BLOCK_TYPE_WATER_FLOWING, 7, 4 }, { BLOCK_TYPE_LAVA, BLOCK_TYPE_LAVA_FLOWING, 3, 12 } };
+
+// steps to the 4 neighbours beside a voxel -x,+x,-z,+z
+static const int _side_x[4] = { -1, 1, 0, 0 };
+static const int _side_z[4] = { 0, 0, -1, 1 };
+
+// RETURNS the fluid a block is, or NULL if it isn't one
+static const fluid_kind_t* _kind_of( block_type_t type ) {
+  for ( int i = 0; i < 2; i++ ) {
+    if ( _kinds[i].source == type || _kinds[i].flowing == type ) { return &_kinds[i]; }
+  }
+  return NULL;
+}
+
+bool fluid_is_fluid( block_type_t type ) { return NULL != _kind_of( type ); }
+
+// rounds towards negative infinity, unlike /, so that eg voxel -1 is in chunk -1
+static int _floor_div( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); }
+
+static chunk_t* _chunk_at( fluid_engine_t* engine, int cx, int cz ) {
+  if ( engine->cached_chunk && engine->cached_cx == cx && engine->cached_cz == cz ) { return engine->cached_chunk; }
+  chunk_t* chunk = engine->chunk_at( cx, cz, engine->user_ptr );
+  if ( chunk ) {
+    engine->cached_chunk = chunk;
+    engine->cached_cx    = cx;
+    engine->cached_cz    = cz;
+  }
+  return chunk;
+}
+
+/* finds the chunk holding world voxel x,y,z and the voxel's x and z in it
+RETURNS NULL if the voxel is above or below the world or its chunk isn't loaded */
+static chunk_t* _voxel_at( fluid_engine_t* engine, int x, int y, int z, int* local_x, int* local_z ) {
+  if ( y < 0 || y >= CHUNK_Y ) { return NULL; }
+  const int cx = _floor_div( x, CHUNK_X ), cz = _floor_div( z, CHUNK_Z );
+  *local_x     = x - cx * CHUNK_X;
+  *local_z     = z - cz * CHUNK_Z;
+  return _chunk_at( engine, cx, cz );
+}
+
+// RETURNS the type of world voxel x,y,z, or BLOCK_TYPE_N if it's above or below the world or its chunk isn't loaded
+static block_type_t _type_at( fluid_engine_t* engine, int x, int y, int z ) {
+  int local_x, local_z;
+  const chunk_t* chunk = _voxel_at( engine, x, y, z, &local_x, &local_z );
+  if ( !chunk ) { return BLOCK_TYPE_N; }
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+  return type;
+}
+
+// RETURNS the level of world voxel x,y,z if it's fluid of this kind: 0 for a source, and 0 for flowing fluid whose level isn't known yet. -1 if it isn't
+static int _level_at( fluid_engine_t* engine, const fluid_kind_t* kind, int x, int y, int z ) {
+  int local_x, local_z;
+  const chunk_t* chunk = _voxel_at( engine, x, y, z, &local_x, &local_z );
+  if ( !chunk ) { return -1; }
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+  if ( kind->source == type ) { return 0; }
+  if ( kind->flowing == type ) { return chunk_get_fluid_level( chunk, local_x, y, local_z ); }
+  return -1;
+}
+
+// RETURNS the level of whatever fluid is at world voxel x,y,z, or -1 if it isn't fluid or it's flowing fluid whose level isn't known yet
+static int _known_level( fluid_engine_t* engine, int x, int y, int z ) {
+  const fluid_kind_t* kind = _kind_of( _type_at( engine, x, y, z ) );
+  if ( !kind ) { return -1; }
+  const int level = _level_at( engine, kind, x, y, z );
+  return 0 == level && kind->flowing == _type_at( engine, x, y, z ) ? -1 : level;
+}
+
+// fluid only spreads sideways where it can't fall: what's under it is neither air nor the same fluid. the bottom of the world holds it up
+static bool _spreads_sideways( fluid_engine_t* engine, const fluid_kind_t* kind, int x, int y, int z ) {
+  if ( 0 == y ) { return true; }
+  const block_type_t below = _type_at( engine, x, y - 1, z );
+  return BLOCK_TYPE_AIR != below && _kind_of( below ) != kind;
+}
+
+// RETURNS the level of fluid of this kind at world voxel x,y,z if it feeds its neighbours sideways, or -1 if it doesn't
+static int _feeding_level( fluid_engine_t* engine, const fluid_kind_t* kind, int x, int y, int z ) {
+  const int level = _level_at( engine, kind, x, y, z );
+  if ( level < 0 || ( 0 == level && kind->source != _type_at( engine, x, y, z ) ) ) { return -1; } // not this fluid, or its level isn't known yet
+  if ( level >= kind->max_level || !_spreads_sideways( engine, kind, x, y, z ) ) { return -1; }
+  return level;
+}
+
+// ties are broken by position so that entries for the same cell and tick come off the heap one after the other
+static bool _is_sooner( const fluid_update_t* a, const fluid_update_t* b ) {
+  if ( a->tick != b->tick ) { return a->tick < b->tick; }
+  if ( a->x != b->x ) { return a->x < b->x; }
+  if ( a->z != b->z ) { return a->z < b->z; }
+  return a->y < b->y;
+}
+
+static void _heap_push( fluid_engine_t* engine, fluid_update_t item ) {
+  if ( engine->n_queued == engine->max_queued ) {
+    engine->max_queued = engine->max_queued > 0 ? engine->max_queued * 2 : 1024;
+    engine->queue      = realloc( engine->queue, engine->max_queued * sizeof( fluid_update_t ) );
+    assert( engine->queue );
+  }
+  int i = engine->n_queued++;
+  while ( i > 0 && _is_sooner( &item, &engine->queue[( i - 1 ) / 2] ) ) {
+    engine->queue[i] = engine->queue[( i - 1 ) / 2];
+    i                = ( i - 1 ) / 2;
+  }
+  engine->queue[i] = item;
+}
+
+static fluid_update_t _heap_pop( fluid_engine_t* engine ) {
+  const fluid_update_t top  = engine->queue[0];
+  const fluid_update_t last = engine->queue[--engine->n_queued];
+  int i                     = 0;
+  while ( 1 ) {
+    int child = 2 * i + 1;
+    if ( child >= engine->n_queued ) { break; }
+    if ( child + 1 < engine->n_queued && _is_sooner( &engine->queue[child + 1], &engine->queue[child] ) ) { child++; }
+    if ( !_is_sooner( &engine->queue[child], &last ) ) { break; }
+    engine->queue[i] = engine->queue[child];
+    i                = child;
+  }
+  if ( engine->n_queued > 0 ) { engine->queue[i] = last; }
+  return top;
+}
+
+// queues world voxel x,y,z for its fluid's next step, if it is fluid
+static void _schedule( fluid_engine_t* engine, int x, int y, int z ) {
+  const fluid_kind_t* kind = _kind_of( _type_at( engine, x, y, z ) );
+  if ( !kind ) { return; }
+  _heap_push( engine, ( fluid_update_t ){ .tick = engine->tick + kind->delay, .x = x, .y = y, .z = z } );
+}
+
+// every cell whose update reads world voxel x,y,z: itself, its 6 neighbours, and the 4 beside the one above, which spread sideways depending on it
+static void _schedule_readers( fluid_engine_t* engine, int x, int y, int z ) {
+  _schedule( engine, x, y, z );
+  _schedule( engine, x, y - 1, z );
+  _schedule( engine, x, y + 1, z );
+  for ( int side = 0; side < 4; side++ ) {
+    _schedule( engine, x + _side_x[side], y, z + _side_z[side] );
+    _schedule( engine, x + _side_x[side], y + 1, z + _side_z[side] );
+  }
+}
+
+// RETURNS true if the block changed, rather than just its level
+static bool _set_block( fluid_engine_t* engine, int x, int y, int z, block_type_t type, uint8_t level ) {
+  int local_x, local_z;
+  chunk_t* chunk = _voxel_at( engine, x, y, z, &local_x, &local_z );
+  assert( chunk );
+  const bool changed       = set_block_type_in_chunk( chunk, local_x, y, local_z, type );
+  const bool level_changed = chunk_set_fluid_level( chunk, local_x, y, local_z, level );
+  if ( changed && engine->block_changed ) { engine->block_changed( x, y, z, engine->user_ptr ); }
+  if ( changed || level_changed ) { _schedule_readers( engine, x, y, z ); }
+  return changed;
+}
+
+// one step of the cell at world voxel x,y,z. RETURNS the number of blocks changed
+static int _update( fluid_engine_t* engine, int x, int y, int z ) {
+  int local_x, local_z;
+  chunk_t* chunk = _voxel_at( engine, x, y, z, &local_x, &local_z );
+  if ( !chunk ) { return 0; } // unloaded since it was queued. fluid_chunk_loaded() wakes it again
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+  const fluid_kind_t* kind = _kind_of( type );
+  if ( !kind ) { return 0; } // drained or dug out since it was queued
+
+  int level = 0;
+  if ( kind->flowing == type ) {
+    // the level it should be now, from what feeds it
+    int fed           = 0;
+    bool next_to_edge = false;
+    if ( _kind_of( _type_at( engine, x, y + 1, z ) ) == kind ) {
+      fed = 1;
+    } else {
+      for ( int side = 0; side < 4; side++ ) {
+        const int nx = x + _side_x[side], nz = z + _side_z[side];
+        if ( BLOCK_TYPE_N == _type_at( engine, nx, y, nz ) ) {
+          next_to_edge = true;
+          continue;
+        }
+        const int feeding = _feeding_level( engine, kind, nx, y, nz );
+        if ( feeding >= 0 && ( 0 == fed || feeding + 1 < fed ) ) { fed = feeding + 1; }
+      }
+    }
+    if ( 0 == fed ) {
+      if ( next_to_edge ) { return 0; } // could be fed from a chunk that isn't loaded. it's woken when that one is
+      return _set_block( engine, x, y, z, BLOCK_TYPE_AIR, 0 ) ? 1 : 0;
+    }
+    if ( chunk_set_fluid_level( chunk, local_x, y, local_z, (uint8_t)fed ) ) { _schedule_readers( engine, x, y, z ); }
+    level = fed;
+  }
+
+  // falls if it can, and only spreads sideways if it can't
+  if ( y > 0 ) {
+    block_type_t below = BLOCK_TYPE_AIR;
+    get_block_type_in_chunk( chunk, local_x, y - 1, local_z, &below );
+    if ( BLOCK_TYPE_AIR == below ) { return _set_block( engine, x, y - 1, z, kind->flowing, 1 ) ? 1 : 0; }
+  }
+  if ( level >= kind->max_level || !_spreads_sideways( engine, kind, x, y, z ) ) { return 0; }
+  int n_changed = 0;
+  for ( int side = 0; side < 4; side++ ) {
+    const int nx = x + _side_x[side], nz = z + _side_z[side];
+    if ( BLOCK_TYPE_AIR != _type_at( engine, nx, y, nz ) ) { continue; }
+    n_changed += _set_block( engine, nx, y, nz, kind->flowing, (uint8_t)( level + 1 ) ) ? 1 : 0;
+  }
+  return n_changed;
+}
+
+static void _push_relevel( fluid_engine_t* engine, int* n_relevel, int x, int y, int z ) {
+  if ( *n_relevel >= engine->relevel_max ) {
+    engine->relevel_max = engine->relevel_max ? engine->relevel_max * 2 : 1024;
+    engine->relevel     = realloc( engine->relevel, engine->relevel_max * sizeof( fluid_update_t ) );
+    assert( engine->relevel );
+  }
+  engine->relevel[( *n_relevel )++] = ( fluid_update_t ){ .x = x, .y = y, .z = z };
+}
+
+// RETURNS true if the chunk has any fluid in it. only looks at the palette of a compressed chunk
+static bool _has_fluid( const chunk_t* chunk ) {
+  if ( chunk->rle ) {
+    for ( uint32_t i = 0; i < chunk->rle->n_palette; i++ ) {
+      if ( fluid_is_fluid( (block_type_t)chunk->rle->palette[i] ) ) { return true; }
+    }
+    return false;
+  }
+  for ( int i = 0; i < CHUNK_X * CHUNK_Y * CHUNK_Z; i++ ) {
+    if ( fluid_is_fluid( (block_type_t)chunk->voxels[i].type ) ) { return true; }
+  }
+  return false;
+}
+
+/* pushes the world coords of the fluid voxels in columns from_x..to_x, from_z..to_z of chunk cx,cz onto the relevel queue. walks the runs of a
+compressed chunk rather than looking up every voxel */
+static void _push_fluid_voxels( fluid_engine_t* engine, int* n_relevel, const chunk_t* chunk, int cx, int cz, int from_x, int to_x, int from_z, int to_z ) {
+  for ( int z = from_z; z <= to_z; z++ ) {
+    for ( int x = from_x; x <= to_x; x++ ) {
+      const int column = CHUNK_X * z + x;
+      if ( chunk->rle ) {
+        const chunk_rle_t* rle = chunk->rle;
+        int run_y              = 0;
+        for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+          const int run_top = run_y + ( rle->runs[r] & 0xFF ) + 1;
+          if ( fluid_is_fluid( (block_type_t)rle->palette[rle->runs[r] >> 8] ) ) {
+            for ( int y = run_y; y < run_top; y++ ) { _push_relevel( engine, n_relevel, cx * CHUNK_X + x, y, cz * CHUNK_Z + z ); }
+          }
+          run_y = run_top;
+        }
+        continue;
+      }
+      for ( int y = 0; y < CHUNK_Y; y++ ) {
+        if ( fluid_is_fluid( (block_type_t)chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type ) ) {
+          _push_relevel( engine, n_relevel, cx * CHUNK_X + x, y, cz * CHUNK_Z + z );
+        }
+      }
+    }
+  }
+}
+
+/* gives flowing fluid of this kind at world voxel x,y,z the level, if it has no level yet or a higher one
+RETURNS true if it did */
+static bool _relevel_voxel( fluid_engine_t* engine, const fluid_kind_t* kind, int x, int y, int z, int level ) {
+  int local_x, local_z;
+  chunk_t* chunk = _voxel_at( engine, x, y, z, &local_x, &local_z );
+  if ( !chunk ) { return false; }
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+  if ( kind->flowing != type ) { return false; }
+  const int prev = chunk_get_fluid_level( chunk, local_x, y, local_z );
+  if ( prev > 0 && prev <= level ) { return false; }
+  chunk_set_fluid_level( chunk, local_x, y, local_z, (uint8_t)level );
+  return true;
+}
+
+void fluid_chunk_loaded( fluid_engine_t* engine, int cx, int cz ) {
+  assert( engine && engine->chunk_at );
+  engine->cached_chunk = NULL;
+
+  const chunk_t* chunk = _chunk_at( engine, cx, cz );
+  assert( chunk );
+  const bool has_fluid = _has_fluid( chunk );
+
+  // everything in the chunk is woken, and so is fluid on the neighbours' borders with it, which stopped at it while it wasn't loaded
+  int n_relevel = 0;
+  if ( has_fluid ) { _push_fluid_voxels( engine, &n_relevel, chunk, cx, cz, 0, CHUNK_X - 1, 0, CHUNK_Z - 1 ); }
+  for ( int side = 0; side < 4; side++ ) {
+    const int ncx            = cx + _side_x[side], ncz = cz + _side_z[side];
+    const chunk_t* neighbour = _chunk_at( engine, ncx, ncz );
+    if ( !neighbour || !_has_fluid( neighbour ) ) { continue; }
+    // the neighbour's columns touching this chunk
+    const int from_x = 0 == side ? CHUNK_X - 1 : 0, to_x = 1 == side ? 0 : CHUNK_X - 1;
+    const int from_z = 2 == side ? CHUNK_Z - 1 : 0, to_z = 3 == side ? 0 : CHUNK_Z - 1;
+    _push_fluid_voxels( engine, &n_relevel, neighbour, ncx, ncz, from_x, to_x, from_z, to_z );
+  }
+  for ( int i = 0; i < n_relevel; i++ ) { _schedule( engine, engine->relevel[i].x, engine->relevel[i].y, engine->relevel[i].z ); }
+  if ( !has_fluid ) { return; }
+
+  /* levels spread out from sources and the neighbours' fluid, breadth first, like light. only the chunk's own flowing fluid is unknown to start with,
+  so the queue starts with the chunk's sources and the neighbours' fluid that has a level */
+  int n_seeds = 0;
+  for ( int i = 0; i < n_relevel; i++ ) {
+    const fluid_update_t voxel = engine->relevel[i];
+    if ( _known_level( engine, voxel.x, voxel.y, voxel.z ) < 0 ) { continue; }
+    engine->relevel[n_seeds++] = voxel;
+  }
+  n_relevel = n_seeds;
+  for ( int head = 0; head < n_relevel; head++ ) {
+    const fluid_update_t curr = engine->relevel[head]; // copy since pushing can move the queue
+    const fluid_kind_t* kind  = _kind_of( _type_at( engine, curr.x, curr.y, curr.z ) );
+    const int level           = _known_level( engine, curr.x, curr.y, curr.z );
+    if ( level < 0 ) { continue; }
+    if ( _relevel_voxel( engine, kind, curr.x, curr.y - 1, curr.z, 1 ) ) { _push_relevel( engine, &n_relevel, curr.x, curr.y - 1, curr.z ); }
+    if ( level >= kind->max_level || !_spreads_sideways( engine, kind, curr.x, curr.y, curr.z ) ) { continue; }
+    for ( int side = 0; side < 4; side++ ) {
+      const int nx = curr.x + _side_x[side], nz = curr.z + _side_z[side];
+      if ( _relevel_voxel( engine, kind, nx, curr.y, nz, level + 1 ) ) { _push_relevel( engine, &n_relevel, nx, curr.y, nz ); }
+    }
+  }
+}
+
+void fluid_block_changed( fluid_engine_t* engine, int x, int y, int z ) {
+  assert( engine && engine->chunk_at );
+  engine->cached_chunk = NULL;
+
+  _schedule_readers( engine, x, y, z );
+}
+
+void fluid_blocks_changed( fluid_engine_t* engine, const int* xyz, int n_blocks ) {
+  assert( engine && engine->chunk_at && ( xyz || 0 == n_blocks ) );
+  engine->cached_chunk = NULL;
+
+  for ( int i = 0; i < n_blocks; i++ ) { _schedule_readers( engine, xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2] ); }
+}
+
+int fluid_tick( fluid_engine_t* engine, int max_updates ) {
+  assert( engine && engine->chunk_at && max_updates > 0 );
+  // chunks may have been evicted, and their slots reused, since the last call
+  engine->cached_chunk = NULL;
+
+  engine->tick++;
+  engine->n_updates   = 0;
+  int n_changed       = 0;
+  bool has_prev       = false;
+  fluid_update_t prev = ( fluid_update_t ){ .tick = 0 };
+  while ( engine->n_queued > 0 && engine->queue[0].tick <= engine->tick && engine->n_updates < max_updates ) {
+    const fluid_update_t update = _heap_pop( engine );
+    if ( has_prev && update.tick == prev.tick && update.x == prev.x && update.y == prev.y && update.z == prev.z ) { continue; } // a repeat
+    has_prev = true;
+    prev     = update;
+    engine->n_updates++;
+    n_changed += _update( engine, update.x, update.y, update.z );
+  }
+  return n_changed;
+}
+
+void fluid_engine_free( fluid_engine_t* engine ) {
+  assert( engine );
+
+  free( engine->queue );
+  free( engine->relevel );
+  memset( engine, 0, sizeof( fluid_engine_t ) );
+}
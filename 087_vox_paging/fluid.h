@@ -0,0 +1,65 @@
+/* Fluid - flowing water and lava. a cellular automaton that only looks at cells that could change, so a tick costs time in proportion to the fluid
+that is moving, not to the size of the world.
+No GL in here so that it can be tested headless. See voxels.c for the world that runs it, and chunk.h for where levels are stored.
+
+Design:
+  sources ( BLOCK_TYPE_WATER, BLOCK_TYPE_LAVA ) are placed and the sim never changes them. flowing blocks ( BLOCK_TYPE_*_FLOWING ) are made and removed
+  by the sim, and have a level: how many steps they are from what feeds them, 1 up to their fluid's max level
+  fluid falls straight down into air, at level 1 again. where it can't fall, because there's something other than the same fluid under it, it spreads
+  sideways into air at one more level, until the max. water spreads 7 steps and lava 3, more slowly
+  a flowing block only stays while something still feeds it: the same fluid above it, or a neighbour one level closer that spreads sideways. take the
+  source away and the flow drains, a level per step
+  the other fluid counts as solid. fluid blocks are opaque to light like any other block, and lava gives off light
+  active cells are kept in a priority queue of the ticks they're due, a min-heap like chunk_quadtree.c's. when a cell changes, the cells whose update
+  reads it are scheduled: itself, its 6 neighbours, and the 4 beside the cell above, which spread sideways or not depending on it. a settled cell
+  does nothing when it comes up and schedules nothing, so still water costs nothing at all
+  a cell can be queued more than once. entries for the same cell and tick come off the heap one after the other and the repeats are skipped
+  levels are derived data, like light: not saved, and rebuilt by fluid_chunk_loaded() spreading out from sources, so a reloaded flow carries on
+  flow stops at chunks that aren't loaded and carries on when they are. every block the sim changes is reported, so the user can relight and remesh it
+*/
+
+#pragma once
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* set the callbacks and user_ptr in a zeroed struct. the rest is reusable queue memory, which grows as needed and is never shrunk, so once the busiest
+flow so far has been queued it doesn't allocate */
+typedef struct fluid_engine_t {
+  // RETURNS chunk cx,cz or NULL if it isn't loaded
+  chunk_t* ( *chunk_at )( int cx, int cz, void* user_ptr );
+  // called after the sim changed the block at world voxel x,y,z. may be NULL
+  void ( *block_changed )( int x, int y, int z, void* user_ptr );
+  void* user_ptr;
+
+  uint32_t tick; // of the last fluid_tick()
+  struct fluid_update_t* queue; // min-heap of cells due, soonest first
+  int n_queued, max_queued;
+  struct fluid_update_t* relevel; // breadth-first queue for fluid_chunk_loaded()
+  int relevel_max;
+  int n_updates; // cells looked at by the last fluid_tick(), for stats
+  // the last chunk looked up, since most neighbours are in the same chunk
+  chunk_t* cached_chunk;
+  int cached_cx, cached_cz;
+} fluid_engine_t;
+
+// RETURNS true for water and lava, source or flowing
+bool fluid_is_fluid( block_type_t type );
+
+/* rebuilds the levels of flowing fluid in chunk cx,cz after it was loaded, from its sources and any loaded neighbours, and wakes fluid in it and on
+the neighbours' borders with it, which stopped there while it wasn't loaded. costs nothing much for a chunk without fluid */
+void fluid_chunk_loaded( fluid_engine_t* engine, int cx, int cz );
+
+/* wakes fluid around world voxel x,y,z after set_block_type_in_chunk() changed it other than by the sim, such as placing a source or digging out the
+bank of a pool. its chunk must be loaded. world voxel x is cx * CHUNK_X + the voxel's x in the chunk, likewise for z */
+void fluid_block_changed( fluid_engine_t* engine, int x, int y, int z );
+
+// the same as fluid_block_changed() for many blocks changed at once, such as a volume edit. xyz is n_blocks world voxel coords, 3 ints each
+void fluid_blocks_changed( fluid_engine_t* engine, const int* xyz, int n_blocks );
+
+/* advances one tick and updates the cells due by then, at most max_updates of them. any left over stay due, and go first next tick
+RETURNS the number of blocks changed */
+int fluid_tick( fluid_engine_t* engine, int max_updates );
+
+// frees the queues and zeroes the engine, callbacks included
+void fluid_engine_free( fluid_engine_t* engine );
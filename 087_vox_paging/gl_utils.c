@@ -9,7 +9,9 @@
 #define SHADER_BINDING_VN 2 /* 4th channel used to store 'heightmap surface' factor of 1 or 0 */
 #define SHADER_BINDING_VC 3
 #define SHADER_BINDING_VPAL_IDX 4
-#define SHADER_BINDING_VPICKING 5 /* special colours to help picking algorithm */
+#define SHADER_BINDING_VPICKING 5    /* special colours to help picking algorithm */
+#define SHADER_BINDING_VPACKED 6     /* integer-packed vertex. see create_mesh_from_packed_mem() */
+#define SHADER_BINDING_VDRAW_OFFSET 7 /* per-draw translation. see create_packed_buffer() */
 
 static int g_win_width = 1920, g_win_height = 1080;
 GLFWwindow* g_window;
@@ -55,6 +57,8 @@ shader_t create_shader_program_from_strings( const char* vert_shader_str, const
   glBindAttribLocation( shader.program_gl, SHADER_BINDING_VC, "a_vc" );
   glBindAttribLocation( shader.program_gl, SHADER_BINDING_VPAL_IDX, "a_vpal_idx" );
   glBindAttribLocation( shader.program_gl, SHADER_BINDING_VPICKING, "a_vpicking" );
+  glBindAttribLocation( shader.program_gl, SHADER_BINDING_VPACKED, "a_vpacked" );
+  glBindAttribLocation( shader.program_gl, SHADER_BINDING_VDRAW_OFFSET, "a_draw_offset" );
   glLinkProgram( shader.program_gl );
   glDeleteShader( vs );
   glDeleteShader( fs );
@@ -296,19 +300,112 @@ mesh_t create_mesh_from_mem( const float* points_buffer, int n_points_comps, con
   return mesh;
 }
 
+mesh_t create_mesh_from_packed_mem( const uint32_t* packed_buffer, int n_packed_comps, int n_vertices ) {
+  assert( packed_buffer && n_packed_comps > 0 && n_packed_comps <= 4 && n_vertices > 0 );
+
+  GLuint vertex_array_gl, packed_buffer_gl = 0;
+  glGenVertexArrays( 1, &vertex_array_gl );
+  glBindVertexArray( vertex_array_gl );
+  {
+    glGenBuffers( 1, &packed_buffer_gl );
+    glBindBuffer( GL_ARRAY_BUFFER, packed_buffer_gl );
+    glBufferData( GL_ARRAY_BUFFER, sizeof( uint32_t ) * n_packed_comps * n_vertices, packed_buffer, GL_STATIC_DRAW );
+    glEnableVertexAttribArray( SHADER_BINDING_VPACKED );
+    glVertexAttribIPointer( SHADER_BINDING_VPACKED, n_packed_comps, GL_UNSIGNED_INT, 0, NULL ); // NOTE(Anton) ...IPointer... variant
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+  }
+  glBindVertexArray( 0 );
+
+  mesh_t mesh = ( mesh_t ){ .vao = vertex_array_gl, .packed_vbo = packed_buffer_gl, .n_vertices = n_vertices };
+  return mesh;
+}
+
 void delete_mesh( mesh_t* mesh ) {
-  assert( mesh && mesh->vao > 0 && mesh->points_vbo > 0 );
+  assert( mesh && mesh->vao > 0 && ( mesh->points_vbo > 0 || mesh->packed_vbo > 0 ) );
 
   if ( mesh->vcolours_vbo ) { glDeleteBuffers( 1, &mesh->vcolours_vbo ); }
   if ( mesh->normals_vbo ) { glDeleteBuffers( 1, &mesh->normals_vbo ); }
   if ( mesh->texcoords_vbo ) { glDeleteBuffers( 1, &mesh->texcoords_vbo ); }
   if ( mesh->picking_vbo ) { glDeleteBuffers( 1, &mesh->picking_vbo ); }
   if ( mesh->palidx_vbo ) { glDeleteBuffers( 1, &mesh->palidx_vbo ); }
-  glDeleteBuffers( 1, &mesh->points_vbo );
+  if ( mesh->packed_vbo ) { glDeleteBuffers( 1, &mesh->packed_vbo ); }
+  if ( mesh->points_vbo ) { glDeleteBuffers( 1, &mesh->points_vbo ); }
   glDeleteVertexArrays( 1, &mesh->vao );
   memset( mesh, 0, sizeof( mesh_t ) );
 }
 
+packed_buffer_t create_packed_buffer( int n_packed_comps, size_t n_vertices_max ) {
+  assert( n_packed_comps > 0 && n_packed_comps <= 4 && n_vertices_max > 0 );
+
+  packed_buffer_t buffer = ( packed_buffer_t ){ .n_packed_comps = n_packed_comps, .n_vertices_max = n_vertices_max };
+  // the context asked for is 4.1, so this is only there if the driver gave a newer one or has the extensions. macOS stops at 4.1
+  buffer.multi_draw_indirect = GLEW_VERSION_4_3 || ( GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance );
+  glGenVertexArrays( 1, &buffer.vao );
+  glBindVertexArray( buffer.vao );
+  {
+    glGenBuffers( 1, &buffer.packed_vbo );
+    glBindBuffer( GL_ARRAY_BUFFER, buffer.packed_vbo );
+    glBufferData( GL_ARRAY_BUFFER, sizeof( uint32_t ) * n_packed_comps * n_vertices_max, NULL, GL_DYNAMIC_DRAW );
+    glEnableVertexAttribArray( SHADER_BINDING_VPACKED );
+    glVertexAttribIPointer( SHADER_BINDING_VPACKED, n_packed_comps, GL_UNSIGNED_INT, 0, NULL ); // NOTE(Anton) ...IPointer... variant
+  }
+  // without base instances the offset is set per draw with glVertexAttrib3f() instead, which is used while the array is disabled
+  if ( buffer.multi_draw_indirect ) {
+    glGenBuffers( 1, &buffer.offsets_vbo );
+    glBindBuffer( GL_ARRAY_BUFFER, buffer.offsets_vbo );
+    glEnableVertexAttribArray( SHADER_BINDING_VDRAW_OFFSET );
+    glVertexAttribPointer( SHADER_BINDING_VDRAW_OFFSET, 3, GL_FLOAT, GL_FALSE, 0, NULL );
+    glVertexAttribDivisor( SHADER_BINDING_VDRAW_OFFSET, 1 );
+    glGenBuffers( 1, &buffer.indirect_bo );
+  }
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+  glBindVertexArray( 0 );
+  return buffer;
+}
+
+void delete_packed_buffer( packed_buffer_t* buffer ) {
+  assert( buffer && buffer->vao > 0 && buffer->packed_vbo > 0 );
+
+  if ( buffer->indirect_bo ) { glDeleteBuffers( 1, &buffer->indirect_bo ); }
+  if ( buffer->offsets_vbo ) { glDeleteBuffers( 1, &buffer->offsets_vbo ); }
+  glDeleteBuffers( 1, &buffer->packed_vbo );
+  glDeleteVertexArrays( 1, &buffer->vao );
+  memset( buffer, 0, sizeof( packed_buffer_t ) );
+}
+
+void update_packed_buffer( packed_buffer_t* buffer, size_t first_vertex, const uint32_t* packed_buffer, size_t n_vertices ) {
+  assert( buffer && buffer->packed_vbo > 0 && packed_buffer && first_vertex + n_vertices <= buffer->n_vertices_max );
+
+  const size_t vertex_sz = sizeof( uint32_t ) * buffer->n_packed_comps;
+  glBindBuffer( GL_ARRAY_BUFFER, buffer->packed_vbo );
+  glBufferSubData( GL_ARRAY_BUFFER, first_vertex * vertex_sz, n_vertices * vertex_sz, packed_buffer );
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void resize_packed_buffer( packed_buffer_t* buffer, size_t n_vertices_max ) {
+  assert( buffer && buffer->packed_vbo > 0 && n_vertices_max >= buffer->n_vertices_max );
+
+  const size_t vertex_sz  = sizeof( uint32_t ) * buffer->n_packed_comps;
+  GLuint packed_buffer_gl = 0;
+  glGenBuffers( 1, &packed_buffer_gl );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, packed_buffer_gl );
+  glBufferData( GL_COPY_WRITE_BUFFER, n_vertices_max * vertex_sz, NULL, GL_DYNAMIC_DRAW );
+  glBindBuffer( GL_COPY_READ_BUFFER, buffer->packed_vbo );
+  glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, buffer->n_vertices_max * vertex_sz );
+  glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+  glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+  glDeleteBuffers( 1, &buffer->packed_vbo );
+
+  // the attribute keeps pointing at the buffer bound when it was set, so point it at the new one
+  glBindVertexArray( buffer->vao );
+  glBindBuffer( GL_ARRAY_BUFFER, packed_buffer_gl );
+  glVertexAttribIPointer( SHADER_BINDING_VPACKED, buffer->n_packed_comps, GL_UNSIGNED_INT, 0, NULL );
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+  glBindVertexArray( 0 );
+  buffer->packed_vbo     = packed_buffer_gl;
+  buffer->n_vertices_max = n_vertices_max;
+}
+
 void update_texture( texture_t* texture, const unsigned char* pixels, bool bgr ) {
   assert( texture && texture->handle_gl );                                                    // NOTE: it is valid for pixels to be NULL
   assert( 4 == texture->n_channels || 3 == texture->n_channels || 1 == texture->n_channels ); // 2 not used yet so not impl
@@ -392,6 +489,50 @@ void draw_mesh( shader_t shader, mat4 P, mat4 V, mat4 M, uint32_t vao, size_t n_
   }
 }
 
+void draw_packed_buffer( shader_t shader, mat4 P, mat4 V, const packed_buffer_t* buffer, const draw_arrays_cmd_t* cmds, int n_cmds, const float* offsets,
+  int n_offsets, texture_t* textures, int n_textures ) {
+  assert( buffer && buffer->vao > 0 && ( cmds || 0 == n_cmds ) && ( offsets || 0 == n_offsets ) );
+  if ( n_cmds <= 0 ) { return; }
+
+  for ( int i = 0; i < n_textures; i++ ) {
+    GLenum tex_type = textures[i].is_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    glActiveTexture( GL_TEXTURE0 + i );
+    glBindTexture( tex_type, textures[i].handle_gl );
+  }
+
+  glUseProgram( shader.program_gl );
+  glProgramUniformMatrix4fv( shader.program_gl, shader.u_P, 1, GL_FALSE, P.m );
+  glProgramUniformMatrix4fv( shader.program_gl, shader.u_V, 1, GL_FALSE, V.m );
+  glBindVertexArray( buffer->vao );
+
+  if ( buffer->multi_draw_indirect ) {
+    // both are rewritten every frame. glBufferData() rather than SubData lets the driver hand over fresh memory instead of waiting on last frame's draw
+    glBindBuffer( GL_ARRAY_BUFFER, buffer->offsets_vbo );
+    glBufferData( GL_ARRAY_BUFFER, sizeof( float ) * 3 * n_offsets, offsets, GL_STREAM_DRAW );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, buffer->indirect_bo );
+    glBufferData( GL_DRAW_INDIRECT_BUFFER, sizeof( draw_arrays_cmd_t ) * n_cmds, cmds, GL_STREAM_DRAW );
+    glMultiDrawArraysIndirect( GL_TRIANGLES, NULL, n_cmds, 0 );
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+  } else {
+    for ( int i = 0; i < n_cmds; i++ ) {
+      assert( (int)cmds[i].base_instance < n_offsets );
+      const float* offset = &offsets[cmds[i].base_instance * 3];
+      glVertexAttrib3f( SHADER_BINDING_VDRAW_OFFSET, offset[0], offset[1], offset[2] );
+      glDrawArrays( GL_TRIANGLES, cmds[i].first, cmds[i].count );
+    }
+    glVertexAttrib3f( SHADER_BINDING_VDRAW_OFFSET, 0.0f, 0.0f, 0.0f );
+  }
+
+  glBindVertexArray( 0 );
+  glUseProgram( 0 );
+  for ( int i = 0; i < n_textures; i++ ) {
+    GLenum tex_type = textures[i].is_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    glActiveTexture( GL_TEXTURE0 + i );
+    glBindTexture( tex_type, 0 );
+  }
+}
+
 void draw_textured_quad( texture_t texture, vec2 scale, vec2 pos ) {
   GLenum tex_type = texture.is_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
   glEnable( GL_BLEND );
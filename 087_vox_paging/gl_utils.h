@@ -8,9 +8,27 @@
 typedef struct mesh_t {
   uint32_t vao;
   uint32_t points_vbo, palidx_vbo, picking_vbo, texcoords_vbo, normals_vbo, vcolours_vbo;
+  uint32_t packed_vbo; // used instead of the other vbos by meshes from create_mesh_from_packed_mem()
   size_t n_vertices;
 } mesh_t;
 
+/* one big vertex buffer of packed vertices that many meshes are sub-allocated from, so they all draw from one VAO in one call - see draw_packed_buffer().
+the caller decides where each mesh goes, eg with range_alloc.h */
+typedef struct packed_buffer_t {
+  uint32_t vao;
+  uint32_t packed_vbo;
+  uint32_t offsets_vbo; // a vec3 per draw, read as an instanced attribute picked by each command's base_instance
+  uint32_t indirect_bo; // draw_arrays_cmd_t per draw
+  int n_packed_comps;
+  size_t n_vertices_max;
+  bool multi_draw_indirect; // GL 4.3 or ARB_multi_draw_indirect with ARB_base_instance. otherwise it's a glDrawArrays() per command
+} packed_buffer_t;
+
+// the command glMultiDrawArraysIndirect() reads. instance_count is 1 and base_instance is the row of the draw's offset
+typedef struct draw_arrays_cmd_t {
+  uint32_t count, instance_count, first, base_instance;
+} draw_arrays_cmd_t;
+
 typedef struct texture_t {
   uint32_t handle_gl;
   int w, h, n_channels;
@@ -47,8 +65,20 @@ const char* gfx_renderer_str( void );
 mesh_t create_mesh_from_mem( const float* points_buffer, int n_points_comps, const uint32_t* pal_idx_buffer, int n_pal_idx_comps, const float* picking_buffer,
   int n_picking_comps, const float* texcoords_buffer, int n_texcoord_comps, const float* normals_buffer, int n_normal_comps, const float* vcolours_buffer,
   int n_vcolour_comps, int n_vertices );
+/* creates a mesh from interleaved packed integer vertices, bound to the uvecN shader input "a_vpacked".
+n_packed_comps is the number of uint32 per vertex, 1 to 4. the shader is responsible for unpacking */
+mesh_t create_mesh_from_packed_mem( const uint32_t* packed_buffer, int n_packed_comps, int n_vertices );
 void delete_mesh( mesh_t* mesh );
 
+/* creates an empty buffer of n_vertices_max packed vertices bound to "a_vpacked", like create_mesh_from_packed_mem(), and a per-draw vec3 bound to
+"a_draw_offset" that the shader adds to positions */
+packed_buffer_t create_packed_buffer( int n_packed_comps, size_t n_vertices_max );
+void delete_packed_buffer( packed_buffer_t* buffer );
+// copies n_vertices vertices into the buffer starting at vertex first_vertex
+void update_packed_buffer( packed_buffer_t* buffer, size_t first_vertex, const uint32_t* packed_buffer, size_t n_vertices );
+// grows the buffer to n_vertices_max, keeping its contents. copied on the GPU
+void resize_packed_buffer( packed_buffer_t* buffer, size_t n_vertices_max );
+
 texture_t create_texture_from_mem( const uint8_t* img_buffer, int w, int h, int n_channels, bool srgb, bool is_depth, bool bgr );
 void delete_texture( texture_t* texture );
 void update_texture( texture_t* texture, const unsigned char* pixels, bool bgr );
@@ -69,6 +99,10 @@ void read_pixels( int x, int y, int w, int h, int n_channels, uint8_t* data );
 
 // textures - array of textures to bind or NULL for none. array is in order - active texture unit 0...onwards.
 void draw_mesh( shader_t shader, mat4 P, mat4 V, mat4 M, uint32_t vao, size_t n_vertices, texture_t* textures, int n_textures );
+/* draws n_cmds ranges of the buffer with one glMultiDrawArraysIndirect() if the driver has it. offsets is 3 floats per row, n_offsets rows,
+and each command's base_instance picks its row */
+void draw_packed_buffer( shader_t shader, mat4 P, mat4 V, const packed_buffer_t* buffer, const draw_arrays_cmd_t* cmds, int n_cmds, const float* offsets,
+  int n_offsets, texture_t* textures, int n_textures );
 void draw_textured_quad( texture_t texture, vec2 scale, vec2 pos );
 
 void wireframe_mode();
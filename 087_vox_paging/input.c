@@ -31,6 +31,9 @@ int g_reload_all_shaders_key                       = GLFW_KEY_7;
 int g_reload_all_textures_key                      = GLFW_KEY_8;
 int g_reload_all_meshes_key                        = GLFW_KEY_9;
 int g_toggle_wireframe_key                         = GLFW_KEY_0;
+int g_toggle_greedy_meshing_key                    = GLFW_KEY_F5;
+int g_quicksave_key                                = GLFW_KEY_F6;
+int g_quickload_key                                = GLFW_KEY_F7;
 int g_screenshot_key                               = GLFW_KEY_F11;
 int g_rotate_prop_ccw_key                          = GLFW_KEY_LEFT_BRACKET;
 int g_rotate_prop_cw_key                           = GLFW_KEY_RIGHT_BRACKET;
@@ -57,6 +57,9 @@ extern int g_reload_all_textures_key;
 extern int g_reload_all_meshes_key;
 extern int g_screenshot_key;
 extern int g_toggle_wireframe_key;
+extern int g_toggle_greedy_meshing_key;
+extern int g_quicksave_key;
+extern int g_quickload_key;
 extern int g_rotate_prop_ccw_key;
 extern int g_rotate_prop_cw_key;
 
@@ -0,0 +1,332 @@
+#include "light.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIGHT_CHANNEL_SKY 0
+#define LIGHT_CHANNEL_BLOCK 1
+// chunks with changed sections remembered before they're passed to sections_changed. an edit rarely touches more than a few
+#define LIGHT_DIRTY_MAX 64
+
+typedef struct light_node_t {
+  int x, y, z;   // world voxel coords
+  uint8_t level; // only used when removing - the light the voxel had before it went dark
+} light_node_t;
+
+typedef struct light_dirty_t {
+  int cx, cz;
+  uint32_t section_mask;
+} light_dirty_t;
+
+// steps to each neighbour in face_idx order -x,+x,-y,+y,-z,+z
+static const int _step_x[6] = { -1, 1, 0, 0, 0, 0 };
+static const int _step_y[6] = { 0, 0, -1, 1, 0, 0 };
+static const int _step_z[6] = { 0, 0, 0, 0, -1, 1 };
+
+// rounds towards negative infinity, unlike /, so that eg voxel -1 is in chunk -1
+static int _floor_div( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); }
+
+static chunk_t* _chunk_at( light_engine_t* engine, int cx, int cz ) {
+  if ( engine->cached_chunk && engine->cached_cx == cx && engine->cached_cz == cz ) { return engine->cached_chunk; }
+  chunk_t* chunk = engine->chunk_at( cx, cz, engine->user_ptr );
+  if ( chunk ) {
+    engine->cached_chunk = chunk;
+    engine->cached_cx    = cx;
+    engine->cached_cz    = cz;
+  }
+  return chunk;
+}
+
+/* finds the chunk holding world voxel x,y,z and the voxel's x and z in it
+RETURNS NULL if the voxel is above or below the world or its chunk isn't loaded */
+static chunk_t* _voxel_at( light_engine_t* engine, int x, int y, int z, int* cx, int* cz, int* local_x, int* local_z ) {
+  if ( y < 0 || y >= CHUNK_Y ) { return NULL; }
+  *cx      = _floor_div( x, CHUNK_X );
+  *cz      = _floor_div( z, CHUNK_Z );
+  *local_x = x - *cx * CHUNK_X;
+  *local_z = z - *cz * CHUNK_Z;
+  return _chunk_at( engine, *cx, *cz );
+}
+
+static bool _is_air( const chunk_t* chunk, int x, int y, int z ) {
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( chunk, x, y, z, &type );
+  return BLOCK_TYPE_AIR == type;
+}
+
+static int _get_level( const chunk_t* chunk, int x, int y, int z, int channel ) {
+  const uint8_t light = chunk_get_light( chunk, x, y, z );
+  return LIGHT_CHANNEL_SKY == channel ? VOXEL_LIGHT_SKY( light ) : VOXEL_LIGHT_BLOCK( light );
+}
+
+static void _flush_dirty( light_engine_t* engine ) {
+  for ( int i = 0; i < engine->n_dirty && engine->sections_changed; i++ ) {
+    engine->sections_changed( engine->dirty[i].cx, engine->dirty[i].cz, engine->dirty[i].section_mask, engine->user_ptr );
+  }
+  engine->n_dirty = 0;
+}
+
+static void _add_dirty( light_engine_t* engine, int cx, int cz, uint32_t section_mask ) {
+  for ( int i = 0; i < engine->n_dirty; i++ ) {
+    if ( engine->dirty[i].cx == cx && engine->dirty[i].cz == cz ) {
+      engine->dirty[i].section_mask |= section_mask;
+      return;
+    }
+  }
+  if ( !engine->dirty ) {
+    engine->dirty = malloc( LIGHT_DIRTY_MAX * sizeof( light_dirty_t ) );
+    assert( engine->dirty );
+  }
+  if ( engine->n_dirty >= LIGHT_DIRTY_MAX ) { _flush_dirty( engine ); }
+  engine->dirty[engine->n_dirty++] = ( light_dirty_t ){ .cx = cx, .cz = cz, .section_mask = section_mask };
+}
+
+// the light of an air voxel is drawn on the faces of the 6 voxels around it, which can be in the sections above and below, and over a chunk border
+static void _set_level( light_engine_t* engine, chunk_t* chunk, int cx, int cz, int x, int y, int z, int channel, int level ) {
+  const uint8_t light = chunk_get_light( chunk, x, y, z );
+  const uint8_t new_light =
+    LIGHT_CHANNEL_SKY == channel ? VOXEL_LIGHT_PACK( level, VOXEL_LIGHT_BLOCK( light ) ) : VOXEL_LIGHT_PACK( VOXEL_LIGHT_SKY( light ), level );
+  if ( !chunk_set_light( chunk, x, y, z, new_light ) ) { return; }
+
+  const int lo = y > 0 ? y - 1 : 0, hi = y < CHUNK_Y - 1 ? y + 1 : CHUNK_Y - 1;
+  uint32_t section_mask = 0;
+  for ( int section = lo / CHUNK_SECTION_Y; section <= hi / CHUNK_SECTION_Y; section++ ) { section_mask |= 1u << section; }
+  _add_dirty( engine, cx, cz, section_mask );
+  if ( 0 == x ) { _add_dirty( engine, cx - 1, cz, section_mask ); }
+  if ( CHUNK_X - 1 == x ) { _add_dirty( engine, cx + 1, cz, section_mask ); }
+  if ( 0 == z ) { _add_dirty( engine, cx, cz - 1, section_mask ); }
+  if ( CHUNK_Z - 1 == z ) { _add_dirty( engine, cx, cz + 1, section_mask ); }
+}
+
+static void _push_node( light_node_t** queue, int* queue_max, int* n_queued, light_node_t node ) {
+  if ( *n_queued >= *queue_max ) {
+    *queue_max = *queue_max ? *queue_max * 2 : 1024;
+    *queue     = realloc( *queue, *queue_max * sizeof( light_node_t ) );
+    assert( *queue );
+  }
+  ( *queue )[( *n_queued )++] = node;
+}
+
+static void _push_add( light_engine_t* engine, int* n_adding, int x, int y, int z ) {
+  _push_node( &engine->add_queue, &engine->add_max, n_adding, ( light_node_t ){ .x = x, .y = y, .z = z } );
+}
+
+/* spreads light outwards from the voxels in the add queue, at whatever level each has by the time it's reached, into air that was darker.
+full sky light going down stays full */
+static void _spread( light_engine_t* engine, int channel, int n_adding ) {
+  for ( int head = 0; head < n_adding; head++ ) {
+    const light_node_t curr = engine->add_queue[head]; // copy since pushing can move the queue
+    int cx, cz, x, z;
+    const chunk_t* chunk = _voxel_at( engine, curr.x, curr.y, curr.z, &cx, &cz, &x, &z );
+    if ( !chunk ) { continue; }
+    const int level = _get_level( chunk, x, curr.y, z, channel );
+    if ( level <= 1 ) { continue; }
+
+    for ( int face = 0; face < 6; face++ ) {
+      int ncx, ncz, nx, nz;
+      const int ny          = curr.y + _step_y[face];
+      chunk_t* neighbour    = _voxel_at( engine, curr.x + _step_x[face], ny, curr.z + _step_z[face], &ncx, &ncz, &nx, &nz );
+      if ( !neighbour || !_is_air( neighbour, nx, ny, nz ) ) { continue; }
+      const int spread_level = ( LIGHT_CHANNEL_SKY == channel && 2 == face && VOXEL_LIGHT_MAX == level ) ? VOXEL_LIGHT_MAX : level - 1;
+      if ( spread_level <= _get_level( neighbour, nx, ny, nz, channel ) ) { continue; }
+      _set_level( engine, neighbour, ncx, ncz, nx, ny, nz, channel, spread_level );
+      _push_add( engine, &n_adding, curr.x + _step_x[face], ny, curr.z + _step_z[face] );
+    }
+  }
+}
+
+/* darkens the voxels that were lit by the light being removed from the voxels in the remove queue. lit voxels at the edge of the dark area got their
+light from somewhere else, so they're put in the add queue to spread back in
+RETURNS the number of voxels in the add queue */
+static int _unspread( light_engine_t* engine, int channel, int n_removing, int n_adding ) {
+  for ( int head = 0; head < n_removing; head++ ) {
+    const light_node_t curr = engine->remove_queue[head];
+    for ( int face = 0; face < 6; face++ ) {
+      int ncx, ncz, nx, nz;
+      const int wx = curr.x + _step_x[face], ny = curr.y + _step_y[face], wz = curr.z + _step_z[face];
+      chunk_t* neighbour = _voxel_at( engine, wx, ny, wz, &ncx, &ncz, &nx, &nz );
+      if ( !neighbour ) { continue; }
+      const int level = _get_level( neighbour, nx, ny, nz, channel );
+      if ( 0 == level ) { continue; }
+      // the only solid voxels with light are lamps, which light themselves
+      const bool lit_by_curr = _is_air( neighbour, nx, ny, nz ) &&
+                               ( level < curr.level || ( LIGHT_CHANNEL_SKY == channel && 2 == face && VOXEL_LIGHT_MAX == curr.level ) );
+      if ( !lit_by_curr ) {
+        _push_add( engine, &n_adding, wx, ny, wz );
+        continue;
+      }
+      _set_level( engine, neighbour, ncx, ncz, nx, ny, nz, channel, 0 );
+      _push_node( &engine->remove_queue, &engine->remove_max, &n_removing, ( light_node_t ){ .x = wx, .y = ny, .z = wz, .level = (uint8_t)level } );
+    }
+  }
+  return n_adding;
+}
+
+void light_block_changed( light_engine_t* engine, int x, int y, int z ) {
+  const int xyz[3] = { x, y, z };
+  light_blocks_changed( engine, xyz, 1 );
+}
+
+void light_blocks_changed( light_engine_t* engine, const int* xyz, int n_blocks ) {
+  assert( engine && engine->chunk_at && ( xyz || 0 == n_blocks ) );
+  engine->cached_chunk = NULL; // chunks may have moved since the last call
+
+  for ( int channel = LIGHT_CHANNEL_SKY; channel <= LIGHT_CHANNEL_BLOCK; channel++ ) {
+    // every block takes its own light first, so that removal spreads out from all of them at once and spreading in comes after
+    int n_removing = 0, n_adding = 0;
+    for ( int i = 0; i < n_blocks; i++ ) {
+      const int x = xyz[i * 3], y = xyz[i * 3 + 1], z = xyz[i * 3 + 2];
+      int cx, cz, local_x, local_z;
+      chunk_t* chunk = _voxel_at( engine, x, y, z, &cx, &cz, &local_x, &local_z );
+      assert( chunk );
+      block_type_t type = BLOCK_TYPE_AIR;
+      get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+
+      // the light the voxel gives itself. above the top of the world is open sky
+      int own_level = LIGHT_CHANNEL_BLOCK == channel ? block_type_light_emission( type ) : 0;
+      if ( LIGHT_CHANNEL_SKY == channel && BLOCK_TYPE_AIR == type && CHUNK_Y - 1 == y ) { own_level = VOXEL_LIGHT_MAX; }
+
+      const int prev_level = _get_level( chunk, local_x, y, local_z, channel );
+      _set_level( engine, chunk, cx, cz, local_x, y, local_z, channel, own_level );
+      if ( prev_level > own_level ) {
+        _push_node( &engine->remove_queue, &engine->remove_max, &n_removing, ( light_node_t ){ .x = x, .y = y, .z = z, .level = (uint8_t)prev_level } );
+      }
+    }
+    n_adding = _unspread( engine, channel, n_removing, n_adding );
+    for ( int i = 0; i < n_blocks; i++ ) {
+      const int x = xyz[i * 3], y = xyz[i * 3 + 1], z = xyz[i * 3 + 2];
+      int cx, cz, local_x, local_z;
+      const chunk_t* chunk = _voxel_at( engine, x, y, z, &cx, &cz, &local_x, &local_z );
+      block_type_t type    = BLOCK_TYPE_AIR;
+      get_block_type_in_chunk( chunk, local_x, y, local_z, &type );
+      if ( _get_level( chunk, local_x, y, local_z, channel ) > 0 ) { _push_add( engine, &n_adding, x, y, z ); }
+      // light from around flows into new air
+      if ( BLOCK_TYPE_AIR == type ) {
+        for ( int face = 0; face < 6; face++ ) { _push_add( engine, &n_adding, x + _step_x[face], y + _step_y[face], z + _step_z[face] ); }
+      }
+    }
+    _spread( engine, channel, n_adding );
+  }
+  _flush_dirty( engine );
+}
+
+// lamps hold their own block light and spread it from there
+static int _seed_lamps( light_engine_t* engine, chunk_t* chunk, int cx, int cz, int n_adding ) {
+  for ( int column = 0; column < CHUNK_X * CHUNK_Z; column++ ) {
+    const int x = column % CHUNK_X, z = column / CHUNK_X;
+    int y       = 0;
+    while ( y < CHUNK_Y ) {
+      // a run of the same type. walks the runs of a compressed chunk rather than looking up every voxel
+      block_type_t type = BLOCK_TYPE_AIR;
+      int run_top       = y + 1;
+      if ( chunk->rle ) {
+        const chunk_rle_t* rle = chunk->rle;
+        int run_y              = 0;
+        for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+          run_top = run_y + ( rle->runs[r] & 0xFF ) + 1;
+          if ( y < run_top ) {
+            type = rle->palette[rle->runs[r] >> 8];
+            break;
+          }
+          run_y = run_top;
+        }
+      } else {
+        type = chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type;
+      }
+      const int emission = block_type_light_emission( type );
+      if ( !emission ) {
+        y = run_top;
+        continue;
+      }
+      for ( ; y < run_top; y++ ) {
+        _set_level( engine, chunk, cx, cz, x, y, z, LIGHT_CHANNEL_BLOCK, emission );
+        _push_add( engine, &n_adding, cx * CHUNK_X + x, y, cz * CHUNK_Z + z );
+      }
+    }
+  }
+  return n_adding;
+}
+
+void light_chunk_loaded( light_engine_t* engine, int cx, int cz ) {
+  assert( engine && engine->chunk_at );
+  engine->cached_chunk = NULL;
+
+  chunk_t* chunk = _chunk_at( engine, cx, cz );
+  assert( chunk );
+  const int world_x = cx * CHUNK_X, world_z = cz * CHUNK_Z;
+
+  for ( int channel = LIGHT_CHANNEL_SKY; channel <= LIGHT_CHANNEL_BLOCK; channel++ ) {
+    int n_adding = 0;
+    if ( LIGHT_CHANNEL_BLOCK == channel ) { n_adding = _seed_lamps( engine, chunk, cx, cz, n_adding ); }
+
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        for ( int face = 0; face < 6; face++ ) {
+          if ( _step_y[face] ) { continue; }
+          int ncx, ncz, nx, nz;
+          const int wx = world_x + x + _step_x[face], wz = world_z + z + _step_z[face];
+          if ( LIGHT_CHANNEL_SKY == channel ) {
+            /* full sky light only goes down columns so far. it spreads sideways into air under the next column's surface, which is in caves and
+            overhangs, where that's darker */
+            chunk_t* neighbour = _voxel_at( engine, wx, 0, wz, &ncx, &ncz, &nx, &nz );
+            if ( !neighbour ) { continue; }
+            const int neighbour_height = neighbour->heightmap[CHUNK_X * nz + nx];
+            for ( int y = chunk->heightmap[CHUNK_X * z + x] + 1; y <= neighbour_height; y++ ) {
+              if ( _is_air( neighbour, nx, y, nz ) && _get_level( neighbour, nx, y, nz, channel ) < VOXEL_LIGHT_MAX - 1 ) {
+                _push_add( engine, &n_adding, world_x + x, y, world_z + z );
+              }
+            }
+          }
+          // light in the loaded chunk next door spreads over the border into this one
+          const bool on_border = wx < world_x || wx >= world_x + CHUNK_X || wz < world_z || wz >= world_z + CHUNK_Z;
+          if ( !on_border ) { continue; }
+          chunk_t* neighbour = _voxel_at( engine, wx, 0, wz, &ncx, &ncz, &nx, &nz );
+          if ( !neighbour ) { continue; }
+          for ( int y = 0; y < CHUNK_Y; y++ ) {
+            const int level = _get_level( neighbour, nx, y, nz, channel );
+            if ( level > 1 && level - 1 > _get_level( chunk, x, y, z, channel ) && _is_air( chunk, x, y, z ) ) { _push_add( engine, &n_adding, wx, y, wz ); }
+          }
+        }
+      }
+    }
+    _spread( engine, channel, n_adding );
+  }
+  _flush_dirty( engine );
+}
+
+void light_chunk_reloaded( light_engine_t* engine, int cx, int cz ) {
+  assert( engine && engine->chunk_at );
+  assert( CHUNK_X == CHUNK_Z ); // borders are walked with one count
+
+  // the neighbours' columns along each shared border, as if they'd been edited
+  const int world_x = cx * CHUNK_X, world_z = cz * CHUNK_Z;
+  const int border_x[4] = { world_x - 1, world_x + CHUNK_X, world_x, world_x };
+  const int border_z[4] = { world_z, world_z, world_z - 1, world_z + CHUNK_Z };
+  int* xyz              = malloc( 4 * CHUNK_X * CHUNK_Y * 3 * sizeof( int ) );
+  assert( xyz );
+  int n_blocks = 0;
+  for ( int i = 0; i < 4; i++ ) {
+    if ( !_chunk_at( engine, _floor_div( border_x[i], CHUNK_X ), _floor_div( border_z[i], CHUNK_Z ) ) ) { continue; }
+    // the -x and +x borders run along z, the others along x
+    const int step_x = i < 2 ? 0 : 1, step_z = i < 2 ? 1 : 0;
+    for ( int j = 0; j < CHUNK_X; j++ ) {
+      for ( int y = 0; y < CHUNK_Y; y++ ) {
+        xyz[n_blocks * 3]     = border_x[i] + j * step_x;
+        xyz[n_blocks * 3 + 1] = y;
+        xyz[n_blocks * 3 + 2] = border_z[i] + j * step_z;
+        n_blocks++;
+      }
+    }
+  }
+  light_blocks_changed( engine, xyz, n_blocks );
+  free( xyz );
+  light_chunk_loaded( engine, cx, cz );
+}
+
+void light_engine_free( light_engine_t* engine ) {
+  assert( engine );
+  free( engine->add_queue );
+  free( engine->remove_queue );
+  free( engine->dirty );
+  memset( engine, 0, sizeof( light_engine_t ) );
+}
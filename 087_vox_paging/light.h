@@ -0,0 +1,58 @@
+/* Light propagation - spreads sky light and lamp light through the air of a world of chunks, and keeps it right as blocks are edited.
+No GL in here so that it can be tested headless. See voxels.c for the world that uses it, and chunk.h for where light is stored.
+
+Design:
+  two channels per voxel, each 0..VOXEL_LIGHT_MAX: sky light and block light. they spread the same way but separately
+  light is a breadth-first flood fill through air. each step loses 1 level, except that full sky light goes straight down without losing any,
+  so open sky, and shafts down into caves, are fully lit
+  light crosses chunk borders. chunks that aren't loaded stop it, and a chunk that loads later picks up the light at its borders
+  removing light is a second flood fill: voxels that were lit by the removed light go dark and their lit neighbours that it didn't reach are re-spread.
+  this only visits voxels the edit could change, rather than relighting the chunk
+  every voxel whose light changes marks the sections, in every chunk, with faces that sample it. the user remeshes only those
+*/
+
+#pragma once
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* set the callbacks and user_ptr in a zeroed struct. the rest is reusable queue memory, which grows as needed and is never shrunk, so after the first
+few edits it doesn't allocate */
+typedef struct light_engine_t {
+  // RETURNS chunk cx,cz or NULL if it isn't loaded
+  chunk_t* ( *chunk_at )( int cx, int cz, void* user_ptr );
+  // called with a bit per section of chunk cx,cz whose vertex data could have changed because of light. may be NULL
+  void ( *sections_changed )( int cx, int cz, uint32_t section_mask, void* user_ptr );
+  void* user_ptr;
+
+  struct light_node_t* add_queue;
+  int add_max;
+  struct light_node_t* remove_queue;
+  int remove_max;
+  struct light_dirty_t* dirty; // sections changed since the last flush
+  int n_dirty;
+  // the last chunk looked up, since flood fills stay in one chunk for most steps
+  chunk_t* cached_chunk;
+  int cached_cx, cached_cz;
+} light_engine_t;
+
+/* spreads light around chunk cx,cz after it was loaded or generated, to and from any loaded neighbours.
+expects chunk_init_sky_light() to have been done, which chunk_generate() and chunk_load_from_mem() do */
+void light_chunk_loaded( light_engine_t* engine, int cx, int cz );
+
+/* the same as light_chunk_loaded() for a chunk whose voxels were swapped for another version while its neighbours stayed loaded, such as reverting
+to the last save. light that spilled into the neighbours from the old voxels is taken away by relighting their columns along the shared borders, then
+light spreads around the new voxels as for a load */
+void light_chunk_reloaded( light_engine_t* engine, int cx, int cz );
+
+/* updates light after set_block_type_in_chunk() changed the block at world voxel coords x,y,z. its chunk must be loaded.
+world voxel x is cx * CHUNK_X + the voxel's x in the chunk, likewise for z */
+void light_block_changed( light_engine_t* engine, int x, int y, int z );
+
+/* the same as light_block_changed() for many blocks changed at once, such as a volume edit. xyz is n_blocks world voxel coords, 3 ints each.
+light is taken away from all of them in one pass and spread back in another, rather than once per block, so a big edit costs about as much as
+relighting the area around it once, and each changed section is reported once */
+void light_blocks_changed( light_engine_t* engine, const int* xyz, int n_blocks );
+
+// frees the queues and zeroes the engine, callbacks included
+void light_engine_free( light_engine_t* engine );
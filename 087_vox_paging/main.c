@@ -49,8 +49,9 @@ int main() {
 
   uint32_t seed = time( NULL );
   printf( "seed = %u\n", seed );
-  uint32_t chunks_wide = 16, chunks_deep = 16;
-  chunks_create( seed, chunks_wide, chunks_deep );
+  char world_name[256];
+  snprintf( world_name, sizeof( world_name ), "world_%u", seed );
+  chunks_create( seed, world_name );
 
   texture_t text_texture;
   {
@@ -88,9 +89,6 @@ int main() {
   int fb_width, fb_height;
   framebuffer_dims( &fb_width, &fb_height );
 
-  framebuffer_t picking_fb = create_framebuffer( fb_width, fb_height );
-  assert( picking_fb.built );
-
   printf( "displaying...\n" );
   double prev_time  = get_time_s();
   double text_timer = 0.2;
@@ -119,32 +117,55 @@ int main() {
     reset_last_polled_input_states();
     poll_events();
 
-    { // TODO(anton) only do when actually resized
+    {
       framebuffer_dims( &fb_width, &fb_height );
       window_dims( &win_width, &win_height );
-      rebuild_framebuffer( &picking_fb, fb_width, fb_height );
-      assert( picking_fb.built );
     }
 
     { // get mouse cursor and controls
       mouse_pos_win( &mouse_x, &mouse_y );
 
-      for ( int i = 1; i <= 4; i++ ) {
+      // flowing fluid is only made by the fluid sim
+      for ( int i = 1; i <= BLOCK_TYPE_LAVA; i++ ) {
         if ( was_key_pressed( g_palette_1_key + i - 1 ) ) {
           printf( "block type set to %i\n", i );
           block_type_to_create = (block_type_t)i;
         }
       }
+      if ( was_key_pressed( g_toggle_greedy_meshing_key ) ) { chunks_greedy_meshing_mode( !chunks_is_greedy_meshing_mode() ); }
+      if ( was_key_pressed( g_toggle_display_all_layers_key ) ) { chunks_slice_view_mode( !chunks_is_slice_view_mode() ); }
+      if ( was_key_pressed( g_current_layer_up_key ) ) { chunks_set_slice_height( chunks_get_slice_height() + 1 ); }
+      if ( was_key_pressed( g_current_layer_down_key ) ) { chunks_set_slice_height( chunks_get_slice_height() - 1 ); }
+      if ( was_key_pressed( g_quicksave_key ) ) {
+        if ( !chunks_save() ) { fprintf( stderr, "ERROR: saving %s\n", world_name ); }
+      }
+      if ( was_key_pressed( g_quickload_key ) ) {
+        if ( !chunks_load() ) { fprintf( stderr, "ERROR: loading %s\n", world_name ); }
+      }
+      if ( was_key_pressed( g_export_mesh_key ) ) {
+        if ( !chunks_export( "out.ply", MESH_EXPORT_PLY ) ) { fprintf( stderr, "ERROR: exporting out.ply\n" ); }
+        if ( !chunks_export( "out.glb", MESH_EXPORT_GLB ) ) { fprintf( stderr, "ERROR: exporting out.glb\n" ); }
+      }
 
       if ( picked ) {
-        bool changed = false;
+        // changed chunks are marked dirty and picked up by chunks_update_dirty_chunk_meshes() below
         if ( lmb_clicked() ) {
-          changed = chunks_create_block_on_face( picked_chunk_id, picked_x, picked_y, picked_z, picked_face, block_type_to_create );
+          chunks_create_block_on_face( picked_chunk_id, picked_x, picked_y, picked_z, picked_face, block_type_to_create );
         } else if ( rmb_clicked() ) {
-          changed = chunks_set_block_type_in_chunk( picked_chunk_id, picked_x, picked_y, picked_z, BLOCK_TYPE_AIR );
+          chunks_set_block_type_in_chunk( picked_chunk_id, picked_x, picked_y, picked_z, BLOCK_TYPE_AIR );
+        } else if ( mmb_clicked() ) {
+          // digs out a ball around the picked voxel in one volume edit
+          int cx = 0, cz = 0;
+          chunks_get_chunk_coords( picked_chunk_id, &cx, &cz );
+          chunks_fill_sphere( cx * CHUNK_X + picked_x, picked_y, cz * CHUNK_Z + picked_z, 4, BLOCK_TYPE_AIR );
         }
-        if ( changed ) { chunks_update_dirty_chunk_meshes(); }
       }
+      // after edits, so that fluid flows into what was just dug out
+      chunks_update_fluids( elapsed_s );
+      // after edits, since this can evict the picked chunk and reuse its id
+      chunks_stream( cam.pos );
+      // every frame, not just on edits, since finished meshes come back from the worker threads asynchronously
+      chunks_update_dirty_chunk_meshes();
       bool cam_fwd = false, cam_bk = false, cam_left = false, cam_rgt = false, turn_left = false, turn_right = false;
       {
         static double prev_mouse_x  = 0.0;
@@ -205,7 +226,8 @@ int main() {
     int chunks_drawn = chunks_get_drawn_count();
 
     // draw box for selection
-    if ( picked ) {
+    int chunk_x = 0, chunk_z = 0;
+    if ( picked && chunks_get_chunk_coords( picked_chunk_id, &chunk_x, &chunk_z ) ) {
       mat4 R = identity_mat4();
       switch ( picked_face ) {
       case 0: R = mult_mat4_mat4( rot_y_deg_mat4( 90.0f ), rot_x_deg_mat4( 90.0f ) ); break;  // rgt
@@ -217,12 +239,10 @@ int main() {
       default: assert( false ); break;
       }
 
-      const int chunk_x       = picked_chunk_id % chunks_wide;
-      const int chunk_z       = picked_chunk_id / chunks_wide;
       const float voxel_scale = 0.2f;
-      const float x_wor       = ( chunk_x * chunks_wide + picked_x ) * voxel_scale;
+      const float x_wor       = ( chunk_x * CHUNK_X + picked_x ) * voxel_scale;
       const float y_wor       = picked_y * voxel_scale;
-      const float z_wor       = ( chunk_z * chunks_wide + picked_z ) * voxel_scale;
+      const float z_wor       = ( chunk_z * CHUNK_Z + picked_z ) * voxel_scale;
       mat4 T                  = translate_mat4( ( vec3 ){ x_wor, y_wor, z_wor } );
       mat4 M                  = mult_mat4_mat4( T, R );
 
@@ -250,8 +270,17 @@ int main() {
       text_timer = 0.0;
       memset( fps_img_mem, 0x00, fps_img_w * fps_img_h * fps_n_channels );
 
-      sprintf( string, "FPS %.2f\n%s\nwin dims (%i,%i). fb dims (%i,%i)\nmouse xy (%.2f,%.2f)\nhovered voxel: %s\nchunks drawn: %i\nseed: %u", fps,
-        gfx_renderer_str(), win_width, win_height, fb_width, fb_height, mouse_x, mouse_y, hovered_voxel_str, chunks_drawn, seed );
+      char slice_str[64];
+      if ( chunks_is_slice_view_mode() ) {
+        sprintf( slice_str, "below y=%i", chunks_get_slice_height() );
+      } else {
+        sprintf( slice_str, "off" );
+      }
+      sprintf( string,
+        "FPS %.2f\n%s\nwin dims (%i,%i). fb dims (%i,%i)\nmouse xy (%.2f,%.2f)\nhovered voxel: %s\nchunks drawn: %i/%i\nseed: %u\nmesher (F5): %s\n"
+        "slice (Home, PgUp/PgDn): %s\nfluid cells queued: %i",
+        fps, gfx_renderer_str(), win_width, win_height, fb_width, fb_height, mouse_x, mouse_y, hovered_voxel_str, chunks_drawn, chunks_get_resident_count(), seed,
+        chunks_is_greedy_meshing_mode() ? "greedy" : "per-face", slice_str, chunks_get_fluid_queued_count() );
 
       if ( APG_PIXFONT_FAILURE == apg_pixfont_image_size_for_str( string, &w, &h, thickness, outlines ) ) {
         fprintf( stderr, "ERROR apg_pixfont_image_size_for_str\n" );
@@ -269,33 +298,20 @@ int main() {
     }
     draw_textured_quad( text_texture, text_scale, text_pos );
 
-    { // render colour IDs around mouse cursor
-      // subwindow rectangle. NOTE THAT FB BUFFER SHOULD STILL BE ORIGINAL BUFFER SIZE.
-      int h            = 3;
-      int w            = 3;
-      int x            = mouse_x - h / 2;
-      int y            = fb_height - ( mouse_y + w / 2 );
-      mat4 offcentre_P = perspective_offcentre_viewport( fb_width, fb_height, x, y, w, h, cam.P );
-
-      bind_framebuffer( &picking_fb );
-      viewport( x, y, w, h );
-      // clear to 1,1,1,1 because 0,0,0,0 is voxel number 0
-      clear_colour_and_depth_buffers( 1, 1, 1, 1 );
-      // clear_depth_buffer();
-
-      chunks_draw_colour_picking( offcentre_P, cam.V );
-
-      uint8_t data[4] = { 0, 0, 0, 0 };
-      // TODO(Anton) this is blocking cpu/gpu sync and can stall. to speed up use the 2-PBO method perhaps.
-      read_pixels( x + w / 2, y + h / 2, 1, 1, 4, data );
-      picked = chunks_picked_colour_to_voxel_idx( data[0], data[1], data[2], data[3], &picked_x, &picked_y, &picked_z, &picked_face, &picked_chunk_id );
+    { // pick the voxel under the mouse cursor by casting a ray from the camera through it
+      const float max_pick_dist = 64.0f;
+      // mouse coords are in window pixels, down from the top
+      const vec4 ndc  = ( vec4 ){ (float)( 2.0 * mouse_x / win_width - 1.0 ), (float)( 1.0 - 2.0 * mouse_y / win_height ), -1.0f, 1.0f };
+      vec4 ray_eye    = mult_mat4_vec4( inverse_mat4( cam.P ), ndc );
+      ray_eye         = ( vec4 ){ ray_eye.x, ray_eye.y, -1.0f, 0.0f };
+      const vec4 ray4 = mult_mat4_vec4( inverse_mat4( cam.V ), ray_eye );
+      const vec3 ray  = ( vec3 ){ ray4.x, ray4.y, ray4.z };
+      picked          = chunks_raycast( cam.pos, ray, max_pick_dist, &picked_chunk_id, &picked_x, &picked_y, &picked_z, &picked_face );
       if ( picked ) {
         sprintf( hovered_voxel_str, "chunk_id=%i voxel=(%i,%i,%i) face=%i", picked_chunk_id, picked_x, picked_y, picked_z, picked_face );
       } else {
         sprintf( hovered_voxel_str, "none" );
       }
-
-      bind_framebuffer( NULL );
     }
     swap_buffer();
   }
@@ -0,0 +1,187 @@
+#include "mesh_cache.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char _mesh_cache_magic[4] = { 'V', 'O', 'X', 'M' };
+
+// 64-bit FNV-1a
+#define MESH_CACHE_HASH_SEED 0xCBF29CE484222325ull
+#define MESH_CACHE_HASH_PRIME 0x100000001B3ull
+
+static uint64_t _hash_bytes( uint64_t hash, const uint8_t* bytes, size_t n_bytes ) {
+  for ( size_t i = 0; i < n_bytes; i++ ) { hash = ( hash ^ bytes[i] ) * MESH_CACHE_HASH_PRIME; }
+  return hash;
+}
+
+static uint64_t _hash_u32( uint64_t hash, uint32_t value ) { return _hash_bytes( hash, (const uint8_t*)&value, sizeof( value ) ); }
+
+// the column as runs of block types going up from y=0, the same for either form of the chunk
+static uint64_t _hash_column( uint64_t hash, const chunk_t* chunk, int x, int z ) {
+  const int column = CHUNK_X * z + x;
+  if ( chunk->rle ) {
+    const chunk_rle_t* rle = chunk->rle;
+    for ( uint32_t r = rle->column_starts[column]; r < rle->column_starts[column + 1]; r++ ) {
+      const uint8_t run[2] = { rle->palette[rle->runs[r] >> 8], (uint8_t)( rle->runs[r] & 0xFF ) };
+      hash                 = _hash_bytes( hash, run, sizeof( run ) );
+    }
+    return hash;
+  }
+  // runs are at most 256 long, which CHUNK_Y is, so these are the runs _rle_from_voxels() in chunk.c finds
+  for ( int y = 0; y < CHUNK_Y; ) {
+    const uint8_t type = chunk->voxels[CHUNK_X * CHUNK_Z * y + column].type;
+    int run_len        = 1;
+    while ( y + run_len < CHUNK_Y && run_len < 256 && chunk->voxels[CHUNK_X * CHUNK_Z * ( y + run_len ) + column].type == type ) { run_len++; }
+    const uint8_t run[2] = { type, (uint8_t)( run_len - 1 ) };
+    hash                 = _hash_bytes( hash, run, sizeof( run ) );
+    y += run_len;
+  }
+  return hash;
+}
+
+// a neighbour's columns and light along the border it shares with the chunk. x,z of the first column and the step to the next
+static uint64_t _hash_border( uint64_t hash, const chunk_t* chunk, int x, int z, int step_x, int step_z ) {
+  for ( int i = 0; i < CHUNK_X; i++, x += step_x, z += step_z ) {
+    hash = _hash_column( hash, chunk, x, z );
+    for ( int y = 0; y < CHUNK_Y; y++ ) {
+      const uint8_t light = chunk_get_light( chunk, x, y, z );
+      hash                = _hash_bytes( hash, &light, 1 );
+    }
+  }
+  return hash;
+}
+
+uint64_t mesh_cache_key( const chunk_t* chunk, const chunk_neighbours_t* neighbours, chunk_mesher_t mesher ) {
+  assert( chunk && ( chunk->voxels || chunk->rle ) );
+  assert( CHUNK_X == CHUNK_Z ); // borders are walked with one count
+
+  uint64_t hash = MESH_CACHE_HASH_SEED;
+  hash          = _hash_u32( hash, MESH_CACHE_VERSION );
+  hash          = _hash_u32( hash, (uint32_t)mesher );
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) { hash = _hash_column( hash, chunk, x, z ); }
+  }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    if ( chunk->light[section] ) {
+      hash = _hash_bytes( hash, chunk->light[section], CHUNK_X * CHUNK_Z * CHUNK_SECTION_Y );
+    } else {
+      const uint8_t fill[2] = { 0xFF, chunk->light_fill[section] }; // marker so a fill can't collide with the start of an array
+      hash                  = _hash_bytes( hash, fill, sizeof( fill ) );
+    }
+  }
+
+  // the column of each neighbour touching the chunk, in chunk_neighbours_t order. missing neighbours hash as a marker
+  const int border_x[4] = { CHUNK_X - 1, 0, 0, 0 }, border_z[4] = { 0, 0, CHUNK_Z - 1, 0 };
+  const int step_x[4] = { 0, 0, 1, 1 }, step_z[4] = { 1, 1, 0, 0 };
+  const int corner_x[4] = { CHUNK_X - 1, 0, CHUNK_X - 1, 0 }, corner_z[4] = { CHUNK_Z - 1, CHUNK_Z - 1, 0, 0 };
+  for ( int i = 0; i < 4; i++ ) {
+    const chunk_t* adjacent = neighbours ? neighbours->adjacent[i] : NULL;
+    hash                    = _hash_u32( hash, adjacent ? 1 : 0 );
+    if ( adjacent ) { hash = _hash_border( hash, adjacent, border_x[i], border_z[i], step_x[i], step_z[i] ); }
+  }
+  for ( int i = 0; i < 4; i++ ) {
+    const chunk_t* diagonal = neighbours ? neighbours->diagonal[i] : NULL;
+    hash                    = _hash_u32( hash, diagonal ? 1 : 0 );
+    if ( diagonal ) { hash = _hash_column( hash, diagonal, corner_x[i], corner_z[i] ); }
+  }
+  return hash;
+}
+
+size_t mesh_cache_blob_size( const chunk_vertex_data_t* vertex_data ) {
+  assert( vertex_data );
+
+  size_t n_bytes = MESH_CACHE_HEADER_BYTES;
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { n_bytes += vertex_data[section].n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ); }
+  return n_bytes;
+}
+
+size_t mesh_cache_save_to_mem( uint64_t key, const chunk_vertex_data_t* vertex_data, const uint16_t* connectivity, uint8_t* dest, size_t dest_sz ) {
+  assert( vertex_data && connectivity && dest );
+
+  const size_t n_bytes = mesh_cache_blob_size( vertex_data );
+  if ( dest_sz < n_bytes ) { return 0; }
+
+  const uint32_t version = MESH_CACHE_VERSION;
+  uint8_t* ptr           = dest;
+  memcpy( ptr, _mesh_cache_magic, 4 );
+  ptr += 4;
+  memcpy( ptr, &version, sizeof( version ) );
+  ptr += sizeof( version );
+  memcpy( ptr, &key, sizeof( key ) );
+  ptr += sizeof( key );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const uint32_t n_vertices = (uint32_t)vertex_data[section].n_vertices;
+    memcpy( ptr, &n_vertices, sizeof( n_vertices ) );
+    ptr += sizeof( n_vertices );
+  }
+  memcpy( ptr, connectivity, CHUNK_SECTIONS * sizeof( uint16_t ) );
+  ptr += CHUNK_SECTIONS * sizeof( uint16_t );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const size_t section_bytes = vertex_data[section].n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t );
+    if ( section_bytes > 0 ) { memcpy( ptr, vertex_data[section].packed_ptr, section_bytes ); }
+    ptr += section_bytes;
+  }
+  assert( (size_t)( ptr - dest ) == n_bytes );
+  return n_bytes;
+}
+
+bool mesh_cache_load_from_mem( const uint8_t* src, size_t n_bytes, uint64_t key, chunk_vertex_data_t* vertex_data, uint16_t* connectivity ) {
+  assert( src && vertex_data && connectivity );
+  assert( 0 == (uintptr_t)src % sizeof( uint32_t ) );
+
+  if ( n_bytes < MESH_CACHE_HEADER_BYTES ) { return false; }
+  uint32_t version = 0;
+  uint64_t src_key = 0;
+  if ( 0 != memcmp( src, _mesh_cache_magic, 4 ) ) { return false; }
+  memcpy( &version, &src[4], sizeof( version ) );
+  memcpy( &src_key, &src[8], sizeof( src_key ) );
+  if ( version != MESH_CACHE_VERSION || src_key != key ) { return false; }
+
+  uint32_t n_vertices[CHUNK_SECTIONS];
+  memcpy( n_vertices, &src[16], sizeof( n_vertices ) );
+  size_t expected_bytes = MESH_CACHE_HEADER_BYTES;
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { expected_bytes += (size_t)n_vertices[section] * VOXEL_VPACKED_COMPS * sizeof( uint32_t ); }
+  if ( expected_bytes != n_bytes ) { return false; }
+
+  memcpy( connectivity, &src[16 + sizeof( n_vertices )], CHUNK_SECTIONS * sizeof( uint16_t ) );
+  const uint32_t* packed_ptr = (const uint32_t*)&src[MESH_CACHE_HEADER_BYTES];
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    // vertex data isn't const anywhere else. nothing writes through it once meshed
+    vertex_data[section] = ( chunk_vertex_data_t ){ .packed_ptr = (uint32_t*)packed_ptr,
+      .n_vertices                                               = n_vertices[section],
+      .n_vpacked_comps                                          = VOXEL_VPACKED_COMPS,
+      .vpacked_buffer_sz                                        = n_vertices[section] * VOXEL_VPACKED_COMPS * sizeof( uint32_t ) };
+    packed_ptr += n_vertices[section] * VOXEL_VPACKED_COMPS;
+  }
+  return true;
+}
+
+bool mesh_cache_write( region_t* region, int local_x, int local_z, uint64_t key, const chunk_vertex_data_t* vertex_data, const uint16_t* connectivity ) {
+  assert( region && vertex_data && connectivity );
+
+  const size_t n_bytes = mesh_cache_blob_size( vertex_data );
+  uint8_t* buffer      = malloc( n_bytes );
+  assert( buffer );
+  bool ret = mesh_cache_save_to_mem( key, vertex_data, connectivity, buffer, n_bytes ) == n_bytes &&
+             region_write_chunk( region, local_x, local_z, buffer, n_bytes );
+  free( buffer );
+  return ret;
+}
+
+bool mesh_cache_read( region_t* region, int local_x, int local_z, uint64_t key, uint8_t** blob_ptr, chunk_vertex_data_t* vertex_data, uint16_t* connectivity ) {
+  assert( region && blob_ptr && vertex_data && connectivity );
+
+  *blob_ptr = NULL;
+  if ( !region_has_chunk( region, local_x, local_z ) ) { return false; }
+  // the table entry has the blob's size, so it's read in one go into a buffer of exactly that size
+  const size_t n_bytes = region->table[local_z * REGION_CHUNKS_W + local_x].n_bytes;
+  uint8_t* buffer      = malloc( n_bytes > 0 ? n_bytes : 1 );
+  assert( buffer );
+  size_t n_read = 0;
+  if ( !region_read_chunk( region, local_x, local_z, buffer, n_bytes, &n_read ) || !mesh_cache_load_from_mem( buffer, n_read, key, vertex_data, connectivity ) ) {
+    free( buffer );
+    return false;
+  }
+  *blob_ptr = buffer;
+  return true;
+}
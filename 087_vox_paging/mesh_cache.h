@@ -0,0 +1,50 @@
+/* Mesh cache - keeps the full detail meshes of saved chunks on disk, so that a chunk that comes back unchanged is uploaded without meshing it again.
+No GL in here so that it can be tested headless. See voxels.c for when blobs are written and looked up.
+
+Design:
+  one mesh blob per chunk, in a region file of its own next to the chunk's - <world name>.<region x>.<region z>.meshes - see region.h.
+  the blob is keyed by a hash of everything the mesher reads: the chunk's voxels and light, the neighbours' border columns and the light in them,
+  the diagonal neighbours' corner columns, which mesher, and MESH_CACHE_VERSION. a blob is only used if its key matches the chunk as it is now,
+  so a stale blob is just a miss, never a wrong mesh, and nothing has to invalidate it
+  voxels are hashed as runs of block types up each column, so a chunk hashes the same compressed or not
+  light is hashed as stored, so the same light held as an array in one chunk and a light_fill in another is a miss. it costs a remesh, that's all
+  only full detail section meshes are cached. LOD meshes are cheap and change with the camera
+
+Blob layout. integers in native byte order, like region.h:
+  magic "VOXM", uint32 MESH_CACHE_VERSION, uint64 key, uint32 n_vertices[CHUNK_SECTIONS], uint16 connectivity[CHUNK_SECTIONS],
+  then the packed vertices of each section in turn, VOXEL_VPACKED_COMPS uint32 each
+*/
+
+#pragma once
+
+#include "chunk.h"
+#include "region.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// bump whenever the mesher's output or the vertex layout changes, so that blobs from older builds are misses
+#define MESH_CACHE_VERSION 4
+#define MESH_CACHE_HEADER_BYTES ( 4 + sizeof( uint32_t ) + sizeof( uint64_t ) + CHUNK_SECTIONS * ( sizeof( uint32_t ) + sizeof( uint16_t ) ) )
+
+/* RETURNS the key of the meshes chunk_gen_vertex_data() would make for this chunk and these neighbours with this mesher.
+neighbours may be NULL, like for chunk_gen_vertex_data() */
+uint64_t mesh_cache_key( const chunk_t* chunk, const chunk_neighbours_t* neighbours, chunk_mesher_t mesher );
+
+// RETURNS the bytes mesh_cache_save_to_mem() needs for these sections
+size_t mesh_cache_blob_size( const chunk_vertex_data_t* vertex_data );
+
+/* serialises the meshes of all CHUNK_SECTIONS sections. vertex_data and connectivity are indexed by section
+RETURNS the number of bytes written to dest, or 0 if dest_sz is too small */
+size_t mesh_cache_save_to_mem( uint64_t key, const chunk_vertex_data_t* vertex_data, const uint16_t* connectivity, uint8_t* dest, size_t dest_sz );
+
+/* reads a blob written by mesh_cache_save_to_mem() without copying it - vertex_data points into src, which must be 4-byte aligned and outlive it
+RETURNS false if src isn't a valid blob, or is one for a different key, in which case vertex_data and connectivity are untouched */
+bool mesh_cache_load_from_mem( const uint8_t* src, size_t n_bytes, uint64_t key, chunk_vertex_data_t* vertex_data, uint16_t* connectivity );
+
+// RETURNS false on a write failure, in which case the previous blob is kept
+bool mesh_cache_write( region_t* region, int local_x, int local_z, uint64_t key, const chunk_vertex_data_t* vertex_data, const uint16_t* connectivity );
+
+/* reads the chunk's blob into a new buffer, *blob_ptr, which vertex_data points into. free() it when done with the vertices
+RETURNS false if there's no blob for the chunk, the read failed, or its key doesn't match, in which case *blob_ptr is NULL */
+bool mesh_cache_read( region_t* region, int local_x, int local_z, uint64_t key, uint8_t** blob_ptr, chunk_vertex_data_t* vertex_data, uint16_t* connectivity );
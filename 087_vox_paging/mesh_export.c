@@ -0,0 +1,249 @@
+#include "mesh_export.h"
+#include <assert.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+// key of a corner in the per-chunk hash: position from vertex word 0, then the face and palette index. texcoords, light, and AO aren't exported
+#define CORNER_KEY_POSITION_MASK 0x0007FFFF
+#define CORNER_KEY_FACE_SHIFT 19
+#define CORNER_KEY_PALIDX_SHIFT 22
+#define CORNER_KEY_EMPTY UINT32_MAX // corner x is at most CHUNK_X, so no real key sets every bit
+
+// bytes per vertex and per triangle in the file
+#define PLY_VERTEX_SZ ( 6 * sizeof( float ) + 3 )
+#define PLY_TRIANGLE_SZ ( 1 + 3 * sizeof( uint32_t ) )
+#define GLB_VERTEX_SZ ( 6 * sizeof( float ) + 4 )
+#define GLB_TRIANGLE_SZ ( 3 * sizeof( uint32_t ) )
+// glb header, JSON chunk header and JSON, then BIN chunk header
+#define GLB_HEADER_SZ ( 12 + 8 + MESH_EXPORT_GLB_JSON_SZ + 8 )
+
+// clang-format off
+static const float _face_normals[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+// clang-format on
+
+/*-------------------------------------------------BUFFERED WRITES-----------------------------------------------------*/
+
+static bool _stream_open( mesh_export_stream_t* stream, const char* filename, const char* mode ) {
+  memset( stream, 0, sizeof( mesh_export_stream_t ) );
+  stream->buffer = malloc( MESH_EXPORT_BUFFER_SZ );
+  if ( !stream->buffer ) { return false; }
+  stream->fptr = fopen( filename, mode );
+  if ( !stream->fptr ) {
+    free( stream->buffer );
+    stream->buffer = NULL;
+    return false;
+  }
+  return true;
+}
+
+static bool _stream_flush( mesh_export_stream_t* stream ) {
+  if ( 0 == stream->n_buffered ) { return true; }
+  const bool ok      = 1 == fwrite( stream->buffer, stream->n_buffered, 1, stream->fptr );
+  stream->n_buffered = 0;
+  return ok;
+}
+
+// RETURNS false if a write failed
+static bool _stream_write( mesh_export_stream_t* stream, const void* src, size_t n_bytes ) {
+  assert( n_bytes <= MESH_EXPORT_BUFFER_SZ );
+  if ( stream->n_buffered + n_bytes > MESH_EXPORT_BUFFER_SZ && !_stream_flush( stream ) ) { return false; }
+  memcpy( &stream->buffer[stream->n_buffered], src, n_bytes );
+  stream->n_buffered += n_bytes;
+  return true;
+}
+
+static bool _stream_close( mesh_export_stream_t* stream ) {
+  bool ok = true;
+  if ( stream->fptr ) {
+    ok = _stream_flush( stream );
+    ok = 0 == fclose( stream->fptr ) && ok;
+  }
+  free( stream->buffer );
+  memset( stream, 0, sizeof( mesh_export_stream_t ) );
+  return ok;
+}
+
+/*-------------------------------------------------HEADERS-----------------------------------------------------*/
+
+// counts are zero-padded to a fixed width so that the header is the same size when it's rewritten at the end
+static bool _write_ply_header( const mesh_export_t* exporter, FILE* fptr ) {
+  const int n = fprintf( fptr,
+    "ply\nformat binary_little_endian 1.0\ncomment exported from 087_vox_paging\n"
+    "element vertex %010u\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+    "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+    "element face %010u\nproperty list uchar uint vertex_indices\nend_header\n",
+    exporter->n_vertices, exporter->n_triangles );
+  return n > 0;
+}
+
+static void _write_u32( uint8_t* dest, uint32_t value ) { memcpy( dest, &value, sizeof( uint32_t ) ); }
+
+/* the JSON describes a buffer of all the vertices then all the indices. an empty export has no mesh, since glTF doesn't allow empty accessors.
+RETURNS false if the JSON didn't fit in MESH_EXPORT_GLB_JSON_SZ */
+static bool _write_glb_header( const mesh_export_t* exporter, FILE* fptr ) {
+  uint8_t header[GLB_HEADER_SZ];
+  memset( header, ' ', sizeof( header ) );
+  char* json                  = (char*)&header[20];
+  const uint32_t vertices_sz  = exporter->n_vertices * GLB_VERTEX_SZ;
+  const uint32_t triangles_sz = exporter->n_triangles * GLB_TRIANGLE_SZ;
+  const uint32_t bin_sz       = vertices_sz + triangles_sz;
+  const char* asset           = "\"asset\":{\"version\":\"2.0\",\"generator\":\"087_vox_paging\"}";
+  int n                       = 0;
+  if ( 0 == exporter->n_vertices ) {
+    n = snprintf( json, MESH_EXPORT_GLB_JSON_SZ + 1, "{%s,\"scene\":0,\"scenes\":[{\"nodes\":[]}]}", asset );
+  } else {
+    // clang-format off
+    n = snprintf( json, MESH_EXPORT_GLB_JSON_SZ + 1,
+      "{%s,\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+      "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"COLOR_0\":2},\"indices\":3}]}],"
+      "\"buffers\":[{\"byteLength\":%u}],"
+      "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%u,\"byteStride\":%u,\"target\":34962},"
+      "{\"buffer\":0,\"byteOffset\":%u,\"byteLength\":%u,\"target\":34963}],"
+      "\"accessors\":[{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\","
+      "\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},"
+      "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},"
+      "{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5121,\"normalized\":true,\"count\":%u,\"type\":\"VEC4\"},"
+      "{\"bufferView\":1,\"byteOffset\":0,\"componentType\":5125,\"count\":%u,\"type\":\"SCALAR\"}]}",
+      asset, bin_sz, vertices_sz, (uint32_t)GLB_VERTEX_SZ, vertices_sz, triangles_sz,
+      exporter->n_vertices, exporter->mins[0], exporter->mins[1], exporter->mins[2], exporter->maxs[0], exporter->maxs[1], exporter->maxs[2],
+      exporter->n_vertices, exporter->n_vertices, exporter->n_triangles * 3 );
+    // clang-format on
+  }
+  if ( n < 0 || n > MESH_EXPORT_GLB_JSON_SZ ) { return false; }
+  json[n] = ' '; // over snprintf's terminator. the padding is spaces
+
+  memcpy( header, "glTF", 4 );
+  _write_u32( &header[4], 2 );
+  _write_u32( &header[8], GLB_HEADER_SZ + bin_sz );
+  _write_u32( &header[12], MESH_EXPORT_GLB_JSON_SZ );
+  memcpy( &header[16], "JSON", 4 );
+  _write_u32( &header[20 + MESH_EXPORT_GLB_JSON_SZ], bin_sz );
+  memcpy( &header[24 + MESH_EXPORT_GLB_JSON_SZ], "BIN\0", 4 );
+  return 1 == fwrite( header, sizeof( header ), 1, fptr );
+}
+
+static bool _write_header( const mesh_export_t* exporter, FILE* fptr ) {
+  return MESH_EXPORT_PLY == exporter->format ? _write_ply_header( exporter, fptr ) : _write_glb_header( exporter, fptr );
+}
+
+/*-------------------------------------------------EXPORT-----------------------------------------------------*/
+
+bool mesh_export_begin( mesh_export_t* exporter, const char* filename, mesh_export_format_t format, const uint8_t* palette_rgb, int n_palette, float scale ) {
+  assert( exporter && filename );
+  assert( n_palette >= 0 && n_palette <= MESH_EXPORT_PALETTE_MAX && ( palette_rgb || 0 == n_palette ) );
+
+  memset( exporter, 0, sizeof( mesh_export_t ) );
+  exporter->format = format;
+  exporter->scale  = scale;
+  memset( exporter->palette_rgb, 128, sizeof( exporter->palette_rgb ) );
+  if ( n_palette > 0 ) { memcpy( exporter->palette_rgb, palette_rgb, (size_t)n_palette * 3 ); }
+  for ( int c = 0; c < 3; c++ ) {
+    exporter->mins[c] = FLT_MAX;
+    exporter->maxs[c] = -FLT_MAX;
+  }
+
+  int n = snprintf( exporter->triangles_filename, sizeof( exporter->triangles_filename ), "%s.triangles.tmp", filename );
+  if ( n < 0 || n >= (int)sizeof( exporter->triangles_filename ) ) { return false; }
+  if ( !_stream_open( &exporter->vertices, filename, "wb" ) ) { return false; }
+  if ( !_stream_open( &exporter->triangles, exporter->triangles_filename, "w+b" ) ) {
+    _stream_close( &exporter->vertices );
+    return false;
+  }
+  exporter->failed = !_write_header( exporter, exporter->vertices.fptr );
+  return true;
+}
+
+// RETURNS the index in the file of the vertex at this corner, writing it if this chunk hasn't had it yet
+static uint32_t _corner_index( mesh_export_t* exporter, const uint32_t* packed, const float* offset ) {
+  const voxel_vertex_t vertex = voxel_vertex_unpack( packed );
+  const uint32_t key =
+    ( packed[0] & CORNER_KEY_POSITION_MASK ) | (uint32_t)vertex.face_idx << CORNER_KEY_FACE_SHIFT | vertex.palidx << CORNER_KEY_PALIDX_SHIFT;
+  const uint32_t hash_mask    = ( 1u << exporter->hash_bits ) - 1;
+  uint32_t slot               = ( key * 2654435761u ) >> ( 32 - exporter->hash_bits );
+  while ( exporter->hash_keys[slot] != CORNER_KEY_EMPTY ) {
+    if ( exporter->hash_keys[slot] == key ) { return exporter->hash_indices[slot]; }
+    slot = ( slot + 1 ) & hash_mask;
+  }
+  exporter->hash_keys[slot]    = key;
+  exporter->hash_indices[slot] = exporter->n_vertices;
+
+  const int corner[3] = { vertex.x, vertex.y, vertex.z };
+  float position[3];
+  for ( int c = 0; c < 3; c++ ) {
+    position[c]       = ( offset[c] + (float)corner[c] ) * exporter->scale;
+    exporter->mins[c] = position[c] < exporter->mins[c] ? position[c] : exporter->mins[c];
+    exporter->maxs[c] = position[c] > exporter->maxs[c] ? position[c] : exporter->maxs[c];
+  }
+  uint8_t record[GLB_VERTEX_SZ];
+  memcpy( record, position, sizeof( position ) );
+  memcpy( &record[12], _face_normals[vertex.face_idx], 3 * sizeof( float ) );
+  memcpy( &record[24], exporter->palette_rgb[vertex.palidx], 3 );
+  record[27]          = 255; // alpha, only written for GLB
+  const size_t rec_sz = MESH_EXPORT_PLY == exporter->format ? PLY_VERTEX_SZ : GLB_VERTEX_SZ;
+  if ( !_stream_write( &exporter->vertices, record, rec_sz ) ) { exporter->failed = true; }
+  return exporter->n_vertices++;
+}
+
+bool mesh_export_chunk( mesh_export_t* exporter, const chunk_vertex_data_t* vertex_data, float offset_x, float offset_y, float offset_z ) {
+  assert( exporter && exporter->vertices.fptr && vertex_data );
+  assert( vertex_data->n_vertices % 3 == 0 );
+  if ( exporter->failed ) { return false; }
+  if ( 0 == vertex_data->n_vertices ) { return true; }
+
+  // at most half full so probes stay short
+  int hash_bits = exporter->hash_bits > 0 ? exporter->hash_bits : 10;
+  while ( ( (size_t)1 << hash_bits ) < vertex_data->n_vertices * 2 ) { hash_bits++; }
+  if ( hash_bits != exporter->hash_bits ) {
+    uint32_t* keys    = realloc( exporter->hash_keys, sizeof( uint32_t ) << hash_bits );
+    uint32_t* indices = realloc( exporter->hash_indices, sizeof( uint32_t ) << hash_bits );
+    if ( keys ) { exporter->hash_keys = keys; }
+    if ( indices ) { exporter->hash_indices = indices; }
+    if ( !keys || !indices ) {
+      exporter->failed = true;
+      return false;
+    }
+    exporter->hash_bits = hash_bits;
+  }
+  memset( exporter->hash_keys, 0xFF, sizeof( uint32_t ) << exporter->hash_bits );
+
+  const float offset[3] = { offset_x, offset_y, offset_z };
+  for ( size_t tri = 0; tri < vertex_data->n_vertices / 3; tri++ ) {
+    uint8_t record[PLY_TRIANGLE_SZ];
+    uint8_t* indices = MESH_EXPORT_PLY == exporter->format ? &record[1] : record;
+    record[0]        = 3;
+    for ( int v = 0; v < 3; v++ ) {
+      const uint32_t idx = _corner_index( exporter, &vertex_data->packed_ptr[( tri * 3 + v ) * VOXEL_VPACKED_COMPS], offset );
+      _write_u32( &indices[v * sizeof( uint32_t )], idx );
+    }
+    const size_t rec_sz = MESH_EXPORT_PLY == exporter->format ? PLY_TRIANGLE_SZ : GLB_TRIANGLE_SZ;
+    if ( !_stream_write( &exporter->triangles, record, rec_sz ) ) { exporter->failed = true; }
+    exporter->n_triangles++;
+  }
+  return !exporter->failed;
+}
+
+bool mesh_export_end( mesh_export_t* exporter ) {
+  assert( exporter );
+
+  bool ok = !exporter->failed && exporter->vertices.fptr && exporter->triangles.fptr;
+  if ( ok ) {
+    // copy the triangles over after the vertices, through the vertex stream's buffer
+    ok = _stream_flush( &exporter->vertices ) && _stream_flush( &exporter->triangles ) && 0 == fseek( exporter->triangles.fptr, 0, SEEK_SET );
+    while ( ok ) {
+      const size_t n = fread( exporter->vertices.buffer, 1, MESH_EXPORT_BUFFER_SZ, exporter->triangles.fptr );
+      if ( 0 == n ) { break; }
+      ok = 1 == fwrite( exporter->vertices.buffer, n, 1, exporter->vertices.fptr );
+    }
+    ok = ok && !ferror( exporter->triangles.fptr );
+  }
+  if ( ok ) { ok = 0 == fseek( exporter->vertices.fptr, 0, SEEK_SET ) && _write_header( exporter, exporter->vertices.fptr ); }
+
+  ok = _stream_close( &exporter->vertices ) && ok;
+  _stream_close( &exporter->triangles );
+  remove( exporter->triangles_filename );
+  free( exporter->hash_keys );
+  free( exporter->hash_indices );
+  memset( exporter, 0, sizeof( mesh_export_t ) );
+  return ok;
+}
@@ -0,0 +1,67 @@
+/* Mesh export - writes chunk meshes to a binary PLY or glTF binary (GLB) file one chunk at a time, for opening in other tools.
+No GL in here so that it can be tested headless. See chunks_export() in voxels.c for exporting the resident world.
+
+Design:
+  only one chunk's mesh is held at a time. vertices go straight to the file through a write buffer. triangles, which both formats want after every
+  vertex, go through another buffer to a temporary file next to the output, which is appended to it when the export is finished
+  the counts, and for GLB the bounds, aren't known until then either, so the header is written at a fixed size up front and rewritten in place at the end
+  within a chunk, a corner shared by faces facing the same way with the same colour is written once. vertices aren't shared across chunks, so there
+  are seams of duplicates along chunk borders
+  chunks should be meshed with CHUNK_MESHER_GREEDY, so that flat areas are a few big triangles
+  multi-byte values are written in native byte order, which is little-endian on everything we build for, like region.h
+
+PLY:  binary_little_endian 1.0. per vertex float x,y,z, float nx,ny,nz, uchar red,green,blue. per face a uchar 3 and 3 uint vertex indices
+GLB:  glTF 2.0. one mesh, one primitive. vertices interleaved in one buffer view: float POSITION, float NORMAL, normalised ubyte COLOR_0 rgba.
+      uint32 indices in a second view. the JSON chunk is padded with spaces to MESH_EXPORT_GLB_JSON_SZ
+*/
+
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MESH_EXPORT_BUFFER_SZ ( 64 * 1024 )
+#define MESH_EXPORT_GLB_JSON_SZ 2048
+#define MESH_EXPORT_PALETTE_MAX ( VOXEL_VPACKED_PALIDX_MASK + 1 )
+
+typedef enum mesh_export_format_t { MESH_EXPORT_PLY = 0, MESH_EXPORT_GLB } mesh_export_format_t;
+
+typedef struct mesh_export_stream_t {
+  FILE* fptr;
+  uint8_t* buffer; // MESH_EXPORT_BUFFER_SZ
+  size_t n_buffered;
+} mesh_export_stream_t;
+
+// set up with mesh_export_begin(). don't touch the members
+typedef struct mesh_export_t {
+  mesh_export_format_t format;
+  mesh_export_stream_t vertices;
+  mesh_export_stream_t triangles;
+  char triangles_filename[256];
+  float scale;
+  uint8_t palette_rgb[MESH_EXPORT_PALETTE_MAX][3];
+  uint32_t n_vertices, n_triangles;
+  float mins[3], maxs[3];
+  bool failed; // a write failed. the rest of the export is skipped and mesh_export_end() reports it
+
+  // one chunk's corners, open addressing. reused for each chunk and grown as needed
+  uint32_t* hash_keys;
+  uint32_t* hash_indices;
+  int hash_bits;
+} mesh_export_t;
+
+/* opens filename and writes a placeholder header. palette_rgb is 3 bytes per palette index for n_palette of them; faces with palette indices past
+those are grey. positions in the file are ( the chunk's offset + corner ) * scale - see mesh_export_chunk()
+RETURNS false if a file couldn't be opened, and leaves nothing open */
+bool mesh_export_begin( mesh_export_t* exporter, const char* filename, mesh_export_format_t format, const uint8_t* palette_rgb, int n_palette, float scale );
+
+/* appends one chunk's triangles. offset_x,y,z is where the chunk's corner 0,0,0 is, in voxels, eg cx * CHUNK_X, 0, cz * CHUNK_Z
+RETURNS false if a write has failed, this export's or an earlier one */
+bool mesh_export_chunk( mesh_export_t* exporter, const chunk_vertex_data_t* vertex_data, float offset_x, float offset_y, float offset_z );
+
+/* appends the triangles, writes the final header, closes the file, and frees everything. call it after a successful mesh_export_begin() even if
+mesh_export_chunk() failed. RETURNS false if any write failed, in which case the file is incomplete */
+bool mesh_export_end( mesh_export_t* exporter );
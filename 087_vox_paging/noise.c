@@ -0,0 +1,298 @@
+#include "noise.h"
+#include <assert.h>
+
+// the SIMD paths only match the scalar one if scalar floats are worked out in SSE registers too, not at x87's higher precision
+#if defined( __SSE2__ ) && defined( __SSE2_MATH__ )
+#define NOISE_HAS_SSE2
+#include <emmintrin.h>
+// AVX2 is built whatever the compiler flags, and used if the CPU running it has it
+#if defined( __GNUC__ )
+#define NOISE_HAS_AVX2
+#define NOISE_AVX2_FN __attribute__( ( target( "avx2" ) ) )
+#include <immintrin.h>
+#endif
+#endif
+
+// a fused multiply-add rounds once where the SIMD paths round twice, so don't let the compiler fuse the scalar path's if FMA is turned on
+#if defined( __clang__ )
+#pragma STDC FP_CONTRACT OFF
+#elif defined( __GNUC__ )
+#pragma GCC optimize( "fp-contract=off" )
+#endif
+
+// multipliers for each axis' coord, before the hash is finalised
+#define NOISE_X_MUL 0x9E3779B1u
+#define NOISE_Y_MUL 0xC2B2AE3Du
+#define NOISE_Z_MUL 0x85EBCA77u
+// lattice gradients are -1..1 in each axis, from 10 bits of the hash each
+#define NOISE_GRAD_MASK 0x3FF
+#define NOISE_GRAD_SCALE ( 2.0f / 1023.0f )
+
+// rounds towards negative infinity, unlike /, so that lattice cells either side of 0 are the same width
+static int _floor_div( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); }
+
+// the murmur3 fmix32 avalanche
+static uint32_t _fmix32( uint32_t h ) {
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+uint32_t noise_hash2( uint32_t seed, int x, int z ) { return _fmix32( seed ^ (uint32_t)x * NOISE_X_MUL ^ (uint32_t)z * NOISE_Z_MUL ); }
+
+// -1..1 at a lattice point
+static float _lattice_value( uint32_t seed, int x, int z ) { return (float)( noise_hash2( seed, x, z ) >> 8 ) * ( 2.0f / 16777215.0f ) - 1.0f; }
+
+// smoothstep, so that the slope is continuous across lattice points
+static float _fade( float t ) { return t * t * ( 3.0f - 2.0f * t ); }
+
+float noise_value2( uint32_t seed, int x, int z, int spacing ) {
+  assert( spacing > 0 );
+
+  const int lx    = _floor_div( x, spacing ), lz = _floor_div( z, spacing );
+  const float fx  = _fade( (float)( x - lx * spacing ) / (float)spacing );
+  const float fz  = _fade( (float)( z - lz * spacing ) / (float)spacing );
+  const float v00 = _lattice_value( seed, lx, lz ), v10 = _lattice_value( seed, lx + 1, lz );
+  const float v01 = _lattice_value( seed, lx, lz + 1 ), v11 = _lattice_value( seed, lx + 1, lz + 1 );
+  const float v0  = v00 + ( v10 - v00 ) * fx;
+  const float v1  = v01 + ( v11 - v01 ) * fx;
+  return v0 + ( v1 - v0 ) * fz;
+}
+
+float noise_fbm2( uint32_t seed, int x, int z, int spacing, int n_octaves ) {
+  assert( spacing > 0 && n_octaves > 0 );
+
+  float sum = 0.0f, amplitude = 1.0f, total_amplitude = 0.0f;
+  for ( int octave = 0; octave < n_octaves; octave++ ) {
+    // a different seed per octave so that the octaves' lattice points don't line up
+    sum += amplitude * noise_value2( noise_hash2( seed, octave, 0 ), x, z, spacing );
+    total_amplitude += amplitude;
+    amplitude *= 0.5f;
+    if ( spacing > 1 ) { spacing /= 2; }
+  }
+  return sum / total_amplitude;
+}
+
+/*-------------------------------------------------3D GRADIENT NOISE-----------------------------------------------------*/
+
+uint32_t noise_hash3( uint32_t seed, int x, int y, int z ) {
+  return _fmix32( seed ^ (uint32_t)x * NOISE_X_MUL ^ (uint32_t)y * NOISE_Y_MUL ^ (uint32_t)z * NOISE_Z_MUL );
+}
+
+// everything about a row of voxels at y,z that doesn't depend on x
+typedef struct noise_row_t {
+  uint32_t yz_hashes[4]; // the seed and y,z parts of the hashes of the lattice points around the row, before x is mixed in. index is ( z << 1 ) | y
+  float dy[2], dz[2];    // y,z of the row from the lattice points below and above it, in lattice cells
+  float fy, fz;          // faded
+} noise_row_t;
+
+// quintic, so that the curvature is continuous across lattice points too
+static float _fade3( float t ) { return t * t * t * ( t * ( t * 6.0f - 15.0f ) + 10.0f ); }
+
+// dot product of the lattice point's gradient and the offset from it
+static float _grad_dot( uint32_t hash, float dx, float dy, float dz ) {
+  const float gx = (float)( hash & NOISE_GRAD_MASK ) * NOISE_GRAD_SCALE - 1.0f;
+  const float gy = (float)( hash >> 10 & NOISE_GRAD_MASK ) * NOISE_GRAD_SCALE - 1.0f;
+  const float gz = (float)( hash >> 20 & NOISE_GRAD_MASK ) * NOISE_GRAD_SCALE - 1.0f;
+  return gx * dx + gy * dy + gz * dz;
+}
+
+static float _lerp( float a, float b, float t ) { return a + ( b - a ) * t; }
+
+static noise_row_t _row_setup( uint32_t seed, int y, int z, int spacing ) {
+  const int ly = _floor_div( y, spacing ), lz = _floor_div( z, spacing );
+  const float ty = (float)( y - ly * spacing ) / (float)spacing, tz = (float)( z - lz * spacing ) / (float)spacing;
+  noise_row_t row = ( noise_row_t ){ .dy = { ty, ty - 1.0f }, .dz = { tz, tz - 1.0f }, .fy = _fade3( ty ), .fz = _fade3( tz ) };
+  for ( int corner = 0; corner < 4; corner++ ) {
+    const uint32_t cy     = (uint32_t)ly + (uint32_t)( corner & 1 ), cz = (uint32_t)lz + (uint32_t)( corner >> 1 );
+    row.yz_hashes[corner] = seed ^ cy * NOISE_Y_MUL ^ cz * NOISE_Z_MUL;
+  }
+  return row;
+}
+
+/* the x part of the noise. lx is x's lattice cell and rx how far into it x is, in voxels. the SIMD versions below must do exactly these operations
+in exactly this order */
+static float _gradient3_x( const noise_row_t* row, int lx, int rx, int spacing ) {
+  const float tx     = (float)rx / (float)spacing;
+  const float fx     = _fade3( tx );
+  const uint32_t hx0 = (uint32_t)lx * NOISE_X_MUL, hx1 = ( (uint32_t)lx + 1u ) * NOISE_X_MUL;
+  float n[4];
+  for ( int corner = 0; corner < 4; corner++ ) {
+    const float dy = row->dy[corner & 1], dz = row->dz[corner >> 1];
+    const float d0 = _grad_dot( _fmix32( row->yz_hashes[corner] ^ hx0 ), tx, dy, dz );
+    const float d1 = _grad_dot( _fmix32( row->yz_hashes[corner] ^ hx1 ), tx - 1.0f, dy, dz );
+    n[corner]      = _lerp( d0, d1, fx );
+  }
+  return _lerp( _lerp( n[0], n[1], row->fy ), _lerp( n[2], n[3], row->fy ), row->fz );
+}
+
+float noise_gradient3( uint32_t seed, int x, int y, int z, int spacing ) {
+  assert( spacing > 0 );
+
+  const noise_row_t row = _row_setup( seed, y, z, spacing );
+  const int lx          = _floor_div( x, spacing );
+  return _gradient3_x( &row, lx, x - lx * spacing, spacing );
+}
+
+#ifdef NOISE_HAS_SSE2
+// SSE2 has no 32-bit low multiply, so multiply the even and odd lanes as 64-bit and keep the low halves
+static __m128i _mullo_sse2( __m128i a, __m128i b ) {
+  const __m128i even = _mm_mul_epu32( a, b );
+  const __m128i odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+  return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+static __m128i _fmix32_sse2( __m128i h ) {
+  h = _mm_xor_si128( h, _mm_srli_epi32( h, 16 ) );
+  h = _mullo_sse2( h, _mm_set1_epi32( (int)0x85EBCA6Bu ) );
+  h = _mm_xor_si128( h, _mm_srli_epi32( h, 13 ) );
+  h = _mullo_sse2( h, _mm_set1_epi32( (int)0xC2B2AE35u ) );
+  return _mm_xor_si128( h, _mm_srli_epi32( h, 16 ) );
+}
+
+static __m128 _fade3_sse2( __m128 t ) {
+  const __m128 t6_15 = _mm_sub_ps( _mm_mul_ps( t, _mm_set1_ps( 6.0f ) ), _mm_set1_ps( 15.0f ) );
+  const __m128 poly  = _mm_add_ps( _mm_mul_ps( t, t6_15 ), _mm_set1_ps( 10.0f ) );
+  return _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( t, t ), t ), poly );
+}
+
+static __m128 _grad_dot_sse2( __m128i hash, __m128 dx, __m128 dy, __m128 dz ) {
+  const __m128i mask = _mm_set1_epi32( NOISE_GRAD_MASK );
+  const __m128 scale = _mm_set1_ps( NOISE_GRAD_SCALE ), one = _mm_set1_ps( 1.0f );
+  const __m128 gx    = _mm_sub_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( hash, mask ) ), scale ), one );
+  const __m128 gy    = _mm_sub_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( hash, 10 ), mask ) ), scale ), one );
+  const __m128 gz    = _mm_sub_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( hash, 20 ), mask ) ), scale ), one );
+  return _mm_add_ps( _mm_add_ps( _mm_mul_ps( gx, dx ), _mm_mul_ps( gy, dy ) ), _mm_mul_ps( gz, dz ) );
+}
+
+static __m128 _lerp_sse2( __m128 a, __m128 b, __m128 t ) { return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) ); }
+
+// 4 voxels at a time
+static void _gradient3_row_sse2( const noise_row_t* row, const int* lx, const int* rx, int spacing, float* values ) {
+  const __m128i x_mul    = _mm_set1_epi32( (int)NOISE_X_MUL );
+  const __m128 spacing_f = _mm_set1_ps( (float)spacing ), one = _mm_set1_ps( 1.0f );
+  for ( int i = 0; i < NOISE_ROW_W; i += 4 ) {
+    const __m128i lx4 = _mm_loadu_si128( (const __m128i*)&lx[i] );
+    const __m128 tx   = _mm_div_ps( _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)&rx[i] ) ), spacing_f );
+    const __m128 tx1  = _mm_sub_ps( tx, one );
+    const __m128 fx   = _fade3_sse2( tx );
+    const __m128i hx0 = _mullo_sse2( lx4, x_mul ), hx1 = _mullo_sse2( _mm_add_epi32( lx4, _mm_set1_epi32( 1 ) ), x_mul );
+    __m128 n[4];
+    for ( int corner = 0; corner < 4; corner++ ) {
+      const __m128i yz = _mm_set1_epi32( (int)row->yz_hashes[corner] );
+      const __m128 dy  = _mm_set1_ps( row->dy[corner & 1] ), dz = _mm_set1_ps( row->dz[corner >> 1] );
+      const __m128 d0  = _grad_dot_sse2( _fmix32_sse2( _mm_xor_si128( yz, hx0 ) ), tx, dy, dz );
+      const __m128 d1  = _grad_dot_sse2( _fmix32_sse2( _mm_xor_si128( yz, hx1 ) ), tx1, dy, dz );
+      n[corner]        = _lerp_sse2( d0, d1, fx );
+    }
+    const __m128 fy = _mm_set1_ps( row->fy ), fz = _mm_set1_ps( row->fz );
+    _mm_storeu_ps( &values[i], _lerp_sse2( _lerp_sse2( n[0], n[1], fy ), _lerp_sse2( n[2], n[3], fy ), fz ) );
+  }
+}
+#endif
+
+#ifdef NOISE_HAS_AVX2
+NOISE_AVX2_FN static __m256i _fmix32_avx2( __m256i h ) {
+  h = _mm256_xor_si256( h, _mm256_srli_epi32( h, 16 ) );
+  h = _mm256_mullo_epi32( h, _mm256_set1_epi32( (int)0x85EBCA6Bu ) );
+  h = _mm256_xor_si256( h, _mm256_srli_epi32( h, 13 ) );
+  h = _mm256_mullo_epi32( h, _mm256_set1_epi32( (int)0xC2B2AE35u ) );
+  return _mm256_xor_si256( h, _mm256_srli_epi32( h, 16 ) );
+}
+
+NOISE_AVX2_FN static __m256 _fade3_avx2( __m256 t ) {
+  const __m256 t6_15 = _mm256_sub_ps( _mm256_mul_ps( t, _mm256_set1_ps( 6.0f ) ), _mm256_set1_ps( 15.0f ) );
+  const __m256 poly  = _mm256_add_ps( _mm256_mul_ps( t, t6_15 ), _mm256_set1_ps( 10.0f ) );
+  return _mm256_mul_ps( _mm256_mul_ps( _mm256_mul_ps( t, t ), t ), poly );
+}
+
+NOISE_AVX2_FN static __m256 _grad_dot_avx2( __m256i hash, __m256 dx, __m256 dy, __m256 dz ) {
+  const __m256i mask = _mm256_set1_epi32( NOISE_GRAD_MASK );
+  const __m256 scale = _mm256_set1_ps( NOISE_GRAD_SCALE ), one = _mm256_set1_ps( 1.0f );
+  const __m256 gx    = _mm256_sub_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_and_si256( hash, mask ) ), scale ), one );
+  const __m256 gy    = _mm256_sub_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srli_epi32( hash, 10 ), mask ) ), scale ), one );
+  const __m256 gz    = _mm256_sub_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srli_epi32( hash, 20 ), mask ) ), scale ), one );
+  return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( gx, dx ), _mm256_mul_ps( gy, dy ) ), _mm256_mul_ps( gz, dz ) );
+}
+
+NOISE_AVX2_FN static __m256 _lerp_avx2( __m256 a, __m256 b, __m256 t ) { return _mm256_add_ps( a, _mm256_mul_ps( _mm256_sub_ps( b, a ), t ) ); }
+
+// 8 voxels at a time
+NOISE_AVX2_FN static void _gradient3_row_avx2( const noise_row_t* row, const int* lx, const int* rx, int spacing, float* values ) {
+  const __m256i x_mul    = _mm256_set1_epi32( (int)NOISE_X_MUL );
+  const __m256 spacing_f = _mm256_set1_ps( (float)spacing ), one = _mm256_set1_ps( 1.0f );
+  for ( int i = 0; i < NOISE_ROW_W; i += 8 ) {
+    const __m256i lx8 = _mm256_loadu_si256( (const __m256i*)&lx[i] );
+    const __m256 tx   = _mm256_div_ps( _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i*)&rx[i] ) ), spacing_f );
+    const __m256 tx1  = _mm256_sub_ps( tx, one );
+    const __m256 fx   = _fade3_avx2( tx );
+    const __m256i hx0 = _mm256_mullo_epi32( lx8, x_mul ), hx1 = _mm256_mullo_epi32( _mm256_add_epi32( lx8, _mm256_set1_epi32( 1 ) ), x_mul );
+    __m256 n[4];
+    for ( int corner = 0; corner < 4; corner++ ) {
+      const __m256i yz = _mm256_set1_epi32( (int)row->yz_hashes[corner] );
+      const __m256 dy  = _mm256_set1_ps( row->dy[corner & 1] ), dz = _mm256_set1_ps( row->dz[corner >> 1] );
+      const __m256 d0  = _grad_dot_avx2( _fmix32_avx2( _mm256_xor_si256( yz, hx0 ) ), tx, dy, dz );
+      const __m256 d1  = _grad_dot_avx2( _fmix32_avx2( _mm256_xor_si256( yz, hx1 ) ), tx1, dy, dz );
+      n[corner]        = _lerp_avx2( d0, d1, fx );
+    }
+    const __m256 fy = _mm256_set1_ps( row->fy ), fz = _mm256_set1_ps( row->fz );
+    _mm256_storeu_ps( &values[i], _lerp_avx2( _lerp_avx2( n[0], n[1], fy ), _lerp_avx2( n[2], n[3], fy ), fz ) );
+  }
+}
+#endif
+
+void noise_gradient3_row( noise_simd_t simd, uint32_t seed, int x0, int y, int z, int spacing, float* values ) {
+  assert( spacing > 0 && values && noise_simd_supported( simd ) );
+
+  const noise_row_t row = _row_setup( seed, y, z, spacing );
+  // lattice cells stepped along the row, rather than a divide per voxel
+  int lx[NOISE_ROW_W], rx[NOISE_ROW_W];
+  lx[0] = _floor_div( x0, spacing );
+  rx[0] = x0 - lx[0] * spacing;
+  for ( int i = 1; i < NOISE_ROW_W; i++ ) {
+    const bool next_cell = rx[i - 1] + 1 == spacing;
+    lx[i]                = lx[i - 1] + ( next_cell ? 1 : 0 );
+    rx[i]                = next_cell ? 0 : rx[i - 1] + 1;
+  }
+
+#ifdef NOISE_HAS_AVX2
+  if ( NOISE_SIMD_AVX2 == simd ) {
+    _gradient3_row_avx2( &row, lx, rx, spacing, values );
+    return;
+  }
+#endif
+#ifdef NOISE_HAS_SSE2
+  if ( NOISE_SIMD_SSE2 == simd ) {
+    _gradient3_row_sse2( &row, lx, rx, spacing, values );
+    return;
+  }
+#endif
+  for ( int i = 0; i < NOISE_ROW_W; i++ ) { values[i] = _gradient3_x( &row, lx[i], rx[i], spacing ); }
+}
+
+bool noise_simd_supported( noise_simd_t simd ) {
+  if ( NOISE_SIMD_SCALAR == simd ) { return true; }
+#ifdef NOISE_HAS_SSE2
+  if ( NOISE_SIMD_SSE2 == simd ) { return true; }
+#endif
+#ifdef NOISE_HAS_AVX2
+  if ( NOISE_SIMD_AVX2 == simd ) { return __builtin_cpu_supports( "avx2" ); }
+#endif
+  return false;
+}
+
+noise_simd_t noise_simd_best( void ) {
+  for ( int simd = NOISE_SIMD_N - 1; simd > NOISE_SIMD_SCALAR; simd-- ) {
+    if ( noise_simd_supported( (noise_simd_t)simd ) ) { return (noise_simd_t)simd; }
+  }
+  return NOISE_SIMD_SCALAR;
+}
+
+const char* noise_simd_name( noise_simd_t simd ) {
+  const char* names[NOISE_SIMD_N] = { "scalar", "sse2", "avx2" };
+  assert( simd >= NOISE_SIMD_SCALAR && simd < NOISE_SIMD_N );
+  return names[simd];
+}
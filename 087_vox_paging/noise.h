@@ -0,0 +1,55 @@
+/* Noise - fractal value noise over the integer voxel grid, for generating terrain one chunk at a time, and 3D gradient noise for caves and ore.
+No GL in here so that it can be tested headless. See chunk_generate() in chunk.h.
+
+Design:
+  every value is a pure function of the seed and world coords, so a chunk comes out the same whatever order, or thread, it's generated on,
+  and neighbouring chunks line up without knowing about each other
+  lattice values come from hashing the seed and the lattice point's coords, so there's no table to build and no limit on coords
+  lattice spacing is a whole number of voxels and lattice cells are found with integer maths, so there's no float precision loss far from the origin
+  fBm: octaves of value noise, each with half the spacing and half the amplitude of the one before
+  3D gradient noise is sampled a row of NOISE_ROW_W voxels along x at a time, which is a row of a chunk. y and z, and everything that only depends on
+  them, are worked out once per row, and the rest runs across the row in SSE2 or AVX2 lanes where the CPU has them
+  every SIMD path does the same float operations in the same order as the scalar one, with no fused multiply-adds, so they all give the same bits.
+  a chunk doesn't depend on which CPU generated it, and the tests check that against the scalar path
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// RETURNS a well mixed hash of the seed and 2D integer coords
+uint32_t noise_hash2( uint32_t seed, int x, int z );
+
+/* value noise at voxel x,z with lattice points every spacing voxels, smoothly interpolated between them
+RETURNS -1..1 */
+float noise_value2( uint32_t seed, int x, int z, int spacing );
+
+/* sums n_octaves of value noise. the first has lattice points every spacing voxels. spacing is halved for each octave after, stopping at 1 voxel
+RETURNS -1..1, normalised by the sum of the octaves' amplitudes */
+float noise_fbm2( uint32_t seed, int x, int z, int spacing, int n_octaves );
+
+// voxels noise_gradient3_row() samples at once. one chunk row
+#define NOISE_ROW_W 16
+
+// ways of running noise_gradient3_row(). they all give exactly the same values
+typedef enum noise_simd_t { NOISE_SIMD_SCALAR = 0, NOISE_SIMD_SSE2, NOISE_SIMD_AVX2, NOISE_SIMD_N } noise_simd_t;
+
+// RETURNS a well mixed hash of the seed and 3D integer coords
+uint32_t noise_hash3( uint32_t seed, int x, int y, int z );
+
+/* gradient noise at voxel x,y,z with lattice points every spacing voxels in all 3 directions. each lattice point has a pseudo-random gradient
+RETURNS -1.5..1.5 at the very most but mostly -0.5..0.5, and 0 at lattice points */
+float noise_gradient3( uint32_t seed, int x, int y, int z, int spacing );
+
+/* writes noise_gradient3() for voxels x0 to x0 + NOISE_ROW_W - 1 at y,z to values, running with simd, which must be supported
+the values are bit-identical to calling noise_gradient3() for each voxel, whatever simd is */
+void noise_gradient3_row( noise_simd_t simd, uint32_t seed, int x0, int y, int z, int spacing, float* values );
+
+// RETURNS true if this build has the path and the CPU running it can run it. NOISE_SIMD_SCALAR always can
+bool noise_simd_supported( noise_simd_t simd );
+
+// RETURNS the fastest supported path
+noise_simd_t noise_simd_best( void );
+
+// RETURNS the path's name, for benchmarks and logs
+const char* noise_simd_name( noise_simd_t simd );
@@ -0,0 +1,126 @@
+#include "range_alloc.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+range_alloc_t range_alloc_create( uint32_t capacity ) {
+  assert( capacity > 0 );
+
+  range_alloc_t alloc = ( range_alloc_t ){ .capacity = capacity, .n_free_ranges = 1, .max_free_ranges = 64 };
+  alloc.free_ranges   = malloc( alloc.max_free_ranges * sizeof( range_alloc_range_t ) );
+  assert( alloc.free_ranges );
+  alloc.free_ranges[0] = ( range_alloc_range_t ){ .offset = 0, .size = capacity };
+  return alloc;
+}
+
+void range_alloc_free( range_alloc_t* alloc ) {
+  assert( alloc );
+
+  free( alloc->free_ranges );
+  memset( alloc, 0, sizeof( range_alloc_t ) );
+}
+
+// opens a gap in the free list at index idx. the caller fills it
+static void _insert_free_range( range_alloc_t* alloc, int idx ) {
+  if ( alloc->n_free_ranges == alloc->max_free_ranges ) {
+    alloc->max_free_ranges *= 2;
+    alloc->free_ranges = realloc( alloc->free_ranges, alloc->max_free_ranges * sizeof( range_alloc_range_t ) );
+    assert( alloc->free_ranges );
+  }
+  memmove( &alloc->free_ranges[idx + 1], &alloc->free_ranges[idx], ( alloc->n_free_ranges - idx ) * sizeof( range_alloc_range_t ) );
+  alloc->n_free_ranges++;
+}
+
+static void _remove_free_range( range_alloc_t* alloc, int idx ) {
+  memmove( &alloc->free_ranges[idx], &alloc->free_ranges[idx + 1], ( alloc->n_free_ranges - idx - 1 ) * sizeof( range_alloc_range_t ) );
+  alloc->n_free_ranges--;
+}
+
+bool range_alloc_reserve( range_alloc_t* alloc, uint32_t size, uint32_t* offset ) {
+  assert( alloc && alloc->free_ranges && offset && size > 0 );
+
+  int best = -1;
+  for ( int i = 0; i < alloc->n_free_ranges; i++ ) {
+    const uint32_t range_size = alloc->free_ranges[i].size;
+    if ( range_size < size || ( best >= 0 && range_size >= alloc->free_ranges[best].size ) ) { continue; }
+    best = i;
+    if ( range_size == size ) { break; } // can't do better than an exact fit
+  }
+  if ( best < 0 ) { return false; }
+
+  range_alloc_range_t* range = &alloc->free_ranges[best];
+  *offset                    = range->offset;
+  range->offset += size;
+  range->size -= size;
+  if ( 0 == range->size ) { _remove_free_range( alloc, best ); }
+  alloc->n_reserved += size;
+  return true;
+}
+
+void range_alloc_release( range_alloc_t* alloc, uint32_t offset, uint32_t size ) {
+  assert( alloc && alloc->free_ranges && size > 0 && offset + size <= alloc->capacity && size <= alloc->n_reserved );
+
+  // first free range after the released one
+  int lo = 0, hi = alloc->n_free_ranges;
+  while ( lo < hi ) {
+    const int mid = ( lo + hi ) / 2;
+    if ( alloc->free_ranges[mid].offset < offset ) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  range_alloc_range_t* prev = lo > 0 ? &alloc->free_ranges[lo - 1] : NULL;
+  range_alloc_range_t* next = lo < alloc->n_free_ranges ? &alloc->free_ranges[lo] : NULL;
+  // releasing a range that is already free, even partly, is a double release
+  assert( !prev || prev->offset + prev->size <= offset );
+  assert( !next || offset + size <= next->offset );
+
+  const bool join_prev = prev && prev->offset + prev->size == offset;
+  const bool join_next = next && offset + size == next->offset;
+  if ( join_prev && join_next ) {
+    prev->size += size + next->size;
+    _remove_free_range( alloc, lo );
+  } else if ( join_prev ) {
+    prev->size += size;
+  } else if ( join_next ) {
+    next->offset = offset;
+    next->size += size;
+  } else {
+    _insert_free_range( alloc, lo );
+    alloc->free_ranges[lo] = ( range_alloc_range_t ){ .offset = offset, .size = size };
+  }
+  alloc->n_reserved -= size;
+}
+
+void range_alloc_grow( range_alloc_t* alloc, uint32_t capacity ) {
+  assert( alloc && alloc->free_ranges && capacity >= alloc->capacity );
+  if ( capacity == alloc->capacity ) { return; }
+
+  range_alloc_range_t* last = alloc->n_free_ranges > 0 ? &alloc->free_ranges[alloc->n_free_ranges - 1] : NULL;
+  if ( last && last->offset + last->size == alloc->capacity ) {
+    last->size += capacity - alloc->capacity;
+  } else {
+    _insert_free_range( alloc, alloc->n_free_ranges );
+    alloc->free_ranges[alloc->n_free_ranges - 1] = ( range_alloc_range_t ){ .offset = alloc->capacity, .size = capacity - alloc->capacity };
+  }
+  alloc->capacity = capacity;
+}
+
+uint32_t range_alloc_largest_free( const range_alloc_t* alloc ) {
+  assert( alloc );
+
+  uint32_t largest = 0;
+  for ( int i = 0; i < alloc->n_free_ranges; i++ ) {
+    if ( alloc->free_ranges[i].size > largest ) { largest = alloc->free_ranges[i].size; }
+  }
+  return largest;
+}
+
+float range_alloc_fragmentation( const range_alloc_t* alloc ) {
+  assert( alloc );
+
+  const uint32_t n_free = alloc->capacity - alloc->n_reserved;
+  if ( 0 == n_free ) { return 0.0f; }
+  return 1.0f - (float)range_alloc_largest_free( alloc ) / (float)n_free;
+}
@@ -0,0 +1,45 @@
+/* Range allocator - hands out ranges of a fixed size buffer, eg vertices of one big GPU vertex buffer, so that every chunk mesh can live in the same buffer
+and be drawn from the same VAO. Only does the bookkeeping - units are whatever the caller says they are and nothing here touches the buffer itself.
+No GL in here so that it can be tested headless. See voxels.c for the vertex buffer it manages.
+
+Design:
+  free list of ranges kept sorted by offset. neighbouring free ranges are always merged, so releasing everything gives back one range
+  reserving takes the front of the smallest free range that fits ( best fit ) which keeps the big ranges big for big meshes. it's a linear scan of the
+  free list, which is fine while that is at most a few thousand ranges. a size class index would be the next step if it gets longer
+  the caller keeps the offset and size of what it reserved and passes both back to release it, so nothing is stored per reserved range
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct range_alloc_range_t {
+  uint32_t offset, size;
+} range_alloc_range_t;
+
+typedef struct range_alloc_t {
+  range_alloc_range_t* free_ranges; // sorted by offset. no two touch
+  int n_free_ranges, max_free_ranges;
+  uint32_t capacity;
+  uint32_t n_reserved; // units in reserved ranges
+} range_alloc_t;
+
+range_alloc_t range_alloc_create( uint32_t capacity );
+
+void range_alloc_free( range_alloc_t* alloc );
+
+/* reserves size units, size > 0
+RETURNS false if no free range is big enough, in which case *offset is untouched. range_alloc_grow() and try again */
+bool range_alloc_reserve( range_alloc_t* alloc, uint32_t size, uint32_t* offset );
+
+// gives back a range from range_alloc_reserve(). offset and size must be exactly what was reserved
+void range_alloc_release( range_alloc_t* alloc, uint32_t offset, uint32_t size );
+
+// adds units to the end, merged into the last free range if that reaches the old end. capacity must not shrink
+void range_alloc_grow( range_alloc_t* alloc, uint32_t capacity );
+
+// RETURNS the size of the biggest range range_alloc_reserve() could give right now
+uint32_t range_alloc_largest_free( const range_alloc_t* alloc );
+
+// RETURNS how much of the free space can't be reserved in one go, 0 for none to 1. 0 when nothing is free
+float range_alloc_fragmentation( const range_alloc_t* alloc );
@@ -0,0 +1,58 @@
+#include "raycast.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+
+// rounds towards negative infinity, unlike /, so that eg voxel -1 is in chunk -1
+static int _floor_div( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); }
+
+bool voxel_raycast( vec3 origin, vec3 dir, float max_dist, voxel_raycast_chunk_at_fn chunk_at, void* user_ptr, voxel_raycast_hit_t* hit ) {
+  assert( chunk_at && hit );
+  assert( isfinite( max_dist ) ); // a ray through missing chunks would never end
+
+  const float len = length_vec3( dir );
+  if ( len <= 0.0f ) { return false; }
+  const float o[3] = { origin.x, origin.y, origin.z };
+  const float d[3] = { dir.x / len, dir.y / len, dir.z / len };
+
+  int v[3], step[3];
+  float t_max[3], t_delta[3]; // distance along the ray to the next boundary on each axis, and between boundaries
+  for ( int a = 0; a < 3; a++ ) {
+    v[a]       = (int)floorf( o[a] );
+    step[a]    = d[a] > 0.0f ? 1 : ( d[a] < 0.0f ? -1 : 0 );
+    t_delta[a] = step[a] ? fabsf( 1.0f / d[a] ) : INFINITY;
+    t_max[a]   = step[a] > 0 ? ( v[a] + 1 - o[a] ) * t_delta[a] : ( step[a] < 0 ? ( o[a] - v[a] ) * t_delta[a] : INFINITY );
+  }
+
+  int chunk_cx = INT_MIN, chunk_cz = INT_MIN, chunk_id = -1;
+  const chunk_t* chunk = NULL;
+  while ( true ) {
+    const int a = t_max[0] < t_max[1] ? ( t_max[0] < t_max[2] ? 0 : 2 ) : ( t_max[1] < t_max[2] ? 1 : 2 );
+    const float t = t_max[a];
+    if ( t > max_dist ) { return false; }
+    v[a] += step[a];
+    t_max[a] += t_delta[a];
+
+    // nothing to hit once out of the top or bottom and heading further out
+    if ( ( v[1] < 0 && step[1] <= 0 ) || ( v[1] >= CHUNK_Y && step[1] >= 0 ) ) { return false; }
+    if ( v[1] < 0 || v[1] >= CHUNK_Y ) { continue; }
+
+    const int cx = _floor_div( v[0], CHUNK_X ), cz = _floor_div( v[2], CHUNK_Z );
+    if ( cx != chunk_cx || cz != chunk_cz ) {
+      chunk_id = -1;
+      chunk    = chunk_at( cx, cz, &chunk_id, user_ptr );
+      chunk_cx = cx;
+      chunk_cz = cz;
+    }
+    if ( !chunk ) { continue; }
+
+    const int x = v[0] - cx * CHUNK_X, z = v[2] - cz * CHUNK_Z;
+    block_type_t block_type = BLOCK_TYPE_AIR;
+    get_block_type_in_chunk( chunk, x, v[1], z, &block_type );
+    if ( BLOCK_TYPE_AIR == block_type ) { continue; }
+
+    // stepping +x goes in through the -x face
+    *hit = ( voxel_raycast_hit_t ){ .chunk_id = chunk_id, .cx = cx, .cz = cz, .x = x, .y = v[1], .z = z, .face_idx = a * 2 + ( step[a] > 0 ? 0 : 1 ), .dist = t };
+    return true;
+  }
+}
@@ -0,0 +1,30 @@
+/* Voxel ray cast - walks a ray through a world of chunks one voxel at a time to find the first solid voxel it hits. Used for picking the voxel under
+the mouse on the CPU, instead of drawing the chunks again into a colour picking framebuffer and reading a pixel back.
+No GL in here so that it can be tested headless. See chunks_raycast() in voxels.c.
+
+Design:
+  Amanatides & Woo grid traversal ("A Fast Voxel Traversal Algorithm for Ray Tracing", 1987). for each axis keep the distance along the ray to the
+  next voxel boundary, and step across whichever boundary is nearest. every voxel the ray passes through is visited exactly once, in order
+  coords are in voxels across the whole world. voxel x,y,z of chunk cx,cz spans cx * CHUNK_X + x to cx * CHUNK_X + x + 1 etc.
+  the chunk is looked up only when the ray crosses into a different chunk
+*/
+
+#pragma once
+#include "apg_maths.h"
+#include "chunk.h"
+#include <stdbool.h>
+
+typedef struct voxel_raycast_hit_t {
+  int chunk_id, cx, cz;
+  int x, y, z;  // voxel within the chunk
+  int face_idx; // face the ray went in through. 0-5 is -x,+x,-y,+y,-z,+z, the same as the face of the mesh drawn there
+  float dist;   // along the ray, in voxels, to where it went in
+} voxel_raycast_hit_t;
+
+/* RETURNS chunk cx,cz and sets its id, or NULL if it isn't loaded. rays go straight through missing chunks */
+typedef const chunk_t* ( *voxel_raycast_chunk_at_fn )( int cx, int cz, int* chunk_id, void* user_ptr );
+
+/* casts a ray from origin along dir, which needn't be normalised, for up to max_dist voxels. the voxel the ray starts in is skipped.
+above and below the chunks counts as air
+RETURNS true and fills in hit if a solid voxel was hit */
+bool voxel_raycast( vec3 origin, vec3 dir, float max_dist, voxel_raycast_chunk_at_fn chunk_at, void* user_ptr, voxel_raycast_hit_t* hit );
@@ -0,0 +1,193 @@
+#include "region.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGION_N_CHUNKS ( REGION_CHUNKS_W * REGION_CHUNKS_W )
+#define REGION_HEADER_UINTS 4 // magic, version, region x, region z
+
+static const char _region_magic[4] = { 'V', 'O', 'X', 'R' };
+
+static int _entry_idx( int local_x, int local_z ) {
+  assert( local_x >= 0 && local_x < REGION_CHUNKS_W && local_z >= 0 && local_z < REGION_CHUNKS_W );
+  return local_z * REGION_CHUNKS_W + local_x;
+}
+
+static uint32_t _sectors_for_bytes( size_t n_bytes ) { return (uint32_t)( ( n_bytes + REGION_SECTOR_SZ - 1 ) / REGION_SECTOR_SZ ); }
+
+static bool _write_new_header( region_t* region ) {
+  uint8_t sector[REGION_SECTOR_SZ];
+  memset( sector, 0, REGION_SECTOR_SZ );
+  uint32_t header[REGION_HEADER_UINTS] = { 0, REGION_VERSION, (uint32_t)region->region_x, (uint32_t)region->region_z };
+  memcpy( &header[0], _region_magic, 4 );
+  memcpy( sector, header, sizeof( header ) );
+  // table is all zeros ie no chunks saved
+  if ( 0 != fseek( region->fptr, 0, SEEK_SET ) ) { return false; }
+  if ( 1 != fwrite( sector, REGION_SECTOR_SZ, 1, region->fptr ) ) { return false; }
+  if ( 0 != fflush( region->fptr ) ) { return false; }
+  region->n_sectors = 1;
+  return true;
+}
+
+static bool _read_header( region_t* region ) {
+  uint32_t header[REGION_HEADER_UINTS];
+  if ( 0 != fseek( region->fptr, 0, SEEK_SET ) ) { return false; }
+  if ( 1 != fread( header, sizeof( header ), 1, region->fptr ) ) { return false; }
+  if ( 0 != memcmp( &header[0], _region_magic, 4 ) ) { return false; }
+  if ( header[1] != REGION_VERSION ) { return false; }
+  if ( (int)header[2] != region->region_x || (int)header[3] != region->region_z ) { return false; }
+  if ( 1 != fread( region->table, sizeof( region->table ), 1, region->fptr ) ) { return false; }
+
+  if ( 0 != fseek( region->fptr, 0, SEEK_END ) ) { return false; }
+  long file_sz = ftell( region->fptr );
+  if ( file_sz < REGION_SECTOR_SZ ) { return false; }
+  region->n_sectors = _sectors_for_bytes( (size_t)file_sz );
+
+  // reject tables pointing outside the file rather than trusting them later
+  for ( int i = 0; i < REGION_N_CHUNKS; i++ ) {
+    if ( 0 == region->table[i].first_sector ) { continue; }
+    if ( region->table[i].first_sector + _sectors_for_bytes( region->table[i].n_bytes ) > region->n_sectors ) { return false; }
+  }
+  return true;
+}
+
+static bool _region_open( const char* filename, int region_x, int region_z, bool create_if_missing, region_t* region ) {
+  assert( filename && region );
+
+  memset( region, 0, sizeof( region_t ) );
+  region->region_x = region_x;
+  region->region_z = region_z;
+
+  region->fptr = fopen( filename, "r+b" );
+  if ( region->fptr ) {
+    if ( _read_header( region ) ) { return true; }
+    fprintf( stderr, "ERROR: `%s` is not a valid region file for region (%i,%i)\n", filename, region_x, region_z );
+    region_close( region );
+    return false;
+  }
+  if ( !create_if_missing ) { return false; }
+
+  region->fptr = fopen( filename, "w+b" );
+  if ( !region->fptr ) { return false; }
+  if ( !_write_new_header( region ) ) {
+    region_close( region );
+    return false;
+  }
+  return true;
+}
+
+bool region_open( const char* filename, int region_x, int region_z, region_t* region ) { return _region_open( filename, region_x, region_z, true, region ); }
+
+bool region_open_existing( const char* filename, int region_x, int region_z, region_t* region ) {
+  return _region_open( filename, region_x, region_z, false, region );
+}
+
+void region_close( region_t* region ) {
+  assert( region );
+
+  if ( region->fptr ) { fclose( region->fptr ); }
+  memset( region, 0, sizeof( region_t ) );
+}
+
+bool region_has_chunk( const region_t* region, int local_x, int local_z ) {
+  assert( region );
+  return region->table[_entry_idx( local_x, local_z )].first_sector > 0;
+}
+
+bool region_read_chunk( region_t* region, int local_x, int local_z, uint8_t* dest, size_t dest_sz, size_t* n_bytes ) {
+  assert( region && region->fptr && dest && n_bytes );
+
+  region_entry_t entry = region->table[_entry_idx( local_x, local_z )];
+  if ( 0 == entry.first_sector || entry.n_bytes > dest_sz ) { return false; }
+
+  if ( 0 != fseek( region->fptr, (long)entry.first_sector * REGION_SECTOR_SZ, SEEK_SET ) ) { return false; }
+  if ( entry.n_bytes > 0 && 1 != fread( dest, entry.n_bytes, 1, region->fptr ) ) { return false; }
+  *n_bytes = entry.n_bytes;
+  return true;
+}
+
+/* RETURNS the first sector of the lowest run of n_sectors that no table entry uses, including the one being replaced, so that its previous version
+stays intact until the table points away from it. a free run at the end of the file may carry on past the end */
+static uint32_t _find_free_sectors( const region_t* region, uint32_t n_sectors ) {
+  bool* used = calloc( region->n_sectors, sizeof( bool ) );
+  assert( used );
+  used[0] = true; // header
+  for ( int i = 0; i < REGION_N_CHUNKS; i++ ) {
+    const region_entry_t entry = region->table[i];
+    if ( 0 == entry.first_sector ) { continue; }
+    for ( uint32_t s = 0; s < _sectors_for_bytes( entry.n_bytes ); s++ ) { used[entry.first_sector + s] = true; }
+  }
+  uint32_t run_start = region->n_sectors, run_len = 0;
+  for ( uint32_t s = 1; s < region->n_sectors && run_len < n_sectors; s++ ) {
+    if ( used[s] ) {
+      run_len = 0;
+      continue;
+    }
+    if ( 0 == run_len++ ) { run_start = s; }
+  }
+  free( used );
+  return run_len > 0 ? run_start : region->n_sectors;
+}
+
+bool region_write_chunk( region_t* region, int local_x, int local_z, const uint8_t* src, size_t n_bytes ) {
+  assert( region && region->fptr && src );
+  assert( n_bytes > 0 && n_bytes <= UINT32_MAX );
+
+  const int idx             = _entry_idx( local_x, local_z );
+  const uint32_t n_sectors  = _sectors_for_bytes( n_bytes );
+  region_entry_t new_entry  = ( region_entry_t ){ .first_sector = _find_free_sectors( region, n_sectors ), .n_bytes = (uint32_t)n_bytes };
+  const size_t padding      = (size_t)n_sectors * REGION_SECTOR_SZ - n_bytes;
+  const uint8_t zeros[1024] = { 0 };
+
+  // payload first. padded out to whole sectors so that a payload written after it starts on a boundary
+  if ( 0 != fseek( region->fptr, (long)new_entry.first_sector * REGION_SECTOR_SZ, SEEK_SET ) ) { return false; }
+  if ( 1 != fwrite( src, n_bytes, 1, region->fptr ) ) { return false; }
+  for ( size_t written = 0; written < padding; written += sizeof( zeros ) ) {
+    size_t n = padding - written < sizeof( zeros ) ? padding - written : sizeof( zeros );
+    if ( 1 != fwrite( zeros, n, 1, region->fptr ) ) { return false; }
+  }
+  if ( 0 != fflush( region->fptr ) ) { return false; }
+  if ( new_entry.first_sector + n_sectors > region->n_sectors ) { region->n_sectors = new_entry.first_sector + n_sectors; }
+
+  // then the one table entry
+  long entry_offset = (long)( sizeof( uint32_t ) * REGION_HEADER_UINTS + sizeof( region_entry_t ) * idx );
+  if ( 0 != fseek( region->fptr, entry_offset, SEEK_SET ) ) { return false; }
+  if ( 1 != fwrite( &new_entry, sizeof( region_entry_t ), 1, region->fptr ) ) { return false; }
+  if ( 0 != fflush( region->fptr ) ) { return false; }
+  region->table[idx] = new_entry;
+
+  return true;
+}
+
+uint32_t region_n_garbage_sectors( const region_t* region ) {
+  assert( region );
+
+  uint32_t n_live = 1; // header
+  for ( int i = 0; i < REGION_N_CHUNKS; i++ ) {
+    if ( region->table[i].first_sector ) { n_live += _sectors_for_bytes( region->table[i].n_bytes ); }
+  }
+  assert( n_live <= region->n_sectors );
+  return region->n_sectors - n_live;
+}
+
+bool region_save_chunk( region_t* region, int local_x, int local_z, const chunk_t* chunk ) {
+  assert( region && chunk );
+
+  uint8_t* buffer = malloc( CHUNK_SAVE_MAX_BYTES );
+  assert( buffer );
+  size_t n_bytes = chunk_save_to_mem( chunk, buffer, CHUNK_SAVE_MAX_BYTES );
+  bool ret       = n_bytes > 0 && region_write_chunk( region, local_x, local_z, buffer, n_bytes );
+  free( buffer );
+  return ret;
+}
+
+bool region_load_chunk( region_t* region, int local_x, int local_z, chunk_t* chunk ) {
+  assert( region && chunk );
+
+  uint8_t* buffer = malloc( CHUNK_SAVE_MAX_BYTES );
+  assert( buffer );
+  size_t n_bytes = 0;
+  bool ret       = region_read_chunk( region, local_x, local_z, buffer, CHUNK_SAVE_MAX_BYTES, &n_bytes ) && chunk_load_from_mem( buffer, n_bytes, chunk );
+  free( buffer );
+  return ret;
+}
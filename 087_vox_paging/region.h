@@ -0,0 +1,65 @@
+/* Region files - the on-disk paging container for chunks.
+One file holds REGION_CHUNKS_W x REGION_CHUNKS_W chunks, so that any one chunk can be paged in or out without reading or rewriting the others.
+
+File layout. all integers are uint32 in native byte order (little-endian on everything we build for):
+sector 0     header
+             - magic "VOXR", version, region x, region z
+             - table of REGION_CHUNKS_W * REGION_CHUNKS_W entries { first sector, size in bytes }, indexed by local chunk z * REGION_CHUNKS_W + x
+               first sector 0 means the chunk has not been saved
+sectors 1... chunk payloads. each payload starts on a sector boundary and covers as many whole sectors as it needs
+
+Saving a chunk writes its payload to sectors no chunk's table entry points at, and only then rewrites its 8-byte table entry, so an interrupted save
+leaves the previous version of the chunk readable. the previous version's sectors are free once the entry points away from them, and the next save
+that fits reuses them. the first free run of sectors big enough is used, or the end of the file if there isn't one, so re-saving chunks over and
+over doesn't grow the file: it stays within about twice its live payloads
+*/
+
+#pragma once
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define REGION_CHUNKS_W 16
+#define REGION_SECTOR_SZ 4096
+#define REGION_VERSION 2 // 2: palette + RLE chunk payloads
+
+typedef struct region_entry_t {
+  uint32_t first_sector;
+  uint32_t n_bytes;
+} region_entry_t;
+
+typedef struct region_t {
+  FILE* fptr;
+  int region_x, region_z;
+  region_entry_t table[REGION_CHUNKS_W * REGION_CHUNKS_W];
+  uint32_t n_sectors; // total in file, including the header sector
+} region_t;
+
+/* opens a region file for reading and writing, creating a new empty one if it doesn't exist
+RETURNS false if the file couldn't be opened or created, or it is not a region file for region_x,region_z */
+bool region_open( const char* filename, int region_x, int region_z, region_t* region );
+
+// the same as region_open() but RETURNS false without creating anything if the file doesn't exist, eg when only looking for saved chunks
+bool region_open_existing( const char* filename, int region_x, int region_z, region_t* region );
+
+void region_close( region_t* region );
+
+bool region_has_chunk( const region_t* region, int local_x, int local_z );
+
+/* reads one chunk's payload by seeking straight to it. n_bytes is set to the payload size
+RETURNS false if the chunk isn't in the region, dest_sz is too small, or the read failed */
+bool region_read_chunk( region_t* region, int local_x, int local_z, uint8_t* dest, size_t dest_sz, size_t* n_bytes );
+
+/* writes a chunk payload into the first run of free sectors it fits in, or at the end of the file, and points the table at it
+RETURNS false on a write failure, in which case the previous version is kept */
+bool region_write_chunk( region_t* region, int local_x, int local_z, const uint8_t* src, size_t n_bytes );
+
+// sectors no longer referenced by the table, left behind by re-saving chunks and reused by later saves
+uint32_t region_n_garbage_sectors( const region_t* region );
+
+// convenience wrappers around chunk_save_to_mem()/chunk_load_from_mem() and the above
+bool region_save_chunk( region_t* region, int local_x, int local_z, const chunk_t* chunk );
+bool region_load_chunk( region_t* region, int local_x, int local_z, chunk_t* chunk );
@@ -0,0 +1,2438 @@
+// headless unit tests for the CPU parts of the voxel chunks (no GL context required)
+// C99
+
+#include "../chunk.h"
+#include "../chunk_cache.h"
+#include "../chunk_quadtree.h"
+#include "../diamond_square.h"
+#include "../fluid.h"
+#include "../light.h"
+#include "../mesh_cache.h"
+#include "../mesh_export.h"
+#include "../noise.h"
+#include "../range_alloc.h"
+#include "../raycast.h"
+#include "../region.h"
+#include "../threads.h"
+#include "../visibility.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-------------------------------------------------TEST CHUNKS-----------------------------------------------------*/
+
+static chunk_t _empty_chunk() {
+  chunk_t chunk;
+  memset( &chunk, 0, sizeof( chunk_t ) );
+  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
+  assert( chunk.voxels );
+  return chunk;
+}
+
+// one chunk cut out of a diamond-square world like chunks_create() makes
+static chunk_t _terrain_chunk( uint32_t seed ) {
+  srand( seed );
+  dsquare_heightmap_t dshm = dsquare_heightmap_alloc( CHUNK_X * 4, 63 );
+  dsquare_heightmap_gen( &dshm, 64, 64, 64 );
+  chunk_t chunk = chunk_generate_from_heightmap( dshm.filtered_heightmap, dshm.w, CHUNK_X, CHUNK_Z );
+  dsquare_heightmap_free( &dshm );
+  return chunk;
+}
+
+// a 3x3 block of neighbouring chunks from one diamond-square world. chunk (cx,cz) is at chunks[cz * 3 + cx]
+static void _terrain_chunks_3x3( uint32_t seed, chunk_t* chunks ) {
+  srand( seed );
+  dsquare_heightmap_t dshm = dsquare_heightmap_alloc( CHUNK_X * 4, 63 );
+  dsquare_heightmap_gen( &dshm, 64, 64, 64 );
+  for ( int cz = 0; cz < 3; cz++ ) {
+    for ( int cx = 0; cx < 3; cx++ ) { chunks[cz * 3 + cx] = chunk_generate_from_heightmap( dshm.filtered_heightmap, dshm.w, cx * CHUNK_X, cz * CHUNK_Z ); }
+  }
+  dsquare_heightmap_free( &dshm );
+}
+
+// stacks of mixed block types with holes, overhangs, and a lone floating voxel
+static chunk_t _mixed_chunk() {
+  chunk_t chunk = _empty_chunk();
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) {
+      int height = 3 + ( x * 7 + z * 3 ) % 9;
+      for ( int y = 0; y <= height; y++ ) {
+        if ( ( x + y + z ) % 11 == 0 ) { continue; }
+        block_type_t type = ( y == height ) ? BLOCK_TYPE_GRASS : ( ( x ^ z ) % 3 == 0 ? BLOCK_TYPE_STONE : BLOCK_TYPE_DIRT );
+        set_block_type_in_chunk( &chunk, x, y, z, type );
+      }
+    }
+  }
+  for ( int x = 2; x < 12; x++ ) { set_block_type_in_chunk( &chunk, x, 20, 5, BLOCK_TYPE_STONE ); }
+  set_block_type_in_chunk( &chunk, 8, 40, 8, BLOCK_TYPE_CRUST );
+  return chunk;
+}
+
+/*-------------------------------------------------COVERAGE RASTERISER-----------------------------------------------------*/
+
+// one cell per voxel face. planes along each axis are numbered 0..dim (voxel edges)
+typedef struct coverage_t {
+  uint8_t* count;
+  uint32_t* key;
+  size_t n_cells;
+} coverage_t;
+
+static const int _dims[3] = { CHUNK_X, CHUNK_Y, CHUNK_Z };
+
+static size_t _cell_idx( int face_idx, int plane, int a, int b ) {
+  const int n_axis = face_idx / 2;
+  const int a_axis = n_axis == 0 ? 1 : 0;
+  const int b_axis = n_axis == 2 ? 1 : 2;
+  assert( plane >= 0 && plane <= _dims[n_axis] && a >= 0 && a < _dims[a_axis] && b >= 0 && b < _dims[b_axis] );
+  return ( ( (size_t)face_idx * ( CHUNK_Y + 1 ) + plane ) * CHUNK_Y + a ) * CHUNK_Y + b;
+}
+
+static coverage_t _coverage_alloc() {
+  coverage_t cov = ( coverage_t ){ .n_cells = (size_t)6 * ( CHUNK_Y + 1 ) * CHUNK_Y * CHUNK_Y };
+  cov.count      = calloc( cov.n_cells, sizeof( uint8_t ) );
+  cov.key        = calloc( cov.n_cells, sizeof( uint32_t ) );
+  assert( cov.count && cov.key );
+  return cov;
+}
+
+static void _coverage_free( coverage_t* cov ) {
+  free( cov->count );
+  free( cov->key );
+  memset( cov, 0, sizeof( coverage_t ) );
+}
+
+// edge function with a top-left tie-break so that samples on the shared diagonal of a quad are counted exactly once
+static bool _inside_edge( float ax, float ay, float bx, float by, float px, float py ) {
+  float e = ( bx - ax ) * ( py - ay ) - ( by - ay ) * ( px - ax );
+  if ( e > 0.0f ) { return true; }
+  if ( e < 0.0f ) { return false; }
+  float dx = bx - ax, dy = by - ay;
+  return dy < 0.0f || ( dy == 0.0f && dx > 0.0f );
+}
+
+// occlusion at corner (i,j) of a w by h quad, in its texcoords, the way the voxel fragment shader looks it up. see VOXEL_QUAD_AO_EDGES_SHIFT
+static int _quad_ao_at( uint32_t quad_ao, int w, int h, int i, int j ) {
+  const bool s_edge = 0 == i || w == i, t_edge = 0 == j || h == j;
+  if ( s_edge && t_edge ) { return quad_ao >> ( 2 * ( ( w == i ) + 2 * ( h == j ) ) ) & VOXEL_AO_MAX; }
+  if ( s_edge ) { return quad_ao >> ( VOXEL_QUAD_AO_EDGES_SHIFT + 2 * ( w == i ) ) & VOXEL_AO_MAX; }
+  if ( t_edge ) { return quad_ao >> ( VOXEL_QUAD_AO_EDGES_SHIFT + 4 + 2 * ( h == j ) ) & VOXEL_AO_MAX; }
+  return VOXEL_AO_MAX;
+}
+
+/* projects each triangle onto its face plane and samples it at the centre of every voxel face it might cover.
+also checks that texcoords advance by exactly one tile per voxel, so the repeating array texture lines up between meshers */
+static void _rasterise( const chunk_vertex_data_t* data, coverage_t* cov ) {
+  assert( data->n_vertices % 3 == 0 );
+  for ( size_t tri = 0; tri < data->n_vertices / 3; tri++ ) {
+    voxel_vertex_t vv[3];
+    for ( int v = 0; v < 3; v++ ) { vv[v] = voxel_vertex_unpack( &data->packed_ptr[( tri * 3 + v ) * VOXEL_VPACKED_COMPS] ); }
+    const int face_idx = vv[0].face_idx;
+    const int n_axis   = face_idx / 2;
+    const int a_axis   = n_axis == 0 ? 1 : 0;
+    const int b_axis   = n_axis == 2 ? 1 : 2;
+    const int plane    = ( &vv[0].x )[n_axis];
+    const uint32_t key = ( vv[0].palidx + 1 ) | (uint32_t)vv[0].sky_light << 9 | (uint32_t)vv[0].block_light << 13;
+
+    // the quad's far corner comes last, where the shader gets its size and occlusion from
+    const int quad_w = vv[2].s, quad_h = vv[2].t;
+    float pa[3], pb[3], ts[3], tt[3];
+    float min_a = 1e9f, max_a = -1e9f, min_b = 1e9f, max_b = -1e9f;
+    float min_s = 1e9f, max_s = -1e9f, min_t = 1e9f, max_t = -1e9f;
+    for ( int v = 0; v < 3; v++ ) {
+      const int corner[3] = { vv[v].x, vv[v].y, vv[v].z };
+      assert( corner[n_axis] == plane ); // flat in its plane
+      assert( vv[v].face_idx == face_idx && vv[v].palidx == vv[0].palidx );
+      assert( vv[v].sky_light == vv[0].sky_light && vv[v].block_light == vv[0].block_light && vv[v].quad_ao == vv[0].quad_ao );
+      assert( vv[v].s <= quad_w && vv[v].t <= quad_h );
+      pa[v] = (float)corner[a_axis];
+      pb[v] = (float)corner[b_axis];
+      ts[v] = (float)vv[v].s;
+      tt[v] = (float)vv[v].t;
+      min_a = pa[v] < min_a ? pa[v] : min_a;
+      max_a = pa[v] > max_a ? pa[v] : max_a;
+      min_b = pb[v] < min_b ? pb[v] : min_b;
+      max_b = pb[v] > max_b ? pb[v] : max_b;
+      min_s = vv[v].s < min_s ? vv[v].s : min_s;
+      max_s = vv[v].s > max_s ? vv[v].s : max_s;
+      min_t = vv[v].t < min_t ? vv[v].t : min_t;
+      max_t = vv[v].t > max_t ? vv[v].t : max_t;
+    }
+    float ext_a = max_a - min_a, ext_b = max_b - min_b, ext_s = max_s - min_s, ext_t = max_t - min_t;
+    assert( ( ext_s == ext_a && ext_t == ext_b ) || ( ext_s == ext_b && ext_t == ext_a ) );
+
+    // counter-clockwise in (a,b) so the tie-break is consistent
+    float area = ( pa[1] - pa[0] ) * ( pb[2] - pb[0] ) - ( pb[1] - pb[0] ) * ( pa[2] - pa[0] );
+    assert( area != 0.0f );
+    if ( area < 0.0f ) {
+      float tmp_a = pa[1], tmp_b = pb[1], tmp_s = ts[1], tmp_t = tt[1];
+      pa[1] = pa[2], pb[1] = pb[2], ts[1] = ts[2], tt[1] = tt[2];
+      pa[2] = tmp_a, pb[2] = tmp_b, ts[2] = tmp_s, tt[2] = tmp_t;
+      area = -area;
+    }
+    for ( int b = (int)min_b; b < (int)max_b; b++ ) {
+      for ( int a = (int)min_a; a < (int)max_a; a++ ) {
+        float px = a + 0.5f, py = b + 0.5f;
+        if ( !_inside_edge( pa[0], pb[0], pa[1], pb[1], px, py ) ) { continue; }
+        if ( !_inside_edge( pa[1], pb[1], pa[2], pb[2], px, py ) ) { continue; }
+        if ( !_inside_edge( pa[2], pb[2], pa[0], pb[0], px, py ) ) { continue; }
+        /* ambient occlusion as it's shaded at the sample, interpolated between the corners of the voxel face the sample's texcoords are in. at the
+        centre of the face that's the mean of its 4 corners, so 8 times it is a whole number */
+        const float w1 = ( ( px - pa[0] ) * ( pb[2] - pb[0] ) - ( py - pb[0] ) * ( pa[2] - pa[0] ) ) / area;
+        const float w2 = ( ( pa[1] - pa[0] ) * ( py - pb[0] ) - ( pb[1] - pb[0] ) * ( px - pa[0] ) ) / area;
+        const int i    = (int)( ts[0] + w1 * ( ts[1] - ts[0] ) + w2 * ( ts[2] - ts[0] ) );
+        const int j    = (int)( tt[0] + w1 * ( tt[1] - tt[0] ) + w2 * ( tt[2] - tt[0] ) );
+        int ao_x8      = 0;
+        for ( int corner = 0; corner < 4; corner++ ) { ao_x8 += 2 * _quad_ao_at( vv[0].quad_ao, quad_w, quad_h, i + corner % 2, j + corner / 2 ); }
+        size_t idx = _cell_idx( face_idx, plane, a, b );
+        cov->count[idx]++;
+        cov->key[idx] = key | (uint32_t)ao_x8 << 17;
+      }
+    }
+  }
+}
+
+/*-------------------------------------------------TESTS-----------------------------------------------------*/
+
+// greedy meshing must emit at least min_ratio times fewer vertices than per-face, so that a change that merges less fails rather than only printing less
+static void _test_greedy_matches_per_face( const char* name, const chunk_t* chunk, const chunk_neighbours_t* neighbours, double min_ratio ) {
+  chunk_vertex_data_t per_face = chunk_gen_vertex_data( chunk, neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+  chunk_vertex_data_t greedy   = chunk_gen_vertex_data( chunk, neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+  assert( per_face.n_vertices > 0 && greedy.n_vertices > 0 );
+  assert( greedy.n_vertices <= per_face.n_vertices );
+
+  coverage_t cov_per_face = _coverage_alloc();
+  coverage_t cov_greedy   = _coverage_alloc();
+  _rasterise( &per_face, &cov_per_face );
+  _rasterise( &greedy, &cov_greedy );
+  size_t n_covered = 0;
+  for ( size_t i = 0; i < cov_per_face.n_cells; i++ ) {
+    assert( cov_per_face.count[i] <= 1 ); // no overlaps
+    assert( cov_greedy.count[i] == cov_per_face.count[i] );
+    assert( cov_greedy.key[i] == cov_per_face.key[i] );
+    n_covered += cov_per_face.count[i];
+  }
+  assert( n_covered * VOXEL_FACE_VERTS == per_face.n_vertices ); // every per-face quad was hit exactly once
+
+  size_t per_face_bytes = per_face.vpacked_buffer_sz;
+  size_t greedy_bytes   = greedy.vpacked_buffer_sz;
+  const double ratio    = (double)per_face.n_vertices / (double)greedy.n_vertices;
+  printf( "%-10s faces %6zu | per-face %7zu verts %9zu bytes | greedy %6zu verts %8zu bytes | x%.1f\n", name, n_covered, per_face.n_vertices, per_face_bytes,
+    greedy.n_vertices, greedy_bytes, ratio );
+  assert( ratio >= min_ratio );
+
+  _coverage_free( &cov_per_face );
+  _coverage_free( &cov_greedy );
+  chunk_free_vertex_data( &per_face );
+  chunk_free_vertex_data( &greedy );
+}
+
+static void _test_greedy_slab() {
+  // a flat 16x16 slab is one quad per side
+  chunk_t chunk = _empty_chunk();
+  for ( int z = 0; z < CHUNK_Z; z++ ) {
+    for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &chunk, x, 0, z, BLOCK_TYPE_CRUST ); }
+  }
+  chunk_vertex_data_t greedy = chunk_gen_vertex_data( &chunk, NULL, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+  assert( greedy.n_vertices == 6 * VOXEL_FACE_VERTS );
+  chunk_free_vertex_data( &greedy );
+  _test_greedy_matches_per_face( "slab", &chunk, NULL, 96.0 );
+  chunk_free( &chunk );
+}
+
+/* chunk_generate() terrain with its neighbours, caves and all, as the world streams it in. ambient occlusion mustn't stop greedy merging: keying faces on
+it held this chunk to x1.3 */
+static void _test_greedy_generated_terrain() {
+  chunk_t chunks[9];
+  for ( int i = 0; i < 9; i++ ) { chunks[i] = chunk_generate( 1234, i % 3, i / 3 ); }
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){
+    .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] }, .diagonal = { &chunks[0], &chunks[2], &chunks[6], &chunks[8] } };
+  _test_greedy_matches_per_face( "generated", &chunks[4], &neighbours, 1.75 );
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+static void _test_greedy_y_range() {
+  // meshing only some layers must cover the same faces in both meshers
+  chunk_t chunk                = _mixed_chunk();
+  chunk_vertex_data_t per_face = chunk_gen_vertex_data( &chunk, NULL, 4, 9, CHUNK_MESHER_PER_FACE );
+  chunk_vertex_data_t greedy   = chunk_gen_vertex_data( &chunk, NULL, 4, 9, CHUNK_MESHER_GREEDY );
+  coverage_t cov_per_face      = _coverage_alloc();
+  coverage_t cov_greedy        = _coverage_alloc();
+  _rasterise( &per_face, &cov_per_face );
+  _rasterise( &greedy, &cov_greedy );
+  assert( 0 == memcmp( cov_per_face.count, cov_greedy.count, cov_per_face.n_cells ) );
+  for ( size_t i = 0; i < per_face.n_vertices; i++ ) {
+    voxel_vertex_t vertex = voxel_vertex_unpack( &per_face.packed_ptr[i * VOXEL_VPACKED_COMPS] );
+    assert( vertex.y >= 4 && vertex.y <= 9 );
+  }
+  for ( size_t i = 0; i < greedy.n_vertices; i++ ) {
+    voxel_vertex_t vertex = voxel_vertex_unpack( &greedy.packed_ptr[i * VOXEL_VPACKED_COMPS] );
+    assert( vertex.y >= 4 && vertex.y <= 9 );
+  }
+  _coverage_free( &cov_per_face );
+  _coverage_free( &cov_greedy );
+  chunk_free_vertex_data( &per_face );
+  chunk_free_vertex_data( &greedy );
+  chunk_free( &chunk );
+}
+
+// one vertex data per section, so that the test can see exactly which sections an edit changed
+static void _gen_section_vertex_data( const chunk_t* chunk, const chunk_neighbours_t* neighbours, chunk_mesher_t mesher, chunk_vertex_data_t* sections ) {
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    sections[section] = chunk_gen_vertex_data( chunk, neighbours, section * CHUNK_SECTION_Y, ( section + 1 ) * CHUNK_SECTION_Y, mesher );
+  }
+}
+
+static void _test_section_meshing() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 4321, chunks );
+  chunk_t* centre               = &chunks[4];
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] } };
+
+  // the sections together cover exactly the faces of the whole chunk, in both meshers
+  for ( int mesher = CHUNK_MESHER_PER_FACE; mesher <= CHUNK_MESHER_GREEDY; mesher++ ) {
+    chunk_vertex_data_t whole = chunk_gen_vertex_data( centre, &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+    chunk_vertex_data_t sections[CHUNK_SECTIONS];
+    _gen_section_vertex_data( centre, &neighbours, (chunk_mesher_t)mesher, sections );
+    coverage_t cov_whole    = _coverage_alloc();
+    coverage_t cov_sections = _coverage_alloc();
+    _rasterise( &whole, &cov_whole );
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+      _rasterise( &sections[section], &cov_sections );
+      chunk_free_vertex_data( &sections[section] );
+    }
+    assert( 0 == memcmp( cov_whole.count, cov_sections.count, cov_whole.n_cells ) );
+    assert( 0 == memcmp( cov_whole.key, cov_sections.key, cov_whole.n_cells * sizeof( *cov_whole.key ) ) );
+    _coverage_free( &cov_whole );
+    _coverage_free( &cov_sections );
+    chunk_free_vertex_data( &whole );
+  }
+
+  /* random edits in the centre chunk or along its neighbours' shared borders. any section of the centre whose mesh changed must be in the mask
+  from chunk_sections_changed_by_edit(). edits go around the surface so that the heightmap rises and falls */
+  srand( 99 );
+  int n_remeshed = 0, n_edits = 0;
+  chunk_vertex_data_t before[CHUNK_SECTIONS], after[CHUNK_SECTIONS];
+  _gen_section_vertex_data( centre, &neighbours, CHUNK_MESHER_PER_FACE, before );
+  while ( n_edits < 200 ) {
+    const int which = rand() % 5; // 0 is the centre
+    const int adjacent_idx[5]  = { 4, 3, 5, 1, 7 };
+    chunk_t* chunk             = &chunks[adjacent_idx[which]];
+    int x = rand() % CHUNK_X, z = rand() % CHUNK_Z;
+    if ( 1 == which ) { x = CHUNK_X - 1; }
+    if ( 2 == which ) { x = 0; }
+    if ( 3 == which ) { z = CHUNK_Z - 1; }
+    if ( 4 == which ) { z = 0; }
+    const int prev_height   = chunk->heightmap[CHUNK_X * z + x];
+    const int y             = prev_height - 8 + rand() % 40;
+    const block_type_t type = rand() % 2 ? BLOCK_TYPE_STONE : BLOCK_TYPE_AIR;
+    if ( y < 0 || y >= CHUNK_Y || !set_block_type_in_chunk( chunk, x, y, z, type ) ) { continue; }
+    const uint32_t mask = chunk_sections_changed_by_edit( y, prev_height, chunk->heightmap[CHUNK_X * z + x] );
+    n_edits++;
+
+    _gen_section_vertex_data( centre, &neighbours, CHUNK_MESHER_PER_FACE, after );
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+      const bool changed = before[section].n_vertices != after[section].n_vertices ||
+                           0 != memcmp( before[section].packed_ptr, after[section].packed_ptr, before[section].vpacked_buffer_sz );
+      assert( !changed || ( mask & ( 1u << section ) ) );
+      chunk_free_vertex_data( &before[section] );
+      before[section] = after[section];
+    }
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { n_remeshed += ( mask >> section ) & 1; }
+  }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { chunk_free_vertex_data( &before[section] ); }
+  printf( "sections   %i edits remeshed %.2f of %i sections on average\n", n_edits, (double)n_remeshed / n_edits, CHUNK_SECTIONS );
+
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+/* faces come out in layer order in both meshers, for the whole chunk and for a section, so slicing at any height is a prefix of the vertices.
+chunk_vertex_data_layer_ends() agrees with counting the faces of each layer by hand */
+static void _test_layer_order() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 4321, chunks );
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] } };
+  const int surface_section     = chunks[4].heightmap[0] / CHUNK_SECTION_Y;
+  const int ranges[2][2]        = { { 0, CHUNK_Y }, { surface_section * CHUNK_SECTION_Y, ( surface_section + 1 ) * CHUNK_SECTION_Y } };
+  uint32_t layer_ends[CHUNK_Y];
+  size_t n_wall_faces_above = 0;
+
+  for ( int mesher = CHUNK_MESHER_PER_FACE; mesher <= CHUNK_MESHER_GREEDY; mesher++ ) {
+    for ( int r = 0; r < 2; r++ ) {
+      const int from_y         = ranges[r][0], n_layers = ranges[r][1] - ranges[r][0];
+      chunk_vertex_data_t data = chunk_gen_vertex_data( &chunks[4], &neighbours, from_y, from_y + n_layers, (chunk_mesher_t)mesher );
+      assert( data.n_vertices > 0 );
+      chunk_vertex_data_layer_ends( &data, from_y, n_layers, layer_ends );
+      assert( layer_ends[n_layers - 1] == data.n_vertices );
+      size_t n_counted = 0;
+      int prev_layer   = from_y;
+      for ( int i = 0; i < n_layers; i++ ) {
+        for ( size_t v = 0; v < data.n_vertices; v += VOXEL_FACE_VERTS ) {
+          const int layer = chunk_face_layer( &data.packed_ptr[v * VOXEL_VPACKED_COMPS] );
+          if ( layer != from_y + i ) { continue; }
+          n_counted += VOXEL_FACE_VERTS;
+          // walls merged up several voxels reach above their layer, which is why the shader clips at the slice as well
+          int max_y = 0;
+          for ( int c = 0; c < VOXEL_FACE_VERTS; c++ ) {
+            const voxel_vertex_t vertex = voxel_vertex_unpack( &data.packed_ptr[( v + c ) * VOXEL_VPACKED_COMPS] );
+            if ( vertex.y > max_y ) { max_y = vertex.y; }
+          }
+          if ( 0 == r && CHUNK_MESHER_GREEDY == mesher && max_y > layer + 1 ) { n_wall_faces_above++; }
+        }
+        assert( layer_ends[i] == n_counted );
+      }
+      for ( size_t v = 0; v < data.n_vertices; v += VOXEL_FACE_VERTS ) {
+        const int layer = chunk_face_layer( &data.packed_ptr[v * VOXEL_VPACKED_COMPS] );
+        assert( layer >= prev_layer && layer < from_y + n_layers );
+        prev_layer = layer;
+      }
+      chunk_free_vertex_data( &data );
+    }
+  }
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+
+  printf( "layers     faces sorted by layer in both meshers | %zu greedy walls span more than one layer\n", n_wall_faces_above );
+}
+
+static void _test_mesh_arena() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 1234, chunks );
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] } };
+
+  // mesh every section of every chunk into one arena, as a worker would. after the first pass the arena is big enough and never grows again
+  chunk_mesh_arena_t arena = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+  size_t max_vertices_after_first_pass = 0;
+  for ( int pass = 0; pass < 2; pass++ ) {
+    for ( int i = 0; i < 9; i++ ) {
+      const chunk_neighbours_t* nbs = 4 == i ? &neighbours : NULL;
+      chunk_mesh_arena_reset( &arena );
+      size_t first_vertex[CHUNK_SECTIONS];
+      for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+        first_vertex[section] = arena.n_vertices;
+        chunk_vertex_data_t view =
+          chunk_gen_vertex_data_in_arena( &arena, &chunks[i], nbs, section * CHUNK_SECTION_Y, ( section + 1 ) * CHUNK_SECTION_Y, CHUNK_MESHER_GREEDY );
+        assert( view.packed_ptr && view.n_vertices == arena.n_vertices - first_vertex[section] );
+      }
+      if ( 1 == pass ) { assert( arena.max_vertices == max_vertices_after_first_pass ); }
+      // views taken after all the appends match the one-off allocating version byte for byte
+      for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+        const size_t end         = section < CHUNK_SECTIONS - 1 ? first_vertex[section + 1] : arena.n_vertices;
+        chunk_vertex_data_t view = chunk_mesh_arena_vertex_data( &arena, first_vertex[section], end - first_vertex[section] );
+        chunk_vertex_data_t data =
+          chunk_gen_vertex_data( &chunks[i], nbs, section * CHUNK_SECTION_Y, ( section + 1 ) * CHUNK_SECTION_Y, CHUNK_MESHER_GREEDY );
+        assert( view.n_vertices == data.n_vertices && view.vpacked_buffer_sz == data.vpacked_buffer_sz );
+        assert( 0 == memcmp( view.packed_ptr, data.packed_ptr, data.vpacked_buffer_sz ) );
+        chunk_free_vertex_data( &data );
+      }
+    }
+    max_vertices_after_first_pass = arena.max_vertices;
+  }
+  printf( "arena      %zu bytes reused for every chunk | worst-case sizing for the centre chunk was %zu bytes\n",
+    arena.max_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ), (size_t)VOXEL_CUBE_VPACKED_BYTES * chunks[4].n_non_air_voxels );
+  chunk_mesh_arena_free( &arena );
+  assert( !arena.packed_ptr && 0 == arena.max_vertices );
+
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+static void _test_neighbour_culling() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 1234, chunks );
+  const chunk_t* centre         = &chunks[4];
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] } };
+
+  // brute force over the 3x3 world: a face is visible if the voxel next to it is air or above/below the world
+  // clang-format off
+  const int xs[6] = { -1,  1,  0,  0,  0,  0 };
+  const int ys[6] = {  0,  0, -1,  1,  0,  0 };
+  const int zs[6] = {  0,  0,  0,  0, -1,  1 };
+  // clang-format on
+  size_t n_expected_faces = 0, n_border_faces_culled = 0;
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        block_type_t type = BLOCK_TYPE_AIR;
+        get_block_type_in_chunk( centre, x, y, z, &type );
+        if ( BLOCK_TYPE_AIR == type ) { continue; }
+        for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
+          const int wx = CHUNK_X + x + xs[face_idx], wy = y + ys[face_idx], wz = CHUNK_Z + z + zs[face_idx];
+          block_type_t neighbour_type = BLOCK_TYPE_AIR;
+          if ( wy >= 0 && wy < CHUNK_Y ) {
+            get_block_type_in_chunk( &chunks[( wz / CHUNK_Z ) * 3 + wx / CHUNK_X], wx % CHUNK_X, wy, wz % CHUNK_Z, &neighbour_type );
+          }
+          if ( BLOCK_TYPE_AIR == neighbour_type ) {
+            n_expected_faces++;
+          } else if ( wx / CHUNK_X != 1 || wz / CHUNK_Z != 1 ) {
+            n_border_faces_culled++;
+          }
+        }
+      }
+    }
+  }
+  assert( n_border_faces_culled > 0 );
+
+  chunk_vertex_data_t isolated = chunk_gen_vertex_data( centre, NULL, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+  chunk_vertex_data_t culled   = chunk_gen_vertex_data( centre, &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+  assert( culled.n_vertices == n_expected_faces * VOXEL_FACE_VERTS );
+  assert( isolated.n_vertices == ( n_expected_faces + n_border_faces_culled ) * VOXEL_FACE_VERTS );
+  printf( "neighbour culling removed %zu of %zu faces\n", n_border_faces_culled, n_expected_faces + n_border_faces_culled );
+  chunk_free_vertex_data( &isolated );
+  chunk_free_vertex_data( &culled );
+
+  // greedy must agree with per-face on which faces are left and on their light, which comes from the neighbours on the border
+  _test_greedy_matches_per_face( "neighbours", centre, &neighbours, 1.5 );
+
+  // a neighbour only missing on one side leaves that wall in place
+  neighbours.adjacent[1]        = NULL;
+  chunk_vertex_data_t east_open = chunk_gen_vertex_data( centre, &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+  size_t n_east_wall_faces      = 0;
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      block_type_t ours = BLOCK_TYPE_AIR, theirs = BLOCK_TYPE_AIR;
+      get_block_type_in_chunk( centre, CHUNK_X - 1, y, z, &ours );
+      get_block_type_in_chunk( &chunks[5], 0, y, z, &theirs );
+      if ( ours != BLOCK_TYPE_AIR && theirs != BLOCK_TYPE_AIR ) { n_east_wall_faces++; }
+    }
+  }
+  assert( east_open.n_vertices == ( n_expected_faces + n_east_wall_faces ) * VOXEL_FACE_VERTS );
+  chunk_free_vertex_data( &east_open );
+
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+// in the centre chunk's voxel coords, up to a chunk over its borders into chunks laid out like _terrain_chunks_3x3(). above and below the world is air
+static bool _ao_test_is_solid( const chunk_t* chunks, bool with_diagonals, int x, int y, int z ) {
+  if ( y < 0 || y >= CHUNK_Y ) { return false; }
+  const int cx = x < 0 ? 0 : ( x < CHUNK_X ? 1 : 2 ), cz = z < 0 ? 0 : ( z < CHUNK_Z ? 1 : 2 );
+  if ( !with_diagonals && cx != 1 && cz != 1 ) { return false; }
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( &chunks[cz * 3 + cx], x - ( cx - 1 ) * CHUNK_X, y, z - ( cz - 1 ) * CHUNK_Z, &type );
+  return type != BLOCK_TYPE_AIR;
+}
+
+// occlusion of the corner of a face of voxel v at corner position p, from the 3 voxels in front of the face touching it
+static int _ao_test_reference( const chunk_t* chunks, bool with_diagonals, const int* v, int face_idx, const int* p ) {
+  const int n_axis = face_idx / 2;
+  int front[3]     = { v[0], v[1], v[2] };
+  front[n_axis] += face_idx % 2 ? 1 : -1;
+  int side_a[3] = { front[0], front[1], front[2] }, side_b[3] = { front[0], front[1], front[2] }, diagonal[3] = { front[0], front[1], front[2] };
+  const int a_axis = ( n_axis + 1 ) % 3, b_axis = ( n_axis + 2 ) % 3;
+  side_a[a_axis] += p[a_axis] > v[a_axis] ? 1 : -1;
+  side_b[b_axis] += p[b_axis] > v[b_axis] ? 1 : -1;
+  diagonal[a_axis] = side_a[a_axis];
+  diagonal[b_axis] = side_b[b_axis];
+  const int a = _ao_test_is_solid( chunks, with_diagonals, side_a[0], side_a[1], side_a[2] );
+  const int b = _ao_test_is_solid( chunks, with_diagonals, side_b[0], side_b[1], side_b[2] );
+  const int d = _ao_test_is_solid( chunks, with_diagonals, diagonal[0], diagonal[1], diagonal[2] );
+  return a && b ? 0 : VOXEL_AO_MAX - a - b - d;
+}
+
+/* every corner of every voxel face a quad covers must get the occlusion of that voxel face's corner from the quad's occlusion, so that merging faces
+doesn't change the shading. n_merged counts quads covering more than one voxel face that have some occlusion */
+static void _test_ao_quads( const chunk_t* chunks, bool with_diagonals, const chunk_vertex_data_t* data, size_t* n_occluded, size_t* n_merged ) {
+  for ( size_t quad = 0; quad < data->n_vertices / VOXEL_FACE_VERTS; quad++ ) {
+    voxel_vertex_t vv[VOXEL_FACE_VERTS];
+    for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { vv[v] = voxel_vertex_unpack( &data->packed_ptr[( quad * VOXEL_FACE_VERTS + v ) * VOXEL_VPACKED_COMPS] ); }
+    const int face_idx = vv[0].face_idx;
+    const int n_axis   = face_idx / 2;
+    const int quad_w = vv[2].s, quad_h = vv[2].t;
+    // which way texcoords run across the quad, from its texcoord 0,0 corner
+    const voxel_vertex_t *origin = NULL, *s_end = NULL, *t_end = NULL;
+    for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) {
+      if ( 0 == vv[v].s && 0 == vv[v].t ) { origin = &vv[v]; }
+      if ( quad_w == vv[v].s && 0 == vv[v].t ) { s_end = &vv[v]; }
+      if ( 0 == vv[v].s && quad_h == vv[v].t ) { t_end = &vv[v]; }
+    }
+    assert( origin && s_end && t_end );
+    int s_axis = 0, t_axis = 0;
+    for ( int c = 0; c < 3; c++ ) {
+      if ( ( &s_end->x )[c] != ( &origin->x )[c] ) { s_axis = c; }
+      if ( ( &t_end->x )[c] != ( &origin->x )[c] ) { t_axis = c; }
+    }
+    const int* o = &origin->x;
+    int lo[3], hi[3];
+    for ( int c = 0; c < 3; c++ ) {
+      lo[c] = o[c] < ( &s_end->x )[c] ? o[c] : ( &s_end->x )[c];
+      lo[c] = lo[c] < ( &t_end->x )[c] ? lo[c] : ( &t_end->x )[c];
+      hi[c] = o[c] > ( &s_end->x )[c] ? o[c] : ( &s_end->x )[c];
+      hi[c] = hi[c] > ( &t_end->x )[c] ? hi[c] : ( &t_end->x )[c];
+    }
+    // corners to voxels
+    const int voxel_n = face_idx % 2 ? lo[n_axis] - 1 : lo[n_axis];
+    lo[n_axis]        = voxel_n;
+    hi[n_axis]        = voxel_n + 1;
+
+    bool occluded = false;
+    for ( int y = lo[1]; y < hi[1]; y++ ) {
+      for ( int z = lo[2]; z < hi[2]; z++ ) {
+        for ( int x = lo[0]; x < hi[0]; x++ ) {
+          const int voxel[3] = { x, y, z };
+          for ( int corner = 0; corner < 4; corner++ ) {
+            int p[3]  = { x, y, z };
+            p[n_axis] = o[n_axis];
+            p[s_axis] += corner % 2;
+            p[t_axis] += corner / 2;
+            const int i = abs( p[s_axis] - o[s_axis] ), j = abs( p[t_axis] - o[t_axis] );
+            const int ao = _ao_test_reference( chunks, with_diagonals, voxel, face_idx, p );
+            assert( _quad_ao_at( vv[0].quad_ao, quad_w, quad_h, i, j ) == ao );
+            *n_occluded += ao < VOXEL_AO_MAX;
+            occluded |= ao < VOXEL_AO_MAX;
+          }
+        }
+      }
+    }
+    *n_merged += occluded && quad_w * quad_h > 1;
+  }
+}
+
+static void _test_ambient_occlusion() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 4321, chunks );
+  // pits, pillars, and overhangs on the surface, a lot of them in the columns around the centre chunk's corners where the diagonal neighbours matter
+  srand( 77 );
+  for ( int i = 0; i < 6000; i++ ) {
+    int x = rand() % ( CHUNK_X * 3 ) - CHUNK_X, z = rand() % ( CHUNK_Z * 3 ) - CHUNK_Z;
+    if ( i % 2 ) {
+      x = ( rand() % 2 ? -1 : CHUNK_X - 1 ) + rand() % 2;
+      z = ( rand() % 2 ? -1 : CHUNK_Z - 1 ) + rand() % 2;
+    }
+    const int cx = x < 0 ? 0 : ( x < CHUNK_X ? 1 : 2 ), cz = z < 0 ? 0 : ( z < CHUNK_Z ? 1 : 2 );
+    chunk_t* chunk = &chunks[cz * 3 + cx];
+    const int lx = x - ( cx - 1 ) * CHUNK_X, lz = z - ( cz - 1 ) * CHUNK_Z;
+    int height = CHUNK_Y - 1;
+    block_type_t type = BLOCK_TYPE_AIR;
+    while ( height > 0 && ( get_block_type_in_chunk( chunk, lx, height, lz, &type ), BLOCK_TYPE_AIR == type ) ) { height--; }
+    const int y = height - 2 + rand() % 6;
+    set_block_type_in_chunk( chunk, lx, y, lz, rand() % 3 ? BLOCK_TYPE_STONE : BLOCK_TYPE_AIR );
+  }
+  for ( int i = 0; i < 9; i++ ) { chunk_init_sky_light( &chunks[i] ); }
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){
+    .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] }, .diagonal = { &chunks[0], &chunks[2], &chunks[6], &chunks[8] } };
+
+  size_t n_occluded_with_diagonals = 0;
+  for ( int with_diagonals = 1; with_diagonals >= 0; with_diagonals-- ) {
+    if ( !with_diagonals ) { memset( neighbours.diagonal, 0, sizeof( neighbours.diagonal ) ); }
+    chunk_vertex_data_t per_face = chunk_gen_vertex_data( &chunks[4], &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+    chunk_vertex_data_t greedy   = chunk_gen_vertex_data( &chunks[4], &neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+    size_t n_occluded = 0, n_merged = 0, n_greedy_occluded = 0, n_greedy_merged = 0;
+    _test_ao_quads( chunks, with_diagonals, &per_face, &n_occluded, &n_merged );
+    _test_ao_quads( chunks, with_diagonals, &greedy, &n_greedy_occluded, &n_greedy_merged );
+    // occlusion no longer stops faces merging
+    assert( n_occluded > 0 && n_greedy_occluded == n_occluded && 0 == n_merged && n_greedy_merged > 0 );
+    // the corner columns of the diagonal neighbours were built up, so without them some corners come out lighter
+    assert( with_diagonals || n_occluded < n_occluded_with_diagonals );
+    if ( with_diagonals ) {
+      n_occluded_with_diagonals = n_occluded;
+      printf( "ao         %6zu of %6zu corners occluded | %5zu merged quads occluded\n", n_occluded, per_face.n_vertices / VOXEL_FACE_VERTS * 4,
+        n_greedy_merged );
+      // the surface is roughed up on purpose, so greedy merges little here with or without occlusion. compare "terrain" for a normal chunk
+      _test_greedy_matches_per_face( "ao", &chunks[4], &neighbours, 1.25 );
+    }
+    chunk_free_vertex_data( &per_face );
+    chunk_free_vertex_data( &greedy );
+  }
+
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+/* a LOD mesh must cover the same cells as the full detail mesh of the chunk downsampled by hand, where a whole cell face counts as covered if any voxel
+face in it is. inside the chunk that's the downsampled chunk's own faces. on the border it's wherever a full detail neighbour voxel touching the cell is air,
+which is what keeps seams against neighbours at other LODs closed */
+static void _test_lod_meshes() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 1234, chunks );
+  chunk_t* centre = &chunks[4];
+  // a tunnel out through the +x border and a floating voxel, so that there's more than a heightmap to downsample
+  for ( int x = 4; x < CHUNK_X + 8; x++ ) {
+    for ( int y = 40; y < 43; y++ ) {
+      for ( int z = 6; z < 9; z++ ) { set_block_type_in_chunk( x < CHUNK_X ? centre : &chunks[5], x % CHUNK_X, y, z, BLOCK_TYPE_AIR ); }
+    }
+  }
+  set_block_type_in_chunk( centre, 9, 120, 3, BLOCK_TYPE_CRUST );
+  chunk_neighbours_t all_neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], &chunks[5], &chunks[1], &chunks[7] } };
+  chunk_vertex_data_t full          = chunk_gen_vertex_data( centre, &all_neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+  chunk_mesh_arena_t arena = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+
+  for ( int missing_east = 0; missing_east < 2; missing_east++ ) {
+    chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { &chunks[3], missing_east ? NULL : &chunks[5], &chunks[1], &chunks[7] } };
+    size_t prev_n_vertices        = full.n_vertices;
+    for ( int lod = 1; lod < CHUNK_LOD_LEVELS; lod++ ) {
+      const int scale = 1 << lod;
+      // reference downsampling: solid if any voxel is, typed by the top-most solid voxel
+      chunk_t coarse = _empty_chunk();
+      for ( int y = 0; y < CHUNK_Y; y += scale ) {
+        for ( int z = 0; z < CHUNK_Z; z += scale ) {
+          for ( int x = 0; x < CHUNK_X; x += scale ) {
+            block_type_t type = BLOCK_TYPE_AIR;
+            for ( int i = 0; i < scale * scale * scale && BLOCK_TYPE_AIR == type; i++ ) {
+              get_block_type_in_chunk( centre, x + i % scale, y + scale - 1 - i / ( scale * scale ), z + ( i / scale ) % scale, &type );
+            }
+            for ( int i = 0; i < scale * scale * scale; i++ ) {
+              set_block_type_in_chunk( &coarse, x + i % scale, y + i / ( scale * scale ), z + ( i / scale ) % scale, type );
+            }
+          }
+        }
+      }
+      chunk_vertex_data_t ref = chunk_gen_vertex_data( &coarse, &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+      chunk_mesh_arena_reset( &arena );
+      chunk_vertex_data_t lod_data = chunk_gen_lod_vertex_data_in_arena( &arena, centre, &neighbours, lod );
+      coverage_t cov_ref           = _coverage_alloc();
+      coverage_t cov_lod           = _coverage_alloc();
+      _rasterise( &ref, &cov_ref );
+      _rasterise( &lod_data, &cov_lod );
+
+      // light differs between the two, so only palette indices are compared
+      const uint32_t palidx_mask = 0x1FF;
+      for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
+        const int n_axis = face_idx / 2;
+        const int a_axis = n_axis == 0 ? 1 : 0;
+        const int b_axis = n_axis == 2 ? 1 : 2;
+        for ( int plane = 0; plane <= _dims[n_axis]; plane++ ) {
+          for ( int a0 = 0; a0 < _dims[a_axis]; a0 += scale ) {
+            for ( int b0 = 0; b0 < _dims[b_axis]; b0 += scale ) {
+              uint32_t ref_key = 0;
+              for ( int i = 0; i < scale * scale; i++ ) {
+                const size_t idx = _cell_idx( face_idx, plane, a0 + i % scale, b0 + i / scale );
+                if ( cov_ref.count[idx] ) { ref_key = cov_ref.key[idx] & palidx_mask; }
+              }
+              for ( int i = 0; i < scale * scale; i++ ) {
+                const size_t idx = _cell_idx( face_idx, plane, a0 + i % scale, b0 + i / scale );
+                assert( cov_lod.count[idx] == ( ref_key ? 1 : 0 ) );
+                assert( !ref_key || ( cov_lod.key[idx] & palidx_mask ) == ref_key );
+              }
+            }
+          }
+        }
+      }
+      assert( lod_data.n_vertices > 0 && lod_data.n_vertices < prev_n_vertices );
+      if ( !missing_east ) {
+        printf( "lod %i      %6zu verts | x%.1f fewer than full detail\n", lod, lod_data.n_vertices, (double)full.n_vertices / (double)lod_data.n_vertices );
+      }
+      prev_n_vertices = lod_data.n_vertices;
+
+      _coverage_free( &cov_ref );
+      _coverage_free( &cov_lod );
+      chunk_free_vertex_data( &ref );
+      chunk_free( &coarse );
+    }
+  }
+
+  chunk_mesh_arena_free( &arena );
+  chunk_free_vertex_data( &full );
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+typedef struct mesh_job_t {
+  const chunk_t* chunk;
+  chunk_neighbours_t neighbours;
+  chunk_vertex_data_t vertex_data;
+  bool finished_on_main_thread;
+} mesh_job_t;
+
+static void _mesh_job_fn( int worker_idx, void* args ) {
+  assert( worker_idx >= 0 && worker_idx < worker_pool_n_workers() );
+  mesh_job_t* job  = (mesh_job_t*)args;
+  job->vertex_data = chunk_gen_vertex_data( job->chunk, &job->neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+}
+
+static void _mesh_job_finished_cb( const char* name, void* args ) {
+  (void)name;
+  mesh_job_t* job              = (mesh_job_t*)args;
+  job->finished_on_main_thread = true;
+}
+
+static void _test_worker_pool_meshing() {
+  // meshing on the worker threads must give exactly the same bytes as meshing serially
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 99, chunks );
+  mesh_job_t jobs[9];
+  memset( jobs, 0, sizeof( jobs ) );
+
+  worker_pool_init();
+  assert( worker_pool_n_workers() >= 1 );
+  for ( int i = 0; i < 9; i++ ) {
+    const int cx = i % 3, cz = i / 3;
+    jobs[i].chunk = &chunks[i];
+    jobs[i].neighbours =
+      ( chunk_neighbours_t ){ .adjacent = { cx > 0 ? &chunks[i - 1] : NULL, cx < 2 ? &chunks[i + 1] : NULL, cz > 0 ? &chunks[i - 3] : NULL, cz < 2 ? &chunks[i + 3] : NULL } };
+    job_description_t job = ( job_description_t ){ .job_function_ptr = _mesh_job_fn, .job_function_args = &jobs[i], .on_finished_cb = _mesh_job_finished_cb };
+    snprintf( job.name, sizeof( job.name ), "mesh %i", i );
+    bool pushed = worker_pool_push_job( job );
+    assert( pushed );
+  }
+  worker_pool_wait();
+  assert( worker_pool_n_jobs_outstanding() == 9 ); // finished but not reported until update
+  for ( int i = 0; i < 9; i++ ) { assert( !jobs[i].finished_on_main_thread ); }
+  worker_pool_update();
+  assert( worker_pool_n_jobs_outstanding() == 0 );
+  worker_pool_free();
+
+  for ( int i = 0; i < 9; i++ ) {
+    assert( jobs[i].finished_on_main_thread );
+    chunk_vertex_data_t serial = chunk_gen_vertex_data( jobs[i].chunk, &jobs[i].neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+    assert( serial.n_vertices == jobs[i].vertex_data.n_vertices );
+    assert( 0 == memcmp( serial.packed_ptr, jobs[i].vertex_data.packed_ptr, serial.vpacked_buffer_sz ) );
+    chunk_free_vertex_data( &serial );
+    chunk_free_vertex_data( &jobs[i].vertex_data );
+  }
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+// compares through get_block_type_in_chunk() so either chunk can be compressed
+static bool _chunks_equal( const chunk_t* a, const chunk_t* b ) {
+  if ( a->n_non_air_voxels != b->n_non_air_voxels || 0 != memcmp( a->heightmap, b->heightmap, sizeof( a->heightmap ) ) ) { return false; }
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        block_type_t type_a = BLOCK_TYPE_AIR, type_b = BLOCK_TYPE_AIR;
+        get_block_type_in_chunk( a, x, y, z, &type_a );
+        get_block_type_in_chunk( b, x, y, z, &type_b );
+        if ( type_a != type_b ) { return false; }
+      }
+    }
+  }
+  return true;
+}
+
+/* chunks generated from noise must come out the same whatever order they're generated in, match chunk_generate_height() at their world coords, and
+not step any more steeply between neighbouring chunks than inside one. near the origin, where coords change sign, and far from it */
+static void _test_noise_terrain() {
+  const uint32_t seed     = 777;
+  const int origins[3][2] = { { -1, -1 }, { 5000, -7000 }, { -100000, 100000 } };
+  const int order[9]      = { 4, 0, 8, 1, 5, 3, 7, 2, 6 };
+  int max_step_inside = 0, max_step_across = 0, min_height = CHUNK_Y, max_height = 0;
+  for ( int o = 0; o < 3; o++ ) {
+    const int ocx = origins[o][0], ocz = origins[o][1];
+    chunk_t chunks[9];
+    for ( int k = 0; k < 9; k++ ) { chunks[order[k]] = chunk_generate( seed, ocx + order[k] % 3, ocz + order[k] / 3 ); }
+    chunk_t again = chunk_generate( seed, ocx + 1, ocz + 1 );
+    assert( _chunks_equal( &again, &chunks[4] ) );
+    chunk_free( &again );
+    chunk_t other_seed = chunk_generate( seed + 1, ocx + 1, ocz + 1 );
+    assert( 0 != memcmp( other_seed.heightmap, chunks[4].heightmap, sizeof( other_seed.heightmap ) ) );
+    chunk_free( &other_seed );
+
+    for ( int wz = 0; wz < 3 * CHUNK_Z; wz++ ) {
+      for ( int wx = 0; wx < 3 * CHUNK_X; wx++ ) {
+        const int height = chunks[( wz / CHUNK_Z ) * 3 + wx / CHUNK_X].heightmap[CHUNK_X * ( wz % CHUNK_Z ) + wx % CHUNK_X];
+        assert( height == chunk_generate_height( seed, ocx * CHUNK_X + wx, ocz * CHUNK_Z + wz ) );
+        min_height = height < min_height ? height : min_height;
+        max_height = height > max_height ? height : max_height;
+        // steps to the previous column in x and in z
+        for ( int axis = 0; axis < 2; axis++ ) {
+          const int px = wx - ( 0 == axis ), pz = wz - ( 1 == axis );
+          if ( px < 0 || pz < 0 ) { continue; }
+          const int prev    = chunks[( pz / CHUNK_Z ) * 3 + px / CHUNK_X].heightmap[CHUNK_X * ( pz % CHUNK_Z ) + px % CHUNK_X];
+          const int step    = abs( height - prev );
+          const bool across = ( 0 == axis && 0 == wx % CHUNK_X ) || ( 1 == axis && 0 == wz % CHUNK_Z );
+          if ( across ) {
+            max_step_across = step > max_step_across ? step : max_step_across;
+          } else {
+            max_step_inside = step > max_step_inside ? step : max_step_inside;
+          }
+        }
+      }
+    }
+    for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+  }
+  // fBm of smoothstepped value noise with these octaves can't rise more than a few voxels per column
+  assert( max_step_inside <= 5 && max_step_across <= 5 );
+  assert( max_height - min_height > 16 );
+  printf( "noise      terrain in any order matches chunk_generate_height() | heights %i..%i | steepest step %i inside chunks, %i across\n", min_height,
+    max_height, max_step_inside, max_step_across );
+}
+
+/* every SIMD path of noise_gradient3_row() must give exactly the same bits as noise_gradient3() one voxel at a time, for any spacing and either side
+of 0, or chunks would depend on the CPU that generated them. then caves and ore from it must stay under the roof chunk_generate() promises */
+static void _test_noise_simd() {
+  const int spacings[8] = { 1, 2, 3, 5, 16, 17, 48, 64 };
+  const int n_rows      = 2000;
+  srand( 2024 );
+  char paths_str[64] = "";
+  for ( int simd = NOISE_SIMD_SCALAR; simd < NOISE_SIMD_N; simd++ ) {
+    if ( !noise_simd_supported( (noise_simd_t)simd ) ) { continue; }
+    if ( paths_str[0] ) { strcat( paths_str, ", " ); }
+    strcat( paths_str, noise_simd_name( (noise_simd_t)simd ) );
+    for ( int r = 0; r < n_rows; r++ ) {
+      const uint32_t seed = (uint32_t)rand();
+      const int spacing   = spacings[r % 8];
+      const int x0        = rand() % 2000000 - 1000000, y = rand() % CHUNK_Y, z = rand() % 2000000 - 1000000;
+      float row[NOISE_ROW_W];
+      noise_gradient3_row( (noise_simd_t)simd, seed, x0, y, z, spacing, row );
+      for ( int i = 0; i < NOISE_ROW_W; i++ ) {
+        const float voxel = noise_gradient3( seed, x0 + i, y, z, spacing );
+        assert( 0 == memcmp( &voxel, &row[i], sizeof( float ) ) );
+        assert( fabsf( voxel ) <= 1.5f );
+      }
+    }
+  }
+  for ( int i = -4; i < 4; i++ ) { assert( 0.0f == noise_gradient3( 99, i * 48, 96, -i * 48, 48 ) ); }
+
+  // tunnels and ore under the ground, nothing changed above the roof
+  int n_underground = 0, n_air = 0, n_ore = 0;
+  for ( int c = 0; c < 4; c++ ) {
+    chunk_t chunk = chunk_generate( 777, c % 2, c / 2 );
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        const int height = chunk.heightmap[CHUNK_X * z + x];
+        for ( int y = 0; y <= height; y++ ) {
+          block_type_t type = BLOCK_TYPE_AIR;
+          get_block_type_in_chunk( &chunk, x, y, z, &type );
+          if ( y < CHUNK_CAVE_FLOOR || y > height - CHUNK_CAVE_ROOF ) {
+            assert( BLOCK_TYPE_AIR != type && BLOCK_TYPE_ORE != type );
+            continue;
+          }
+          n_underground++;
+          n_air += BLOCK_TYPE_AIR == type;
+          n_ore += BLOCK_TYPE_ORE == type;
+        }
+      }
+    }
+    chunk_free( &chunk );
+  }
+  assert( n_air > 0 && n_ore > 0 );
+  printf( "noise 3d   %s rows bit-identical to per-voxel scalar over %i rows each | caves %.1f%% and ore %.1f%% of the underground\n", paths_str, n_rows,
+    100.0f * n_air / n_underground, 100.0f * n_ore / n_underground );
+}
+
+static long _file_sz( const char* filename ) {
+  FILE* fptr = fopen( filename, "rb" );
+  assert( fptr );
+  fseek( fptr, 0, SEEK_END );
+  long sz = ftell( fptr );
+  fclose( fptr );
+  return sz;
+}
+
+static void _test_region_paging() {
+  const char* filename = "test.region";
+  remove( filename );
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 7, chunks );
+
+  region_t region;
+  // streaming looks for regions that were never written without creating them
+  bool ret = region_open_existing( filename, 2, -3, &region );
+  assert( !ret );
+  FILE* fptr = fopen( filename, "rb" );
+  assert( !fptr );
+  ret = region_open( filename, 2, -3, &region );
+  assert( ret );
+  assert( _file_sz( filename ) == REGION_SECTOR_SZ ); // just the header
+  for ( int i = 0; i < 9; i++ ) {
+    ret = region_save_chunk( &region, i % 3, i / 3, &chunks[i] );
+    assert( ret );
+  }
+  assert( !region_has_chunk( &region, 3, 0 ) && !region_has_chunk( &region, REGION_CHUNKS_W - 1, REGION_CHUNKS_W - 1 ) );
+  assert( 0 == region_n_garbage_sectors( &region ) );
+  region_close( &region );
+
+  // a region file only opens as the region it was made for
+  ret = region_open( filename, 0, 0, &region );
+  assert( !ret );
+
+  // load one chunk from the middle without touching the others
+  ret = region_open( filename, 2, -3, &region );
+  assert( ret );
+  chunk_t loaded;
+  ret = region_load_chunk( &region, 1, 1, &loaded );
+  assert( ret );
+  assert( _chunks_equal( &loaded, &chunks[4] ) );
+  chunk_t missing;
+  ret = region_load_chunk( &region, 5, 5, &missing );
+  assert( !ret );
+
+  // re-saving one chunk writes only that chunk's sectors and leaves everything else in place
+  const long sz_before = _file_sz( filename );
+  set_block_type_in_chunk( &loaded, 0, CHUNK_Y - 1, 0, BLOCK_TYPE_CRUST );
+  ret = region_save_chunk( &region, 1, 1, &loaded );
+  assert( ret );
+  const long payload_sectors = ( CHUNK_SAVE_MAX_BYTES + REGION_SECTOR_SZ - 1 ) / REGION_SECTOR_SZ;
+  assert( _file_sz( filename ) - sz_before <= payload_sectors * REGION_SECTOR_SZ );
+  assert( region_n_garbage_sectors( &region ) > 0 );
+  // saving it over and over reuses the sectors each previous version leaves free rather than growing the file
+  const long sz_resaved = _file_sz( filename );
+  for ( int i = 0; i < 20; i++ ) {
+    set_block_type_in_chunk( &loaded, 0, CHUNK_Y - 1, 0, i % 2 ? BLOCK_TYPE_CRUST : BLOCK_TYPE_AIR );
+    ret = region_save_chunk( &region, 1, 1, &loaded );
+    assert( ret );
+  }
+  assert( _file_sz( filename ) <= sz_resaved + payload_sectors * REGION_SECTOR_SZ );
+  assert( region_n_garbage_sectors( &region ) <= 2 * (uint32_t)payload_sectors );
+  region_close( &region );
+
+  ret = region_open( filename, 2, -3, &region );
+  assert( ret );
+  for ( int i = 0; i < 9; i++ ) {
+    chunk_t chunk;
+    ret = region_load_chunk( &region, i % 3, i / 3, &chunk );
+    assert( ret );
+    assert( _chunks_equal( &chunk, 4 == i ? &loaded : &chunks[i] ) );
+    chunk_free( &chunk );
+  }
+  region_close( &region );
+
+  // a payload that isn't a chunk is rejected rather than loaded
+  ret = region_open( filename, 2, -3, &region );
+  assert( ret );
+  uint8_t junk[100] = { 0 };
+  ret = region_write_chunk( &region, 0, 0, junk, sizeof( junk ) );
+  assert( ret );
+  chunk_t bad;
+  ret = region_load_chunk( &region, 0, 0, &bad );
+  assert( !ret && !bad.voxels );
+  region_close( &region );
+
+  chunk_free( &loaded );
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+  remove( filename );
+}
+
+// RETURNS the chunk's neighbours among chunks laid out like _terrain_chunks_3x3(), NULL past the edges
+static chunk_neighbours_t _neighbours_3x3( chunk_t* chunks, int cx, int cz ) {
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { NULL } };
+  const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 }, dz[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+  for ( int i = 0; i < 8; i++ ) {
+    const int nx         = cx + dx[i], nz = cz + dz[i];
+    const chunk_t* chunk = nx >= 0 && nx < 3 && nz >= 0 && nz < 3 ? &chunks[nz * 3 + nx] : NULL;
+    if ( i < 4 ) {
+      neighbours.adjacent[i] = chunk;
+    } else {
+      neighbours.diagonal[i - 4] = chunk;
+    }
+  }
+  return neighbours;
+}
+
+/* exports a 3x3 world to binary PLY and GLB and reads them back. the triangles must cover exactly the voxel faces the per-face mesher finds, facing
+out, and the two files must hold the same vertices and triangles */
+static void _test_mesh_export() {
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 1234, chunks );
+  const uint8_t palette_rgb[3][3] = { { 10, 200, 20 }, { 128, 128, 130 }, { 120, 80, 40 } };
+  const char* filenames[2]        = { "test_export.ply", "test_export.glb" };
+  size_t n_expected_faces         = 0, n_vertices_before_dedup = 0;
+  chunk_mesh_arena_t arena        = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+  for ( int format = 0; format < 2; format++ ) {
+    mesh_export_t exporter;
+    bool ret = mesh_export_begin( &exporter, filenames[format], (mesh_export_format_t)format, &palette_rgb[0][0], 3, 1.0f );
+    assert( ret );
+    for ( int i = 0; i < 9; i++ ) {
+      const chunk_neighbours_t neighbours = _neighbours_3x3( chunks, i % 3, i / 3 );
+      chunk_mesh_arena_reset( &arena );
+      chunk_vertex_data_t vertex_data = chunk_gen_vertex_data_in_arena( &arena, &chunks[i], &neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+      ret                             = mesh_export_chunk( &exporter, &vertex_data, ( i % 3 ) * CHUNK_X, 0.0f, ( i / 3 ) * CHUNK_Z );
+      assert( ret );
+      if ( 0 == format ) {
+        n_vertices_before_dedup += vertex_data.n_vertices;
+        chunk_vertex_data_t per_face = chunk_gen_vertex_data( &chunks[i], &neighbours, 0, CHUNK_Y, CHUNK_MESHER_PER_FACE );
+        n_expected_faces += per_face.n_vertices / VOXEL_FACE_VERTS;
+        chunk_free_vertex_data( &per_face );
+      }
+    }
+    ret = mesh_export_end( &exporter );
+    assert( ret );
+  }
+
+  // PLY
+  FILE* fptr = fopen( filenames[0], "rb" );
+  assert( fptr );
+  unsigned int n_vertices = 0, n_triangles = 0;
+  char line[256];
+  while ( fgets( line, sizeof( line ), fptr ) && strcmp( line, "end_header\n" ) != 0 ) {
+    sscanf( line, "element vertex %u", &n_vertices );
+    sscanf( line, "element face %u", &n_triangles );
+  }
+  const long header_sz = ftell( fptr );
+  assert( n_vertices > 0 && n_vertices < n_vertices_before_dedup );
+  assert( _file_sz( filenames[0] ) == header_sz + (long)n_vertices * 27 + (long)n_triangles * 13 );
+  float* ply_vertices   = malloc( (size_t)n_vertices * 6 * sizeof( float ) );
+  uint32_t* ply_indices = malloc( (size_t)n_triangles * 3 * sizeof( uint32_t ) );
+  assert( ply_vertices && ply_indices );
+  for ( unsigned int v = 0; v < n_vertices; v++ ) {
+    uint8_t rgb[3];
+    size_t n_read = fread( &ply_vertices[v * 6], sizeof( float ), 6, fptr ) + fread( rgb, 1, 3, fptr );
+    assert( 9 == n_read );
+    // one of the palette colours given to the exporter, or grey for the crust at the bottom, whose palette index is past them
+    bool known_colour = 128 == rgb[0] && 128 == rgb[1] && 128 == rgb[2];
+    for ( int p = 0; p < 3; p++ ) { known_colour |= 0 == memcmp( rgb, palette_rgb[p], 3 ); }
+    assert( known_colour );
+  }
+  double area = 0.0;
+  for ( unsigned int t = 0; t < n_triangles; t++ ) {
+    uint8_t count = 0;
+    size_t n_read = fread( &count, 1, 1, fptr ) + fread( &ply_indices[t * 3], sizeof( uint32_t ), 3, fptr );
+    assert( 4 == n_read && 3 == count );
+    const float* p[3];
+    for ( int v = 0; v < 3; v++ ) {
+      assert( ply_indices[t * 3 + v] < n_vertices );
+      p[v] = &ply_vertices[ply_indices[t * 3 + v] * 6];
+    }
+    const double e1[3]    = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+    const double e2[3]    = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+    const double cross[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    const double dp       = cross[0] * p[0][3] + cross[1] * p[0][4] + cross[2] * p[0][5];
+    assert( dp > 0.0 ); // counter-clockwise seen from outside, around the face normal
+    area += dp * 0.5;
+  }
+  assert( area == (double)n_expected_faces );
+  fclose( fptr );
+
+  // GLB: the same vertex positions and indices in the BIN chunk
+  fptr = fopen( filenames[1], "rb" );
+  assert( fptr );
+  uint32_t header[5];
+  size_t n_read = fread( header, sizeof( uint32_t ), 5, fptr );
+  assert( 5 == n_read && 0 == memcmp( &header[0], "glTF", 4 ) && 2 == header[1] && 0 == memcmp( &header[4], "JSON", 4 ) );
+  assert( (long)header[2] == _file_sz( filenames[1] ) );
+  char* json = calloc( header[3] + 1, 1 );
+  assert( json );
+  n_read = fread( json, header[3], 1, fptr );
+  assert( 1 == n_read );
+  char expected[64];
+  snprintf( expected, sizeof( expected ), "\"count\":%u,\"type\":\"VEC3\"", n_vertices );
+  assert( strstr( json, expected ) );
+  snprintf( expected, sizeof( expected ), "\"count\":%u,\"type\":\"SCALAR\"", n_triangles * 3 );
+  assert( strstr( json, expected ) );
+  uint32_t bin_header[2];
+  n_read = fread( bin_header, sizeof( uint32_t ), 2, fptr );
+  assert( 2 == n_read && bin_header[0] == n_vertices * 28 + n_triangles * 12 && 0 == memcmp( &bin_header[1], "BIN\0", 4 ) );
+  for ( unsigned int v = 0; v < n_vertices; v++ ) {
+    float pos_normal[6];
+    uint8_t rgba[4];
+    n_read = fread( pos_normal, sizeof( float ), 6, fptr ) + fread( rgba, 1, 4, fptr );
+    assert( 10 == n_read && 0 == memcmp( pos_normal, &ply_vertices[v * 6], sizeof( pos_normal ) ) && 255 == rgba[3] );
+  }
+  for ( unsigned int i = 0; i < n_triangles * 3; i++ ) {
+    uint32_t idx = 0;
+    n_read       = fread( &idx, sizeof( uint32_t ), 1, fptr );
+    assert( 1 == n_read && idx == ply_indices[i] );
+  }
+  fclose( fptr );
+  printf( "export     %5u verts %6u tris | %zu verts before dedup | ply %ld bytes glb %ld bytes\n", n_vertices, n_triangles, n_vertices_before_dedup,
+    _file_sz( filenames[0] ), _file_sz( filenames[1] ) );
+
+  // the triangles' temporary file is gone, and an empty export is still a valid file
+  assert( !fopen( "test_export.ply.triangles.tmp", "rb" ) );
+  for ( int format = 0; format < 2; format++ ) {
+    mesh_export_t exporter;
+    bool ret = mesh_export_begin( &exporter, filenames[format], (mesh_export_format_t)format, NULL, 0, 1.0f );
+    assert( ret );
+    ret = mesh_export_end( &exporter );
+    assert( ret );
+    remove( filenames[format] );
+  }
+
+  free( json );
+  free( ply_vertices );
+  free( ply_indices );
+  chunk_mesh_arena_free( &arena );
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+}
+
+// one edit to a chunk of a 3x3 world, and whether the middle chunk's mesh cache key should change because of it
+typedef struct mesh_cache_edit_t {
+  const char* name;
+  int chunk; // index in the 3x3 world. 4 is the middle
+  int x, y, z;
+  bool light; // change the light there instead of the block
+  bool changes_key;
+} mesh_cache_edit_t;
+
+/* writes the middle chunk of a 3x3 world's meshes to a mesh cache region and reads them back. the key must change with anything the mesher reads -
+the chunk, the neighbours' border columns and the light there, the diagonals' corner columns, and the mesher - but not with anything else */
+static void _test_mesh_cache() {
+  const char* filename = "test.meshes";
+  remove( filename );
+  chunk_t chunks[9];
+  _terrain_chunks_3x3( 99, chunks );
+  const chunk_neighbours_t neighbours = _neighbours_3x3( chunks, 1, 1 );
+
+  chunk_mesh_arena_t arena = ( chunk_mesh_arena_t ){ .packed_ptr = NULL };
+  size_t first_vertex[CHUNK_SECTIONS + 1];
+  uint16_t connectivity[CHUNK_SECTIONS];
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    first_vertex[section] = arena.n_vertices;
+    chunk_gen_vertex_data_in_arena( &arena, &chunks[4], &neighbours, section * CHUNK_SECTION_Y, ( section + 1 ) * CHUNK_SECTION_Y, CHUNK_MESHER_GREEDY );
+    connectivity[section] = chunk_section_connectivity( &chunks[4], section );
+  }
+  first_vertex[CHUNK_SECTIONS] = arena.n_vertices;
+  chunk_vertex_data_t vertex_data[CHUNK_SECTIONS];
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    vertex_data[section] = chunk_mesh_arena_vertex_data( &arena, first_vertex[section], first_vertex[section + 1] - first_vertex[section] );
+  }
+  const uint64_t key = mesh_cache_key( &chunks[4], &neighbours, CHUNK_MESHER_GREEDY );
+
+  region_t region;
+  bool ret = region_open( filename, 0, 0, &region );
+  assert( ret );
+  ret = mesh_cache_write( &region, 1, 1, key, vertex_data, connectivity );
+  assert( ret );
+  region_close( &region );
+
+  ret = region_open_existing( filename, 0, 0, &region );
+  assert( ret );
+  uint8_t* blob = NULL;
+  chunk_vertex_data_t cached[CHUNK_SECTIONS];
+  uint16_t cached_connectivity[CHUNK_SECTIONS];
+  ret = mesh_cache_read( &region, 1, 1, key, &blob, cached, cached_connectivity );
+  assert( ret && blob );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    assert( cached[section].n_vertices == vertex_data[section].n_vertices && cached[section].n_vpacked_comps == VOXEL_VPACKED_COMPS );
+    assert( 0 == memcmp( cached[section].packed_ptr, vertex_data[section].packed_ptr, vertex_data[section].vpacked_buffer_sz ) );
+  }
+  assert( 0 == memcmp( cached_connectivity, connectivity, sizeof( connectivity ) ) );
+  free( blob );
+  // a different key, or a chunk with no blob, is a miss
+  ret = mesh_cache_read( &region, 1, 1, key + 1, &blob, cached, cached_connectivity );
+  assert( !ret && !blob );
+  ret = mesh_cache_read( &region, 2, 1, key, &blob, cached, cached_connectivity );
+  assert( !ret && !blob );
+  const long blob_sz = (long)mesh_cache_blob_size( vertex_data );
+  region_close( &region );
+
+  // the same voxels compressed or not are the same key. the other mesher or a missing neighbour isn't
+  chunk_t copy = chunk_copy( &chunks[4] );
+  if ( copy.rle ) {
+    chunk_decompress( &copy );
+  } else {
+    chunk_compress( &copy );
+  }
+  assert( mesh_cache_key( &copy, &neighbours, CHUNK_MESHER_GREEDY ) == key );
+  chunk_free( &copy );
+  assert( mesh_cache_key( &chunks[4], &neighbours, CHUNK_MESHER_PER_FACE ) != key );
+  chunk_neighbours_t fewer = neighbours;
+  fewer.diagonal[3]        = NULL;
+  assert( mesh_cache_key( &chunks[4], &fewer, CHUNK_MESHER_GREEDY ) != key );
+  assert( mesh_cache_key( &chunks[4], NULL, CHUNK_MESHER_GREEDY ) != key );
+
+  // copies of just the neighbours' border and corner columns, as mesh jobs take, mesh and key the same as the whole chunks
+  const int border_min_x[4] = { CHUNK_X - 1, 0, 0, 0 }, border_max_x[4] = { CHUNK_X - 1, 0, CHUNK_X - 1, CHUNK_X - 1 };
+  const int border_min_z[4] = { 0, 0, CHUNK_Z - 1, 0 }, border_max_z[4] = { CHUNK_Z - 1, CHUNK_Z - 1, CHUNK_Z - 1, 0 };
+  const int corner_x[4] = { CHUNK_X - 1, 0, CHUNK_X - 1, 0 }, corner_z[4] = { CHUNK_Z - 1, CHUNK_Z - 1, 0, 0 };
+  chunk_t adjacent_columns[4], diagonal_columns[4];
+  chunk_neighbours_t columns = neighbours;
+  size_t columns_bytes = 0, full_bytes = 0;
+  for ( int i = 0; i < 4; i++ ) {
+    adjacent_columns[i] = chunk_copy_columns( neighbours.adjacent[i], border_min_x[i], border_min_z[i], border_max_x[i], border_max_z[i] );
+    diagonal_columns[i] = chunk_copy_columns( neighbours.diagonal[i], corner_x[i], corner_z[i], corner_x[i], corner_z[i] );
+    columns.adjacent[i] = &adjacent_columns[i];
+    columns.diagonal[i] = &diagonal_columns[i];
+    columns_bytes += chunk_resident_bytes( &adjacent_columns[i] ) + chunk_resident_bytes( &diagonal_columns[i] );
+    full_bytes += chunk_resident_bytes( neighbours.adjacent[i] ) + chunk_resident_bytes( neighbours.diagonal[i] );
+  }
+  assert( mesh_cache_key( &chunks[4], &columns, CHUNK_MESHER_GREEDY ) == key );
+  const size_t n_arena_vertices = arena.n_vertices;
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const size_t first = arena.n_vertices;
+    chunk_gen_vertex_data_in_arena( &arena, &chunks[4], &columns, section * CHUNK_SECTION_Y, ( section + 1 ) * CHUNK_SECTION_Y, CHUNK_MESHER_GREEDY );
+    const chunk_vertex_data_t ref = chunk_mesh_arena_vertex_data( &arena, first_vertex[section], first_vertex[section + 1] - first_vertex[section] );
+    const chunk_vertex_data_t got = chunk_mesh_arena_vertex_data( &arena, first, arena.n_vertices - first );
+    assert( got.n_vertices == ref.n_vertices && 0 == memcmp( got.packed_ptr, ref.packed_ptr, ref.vpacked_buffer_sz ) );
+  }
+  assert( arena.n_vertices == 2 * n_arena_vertices );
+  for ( int i = 0; i < 4; i++ ) {
+    chunk_free( &adjacent_columns[i] );
+    chunk_free( &diagonal_columns[i] );
+  }
+  assert( columns_bytes * 4 < full_bytes );
+
+  const mesh_cache_edit_t edits[] = {
+    { "voxel", 4, 8, 100, 8, false, true },
+    { "light", 4, 8, 200, 8, true, true },
+    { "-x border", 3, CHUNK_X - 1, 60, 5, false, true },
+    { "-x border light", 3, CHUNK_X - 1, 200, 5, true, true },
+    { "+z border", 7, 9, 30, 0, false, true },
+    { "-x inside", 3, CHUNK_X - 2, 60, 5, false, false },
+    { "-x inside light", 3, 0, 200, 5, true, false },
+    { "-x-z corner", 0, CHUNK_X - 1, 60, CHUNK_Z - 1, false, true },
+    { "-x-z inside", 0, CHUNK_X - 1, 60, CHUNK_Z - 2, false, false },
+    { "+x+z corner", 8, 0, 60, 0, false, true },
+    { "+x+z corner light", 8, 0, 200, 0, true, false }, // only the diagonals' voxels shade corners
+  };
+  const int n_edits = (int)( sizeof( edits ) / sizeof( edits[0] ) );
+  for ( int i = 0; i < n_edits; i++ ) {
+    const mesh_cache_edit_t* edit = &edits[i];
+    chunk_t edited                = chunk_copy( &chunks[edit->chunk] );
+    if ( edit->light ) {
+      const uint8_t light = chunk_get_light( &edited, edit->x, edit->y, edit->z );
+      chunk_set_light( &edited, edit->x, edit->y, edit->z, VOXEL_LIGHT_PACK( VOXEL_LIGHT_SKY( light ), ( VOXEL_LIGHT_BLOCK( light ) + 1 ) % 16 ) );
+    } else {
+      block_type_t type = BLOCK_TYPE_AIR;
+      get_block_type_in_chunk( &edited, edit->x, edit->y, edit->z, &type );
+      set_block_type_in_chunk( &edited, edit->x, edit->y, edit->z, BLOCK_TYPE_AIR == type ? BLOCK_TYPE_STONE : BLOCK_TYPE_AIR );
+    }
+    chunk_neighbours_t edited_neighbours = neighbours;
+    const chunk_t* middle                = 4 == edit->chunk ? &edited : &chunks[4];
+    for ( int n = 0; n < 4; n++ ) {
+      if ( edited_neighbours.adjacent[n] == &chunks[edit->chunk] ) { edited_neighbours.adjacent[n] = &edited; }
+      if ( edited_neighbours.diagonal[n] == &chunks[edit->chunk] ) { edited_neighbours.diagonal[n] = &edited; }
+    }
+    const bool changed = mesh_cache_key( middle, &edited_neighbours, CHUNK_MESHER_GREEDY ) != key;
+    if ( changed != edit->changes_key ) { fprintf( stderr, "mesh cache key %s after edit `%s`\n", changed ? "changed" : "didn't change", edit->name ); }
+    assert( changed == edit->changes_key );
+    chunk_free( &edited );
+  }
+  printf( "mesh cache %5zu verts | blob %ld bytes, region file %ld bytes | %i edits keyed | neighbour columns %zu of %zu bytes\n", n_arena_vertices, blob_sz,
+    _file_sz( filename ), n_edits, columns_bytes, full_bytes );
+
+  chunk_mesh_arena_free( &arena );
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &chunks[i] ); }
+  remove( filename );
+}
+
+static bool _even_slots_only( int slot, void* user_ptr ) {
+  (void)user_ptr;
+  return 0 == slot % 2;
+}
+
+static void _test_chunk_cache() {
+  const int max_slots = 300;
+  chunk_cache_t cache = chunk_cache_alloc( max_slots );
+  // brute force reference. a key per slot, or in_use false
+  int ref_cx[300], ref_cz[300];
+  bool ref_in_use[300] = { false };
+
+  srand( 99 );
+  for ( int step = 0; step < 20000; step++ ) {
+    // small coordinate range, including negatives, so keys collide and get removed and reinserted often
+    const int cx = rand() % 41 - 20, cz = rand() % 41 - 20;
+    int ref_slot = -1;
+    for ( int i = 0; i < max_slots; i++ ) {
+      if ( ref_in_use[i] && ref_cx[i] == cx && ref_cz[i] == cz ) { ref_slot = i; }
+    }
+    assert( chunk_cache_find( &cache, cx, cz ) == ref_slot );
+    if ( ref_slot >= 0 ) {
+      chunk_cache_remove( &cache, ref_slot );
+      ref_in_use[ref_slot] = false;
+      continue;
+    }
+    const int slot = chunk_cache_insert( &cache, cx, cz );
+    if ( cache.n_used == max_slots && slot < 0 ) { continue; } // full
+    assert( slot >= 0 && slot < max_slots && !ref_in_use[slot] );
+    ref_cx[slot] = cx;
+    ref_cz[slot] = cz;
+    ref_in_use[slot] = true;
+  }
+  // every key that went in is still found after all the backward shifts
+  int n_in_use = 0;
+  for ( int i = 0; i < max_slots; i++ ) {
+    if ( !ref_in_use[i] ) { continue; }
+    assert( chunk_cache_find( &cache, ref_cx[i], ref_cz[i] ) == i );
+    n_in_use++;
+  }
+  assert( n_in_use == cache.n_used );
+  chunk_cache_free( &cache );
+
+  // fills up, then hands back removed slots
+  cache = chunk_cache_alloc( 4 );
+  for ( int i = 0; i < 4; i++ ) { assert( chunk_cache_insert( &cache, i, -i ) == i ); }
+  assert( chunk_cache_insert( &cache, 100, 100 ) < 0 );
+  chunk_cache_remove( &cache, 2 );
+  assert( chunk_cache_find( &cache, 2, -2 ) < 0 );
+  assert( chunk_cache_insert( &cache, 100, 100 ) == 2 );
+
+  // least recently used, skipping slots the caller wants to keep
+  chunk_cache_touch( &cache, 0 );
+  assert( chunk_cache_lru_slot( &cache, NULL, NULL ) == 1 );
+  assert( chunk_cache_lru_slot( &cache, _even_slots_only, NULL ) == 2 );
+  chunk_cache_touch( &cache, 2 );
+  assert( chunk_cache_lru_slot( &cache, _even_slots_only, NULL ) == 0 );
+  chunk_cache_free( &cache );
+
+  printf( "chunk cache: ok\n" );
+}
+
+// a wedge opening along +x from the origin of the test, like a frustum seen from above. exact for areas, so a node is in view if any chunk under it is
+static bool _test_quadtree_in_view( int cx, int cz, int size, void* user_ptr ) {
+  (void)user_ptr;
+  // the corner of the area closest to the line z = 0, and whether it's inside x >= |z| - 2
+  const int near_z = cz > 0 ? cz : ( cz + size - 1 < 0 ? cz + size - 1 : 0 );
+  return cx + size - 1 >= abs( near_z ) - 2;
+}
+
+static void _test_chunk_quadtree() {
+  chunk_quadtree_t tree = chunk_quadtree_alloc( 64 ); // small so the pool has to grow
+  // brute force reference. chunk id is the index, coords are random including negative ones and a few far out
+  const int n_chunks = 3000;
+  int ref_cx[3000], ref_cz[3000];
+  bool ref_in[3000];
+  int chunk_ids[3000], ref_ids[3000];
+  float sqdists[3000];
+  int n_in = 0, n_visited = 0, n_found = 0, n_queries = 0;
+
+  srand( 23 );
+  for ( int i = 0; i < n_chunks; i++ ) {
+    ref_in[i] = false;
+    ref_cx[i] = rand() % 200 - 100;
+    ref_cz[i] = rand() % 200 - 100;
+    if ( i % 500 == 0 ) { ref_cx[i] = CHUNK_QUADTREE_HALF_W - 1 - i; } // near the edge of the tree
+    for ( int j = 0; j < i; j++ ) {
+      if ( ref_cx[j] == ref_cx[i] && ref_cz[j] == ref_cz[i] ) {
+        ref_cx[i] = INT32_MIN; // a duplicate. left out
+        break;
+      }
+    }
+  }
+  for ( int step = 0; step < 12000; step++ ) {
+    const int i = rand() % n_chunks;
+    if ( INT32_MIN == ref_cx[i] ) { continue; }
+    if ( ref_in[i] ) {
+      assert( chunk_quadtree_remove( &tree, ref_cx[i], ref_cz[i] ) );
+      assert( !chunk_quadtree_remove( &tree, ref_cx[i], ref_cz[i] ) );
+      n_in--;
+    } else {
+      chunk_quadtree_insert( &tree, ref_cx[i], ref_cz[i], i );
+      n_in++;
+    }
+    ref_in[i] = !ref_in[i];
+    assert( ( n_in > 0 ? tree.nodes[tree.root].n_chunks : 0 ) == n_in );
+    if ( step % 1000 != 999 ) { continue; }
+
+    // in view, in range, and in order of distance from a random camera, like brute force finds after a sort
+    const chunk_quadtree_query_t query = ( chunk_quadtree_query_t ){ .cam_cx = ( rand() % 2000 ) / 10.0f - 100.0f,
+      .cam_cz                                                               = ( rand() % 2000 ) / 10.0f - 100.0f,
+      .max_sqdist                                                           = 70.0f * 70.0f,
+      .is_area_in_view                                                      = step % 2000 == 999 ? _test_quadtree_in_view : NULL };
+    const int n = chunk_quadtree_front_to_back( &tree, &query, chunk_ids, sqdists, n_chunks );
+    int n_ref   = 0;
+    for ( int j = 0; j < n_chunks; j++ ) {
+      if ( !ref_in[j] ) { continue; }
+      const float dx = ref_cx[j] + 0.5f - query.cam_cx, dz = ref_cz[j] + 0.5f - query.cam_cz;
+      if ( dx * dx + dz * dz > query.max_sqdist ) { continue; }
+      if ( query.is_area_in_view && !query.is_area_in_view( ref_cx[j], ref_cz[j], 1, NULL ) ) { continue; }
+      ref_ids[n_ref++] = j;
+    }
+    assert( n == n_ref );
+    for ( int k = 0; k < n; k++ ) {
+      const int j    = chunk_ids[k];
+      const float dx = ref_cx[j] + 0.5f - query.cam_cx, dz = ref_cz[j] + 0.5f - query.cam_cz;
+      assert( ref_in[j] && fabsf( sqdists[k] - ( dx * dx + dz * dz ) ) < 1e-3f ); // not exact, since either side may be a fused multiply-add
+      if ( k > 0 ) { assert( sqdists[k - 1] <= sqdists[k] ); }
+      bool found = false;
+      for ( int r = 0; r < n_ref && !found; r++ ) { found = ref_ids[r] == j; }
+      assert( found );
+    }
+    // and stopping early keeps the nearest
+    if ( n > 10 ) {
+      assert( 10 == chunk_quadtree_front_to_back( &tree, &query, ref_ids, NULL, 10 ) );
+      assert( 0 == memcmp( ref_ids, chunk_ids, 10 * sizeof( int ) ) );
+    }
+    n_found += n;
+    n_queries++;
+    chunk_quadtree_front_to_back( &tree, &query, chunk_ids, sqdists, n_chunks );
+    n_visited += tree.n_nodes_visited;
+  }
+  // removing everything frees every node
+  for ( int i = 0; i < n_chunks; i++ ) {
+    if ( ref_in[i] ) { assert( chunk_quadtree_remove( &tree, ref_cx[i], ref_cz[i] ) ); }
+  }
+  assert( tree.root < 0 && tree.n_free == tree.n_nodes );
+  chunk_quadtree_free( &tree );
+
+  printf( "quadtree   %i chunks in view and range found in order per query | %i nodes visited per query\n", n_found / n_queries, n_visited / n_queries );
+}
+
+// the free list is sorted, never touching, and together with the reference's reserved units covers the capacity exactly
+static void _test_range_alloc_check( const range_alloc_t* alloc, const bool* ref_reserved ) {
+  uint32_t n_free = 0;
+  for ( int i = 0; i < alloc->n_free_ranges; i++ ) {
+    const range_alloc_range_t* range = &alloc->free_ranges[i];
+    assert( range->size > 0 && range->offset + range->size <= alloc->capacity );
+    if ( i > 0 ) { assert( alloc->free_ranges[i - 1].offset + alloc->free_ranges[i - 1].size < range->offset ); }
+    for ( uint32_t unit = range->offset; unit < range->offset + range->size; unit++ ) { assert( !ref_reserved[unit] ); }
+    n_free += range->size;
+  }
+  assert( n_free + alloc->n_reserved == alloc->capacity );
+}
+
+static void _test_range_alloc() {
+  // random mesh-sized reserves and releases against a unit-per-bool reference
+  const uint32_t capacity = 1 << 14;
+  range_alloc_t alloc     = range_alloc_create( capacity );
+  bool* ref_reserved      = calloc( 1 << 15, sizeof( bool ) );
+  uint32_t offsets[256], sizes[256];
+  bool live[256] = { false };
+  int n_failed = 0;
+  float max_fragmentation = 0.0f;
+  assert( ref_reserved );
+
+  srand( 21 );
+  for ( int step = 0; step < 20000; step++ ) {
+    const int i = rand() % 256;
+    if ( live[i] ) {
+      range_alloc_release( &alloc, offsets[i], sizes[i] );
+      for ( uint32_t unit = offsets[i]; unit < offsets[i] + sizes[i]; unit++ ) { ref_reserved[unit] = false; }
+      live[i] = false;
+    } else {
+      sizes[i] = 6 * ( 1 + rand() % 40 ); // whole quads, like section meshes
+      if ( !range_alloc_reserve( &alloc, sizes[i], &offsets[i] ) ) {
+        assert( range_alloc_largest_free( &alloc ) < sizes[i] );
+        n_failed++;
+        continue;
+      }
+      for ( uint32_t unit = offsets[i]; unit < offsets[i] + sizes[i]; unit++ ) {
+        assert( !ref_reserved[unit] );
+        ref_reserved[unit] = true;
+      }
+      live[i] = true;
+    }
+    if ( step % 97 == 0 ) { _test_range_alloc_check( &alloc, ref_reserved ); }
+    const float fragmentation = range_alloc_fragmentation( &alloc );
+    if ( fragmentation > max_fragmentation ) { max_fragmentation = fragmentation; }
+  }
+  _test_range_alloc_check( &alloc, ref_reserved );
+  // releasing the rest merges everything back into one range
+  for ( int i = 0; i < 256; i++ ) {
+    if ( !live[i] ) { continue; }
+    range_alloc_release( &alloc, offsets[i], sizes[i] );
+    for ( uint32_t unit = offsets[i]; unit < offsets[i] + sizes[i]; unit++ ) { ref_reserved[unit] = false; }
+  }
+  assert( 0 == alloc.n_reserved && 1 == alloc.n_free_ranges && capacity == range_alloc_largest_free( &alloc ) );
+  assert( 0.0f == range_alloc_fragmentation( &alloc ) );
+  range_alloc_free( &alloc );
+
+  // a released range is handed straight back for the same size, and best fit takes the smallest hole that fits, not the first
+  alloc = range_alloc_create( 100 );
+  uint32_t a = 0, b = 0, c = 0, d = 0, e = 0, f = 0;
+  assert( range_alloc_reserve( &alloc, 30, &a ) && range_alloc_reserve( &alloc, 10, &b ) && range_alloc_reserve( &alloc, 10, &c ) );
+  assert( range_alloc_reserve( &alloc, 5, &d ) && range_alloc_reserve( &alloc, 10, &e ) );
+  assert( 0 == a && 30 == b && 40 == c && 50 == d && 55 == e ); // 35 free at the end
+  range_alloc_release( &alloc, b, 10 );
+  assert( range_alloc_reserve( &alloc, 10, &f ) && f == b );
+  range_alloc_release( &alloc, a, 30 );
+  range_alloc_release( &alloc, d, 5 );
+  assert( 3 == alloc.n_free_ranges && 35 == range_alloc_largest_free( &alloc ) );
+  assert( range_alloc_reserve( &alloc, 4, &f ) && f == d );  // the 5 hole
+  assert( range_alloc_reserve( &alloc, 20, &f ) && f == a ); // the 30 hole over the bigger 35 at the end
+  assert( !range_alloc_reserve( &alloc, 36, &f ) );
+  // growing extends the free range at the end rather than adding another
+  range_alloc_grow( &alloc, 200 );
+  assert( 3 == alloc.n_free_ranges && range_alloc_reserve( &alloc, 135, &f ) && 65 == f );
+  // and adds one when the end was reserved
+  range_alloc_grow( &alloc, 212 );
+  assert( 3 == alloc.n_free_ranges && range_alloc_reserve( &alloc, 12, &f ) && 200 == f );
+  // the holes left between b, c and e merge with their neighbours as those go
+  range_alloc_release( &alloc, c, 10 );
+  range_alloc_release( &alloc, e, 10 );
+  range_alloc_release( &alloc, b, 10 );
+  assert( 2 == alloc.n_free_ranges && 30 == range_alloc_largest_free( &alloc ) ); // 20-50 and 54-65
+  range_alloc_free( &alloc );
+  free( ref_reserved );
+
+  printf( "range alloc: %i reserves didn't fit, worst fragmentation %.0f%%, ok\n", n_failed, max_fragmentation * 100.0f );
+}
+
+/* 3x3 chunks of terrain with tunnels carved through it for the visibility and ray cast tests. chunk (cx,cz) is at chunks[cz * 3 + cx].
+voxel coords run across all 9 chunks and voxel x spans x..x+1 */
+typedef struct test_world_t {
+  chunk_t chunks[9];
+  uint16_t connectivity[9 * CHUNK_SECTIONS];
+  double eye[3], fwd[3];
+  bool use_fwd; // only look at things in front of the eye
+} test_world_t;
+
+static bool _test_world_is_air( const test_world_t* world, int x, int y, int z ) {
+  if ( x < 0 || x >= 3 * CHUNK_X || z < 0 || z >= 3 * CHUNK_Z ) { return false; }
+  block_type_t block_type = BLOCK_TYPE_AIR;
+  if ( !get_block_type_in_chunk( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, &block_type ) ) { return false; }
+  return BLOCK_TYPE_AIR == block_type;
+}
+
+static void _test_world_set( test_world_t* world, int x, int y, int z, block_type_t type ) {
+  if ( x < 0 || x >= 3 * CHUNK_X || z < 0 || z >= 3 * CHUNK_Z ) { return; }
+  set_block_type_in_chunk( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, type );
+}
+
+// tunnel_start is set to a voxel in the middle chunk inside the first tunnel
+static test_world_t* _test_world_alloc( int* tunnel_start ) {
+  test_world_t* world = calloc( 1, sizeof( test_world_t ) );
+  assert( world );
+  _terrain_chunks_3x3( 21, world->chunks );
+  // the valleys are filled in so that the tunnels are well underground
+  for ( int y = 1; y < 64; y++ ) {
+    for ( int z = 0; z < 3 * CHUNK_Z; z++ ) {
+      for ( int x = 0; x < 3 * CHUNK_X; x++ ) {
+        if ( _test_world_is_air( world, x, y, z ) ) { _test_world_set( world, x, y, z, BLOCK_TYPE_STONE ); }
+      }
+    }
+  }
+  // tunnels wandering through the ground, the first one starting in the middle chunk
+  srand( 5 );
+  for ( int tunnel = 0; tunnel < 6; tunnel++ ) {
+    int p[3] = { rand() % ( 3 * CHUNK_X ), 10 + rand() % 40, rand() % ( 3 * CHUNK_Z ) };
+    if ( 0 == tunnel ) {
+      p[0] = CHUNK_X + CHUNK_X / 2;
+      p[2] = CHUNK_Z + CHUNK_Z / 2;
+      memcpy( tunnel_start, p, sizeof( p ) );
+    }
+    for ( int i = 0; i < 120; i++ ) {
+      for ( int dy = -1; dy <= 1; dy++ ) {
+        for ( int dz = -1; dz <= 1; dz++ ) {
+          for ( int dx = -1; dx <= 1; dx++ ) { _test_world_set( world, p[0] + dx, p[1] + dy, p[2] + dz, BLOCK_TYPE_AIR ); }
+        }
+      }
+      const int axis = rand() % 3;
+      p[axis] += rand() % 2 ? 1 : -1;
+      p[1] = p[1] < 2 ? 2 : ( p[1] > 54 ? 54 : p[1] );
+    }
+  }
+  for ( int i = 0; i < 9; i++ ) {
+    for ( int s = 0; s < CHUNK_SECTIONS; s++ ) { world->connectivity[i * CHUNK_SECTIONS + s] = chunk_section_connectivity( &world->chunks[i], s ); }
+  }
+  return world;
+}
+
+static void _test_world_free( test_world_t* world ) {
+  for ( int i = 0; i < 9; i++ ) { chunk_free( &world->chunks[i] ); }
+  free( world );
+}
+
+static int _vis_chunk_id_at( int cx, int cz, void* user_ptr ) {
+  (void)user_ptr;
+  return ( cx >= 0 && cx < 3 && cz >= 0 && cz < 3 ) ? cz * 3 + cx : -1;
+}
+
+static bool _vis_is_in_front( const test_world_t* world, double x, double y, double z ) {
+  return ( x - world->eye[0] ) * world->fwd[0] + ( y - world->eye[1] ) * world->fwd[1] + ( z - world->eye[2] ) * world->fwd[2] >= 0.0;
+}
+
+// a half-space instead of a frustum. in view if any corner of the section is in front of the eye
+static bool _vis_is_section_in_view( int cx, int sy, int cz, void* user_ptr ) {
+  const test_world_t* world = (const test_world_t*)user_ptr;
+  if ( !world->use_fwd ) { return true; }
+  for ( int corner = 0; corner < 8; corner++ ) {
+    const double x = ( cx + ( corner & 1 ) ) * CHUNK_X, y = ( sy + ( corner >> 1 & 1 ) ) * CHUNK_SECTION_Y, z = ( cz + ( corner >> 2 & 1 ) ) * CHUNK_Z;
+    if ( _vis_is_in_front( world, x, y, z ) ) { return true; }
+  }
+  return false;
+}
+
+// voxel walk from the eye to the centre of voxel t. RETURNS true if every voxel on the way is air
+static bool _vis_line_of_sight( const test_world_t* world, int tx, int ty, int tz ) {
+  const int target[3] = { tx, ty, tz };
+  int v[3], step[3], n_steps = 0;
+  double t_max[3], t_delta[3];
+  for ( int a = 0; a < 3; a++ ) {
+    v[a]             = (int)floor( world->eye[a] );
+    const double dir = target[a] + 0.5 - world->eye[a];
+    step[a]          = dir > 0.0 ? 1 : ( dir < 0.0 ? -1 : 0 );
+    t_delta[a]       = step[a] ? fabs( 1.0 / dir ) : INFINITY;
+    t_max[a]         = step[a] > 0 ? ( v[a] + 1 - world->eye[a] ) * t_delta[a] : ( step[a] < 0 ? ( world->eye[a] - v[a] ) * t_delta[a] : INFINITY );
+    n_steps += abs( target[a] - v[a] );
+  }
+  for ( int i = 0; i < n_steps; i++ ) {
+    const int a = t_max[0] < t_max[1] ? ( t_max[0] < t_max[2] ? 0 : 2 ) : ( t_max[1] < t_max[2] ? 1 : 2 );
+    v[a] += step[a];
+    t_max[a] += t_delta[a];
+    if ( !_test_world_is_air( world, v[0], v[1], v[2] ) ) { return false; }
+  }
+  return v[0] == tx && v[1] == ty && v[2] == tz;
+}
+
+static void _vis_mark_section( uint32_t* visible, int x, int y, int z ) { visible[( z / CHUNK_Z ) * 3 + x / CHUNK_X] |= 1u << ( y / CHUNK_SECTION_Y ); }
+
+/* brute force. casts a ray from the eye to every air voxel next to a solid one. the voxel's section is visible if the ray gets there, and so are the
+sections of the solid voxels beside it whose faces point back towards the eye */
+static int _vis_reference( const test_world_t* world, uint32_t* visible ) {
+  memset( visible, 0, 9 * sizeof( uint32_t ) );
+  _vis_mark_section( visible, (int)world->eye[0], (int)world->eye[1], (int)world->eye[2] );
+  const int d[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < 3 * CHUNK_Z; z++ ) {
+      for ( int x = 0; x < 3 * CHUNK_X; x++ ) {
+        if ( !_test_world_is_air( world, x, y, z ) ) { continue; }
+        int solid_mask = 0;
+        for ( int n = 0; n < 6; n++ ) {
+          const int nx = x + d[n][0], ny = y + d[n][1], nz = z + d[n][2];
+          if ( ny >= 0 && ny < CHUNK_Y && nx >= 0 && nx < 3 * CHUNK_X && nz >= 0 && nz < 3 * CHUNK_Z && !_test_world_is_air( world, nx, ny, nz ) ) {
+            solid_mask |= 1 << n;
+          }
+        }
+        if ( !solid_mask ) { continue; }
+        if ( world->use_fwd && !_vis_is_in_front( world, x + 0.5, y + 0.5, z + 0.5 ) ) { continue; }
+        if ( !_vis_line_of_sight( world, x, y, z ) ) { continue; }
+        _vis_mark_section( visible, x, y, z );
+        for ( int n = 0; n < 6; n++ ) {
+          if ( !( solid_mask >> n & 1 ) ) { continue; }
+          // centre of the shared face, and whether the eye is on this voxel's side of it
+          const double face[3] = { x + 0.5 + d[n][0] * 0.5, y + 0.5 + d[n][1] * 0.5, z + 0.5 + d[n][2] * 0.5 };
+          const int a          = n / 2;
+          if ( ( d[n][a] > 0 ) != ( world->eye[a] < face[a] ) ) { continue; }
+          if ( world->use_fwd && !_vis_is_in_front( world, face[0], face[1], face[2] ) ) { continue; }
+          _vis_mark_section( visible, x + d[n][0], y + d[n][1], z + d[n][2] );
+        }
+      }
+    }
+  }
+  int n_visible = 0;
+  for ( int i = 0; i < 9; i++ ) {
+    for ( int s = 0; s < CHUNK_SECTIONS; s++ ) { n_visible += visible[i] >> s & 1; }
+  }
+  return n_visible;
+}
+
+static void _test_visibility_search( const char* name, test_world_t* world, chunk_visibility_t* vis ) {
+  assert( _test_world_is_air( world, (int)world->eye[0], (int)world->eye[1], (int)world->eye[2] ) );
+
+  const chunk_visibility_query_t query = ( chunk_visibility_query_t ){ .cam_cx = (int)world->eye[0] / CHUNK_X,
+    .cam_sy                                                                   = (int)world->eye[1] / CHUNK_SECTION_Y,
+    .cam_cz                                                                   = (int)world->eye[2] / CHUNK_Z,
+    .n_chunk_ids                                                              = 9,
+    .chunk_id_at                                                              = _vis_chunk_id_at,
+    .is_section_in_view                                                       = _vis_is_section_in_view,
+    .connectivity                                                             = world->connectivity,
+    .user_ptr                                                                 = world };
+  uint32_t found[9], reference[9];
+  const int n_found     = chunk_visibility_search( vis, &query, found );
+  const int n_reference = _vis_reference( world, reference );
+  // conservative. everything a ray can reach is found
+  for ( int i = 0; i < 9; i++ ) { assert( ( found[i] & reference[i] ) == reference[i] ); }
+  assert( n_found >= n_reference );
+  printf( "%-10s visibility search kept %3i of %i sections | line of sight reaches %3i\n", name, n_found, 9 * CHUNK_SECTIONS, n_reference );
+}
+
+static void _test_visibility() {
+  {
+    chunk_t chunk = _empty_chunk();
+    assert( CHUNK_SECTION_ALL_CONNECTED == chunk_section_connectivity( &chunk, 3 ) );
+    // a floor through the middle of section 1 splits it into a top and bottom that don't meet
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &chunk, x, CHUNK_SECTION_Y + 5, z, BLOCK_TYPE_STONE ); }
+    }
+    const uint16_t split = chunk_section_connectivity( &chunk, 1 );
+    assert( !chunk_section_faces_connected( split, 2, 3 ) );
+    assert( chunk_section_faces_connected( split, 0, 1 ) && chunk_section_faces_connected( split, 2, 4 ) && chunk_section_faces_connected( split, 3, 5 ) );
+    assert( CHUNK_SECTION_ALL_CONNECTED == chunk_section_connectivity( &chunk, 0 ) );
+    // then a hole in the floor joins them up again
+    set_block_type_in_chunk( &chunk, 7, CHUNK_SECTION_Y + 5, 9, BLOCK_TYPE_AIR );
+    assert( CHUNK_SECTION_ALL_CONNECTED == chunk_section_connectivity( &chunk, 1 ) );
+    for ( int a = 0; a < 6; a++ ) { assert( !chunk_section_faces_connected( CHUNK_SECTION_ALL_CONNECTED, a, a ) ); }
+    chunk_free( &chunk );
+  }
+
+  int tunnel_start[3] = { 0 };
+  test_world_t* world = _test_world_alloc( tunnel_start );
+  chunk_visibility_t vis = ( chunk_visibility_t ){ .n_chunk_ids = 0 };
+  // inside a tunnel. fractions keep rays off voxel edges
+  world->eye[0] = tunnel_start[0] + 0.37, world->eye[1] = tunnel_start[1] + 0.61, world->eye[2] = tunnel_start[2] + 0.43;
+  _test_visibility_search( "tunnel", world, &vis );
+  world->use_fwd = true;
+  world->fwd[0] = 1.0, world->fwd[1] = -0.2, world->fwd[2] = 0.3;
+  _test_visibility_search( "tunnel fwd", world, &vis );
+  // above the hills in the middle chunk, looking down at an angle
+  world->use_fwd = false;
+  world->eye[1]  = 0.61;
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    if ( _test_world_is_air( world, (int)world->eye[0], y, (int)world->eye[2] ) ) { continue; }
+    world->eye[1] = y + 4.61;
+  }
+  _test_visibility_search( "surface", world, &vis );
+  world->use_fwd = true;
+  world->fwd[0] = -0.5, world->fwd[1] = -0.7, world->fwd[2] = 0.5;
+  _test_visibility_search( "surface fwd", world, &vis );
+  chunk_visibility_free( &vis );
+
+  _test_world_free( world );
+}
+
+static const chunk_t* _raycast_chunk_at( int cx, int cz, int* chunk_id, void* user_ptr ) {
+  test_world_t* world = (test_world_t*)user_ptr;
+  *chunk_id           = _vis_chunk_id_at( cx, cz, NULL );
+  return *chunk_id >= 0 ? &world->chunks[*chunk_id] : NULL;
+}
+
+// slab test. RETURNS the distance along the normalised ray to where it goes into voxel v, or INFINITY if it misses or starts inside it
+static double _ray_voxel_entry( const double* o, const double* d, const int* v, int* face_idx ) {
+  double t_in = -INFINITY, t_out = INFINITY;
+  for ( int a = 0; a < 3; a++ ) {
+    if ( 0.0 == d[a] ) {
+      if ( o[a] < v[a] || o[a] >= v[a] + 1 ) { return INFINITY; }
+      continue;
+    }
+    double t0 = ( v[a] - o[a] ) / d[a], t1 = ( v[a] + 1 - o[a] ) / d[a];
+    if ( t0 > t1 ) {
+      const double tmp = t0;
+      t0 = t1, t1 = tmp;
+    }
+    if ( t0 > t_in ) {
+      t_in      = t0;
+      *face_idx = a * 2 + ( d[a] > 0.0 ? 0 : 1 );
+    }
+    t_out = t1 < t_out ? t1 : t_out;
+  }
+  return ( t_in <= t_out && t_in > 0.0 ) ? t_in : INFINITY;
+}
+
+static void _test_raycast() {
+  int tunnel_start[3] = { 0 };
+  test_world_t* world = _test_world_alloc( tunnel_start );
+
+  // against the nearest solid voxel any slab test finds along the ray
+  srand( 17 );
+  const float max_dist = 24.0f;
+  int n_hits = 0, n_rays = 200;
+  for ( int ray = 0; ray < n_rays; ray++ ) {
+    double o[3], d[3];
+    do {
+      o[0] = 3.0 * CHUNK_X * rand() / RAND_MAX, o[1] = 80.0 * rand() / RAND_MAX, o[2] = 3.0 * CHUNK_Z * rand() / RAND_MAX;
+    } while ( !_test_world_is_air( world, (int)o[0], (int)o[1], (int)o[2] ) );
+    double len = 0.0;
+    while ( len < 0.1 ) {
+      for ( int a = 0; a < 3; a++ ) { d[a] = 2.0 * rand() / RAND_MAX - 1.0; }
+      len = sqrt( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+    }
+    for ( int a = 0; a < 3; a++ ) { d[a] /= len; }
+
+    voxel_raycast_hit_t hit;
+    const bool ret = voxel_raycast( ( vec3 ){ (float)o[0], (float)o[1], (float)o[2] }, ( vec3 ){ (float)d[0], (float)d[1], (float)d[2] }, max_dist,
+      _raycast_chunk_at, world, &hit );
+
+    double nearest_t = INFINITY;
+    int nearest[3] = { 0 }, nearest_face = -1;
+    int mins[3], maxs[3];
+    for ( int a = 0; a < 3; a++ ) {
+      mins[a] = (int)floor( fmin( o[a], o[a] + d[a] * max_dist ) );
+      maxs[a] = (int)floor( fmax( o[a], o[a] + d[a] * max_dist ) );
+    }
+    mins[1] = mins[1] < 0 ? 0 : mins[1];
+    maxs[1] = maxs[1] >= CHUNK_Y ? CHUNK_Y - 1 : maxs[1];
+    for ( int y = mins[1]; y <= maxs[1]; y++ ) {
+      for ( int z = mins[2]; z <= maxs[2]; z++ ) {
+        for ( int x = mins[0]; x <= maxs[0]; x++ ) {
+          if ( x < 0 || x >= 3 * CHUNK_X || z < 0 || z >= 3 * CHUNK_Z || _test_world_is_air( world, x, y, z ) ) { continue; }
+          const int v[3] = { x, y, z };
+          int face_idx   = -1;
+          const double t = _ray_voxel_entry( o, d, v, &face_idx );
+          if ( t > max_dist || t >= nearest_t ) { continue; }
+          nearest_t = t;
+          memcpy( nearest, v, sizeof( v ) );
+          nearest_face = face_idx;
+        }
+      }
+    }
+    assert( ret == ( nearest_t <= max_dist ) );
+    if ( !ret ) { continue; }
+    n_hits++;
+    assert( hit.chunk_id == _vis_chunk_id_at( hit.cx, hit.cz, NULL ) );
+    assert( hit.cx * CHUNK_X + hit.x == nearest[0] && hit.y == nearest[1] && hit.cz * CHUNK_Z + hit.z == nearest[2] );
+    assert( hit.face_idx == nearest_face );
+    assert( fabs( hit.dist - nearest_t ) < 1e-3 );
+  }
+
+  // from above the world straight down onto the top of the middle column
+  voxel_raycast_hit_t hit;
+  bool ret = voxel_raycast( ( vec3 ){ 24.5f, 300.0f, 24.5f }, ( vec3 ){ 0.0f, -1.0f, 0.0f }, 400.0f, _raycast_chunk_at, world, &hit );
+  assert( ret && 4 == hit.chunk_id && 8 == hit.x && 8 == hit.z && 3 == hit.face_idx );
+  assert( hit.y == world->chunks[4].heightmap[8 * CHUNK_X + 8] );
+  // away from the world, and up into the sky
+  ret = voxel_raycast( ( vec3 ){ -0.5f, 20.0f, 24.5f }, ( vec3 ){ -1.0f, 0.0f, 0.0f }, 100.0f, _raycast_chunk_at, world, &hit );
+  assert( !ret );
+  ret = voxel_raycast( ( vec3 ){ 24.5f, 200.0f, 24.5f }, ( vec3 ){ 0.1f, 1.0f, 0.0f }, 1000.0f, _raycast_chunk_at, world, &hit );
+  assert( !ret );
+
+  printf( "raycast    %i of %i random rays hit | all match the nearest voxel by brute force\n", n_hits, n_rays );
+  _test_world_free( world );
+}
+
+typedef struct light_test_t {
+  test_world_t* world;
+  uint32_t sections_changed[9]; // reported by the engine since last cleared
+  bool loaded[9];
+} light_test_t;
+
+static chunk_t* _light_test_chunk_at( int cx, int cz, void* user_ptr ) {
+  light_test_t* test = user_ptr;
+  return ( cx >= 0 && cx < 3 && cz >= 0 && cz < 3 && test->loaded[cz * 3 + cx] ) ? &test->world->chunks[cz * 3 + cx] : NULL;
+}
+
+static void _light_test_sections_changed( int cx, int cz, uint32_t section_mask, void* user_ptr ) {
+  light_test_t* test = user_ptr;
+  if ( cx >= 0 && cx < 3 && cz >= 0 && cz < 3 ) { test->sections_changed[cz * 3 + cx] |= section_mask; }
+}
+
+#define LIGHT_TEST_W ( 3 * CHUNK_X )
+#define LIGHT_TEST_N ( (size_t)LIGHT_TEST_W * CHUNK_Y * LIGHT_TEST_W )
+
+static size_t _light_test_idx( int x, int y, int z ) { return ( (size_t)y * LIGHT_TEST_W + z ) * LIGHT_TEST_W + x; }
+
+static void _light_test_snapshot( const test_world_t* world, uint8_t* light ) {
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < LIGHT_TEST_W; z++ ) {
+      for ( int x = 0; x < LIGHT_TEST_W; x++ ) {
+        light[_light_test_idx( x, y, z )] = chunk_get_light( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z );
+      }
+    }
+  }
+}
+
+// from scratch: full sky light down each column until it hits something, lamps, then a flood fill of each channel until nothing gets any brighter
+static void _light_test_reference( const test_world_t* world, uint8_t* light ) {
+  memset( light, 0, LIGHT_TEST_N );
+  size_t n_queued = 0, queue_max = LIGHT_TEST_N;
+  uint32_t* queue = malloc( queue_max * sizeof( uint32_t ) );
+  assert( queue );
+  for ( int channel = 0; channel < 2; channel++ ) {
+    const int shift = 0 == channel ? 4 : 0;
+    n_queued        = 0;
+    for ( int z = 0; z < LIGHT_TEST_W; z++ ) {
+      for ( int x = 0; x < LIGHT_TEST_W; x++ ) {
+        for ( int y = CHUNK_Y - 1; y >= 0 && 0 == channel && _test_world_is_air( world, x, y, z ); y-- ) {
+          light[_light_test_idx( x, y, z )] |= VOXEL_LIGHT_MAX << shift;
+          queue[n_queued++] = (uint32_t)_light_test_idx( x, y, z );
+        }
+        for ( int y = 0; y < CHUNK_Y && 1 == channel; y++ ) {
+          block_type_t type = BLOCK_TYPE_AIR;
+          get_block_type_in_chunk( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, &type );
+          if ( !block_type_light_emission( type ) ) { continue; }
+          light[_light_test_idx( x, y, z )] |= block_type_light_emission( type ) << shift;
+          queue[n_queued++] = (uint32_t)_light_test_idx( x, y, z );
+        }
+      }
+    }
+    for ( size_t head = 0; head < n_queued; head++ ) {
+      const int x = queue[head] % LIGHT_TEST_W, z = ( queue[head] / LIGHT_TEST_W ) % LIGHT_TEST_W, y = queue[head] / ( LIGHT_TEST_W * LIGHT_TEST_W );
+      const int level = ( light[queue[head]] >> shift ) & 0xF;
+      const int step[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+      for ( int face = 0; face < 6; face++ ) {
+        const int nx = x + step[face][0], ny = y + step[face][1], nz = z + step[face][2];
+        if ( ny < 0 || ny >= CHUNK_Y || !_test_world_is_air( world, nx, ny, nz ) ) { continue; }
+        const int spread = ( 0 == channel && 2 == face && VOXEL_LIGHT_MAX == level ) ? level : level - 1;
+        uint8_t* neighbour = &light[_light_test_idx( nx, ny, nz )];
+        if ( spread <= ( ( *neighbour >> shift ) & 0xF ) ) { continue; }
+        *neighbour = (uint8_t)( ( *neighbour & ~( 0xF << shift ) ) | spread << shift );
+        if ( n_queued >= queue_max ) {
+          queue_max *= 2;
+          queue = realloc( queue, queue_max * sizeof( uint32_t ) );
+          assert( queue );
+        }
+        queue[n_queued++] = (uint32_t)_light_test_idx( nx, ny, nz );
+      }
+    }
+  }
+  free( queue );
+}
+
+static void _light_test_matches_reference( const test_world_t* world, uint8_t* light, uint8_t* reference ) {
+  _light_test_snapshot( world, light );
+  _light_test_reference( world, reference );
+  assert( 0 == memcmp( light, reference, LIGHT_TEST_N ) );
+}
+
+// sets a voxel and tells the engine. RETURNS the number of sections the engine reported, after checking they cover every voxel whose light changed
+/* checks that every section with a face next to a voxel whose light went from before to after was reported as changed
+RETURNS the number of sections reported */
+static int _light_test_sections_reported( light_test_t* test, const uint8_t* before, const uint8_t* after ) {
+  for ( size_t i = 0; i < LIGHT_TEST_N; i++ ) {
+    if ( before[i] == after[i] ) { continue; }
+    const int vx = i % LIGHT_TEST_W, vz = ( i / LIGHT_TEST_W ) % LIGHT_TEST_W, vy = (int)( i / ( LIGHT_TEST_W * LIGHT_TEST_W ) );
+    // the faces around the voxel, which may be over a section or chunk border
+    const int step[7][3] = { { 0, 0, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    for ( int s = 0; s < 7; s++ ) {
+      const int nx = vx + step[s][0], ny = vy + step[s][1], nz = vz + step[s][2];
+      if ( nx < 0 || nx >= LIGHT_TEST_W || ny < 0 || ny >= CHUNK_Y || nz < 0 || nz >= LIGHT_TEST_W ) { continue; }
+      assert( test->sections_changed[( nz / CHUNK_Z ) * 3 + nx / CHUNK_X] & ( 1u << ( ny / CHUNK_SECTION_Y ) ) );
+    }
+  }
+  int n_sections = 0;
+  for ( int i = 0; i < 9; i++ ) {
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { n_sections += ( test->sections_changed[i] >> section ) & 1; }
+  }
+  return n_sections;
+}
+
+static int _light_test_edit( light_engine_t* engine, light_test_t* test, int x, int y, int z, block_type_t type, uint8_t* before, uint8_t* after ) {
+  _light_test_snapshot( test->world, before );
+  if ( !set_block_type_in_chunk( &test->world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, type ) ) { return 0; }
+  memset( test->sections_changed, 0, sizeof( test->sections_changed ) );
+  light_block_changed( engine, x, y, z );
+  _light_test_snapshot( test->world, after );
+  return _light_test_sections_reported( test, before, after );
+}
+
+// sets every voxel in the box from..to inclusive to type, then updates light for all of them at once. RETURNS the sections reported
+static int _light_test_box_edit(
+  light_engine_t* engine, light_test_t* test, const int* from, const int* to, block_type_t type, uint8_t* before, uint8_t* after ) {
+  _light_test_snapshot( test->world, before );
+  const int n_max = ( to[0] - from[0] + 1 ) * ( to[1] - from[1] + 1 ) * ( to[2] - from[2] + 1 );
+  int* xyz        = malloc( n_max * 3 * sizeof( int ) );
+  assert( xyz );
+  int n_changed = 0;
+  for ( int y = from[1]; y <= to[1]; y++ ) {
+    for ( int z = from[2]; z <= to[2]; z++ ) {
+      for ( int x = from[0]; x <= to[0]; x++ ) {
+        if ( !set_block_type_in_chunk( &test->world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, type ) ) { continue; }
+        xyz[n_changed * 3]     = x;
+        xyz[n_changed * 3 + 1] = y;
+        xyz[n_changed * 3 + 2] = z;
+        n_changed++;
+      }
+    }
+  }
+  memset( test->sections_changed, 0, sizeof( test->sections_changed ) );
+  light_blocks_changed( engine, xyz, n_changed );
+  free( xyz );
+  _light_test_snapshot( test->world, after );
+  return _light_test_sections_reported( test, before, after );
+}
+
+static void _test_light() {
+  int tunnel_start[3] = { 0 };
+  light_test_t test   = ( light_test_t ){ .world = _test_world_alloc( tunnel_start ) };
+  test_world_t* world = test.world;
+  uint8_t* light      = malloc( LIGHT_TEST_N );
+  uint8_t* reference  = malloc( LIGHT_TEST_N );
+  assert( light && reference );
+
+  // lamps in the tunnels before loading
+  srand( 23 );
+  for ( int n_lamps = 0; n_lamps < 6; ) {
+    const int x = rand() % LIGHT_TEST_W, y = 2 + rand() % 54, z = rand() % LIGHT_TEST_W;
+    if ( !_test_world_is_air( world, x, y, z ) ) { continue; }
+    _test_world_set( world, x, y, z, BLOCK_TYPE_LAMP );
+    n_lamps++;
+  }
+  // a room over the border between chunks 3 and 4 with a lamp on the chunk 4 side, so that chunk 3's side is only lit from next door
+  const int rx = CHUNK_X, ry = 60, rz = CHUNK_Z + 8;
+  for ( int x = rx - 4; x <= rx + 3; x++ ) { _test_world_set( world, x, ry, rz, BLOCK_TYPE_AIR ); }
+  _test_world_set( world, rx, ry, rz, BLOCK_TYPE_LAMP );
+  // a roof over the border between chunks 4 and 5. the sky light under it comes in from the sides
+  int roof_y = 0;
+  for ( int z = CHUNK_Z + 4; z < CHUNK_Z + 10; z++ ) {
+    for ( int x = 2 * CHUNK_X - 3; x < 2 * CHUNK_X + 3; x++ ) {
+      const int surface = world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X].heightmap[CHUNK_X * ( z % CHUNK_Z ) + x % CHUNK_X];
+      roof_y            = surface + 3 > roof_y ? surface + 3 : roof_y;
+    }
+  }
+  for ( int z = CHUNK_Z + 4; z < CHUNK_Z + 10; z++ ) {
+    for ( int x = 2 * CHUNK_X - 3; x < 2 * CHUNK_X + 3; x++ ) { _test_world_set( world, x, roof_y, z, BLOCK_TYPE_STONE ); }
+  }
+  // compressed like resident chunks are, then loaded one at a time like streaming does
+  for ( int i = 0; i < 9; i++ ) {
+    chunk_init_sky_light( &world->chunks[i] );
+    chunk_compress( &world->chunks[i] );
+  }
+  light_engine_t engine = ( light_engine_t ){ .chunk_at = _light_test_chunk_at, .sections_changed = _light_test_sections_changed, .user_ptr = &test };
+  const int load_order[9] = { 4, 0, 8, 1, 5, 3, 7, 2, 6 };
+  for ( int i = 0; i < 9; i++ ) {
+    test.loaded[load_order[i]] = true;
+    light_chunk_loaded( &engine, load_order[i] % 3, load_order[i] / 3 );
+  }
+  _light_test_matches_reference( world, light, reference );
+  assert( VOXEL_LIGHT_MAX - 4 == VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[3], rx - 4, ry, rz % CHUNK_Z ) ) );
+  const int under_roof = VOXEL_LIGHT_SKY( chunk_get_light( &world->chunks[5], 0, roof_y - 1, 7 ) );
+  assert( under_roof > 0 && under_roof < VOXEL_LIGHT_MAX );
+
+  // a shaft straight down into the first tunnel lets in full sky light
+  const int tx = tunnel_start[0], ty = tunnel_start[1], tz = tunnel_start[2];
+  assert( 0 == VOXEL_LIGHT_SKY( chunk_get_light( &world->chunks[4], tx % CHUNK_X, ty, tz % CHUNK_Z ) ) );
+  for ( int y = world->chunks[4].heightmap[CHUNK_X * ( tz % CHUNK_Z ) + tx % CHUNK_X]; y > ty; y-- ) {
+    _light_test_edit( &engine, &test, tx, y, tz, BLOCK_TYPE_AIR, light, reference );
+  }
+  assert( VOXEL_LIGHT_SKY( chunk_get_light( &world->chunks[4], tx % CHUNK_X, ty, tz % CHUNK_Z ) ) == VOXEL_LIGHT_MAX );
+  _light_test_matches_reference( world, light, reference );
+
+  // the lamp takes its light from both sides of the border with it when it's removed, and puts it back
+  _light_test_edit( &engine, &test, rx, ry, rz, BLOCK_TYPE_AIR, light, reference );
+  assert( 0 == VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[3], rx - 4, ry, rz % CHUNK_Z ) ) );
+  assert( 0 == VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[4], 3, ry, rz % CHUNK_Z ) ) );
+  _light_test_edit( &engine, &test, rx, ry, rz, BLOCK_TYPE_LAMP, light, reference );
+  assert( VOXEL_LIGHT_MAX - 3 == VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[4], 3, ry, rz % CHUNK_Z ) ) );
+  _light_test_matches_reference( world, light, reference );
+
+  // random digging, building, and lamps around the surface and the tunnels
+  int n_edits = 0, n_sections = 0;
+  while ( n_edits < 100 ) {
+    const int x = rand() % LIGHT_TEST_W, z = rand() % LIGHT_TEST_W;
+    const int surface = world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X].heightmap[CHUNK_X * ( z % CHUNK_Z ) + x % CHUNK_X];
+    const int which = rand() % 10;
+    const int y     = which < 6 ? surface - rand() % 12 : 2 + rand() % ( surface + 2 );
+    if ( y < 1 || y >= CHUNK_Y ) { continue; }
+    const block_type_t type = which < 4 ? BLOCK_TYPE_AIR : ( which < 8 ? BLOCK_TYPE_STONE : BLOCK_TYPE_LAMP );
+    if ( _test_world_is_air( world, x, y, z ) == ( BLOCK_TYPE_AIR == type ) ) { continue; } // digging air or building in rock
+    n_sections += _light_test_edit( &engine, &test, x, y, z, type, light, reference );
+    if ( 0 == ++n_edits % 20 ) { _light_test_matches_reference( world, light, reference ); }
+  }
+  // a lone edit only remeshes the sections around it, not whole chunks
+  assert( n_sections < n_edits * CHUNK_SECTIONS );
+
+  // volume edits relight in one go: a hall dug out across the corner of 4 chunks and open to the sky, a pillar of lamps in it, then half filled back in
+  const int hall_from[3]   = { CHUNK_X - 6, 40, CHUNK_Z - 6 }, hall_to[3] = { CHUNK_X + 5, CHUNK_Y - 1, CHUNK_Z + 5 };
+  const int pillar_from[3] = { CHUNK_X, 41, CHUNK_Z }, pillar_to[3] = { CHUNK_X, 60, CHUNK_Z };
+  const int fill_from[3]   = { CHUNK_X - 6, 40, CHUNK_Z - 6 }, fill_to[3] = { CHUNK_X + 5, 90, CHUNK_Z - 1 };
+  int n_box_sections = _light_test_box_edit( &engine, &test, hall_from, hall_to, BLOCK_TYPE_AIR, light, reference );
+  _light_test_matches_reference( world, light, reference );
+  assert( VOXEL_LIGHT_MAX == VOXEL_LIGHT_SKY( chunk_get_light( &world->chunks[4], 0, 40, 0 ) ) );
+  chunk_t saved = chunk_copy( &world->chunks[4] );
+  n_box_sections += _light_test_box_edit( &engine, &test, pillar_from, pillar_to, BLOCK_TYPE_LAMP, light, reference );
+  _light_test_matches_reference( world, light, reference );
+  n_box_sections += _light_test_box_edit( &engine, &test, fill_from, fill_to, BLOCK_TYPE_STONE, light, reference );
+  _light_test_matches_reference( world, light, reference );
+
+  // reverting the middle chunk to before the lamps takes their light back out of the chunks around it, as reloading a save does
+  assert( VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[3], CHUNK_X - 1, 50, 0 ) ) == VOXEL_LIGHT_MAX - 1 );
+  chunk_free( &world->chunks[4] );
+  world->chunks[4] = saved;
+  chunk_init_sky_light( &world->chunks[4] );
+  memset( test.sections_changed, 0, sizeof( test.sections_changed ) );
+  light_chunk_reloaded( &engine, 1, 1 );
+  assert( VOXEL_LIGHT_BLOCK( chunk_get_light( &world->chunks[3], CHUNK_X - 1, 50, 0 ) ) < VOXEL_LIGHT_MAX - 1 );
+  _light_test_matches_reference( world, light, reference );
+
+  printf( "light      matches a from-scratch flood fill after loading, %i edits, 3 volume edits, and a reload | %.1f sections relit per edit, %i by volume edits\n",
+    n_edits, (double)n_sections / n_edits, n_box_sections );
+  light_engine_free( &engine );
+  free( light );
+  free( reference );
+  _test_world_free( world );
+}
+
+static void _fluid_test_block_changed( int x, int y, int z, void* user_ptr ) {
+  light_test_t* test = user_ptr;
+  test->sections_changed[( z / CHUNK_Z ) * 3 + x / CHUNK_X] |= 1u << ( y / CHUNK_SECTION_Y );
+}
+
+static block_type_t _fluid_test_type( const test_world_t* world, int x, int y, int z ) {
+  block_type_t type = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z, &type );
+  return type;
+}
+
+static int _fluid_test_level( const test_world_t* world, int x, int y, int z ) {
+  return chunk_get_fluid_level( &world->chunks[( z / CHUNK_Z ) * 3 + x / CHUNK_X], x % CHUNK_X, y, z % CHUNK_Z );
+}
+
+// sets a block other than by the sim, like an edit, and tells the engine
+static void _fluid_test_edit( fluid_engine_t* engine, test_world_t* world, int x, int y, int z, block_type_t type ) {
+  _test_world_set( world, x, y, z, type );
+  fluid_block_changed( engine, x, y, z );
+}
+
+// RETURNS the number of ticks until nothing is queued
+static int _fluid_test_settle( fluid_engine_t* engine, int* n_changed, int* n_updates ) {
+  int n_ticks = 0;
+  while ( engine->n_queued > 0 ) {
+    *n_changed += fluid_tick( engine, 1 << 20 );
+    *n_updates += engine->n_updates;
+    assert( ++n_ticks < 10000 ); // never settles
+  }
+  return n_ticks;
+}
+
+#define FLUID_TEST_MAX_Y 24
+
+/* checks that every fluid voxel is where the rules say it should be once nothing is moving, written out again here from fluid.h rather than sharing
+the engine's code: no fluid over air, no air beside fluid that spreads, and every flowing voxel at one more than what feeds it */
+static void _fluid_test_check_settled( const test_world_t* world ) {
+  const block_type_t sources[2] = { BLOCK_TYPE_WATER, BLOCK_TYPE_LAVA }, flowings[2] = { BLOCK_TYPE_WATER_FLOWING, BLOCK_TYPE_LAVA_FLOWING };
+  const int max_levels[2]       = { 7, 3 };
+  const int side_x[4]           = { -1, 1, 0, 0 }, side_z[4] = { 0, 0, -1, 1 };
+  for ( int y = 0; y < FLUID_TEST_MAX_Y; y++ ) {
+    for ( int z = 1; z < LIGHT_TEST_W - 1; z++ ) {
+      for ( int x = 1; x < LIGHT_TEST_W - 1; x++ ) {
+        const block_type_t type = _fluid_test_type( world, x, y, z );
+        const int kind          = ( sources[0] == type || flowings[0] == type ) ? 0 : ( ( sources[1] == type || flowings[1] == type ) ? 1 : -1 );
+        if ( kind < 0 ) { continue; }
+        const block_type_t below = y > 0 ? _fluid_test_type( world, x, y - 1, z ) : BLOCK_TYPE_STONE;
+        assert( BLOCK_TYPE_AIR != below );
+        const int level = flowings[kind] == type ? _fluid_test_level( world, x, y, z ) : 0;
+        if ( flowings[kind] == type ) {
+          const block_type_t above = _fluid_test_type( world, x, y + 1, z );
+          int fed                  = ( sources[kind] == above || flowings[kind] == above ) ? 1 : 0;
+          for ( int side = 0; side < 4 && 1 != fed; side++ ) {
+            const int nx             = x + side_x[side], nz = z + side_z[side];
+            const block_type_t ntype = _fluid_test_type( world, nx, y, nz );
+            const int nlevel         = sources[kind] == ntype ? 0 : ( flowings[kind] == ntype ? _fluid_test_level( world, nx, y, nz ) : -1 );
+            if ( nlevel < 0 || nlevel >= max_levels[kind] ) { continue; }
+            const block_type_t nbelow = y > 0 ? _fluid_test_type( world, nx, y - 1, nz ) : BLOCK_TYPE_STONE;
+            if ( BLOCK_TYPE_AIR == nbelow || sources[kind] == nbelow || flowings[kind] == nbelow ) { continue; } // falls rather than spreading
+            fed = 0 == fed || nlevel + 1 < fed ? nlevel + 1 : fed;
+          }
+          assert( fed > 0 && fed == level );
+        }
+        if ( level >= max_levels[kind] || sources[kind] == below || flowings[kind] == below ) { continue; }
+        for ( int side = 0; side < 4; side++ ) { assert( BLOCK_TYPE_AIR != _fluid_test_type( world, x + side_x[side], y, z + side_z[side] ) ); }
+      }
+    }
+  }
+}
+
+static void _test_fluid() {
+  // 3x3 chunks of flat ground with the surface at y=10, compressed and loaded one at a time like the light test
+  light_test_t test   = ( light_test_t ){ .world = calloc( 1, sizeof( test_world_t ) ) };
+  test_world_t* world = test.world;
+  assert( world );
+  for ( int i = 0; i < 9; i++ ) {
+    world->chunks[i] = _empty_chunk();
+    for ( int y = 0; y < 10; y++ ) {
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &world->chunks[i], x, y, z, BLOCK_TYPE_STONE ); }
+      }
+    }
+    chunk_compress( &world->chunks[i] );
+  }
+  fluid_engine_t engine   = ( fluid_engine_t ){ .chunk_at = _light_test_chunk_at, .block_changed = _fluid_test_block_changed, .user_ptr = &test };
+  const int load_order[9] = { 4, 0, 8, 1, 5, 3, 7, 2, 6 };
+  for ( int i = 0; i < 9; i++ ) {
+    test.loaded[load_order[i]] = true;
+    fluid_chunk_loaded( &engine, load_order[i] % 3, load_order[i] / 3 );
+  }
+  assert( 0 == engine.n_queued ); // no fluid, so nothing to wake
+
+  // a water source on the ground spreads out in a diamond 7 steps across, over the borders of chunk 4
+  const int wx = CHUNK_X + 4, wy = 10, wz = CHUNK_Z + 8;
+  int n_changed = 0, n_updates = 0;
+  _fluid_test_edit( &engine, world, wx, wy, wz, BLOCK_TYPE_WATER );
+  const int n_spread_ticks = _fluid_test_settle( &engine, &n_changed, &n_updates );
+  _fluid_test_check_settled( world );
+  assert( 4 * ( 1 + 2 + 3 + 4 + 5 + 6 + 7 ) == n_changed );
+  assert( BLOCK_TYPE_WATER_FLOWING == _fluid_test_type( world, wx - 7, wy, wz ) && 7 == _fluid_test_level( world, wx - 7, wy, wz ) );
+  assert( BLOCK_TYPE_AIR == _fluid_test_type( world, wx - 8, wy, wz ) );
+  assert( BLOCK_TYPE_WATER_FLOWING == _fluid_test_type( world, wx + 3, wy, wz - 2 ) && 5 == _fluid_test_level( world, wx + 3, wy, wz - 2 ) );
+  assert( test.sections_changed[3] && test.sections_changed[4] && !test.sections_changed[8] ); // every block it changed was reported
+  // still water costs nothing
+  for ( int i = 0; i < 100; i++ ) {
+    assert( 0 == fluid_tick( &engine, 1 << 20 ) );
+    assert( 0 == engine.n_updates );
+  }
+
+  // a pit dug into the ground beside the source. water falls in down its sides and spreads across the bottom
+  int pit_xyz[3 * 3 * 3 * 3], n_pit = 0;
+  for ( int y = 7; y < 10; y++ ) {
+    for ( int z = wz - 1; z <= wz + 1; z++ ) {
+      for ( int x = wx + 2; x <= wx + 4; x++ ) {
+        _test_world_set( world, x, y, z, BLOCK_TYPE_AIR );
+        pit_xyz[n_pit * 3]     = x;
+        pit_xyz[n_pit * 3 + 1] = y;
+        pit_xyz[n_pit * 3 + 2] = z;
+        n_pit++;
+      }
+    }
+  }
+  fluid_blocks_changed( &engine, pit_xyz, n_pit );
+  _fluid_test_settle( &engine, &n_changed, &n_updates );
+  _fluid_test_check_settled( world );
+  for ( int i = 0; i < n_pit; i++ ) {
+    if ( 7 == pit_xyz[i * 3 + 1] ) { assert( BLOCK_TYPE_WATER_FLOWING == _fluid_test_type( world, pit_xyz[i * 3], 7, pit_xyz[i * 3 + 2] ) ); }
+  }
+  assert( BLOCK_TYPE_WATER_FLOWING == _fluid_test_type( world, wx + 2, 8, wz ) && 1 == _fluid_test_level( world, wx + 2, 8, wz ) );
+
+  // lava spreads 3 steps, and more slowly. it glows
+  const int lx = 2 * CHUNK_X + 8, ly = 10, lz = 2 * CHUNK_Z + 8;
+  _fluid_test_edit( &engine, world, lx, ly, lz, BLOCK_TYPE_LAVA );
+  const int n_lava_ticks = _fluid_test_settle( &engine, &n_changed, &n_updates );
+  _fluid_test_check_settled( world );
+  assert( BLOCK_TYPE_LAVA_FLOWING == _fluid_test_type( world, lx, ly, lz + 3 ) && BLOCK_TYPE_AIR == _fluid_test_type( world, lx, ly, lz + 4 ) );
+  assert( n_lava_ticks > n_spread_ticks / 2 && block_type_light_emission( BLOCK_TYPE_LAVA_FLOWING ) > 0 );
+
+  /* levels aren't saved. unloading everything and loading it again one chunk at a time rebuilds them as they were, from the sources, and nothing
+  moves afterwards */
+  uint8_t* levels = calloc( (size_t)LIGHT_TEST_W * FLUID_TEST_MAX_Y * LIGHT_TEST_W, 1 );
+  assert( levels );
+  for ( int y = 0; y < FLUID_TEST_MAX_Y; y++ ) {
+    for ( int z = 0; z < LIGHT_TEST_W; z++ ) {
+      for ( int x = 0; x < LIGHT_TEST_W; x++ ) { levels[( y * LIGHT_TEST_W + z ) * LIGHT_TEST_W + x] = (uint8_t)_fluid_test_level( world, x, y, z ); }
+    }
+  }
+  for ( int i = 0; i < 9; i++ ) {
+    test.loaded[i] = false;
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+      free( world->chunks[i].fluid_levels[section] );
+      world->chunks[i].fluid_levels[section]   = NULL;
+      world->chunks[i].n_fluid_levels[section] = 0;
+    }
+    chunk_compress( &world->chunks[i] );
+  }
+  for ( int i = 0; i < 9; i++ ) {
+    test.loaded[load_order[8 - i]] = true;
+    fluid_chunk_loaded( &engine, load_order[8 - i] % 3, load_order[8 - i] / 3 );
+  }
+  int n_reload_changed = 0;
+  _fluid_test_settle( &engine, &n_reload_changed, &n_updates );
+  assert( 0 == n_reload_changed );
+  for ( int y = 0; y < FLUID_TEST_MAX_Y; y++ ) {
+    for ( int z = 0; z < LIGHT_TEST_W; z++ ) {
+      for ( int x = 0; x < LIGHT_TEST_W; x++ ) { assert( levels[( y * LIGHT_TEST_W + z ) * LIGHT_TEST_W + x] == _fluid_test_level( world, x, y, z ) ); }
+    }
+  }
+
+  // taking the water source away drains all of its flow, pit and all, and leaves the lava
+  _fluid_test_edit( &engine, world, wx, wy, wz, BLOCK_TYPE_AIR );
+  _fluid_test_settle( &engine, &n_changed, &n_updates );
+  _fluid_test_check_settled( world );
+  for ( int y = 0; y < FLUID_TEST_MAX_Y; y++ ) {
+    for ( int z = 0; z < LIGHT_TEST_W; z++ ) {
+      for ( int x = 0; x < LIGHT_TEST_W; x++ ) { assert( BLOCK_TYPE_WATER_FLOWING != _fluid_test_type( world, x, y, z ) ); }
+    }
+  }
+  assert( BLOCK_TYPE_LAVA_FLOWING == _fluid_test_type( world, lx + 3, ly, lz ) );
+  // the lava is all in the last chunk, so the others have given their level arrays back
+  for ( int i = 0; i < 8; i++ ) {
+    for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { assert( !world->chunks[i].fluid_levels[section] ); }
+  }
+  assert( world->chunks[8].fluid_levels[ly / CHUNK_SECTION_Y] );
+
+  printf( "fluid      spreads, falls, drains, and relevels after reloading to a settled state | %i blocks changed, %.1f cell updates each\n", n_changed,
+    (double)n_updates / n_changed );
+  fluid_engine_free( &engine );
+  free( levels );
+  _test_world_free( world );
+}
+
+static void _test_chunk_compression( const char* name, const chunk_t* chunk ) {
+  chunk_t compressed = chunk_copy( chunk );
+  chunk_compress( &compressed );
+  assert( ( compressed.rle != NULL ) != ( compressed.voxels != NULL ) );
+  assert( _chunks_equal( &compressed, chunk ) );
+  // it's only compressed if that makes it smaller
+  assert( chunk_resident_bytes( &compressed ) <= chunk_resident_bytes( chunk ) );
+
+  // meshing straight from the compressed form gives the same bytes. the occupancy masks are built from the runs rather than the voxels
+  for ( int mesher = CHUNK_MESHER_PER_FACE; mesher <= CHUNK_MESHER_GREEDY; mesher++ ) {
+    chunk_vertex_data_t from_plain      = chunk_gen_vertex_data( chunk, NULL, 0, CHUNK_Y, (chunk_mesher_t)mesher );
+    chunk_vertex_data_t from_compressed = chunk_gen_vertex_data( &compressed, NULL, 0, CHUNK_Y, (chunk_mesher_t)mesher );
+    assert( from_plain.n_vertices == from_compressed.n_vertices );
+    assert( 0 == memcmp( from_plain.packed_ptr, from_compressed.packed_ptr, from_plain.vpacked_buffer_sz ) );
+    chunk_free_vertex_data( &from_plain );
+    chunk_free_vertex_data( &from_compressed );
+  }
+
+  uint8_t* buffer = malloc( CHUNK_SAVE_MAX_BYTES );
+  assert( buffer );
+  size_t n_bytes = chunk_save_to_mem( chunk, buffer, CHUNK_SAVE_MAX_BYTES );
+  assert( n_bytes > 0 && n_bytes < CHUNK_X * CHUNK_Y * CHUNK_Z / 4 ); // whichever of runs and bit-packed is smaller
+  assert( n_bytes == chunk_save_to_mem( &compressed, buffer, CHUNK_SAVE_MAX_BYTES ) ); // same bytes from either form
+  assert( 0 == chunk_save_to_mem( chunk, buffer, n_bytes - 1 ) );
+  chunk_t loaded;
+  bool ret = chunk_load_from_mem( buffer, n_bytes, &loaded );
+  assert( ret && ( loaded.rle != NULL ) == ( compressed.rle != NULL ) );
+  assert( _chunks_equal( &loaded, chunk ) );
+  chunk_free( &loaded );
+  ret = chunk_load_from_mem( buffer, n_bytes - 2, &loaded ); // truncated
+  assert( !ret && !loaded.rle && !loaded.voxels );
+  free( buffer );
+
+  printf( "%-10s resident %6zu -> %6zu bytes (x%.1f) | saved %5zu bytes\n", name, chunk_resident_bytes( chunk ), chunk_resident_bytes( &compressed ),
+    (double)chunk_resident_bytes( chunk ) / (double)chunk_resident_bytes( &compressed ), n_bytes );
+
+  // writing goes to a decompressed working copy. writing the same type again doesn't need one
+  const bool was_compressed = NULL != compressed.rle;
+  block_type_t type         = BLOCK_TYPE_AIR;
+  get_block_type_in_chunk( &compressed, 5, 3, 9, &type );
+  bool changed = set_block_type_in_chunk( &compressed, 5, 3, 9, type );
+  assert( !changed && was_compressed == ( NULL != compressed.rle ) );
+  changed = set_block_type_in_chunk( &compressed, 5, 3, 9, BLOCK_TYPE_AIR == type ? BLOCK_TYPE_DIRT : BLOCK_TYPE_AIR );
+  assert( changed && compressed.voxels && !compressed.rle );
+  assert( !_chunks_equal( &compressed, chunk ) );
+  chunk_free( &compressed );
+}
+
+static void _test_vertex_pack_round_trip() {
+  // every field at its minimum and maximum, so a shift or mask that is off by one clobbers a neighbour
+  voxel_vertex_t vertices[] = {
+    ( voxel_vertex_t ){ .x = 0, .y = 0, .z = 0, .face_idx = 0, .palidx = 0, .s = 0, .t = 0, .sky_light = 0, .block_light = 0, .quad_ao = 0 },
+    ( voxel_vertex_t ){ .x = CHUNK_X,
+      .y                   = CHUNK_Y,
+      .z                   = CHUNK_Z,
+      .face_idx            = 5,
+      .palidx              = 15,
+      .s                   = CHUNK_X,
+      .t                   = CHUNK_Y,
+      .sky_light           = 15,
+      .block_light         = 15,
+      .quad_ao             = VOXEL_QUAD_AO_OPEN },
+    ( voxel_vertex_t ){ .x = CHUNK_X, .y = 0, .z = CHUNK_Z, .face_idx = 0, .palidx = 15, .s = 0, .t = CHUNK_Y, .sky_light = 0, .block_light = 15, .quad_ao = 0 },
+    ( voxel_vertex_t ){
+      .x = 0, .y = CHUNK_Y, .z = 0, .face_idx = 5, .palidx = 0, .s = CHUNK_Z, .t = 0, .sky_light = 15, .block_light = 0, .quad_ao = VOXEL_QUAD_AO_OPEN },
+    ( voxel_vertex_t ){ .x = 7, .y = 130, .z = 3, .face_idx = 3, .palidx = 2, .s = 9, .t = 16, .sky_light = 9, .block_light = 6, .quad_ao = 0x8421 },
+  };
+  for ( size_t i = 0; i < sizeof( vertices ) / sizeof( vertices[0] ); i++ ) {
+    uint32_t packed[VOXEL_VPACKED_COMPS] = { 0 };
+    voxel_vertex_pack( vertices[i], packed );
+    voxel_vertex_t out = voxel_vertex_unpack( packed );
+    assert( out.x == vertices[i].x && out.y == vertices[i].y && out.z == vertices[i].z );
+    assert( out.face_idx == vertices[i].face_idx && out.palidx == vertices[i].palidx );
+    assert( out.s == vertices[i].s && out.t == vertices[i].t );
+    assert( out.sky_light == vertices[i].sky_light && out.block_light == vertices[i].block_light );
+    assert( out.quad_ao == vertices[i].quad_ao );
+  }
+  assert( VOXEL_VPACKED_COMPS * sizeof( uint32_t ) == 8 );
+}
+
+int main() {
+  _test_vertex_pack_round_trip();
+  {
+    chunk_t chunk = _empty_chunk();
+    set_block_type_in_chunk( &chunk, 3, 7, 11, BLOCK_TYPE_STONE );
+    _test_greedy_matches_per_face( "single", &chunk, NULL, 1.0 );
+    chunk_free( &chunk );
+  }
+  _test_greedy_slab();
+  {
+    chunk_t chunk = _mixed_chunk();
+    _test_greedy_matches_per_face( "mixed", &chunk, NULL, 1.3 );
+    chunk_free( &chunk );
+  }
+  {
+    chunk_t chunk = _terrain_chunk( 1234 );
+    _test_greedy_matches_per_face( "terrain", &chunk, NULL, 3.5 );
+    chunk_free( &chunk );
+  }
+  _test_greedy_generated_terrain();
+  _test_greedy_y_range();
+  _test_neighbour_culling();
+  _test_ambient_occlusion();
+  _test_section_meshing();
+  _test_layer_order();
+  _test_lod_meshes();
+  _test_noise_terrain();
+  _test_noise_simd();
+  _test_mesh_arena();
+  _test_worker_pool_meshing();
+  {
+    chunk_t chunk = _terrain_chunk( 1234 );
+    _test_chunk_compression( "terrain", &chunk );
+    chunk_free( &chunk );
+    chunk = _mixed_chunk();
+    _test_chunk_compression( "mixed", &chunk );
+    chunk_free( &chunk );
+    // worst case for RLE: every voxel differs from the one below
+    chunk = _empty_chunk();
+    for ( int y = 0; y < CHUNK_Y; y += 2 ) {
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &chunk, x, y, z, BLOCK_TYPE_STONE ); }
+      }
+    }
+    _test_chunk_compression( "stripes", &chunk );
+    chunk_t stripes = chunk_copy( &chunk );
+    chunk_compress( &stripes );
+    assert( stripes.voxels && !stripes.rle && stripes.stays_plain ); // more runs than voxels, so it stays as it was, and isn't tried again
+    // until an edit. filling in the gaps leaves one run per column
+    for ( int y = 1; y < CHUNK_Y; y += 2 ) {
+      for ( int z = 0; z < CHUNK_Z; z++ ) {
+        for ( int x = 0; x < CHUNK_X; x++ ) { set_block_type_in_chunk( &stripes, x, y, z, BLOCK_TYPE_STONE ); }
+      }
+    }
+    assert( !stripes.stays_plain );
+    chunk_compress( &stripes );
+    assert( !stripes.voxels && stripes.rle );
+    chunk_free( &stripes );
+    chunk_free( &chunk );
+  }
+  _test_region_paging();
+  _test_mesh_export();
+  _test_mesh_cache();
+  _test_chunk_cache();
+  _test_chunk_quadtree();
+  _test_range_alloc();
+  _test_visibility();
+  _test_raycast();
+  _test_light();
+  _test_fluid();
+
+  printf( "all tests passed\n" );
+  return 0;
+}
@@ -0,0 +1,163 @@
+/* Copyright Anton Gerdelan <antongdl@protonmail.com>. 2019 */
+
+#include "threads.h"
+#include <assert.h>
+#include <pthread.h> // could move into platform file for Windows support. mingw has winpthreads
+#include <unistd.h>  // sysconf. not portable TODO
+#include <string.h>
+#define MAX_JOBS_IN_QUEUE 1024
+#define MAX_WORKERS 31
+#define DEFAULT_WORKERS 7 // if the CPU count can't be queried
+
+typedef struct job_queue_t {
+  job_description_t data[MAX_JOBS_IN_QUEUE];
+  int n;
+  int start_idx;
+} job_queue_t;
+
+typedef struct worker_pool_t {
+  // one mutex guards everything below. jobs are coarse (eg a whole chunk) so contention is low
+  pthread_mutex_t mutex;
+  pthread_cond_t job_pushed_cond;
+  pthread_cond_t job_finished_cond;
+  job_queue_t job_queue;
+  job_queue_t finished_queue;
+  int n_running;
+  int n_outstanding; // queued + running + finished. never exceeds MAX_JOBS_IN_QUEUE so the finished queue can't overflow
+  bool shutdown;
+
+  pthread_t threads[MAX_WORKERS];
+  int worker_idxs[MAX_WORKERS];
+  int n_workers;
+} worker_pool_t;
+
+static worker_pool_t _g_pool;
+
+static void _queue_push( job_queue_t* queue, job_description_t job ) {
+  assert( queue->n < MAX_JOBS_IN_QUEUE );
+  int end_idx          = ( queue->start_idx + queue->n ) % MAX_JOBS_IN_QUEUE;
+  queue->data[end_idx] = job;
+  queue->n++;
+}
+
+static job_description_t _queue_pop( job_queue_t* queue ) {
+  assert( queue->n > 0 );
+  job_description_t job = queue->data[queue->start_idx];
+  queue->start_idx      = ( queue->start_idx + 1 ) % MAX_JOBS_IN_QUEUE;
+  queue->n--;
+  return job;
+}
+
+static void* _worker_thread_sr( void* arg ) {
+  int worker_idx = *( (int*)arg );
+
+  pthread_mutex_lock( &_g_pool.mutex );
+  while ( 1 ) {
+    // sleep until there is a job or threads are shutting down
+    while ( !_g_pool.shutdown && 0 == _g_pool.job_queue.n ) { pthread_cond_wait( &_g_pool.job_pushed_cond, &_g_pool.mutex ); }
+    if ( _g_pool.shutdown ) { break; }
+
+    job_description_t job = _queue_pop( &_g_pool.job_queue );
+    _g_pool.n_running++;
+    pthread_mutex_unlock( &_g_pool.mutex );
+
+    job.job_function_ptr( worker_idx, job.job_function_args );
+
+    pthread_mutex_lock( &_g_pool.mutex );
+    _queue_push( &_g_pool.finished_queue, job );
+    _g_pool.n_running--;
+    pthread_cond_broadcast( &_g_pool.job_finished_cond );
+  }
+  pthread_mutex_unlock( &_g_pool.mutex );
+
+  return NULL;
+}
+
+void worker_pool_init() {
+  memset( &_g_pool, 0, sizeof( worker_pool_t ) );
+  int ret = pthread_mutex_init( &_g_pool.mutex, NULL );
+  assert( 0 == ret );
+  ret = pthread_cond_init( &_g_pool.job_pushed_cond, NULL );
+  assert( 0 == ret );
+  ret = pthread_cond_init( &_g_pool.job_finished_cond, NULL );
+  assert( 0 == ret );
+
+  // leave one logical CPU for the main thread
+  long n_cpus = DEFAULT_WORKERS + 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  n_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+  _g_pool.n_workers = n_cpus - 1 < 1 ? 1 : ( n_cpus - 1 > MAX_WORKERS ? MAX_WORKERS : (int)n_cpus - 1 );
+
+  for ( int i = 0; i < _g_pool.n_workers; i++ ) {
+    _g_pool.worker_idxs[i] = i;
+    ret                    = pthread_create( &_g_pool.threads[i], NULL, _worker_thread_sr, &_g_pool.worker_idxs[i] );
+    assert( 0 == ret );
+  }
+}
+
+void worker_pool_free() {
+  pthread_mutex_lock( &_g_pool.mutex );
+  _g_pool.shutdown = true;
+  pthread_cond_broadcast( &_g_pool.job_pushed_cond );
+  pthread_mutex_unlock( &_g_pool.mutex );
+
+  for ( int i = 0; i < _g_pool.n_workers; i++ ) {
+    int ret = pthread_join( _g_pool.threads[i], NULL );
+    assert( 0 == ret );
+  }
+
+  pthread_cond_destroy( &_g_pool.job_finished_cond );
+  pthread_cond_destroy( &_g_pool.job_pushed_cond );
+  int ret = pthread_mutex_destroy( &_g_pool.mutex );
+  assert( 0 == ret );
+  memset( &_g_pool, 0, sizeof( worker_pool_t ) );
+}
+
+int worker_pool_n_workers() { return _g_pool.n_workers; }
+
+bool worker_pool_push_job( job_description_t job ) {
+  assert( job.job_function_ptr && job.on_finished_cb );
+
+  bool pushed = false;
+  pthread_mutex_lock( &_g_pool.mutex );
+  if ( _g_pool.n_outstanding < MAX_JOBS_IN_QUEUE ) {
+    _queue_push( &_g_pool.job_queue, job );
+    _g_pool.n_outstanding++;
+    pthread_cond_signal( &_g_pool.job_pushed_cond );
+    pushed = true;
+  }
+  pthread_mutex_unlock( &_g_pool.mutex );
+  return pushed;
+}
+
+int worker_pool_n_jobs_outstanding() {
+  pthread_mutex_lock( &_g_pool.mutex );
+  int n = _g_pool.n_outstanding;
+  pthread_mutex_unlock( &_g_pool.mutex );
+  return n;
+}
+
+void worker_pool_wait() {
+  pthread_mutex_lock( &_g_pool.mutex );
+  while ( _g_pool.job_queue.n > 0 || _g_pool.n_running > 0 ) { pthread_cond_wait( &_g_pool.job_finished_cond, &_g_pool.mutex ); }
+  pthread_mutex_unlock( &_g_pool.mutex );
+}
+
+void worker_pool_update() {
+  while ( 1 ) {
+    // one at a time with the lock released for the callback, so that callbacks can push new jobs
+    job_description_t job;
+    bool got_job = false;
+    pthread_mutex_lock( &_g_pool.mutex );
+    if ( _g_pool.finished_queue.n > 0 ) {
+      job = _queue_pop( &_g_pool.finished_queue );
+      _g_pool.n_outstanding--;
+      got_job = true;
+    }
+    pthread_mutex_unlock( &_g_pool.mutex );
+    if ( !got_job ) { break; }
+
+    job.on_finished_cb( job.name, job.job_function_args );
+  }
+}
@@ -0,0 +1,51 @@
+/* Copyright Anton Gerdelan <antongdl@protonmail.com>. 2019
+Worker pool. Successor to 046_async_texture/threads.h
+Design:
+  1 worker thread per logical CPU, minus the main thread, up to MAX_WORKERS
+  threads persist until worker_pool_free is called
+  idle threads sleep on a condition variable and wake as soon as a job is pushed ( no polling )
+  finished jobs go into a finished queue and the thread moves straight on to the next job
+  worker_pool_update() calls on_finished_cb for each finished job on the calling ( main ) thread, so eg GL uploads can happen there
+*/
+
+#pragma once
+#include <stdbool.h>
+
+typedef struct job_description_t {
+  // function with the work to do in the thread
+  // int is the worker index used to compute the job. 0 to worker_pool_n_workers()-1. handy for per-worker scratch memory
+  // void* is job_function_args
+  void ( *job_function_ptr )( int, void* );
+  // any memory the functions can read/write
+  // warning: don't use memory on a stack that's likely to close before the thread ends
+  // warning: don't access this memory until the thread is done with it
+  // note: to have the thread write into a block of memory use eg a char**
+  void* job_function_args;
+  // callback called on the main thread to notify program that job has finished.
+  // void* is job_function_args
+  void ( *on_finished_cb )( const char*, void* );
+  // name of the job for display in debug
+  char name[16];
+} job_description_t;
+
+// initialises reasources and starts all worker threads
+void worker_pool_init();
+
+// signals all threads to stop, waits until current jobs done, cleans up threads.
+// jobs still queued are dropped without calling their callbacks, so call worker_pool_wait() and worker_pool_update() first if that matters
+void worker_pool_free();
+
+// number of worker threads started by worker_pool_init()
+int worker_pool_n_workers();
+
+// returns false if queue was full. jobs are queued, running, or waiting for worker_pool_update() until their on_finished_cb is called
+bool worker_pool_push_job( job_description_t job );
+
+// number of jobs pushed whose on_finished_cb has not been called yet
+int worker_pool_n_jobs_outstanding();
+
+// blocks until every pushed job has finished running. call worker_pool_update() afterwards to run the callbacks
+void worker_pool_wait();
+
+// calls on_finished_cb for all finished jobs, on the calling thread
+void worker_pool_update();
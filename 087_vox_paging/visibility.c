@@ -0,0 +1,90 @@
+#include "visibility.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// marks the camera's section in chunk_visibility_t.entered, which can be left by any face
+#define ENTERED_FROM_CAMERA ( 1 << 6 )
+
+typedef struct chunk_visibility_step_t {
+  int cx, cz;
+  int16_t chunk_id;
+  int8_t sy;
+  int8_t entered_face; // 0-5 or -1 for the camera's section
+} chunk_visibility_step_t;
+
+static void _push_step( chunk_visibility_t* vis, int* n_queued, chunk_visibility_step_t step ) {
+  if ( *n_queued >= vis->queue_max ) {
+    vis->queue_max = vis->queue_max ? vis->queue_max * 2 : 1024;
+    vis->queue     = realloc( vis->queue, vis->queue_max * sizeof( chunk_visibility_step_t ) );
+    assert( vis->queue );
+  }
+  vis->queue[( *n_queued )++] = step;
+}
+
+int chunk_visibility_search( chunk_visibility_t* vis, const chunk_visibility_query_t* query, uint32_t* visible_sections ) {
+  assert( vis && query && query->chunk_id_at && query->connectivity && visible_sections );
+  assert( query->n_chunk_ids > 0 && query->n_chunk_ids <= INT16_MAX );
+
+  if ( query->n_chunk_ids > vis->n_chunk_ids ) {
+    free( vis->entered );
+    vis->entered     = malloc( query->n_chunk_ids * CHUNK_SECTIONS );
+    vis->n_chunk_ids = query->n_chunk_ids;
+    assert( vis->entered );
+  }
+  memset( vis->entered, 0, query->n_chunk_ids * CHUNK_SECTIONS );
+  memset( visible_sections, 0, query->n_chunk_ids * sizeof( uint32_t ) );
+
+  const int cam_sy       = query->cam_sy < 0 ? 0 : ( query->cam_sy >= CHUNK_SECTIONS ? CHUNK_SECTIONS - 1 : query->cam_sy );
+  const int cam_chunk_id = query->chunk_id_at( query->cam_cx, query->cam_cz, query->user_ptr );
+  if ( cam_chunk_id < 0 ) { return 0; }
+  assert( cam_chunk_id < query->n_chunk_ids );
+
+  int n_queued = 0, n_visible = 0;
+  _push_step( vis, &n_queued,
+    ( chunk_visibility_step_t ){ .cx = query->cam_cx, .cz = query->cam_cz, .chunk_id = (int16_t)cam_chunk_id, .sy = (int8_t)cam_sy, .entered_face = -1 } );
+  vis->entered[cam_chunk_id * CHUNK_SECTIONS + cam_sy] = ENTERED_FROM_CAMERA;
+  visible_sections[cam_chunk_id] |= 1u << cam_sy;
+  n_visible++;
+
+  // steps and the face each leaves by, in face_idx order -x,+x,-y,+y,-z,+z
+  const int step_x[6] = { -1, 1, 0, 0, 0, 0 };
+  const int step_y[6] = { 0, 0, -1, 1, 0, 0 };
+  const int step_z[6] = { 0, 0, 0, 0, -1, 1 };
+  for ( int head = 0; head < n_queued; head++ ) {
+    const chunk_visibility_step_t curr = vis->queue[head]; // copy since pushing can move the queue
+    const uint16_t connectivity        = query->connectivity[curr.chunk_id * CHUNK_SECTIONS + curr.sy];
+    const int dx = curr.cx - query->cam_cx, dy = curr.sy - cam_sy, dz = curr.cz - query->cam_cz;
+    for ( int face = 0; face < 6; face++ ) {
+      if ( curr.entered_face >= 0 && !chunk_section_faces_connected( connectivity, curr.entered_face, face ) ) { continue; }
+      // only ever move away from the camera along an axis
+      if ( ( step_x[face] && dx * step_x[face] < 0 ) || ( step_y[face] && dy * step_y[face] < 0 ) || ( step_z[face] && dz * step_z[face] < 0 ) ) { continue; }
+
+      const int cx = curr.cx + step_x[face], sy = curr.sy + step_y[face], cz = curr.cz + step_z[face];
+      if ( sy < 0 || sy >= CHUNK_SECTIONS ) { continue; }
+      const int chunk_id = step_y[face] ? curr.chunk_id : query->chunk_id_at( cx, cz, query->user_ptr );
+      if ( chunk_id < 0 ) { continue; }
+      assert( chunk_id < query->n_chunk_ids );
+      const int entered_face = face ^ 1; // the opposite face
+      uint8_t* entered       = &vis->entered[chunk_id * CHUNK_SECTIONS + sy];
+      if ( *entered & ( 1 << entered_face ) ) { continue; }
+      if ( query->is_section_in_view && !query->is_section_in_view( cx, sy, cz, query->user_ptr ) ) { continue; }
+
+      if ( !*entered ) {
+        visible_sections[chunk_id] |= 1u << sy;
+        n_visible++;
+      }
+      *entered |= 1 << entered_face;
+      _push_step( vis, &n_queued,
+        ( chunk_visibility_step_t ){ .cx = cx, .cz = cz, .chunk_id = (int16_t)chunk_id, .sy = (int8_t)sy, .entered_face = (int8_t)entered_face } );
+    }
+  }
+  return n_visible;
+}
+
+void chunk_visibility_free( chunk_visibility_t* vis ) {
+  assert( vis );
+  free( vis->entered );
+  free( vis->queue );
+  memset( vis, 0, sizeof( chunk_visibility_t ) );
+}
@@ -0,0 +1,41 @@
+/* Section visibility graph - finds the chunk sections that could be seen from the camera, so that sections hidden underground or behind hills
+aren't drawn. No GL in here so that it can be tested headless. See voxels.c for the drawing that uses it.
+
+Design:
+  every section has a connectivity mask saying which pairs of its faces are joined through air - see chunk_section_connectivity()
+  breadth-first search outwards from the camera's section. the search can leave a section by a face only if air joins it to the face it came in by
+  a line of sight only ever moves away from the camera along each axis, so the search never steps back towards the camera's section on any axis
+  a section the search steps into is visible even if it's solid, since its faces on that side could be seen
+  the search is conservative - it can include sections that are hidden, but never leaves out one that could be seen
+*/
+
+#pragma once
+#include "chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct chunk_visibility_query_t {
+  int cam_cx, cam_sy, cam_cz; // section the camera is in. cam_sy is clamped to 0..CHUNK_SECTIONS-1
+  int n_chunk_ids;            // chunk ids are 0..n_chunk_ids-1
+  // RETURNS the id of chunk cx,cz or -1 if there isn't one. the search doesn't go past missing chunks
+  int ( *chunk_id_at )( int cx, int cz, void* user_ptr );
+  // RETURNS false if section sy of chunk cx,cz is outside the view eg a frustum check. the search doesn't go past these. may be NULL
+  bool ( *is_section_in_view )( int cx, int sy, int cz, void* user_ptr );
+  const uint16_t* connectivity; // CHUNK_SECTIONS entries per chunk id, from chunk_section_connectivity()
+  void* user_ptr;
+} chunk_visibility_query_t;
+
+/* reusable search memory. a zeroed struct is valid and empty. grows as needed, and is never shrunk, so after the first search it doesn't allocate */
+typedef struct chunk_visibility_t {
+  uint8_t* entered; // bit per face a section was entered by, and bit 6 for the camera's section. CHUNK_SECTIONS per chunk id
+  int n_chunk_ids;
+  struct chunk_visibility_step_t* queue;
+  int queue_max;
+} chunk_visibility_t;
+
+/* sets bit n of visible_sections[chunk_id] if section n of that chunk could be visible from the camera, and clears the bits of every other section.
+visible_sections must have query->n_chunk_ids entries
+RETURNS the number of visible sections */
+int chunk_visibility_search( chunk_visibility_t* vis, const chunk_visibility_query_t* query, uint32_t* visible_sections );
+
+void chunk_visibility_free( chunk_visibility_t* vis );
@@ -4,606 +4,841 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "../common/include/stb/stb_image.h"
 #include "camera.h"
-#include "diamond_square.h"
+#include "chunk.h"
+#include "chunk_cache.h"
+#include "chunk_quadtree.h"
+#include "fluid.h"
 #include "gl_utils.h"
 #include "glcontext.h" // some GL calls/data types not encapsulated by gl_utils yet
+#include "light.h"
+#include "mesh_cache.h"
+#include "mesh_export.h"
+#include "range_alloc.h"
+#include "raycast.h"
+#include "region.h"
+#include "threads.h"
+#include "visibility.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* TODO / rough plan
-* program maintains a chunks table
-* chunks list has
--chunk (x,y) name/coords
--if it's loaded into memory
--if it's loadable from a file
-* when loading a chunk
-- is it already in memory?
-- if not is it loadable from a file?
-- if so then load it from within given chunks file by going to appropriate offset
-- if not then generate chunk
-
-chunks binary file:
-31 -- number of chunks in file
--- table of chunk names and ~their memory offsets and size in the file
-0,0 10 128
-0,1 138 26
-0,2 164 10
-1,1
-1,2 -1,0 -1,1 ...
--- first chunk's data
--- second chunk's data
-...
+/* Paging
+* the world has no size limit. chunks are kept in a cache keyed by chunk coords (cx,cz) - see chunk_cache.h
+* chunks_stream() follows the camera: chunks within the view radius are loaded from their region file if saved, or generated if not
+* chunks outside the radius stay cached until the memory budget is exceeded, then the least recently used are evicted. edited chunks are saved first
+* chunk ids ( slots in the cache ) are only valid while a chunk is resident
+* one region file per REGION_CHUNKS_W x REGION_CHUNKS_W chunks, named <world name>.<region x>.<region z>.region - see region.h
+* saving a chunk also writes its full detail meshes to <world name>.<region x>.<region z>.meshes. when it's next loaded, and the meshes' key matches,
+  they're uploaded instead of remeshing it - see mesh_cache.h
 */
 
-// dimensions of chunk in voxels
-#define CHUNK_X 16  // 32
-#define CHUNK_Y 256 // 256
-#define CHUNK_Z 16  // 32
-
-#define VOXEL_FACE_VERTS 6
-#define VOXEL_VP_COMPS 3
-#define VOXEL_VT_COMPS 2
-#define VOXEL_VN_COMPS 4
-#define VOXEL_VPICKING_COMPS 3
-#define VOXEL_VPALIDX_COMPS 1
-#define VOXEL_FACE_VP_FLOATS ( VOXEL_FACE_VERTS * VOXEL_VP_COMPS )
-#define VOXEL_FACE_VP_BYTES ( VOXEL_FACE_VP_FLOATS * sizeof( float ) )
-#define VOXEL_FACE_VT_FLOATS ( VOXEL_FACE_VERTS * VOXEL_VT_COMPS )
-#define VOXEL_FACE_VT_BYTES ( VOXEL_FACE_VT_FLOATS * sizeof( float ) )
-#define VOXEL_FACE_VN_FLOATS ( VOXEL_FACE_VERTS * VOXEL_VN_COMPS )
-#define VOXEL_FACE_VN_BYTES ( VOXEL_FACE_VN_FLOATS * sizeof( float ) )
-#define VOXEL_FACE_VPICKING_FLOATS ( VOXEL_FACE_VERTS * VOXEL_VPICKING_COMPS )
-#define VOXEL_FACE_VPICKING_BYTES ( VOXEL_FACE_VPICKING_FLOATS * sizeof( float ) )
-#define VOXEL_FACE_VPALIDX_UINTS ( VOXEL_FACE_VERTS * VOXEL_VPALIDX_COMPS )
-#define VOXEL_FACE_VPALIDX_BYTES ( VOXEL_FACE_VPALIDX_UINTS * sizeof( uint32_t ) )
-#define VOXEL_CUBE_VP_FLOATS ( VOXEL_FACE_VP_FLOATS * 6 )
-#define VOXEL_CUBE_VP_BYTES ( VOXEL_FACE_VP_BYTES * 6 )
-#define VOXEL_CUBE_VT_FLOATS ( VOXEL_FACE_VT_FLOATS * 6 )
-#define VOXEL_CUBE_VT_BYTES ( VOXEL_FACE_VT_BYTES * 6 )
-#define VOXEL_CUBE_VN_FLOATS ( VOXEL_FACE_VN_FLOATS * 6 )
-#define VOXEL_CUBE_VN_BYTES ( VOXEL_CUBE_VN_FLOATS * sizeof( float ) )
-#define VOXEL_CUBE_VPICKING_FLOATS ( VOXEL_FACE_VPICKING_FLOATS * 6 )
-#define VOXEL_CUBE_VPICKING_BYTES ( VOXEL_FACE_VPICKING_BYTES * 6 )
-#define VOXEL_CUBE_VPALIDX_UINTS ( VOXEL_FACE_VPALIDX_UINTS * 6 )
-#define VOXEL_CUBE_VPALIDX_BYTES ( VOXEL_FACE_VPALIDX_BYTES * 6 )
-
-#pragma pack( push, 1 )
-typedef struct voxel_t {
-  uint8_t type;
-} voxel_t;
-
-typedef struct chunk_t {
-  voxel_t* voxels;
-  int heightmap[CHUNK_X * CHUNK_Z];
-  uint32_t n_non_air_voxels;
-} chunk_t;
-#pragma pack( pop )
-
-typedef struct chunk_vertex_data_t {
-  float* positions_ptr;
-  float* texcoords_ptr;
-  float* picking_ptr; // only needs 3 bytes
-  float* normals_ptr;
-  uint32_t* palette_indices_ptr;
-  size_t n_vertices;
-  size_t n_vp_comps;
-  size_t n_vt_comps;
-  size_t n_vpalidx_comps;
-  size_t n_vpicking_comps;
-  size_t n_vn_comps;
-  size_t vp_buffer_sz;
-  size_t vt_buffer_sz;
-  size_t vn_buffer_sz;
-  size_t vpalidx_buffer_sz;
-  size_t vpicking_buffer_sz;
-} chunk_vertex_data_t;
-
-// clang-format off
-//                                     x   y   z   x   y   z   x   y   z | x   y   z   x   y   z   x   y   z
-static const float _west_face[]   = { -1,  1, -1, -1, -1, -1, -1,  1,  1, -1,  1,  1, -1, -1, -1, -1, -1,  1 };
-static const float _east_face[]   = {  1,  1,  1,  1, -1,  1,  1,  1, -1,  1,  1, -1,  1, -1,  1,  1, -1, -1 };
-static const float _bottom_face[] = { -1, -1,  1, -1, -1, -1,  1, -1,  1,  1, -1,  1, -1, -1, -1,  1, -1, -1 };
-static const float _top_face[]    = { -1,  1, -1, -1,  1,  1,  1,  1, -1,  1,  1, -1, -1,  1,  1,  1,  1,  1 };
-static const float _north_face[]  = {  1,  1, -1,  1, -1, -1, -1,  1, -1, -1,  1, -1,  1, -1, -1, -1, -1, -1 };
-static const float _south_face[]  = { -1,  1,  1, -1, -1,  1,  1,  1,  1,  1,  1,  1, -1, -1,  1,  1, -1,  1 };
-// clang-format on
-
-static const int palette_grass = 0;
-static const int palette_stone = 1;
-static const int palette_dirt  = 2;
-static const int palette_crust = 3;
-
-// might be handy to keep as a reference
-#if 0
-/* creates vertex data for a cube made from 6 individual faces */
-static chunk_vertex_data_t _test_cube_from_faces() {
-  chunk_vertex_data_t cube = ( chunk_vertex_data_t ){
-    .n_vp_comps = VOXEL_VP_COMPS, .n_vt_comps = VOXEL_VT_COMPS, .n_vpalidx_comps = VOXEL_VPALIDX_COMPS, .n_vn_comps = VOXEL_VN_COMPS, .n_vpicking_comps = VOXEL_VPICKING_COMPS
-  };
-  cube.positions_ptr = malloc( VOXEL_CUBE_VP_BYTES );
-  if ( !cube.positions_ptr ) { return cube; }
-  cube.palette_indices_ptr = malloc( VOXEL_CUBE_VPALIDX_BYTES );
-  if ( !cube.palette_indices_ptr ) {
-    free( cube.positions_ptr );
-    cube.positions_ptr = NULL;
-    return cube;
-  }
-
-  int float_idx                     = 0;
-  int palette_indices_idx           = 0;
-  const float* faces[6]             = { _west_face, _east_face, _bottom_face, _top_face, _north_face, _south_face };
-  const uint32_t palette_indices[6] = { 0, 1, 2, 3, 4, 5 };
-  for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
-    memcpy( &cube.positions_ptr[float_idx], faces[face_idx], VOXEL_FACE_VP_BYTES );
-    for ( int i = 0; i < VOXEL_FACE_VERTS; i++ ) {
-      memcpy( &cube.palette_indices_ptr[palette_indices_idx + i], &palette_indices[face_idx], sizeof( uint32_t ) );
-    }
-    float_idx += VOXEL_FACE_VP_FLOATS;
-    palette_indices_idx += VOXEL_FACE_VERTS;
-    cube.n_vertices += VOXEL_FACE_VERTS;
+/* Drawing
+* chunks_sort_draw_queue() gets the chunks in the frustum from a quadtree, already nearest first, and keeps those the visibility search can see.
+  nothing is sorted and chunks outside the frustum are mostly rejected many at a time - see chunk_quadtree.h
+* every mesh lives in one big vertex buffer, in a range reserved from a range_alloc_t that mirrors it - see range_alloc.h. the buffer doubles when
+  nothing fits
+* chunks_draw() writes one command per visible section ( or LOD mesh ) plus a translation per chunk and draws the lot with one
+  glMultiDrawArraysIndirect(), so the cost of the draw call doesn't grow with the number of chunks in view. see draw_packed_buffer()
+* slice view hides everything from a height up. faces are meshed in layer order, so that's drawing a prefix of each section cut by the slice, and
+  skipping the sections above it. the shader clips walls that reach up through the slice, and a second pass draws the back faces of the cut sections
+  as caps where the slice cuts into the ground. moving the slice remeshes nothing
+*/
+
+/* Fluids
+* water and lava flow at a fixed tick rate, whatever the frame rate. only cells that could change are updated, so still water costs nothing - see fluid.h
+* blocks the fluid sim changes go down the same path as a volume edit: their sections are marked dirty and light is updated for all of them at once
+*/
+
+/*-------------------------------------------------CHUNKS ORGANISATION-----------------------------------------------------*/
+
+// most chunks resident at once
+#define CHUNKS_MAX 16384
+#define VOXEL_SCALE 0.2f
+#define CHUNKS_DEFAULT_RADIUS 40
+#define CHUNKS_DEFAULT_MEMORY_BUDGET ( 256 * 1024 * 1024 )
+/* chunks within this many chunks of the camera are drawn at full detail. each level of detail after that reaches twice as far as the one before,
+so every ring of chunks costs about the same number of triangles. see chunk_gen_lod_vertex_data_in_arena() */
+#define CHUNKS_LOD_DIST 5
+// chunks loaded or generated per chunks_stream() so that flying fast doesn't stall a frame. nearest first
+#define CHUNKS_MAX_LOADS_PER_STREAM 8
+// saved chunks are meshed for their region's mesh cache this many at a time, each holding a copy of its chunk, so a big save doesn't copy them all at once
+#define CHUNKS_MAX_MESH_CACHE_JOBS 16
+// fluid ticks per second
+#define CHUNKS_FLUID_TICK_HZ 20
+/* fluid cells updated per tick, at most. a flood bigger than this just flows more slowly rather than stalling the frame. and ticks per
+chunks_update_fluids(), so a long frame doesn't have to catch up all at once */
+#define CHUNKS_FLUID_MAX_UPDATES_PER_TICK 4096
+#define CHUNKS_FLUID_MAX_TICKS_PER_UPDATE 4
+
+#define ALL_SECTIONS_MASK ( ( 1u << CHUNK_SECTIONS ) - 1 )
+// vertices in the shared vertex buffer to start with. it doubles whenever a mesh doesn't fit
+#define CHUNKS_VERTEX_BUFFER_START ( 1024 * 1024 )
+// meshes are given whole multiples of this many vertices, so a freed range is more often the right size for the next mesh
+#define CHUNKS_VERTEX_GRANULE 96
+
+// a mesh's vertices in the shared vertex buffer. n_reserved is 0 for no mesh
+typedef struct chunk_mesh_range_t {
+  uint32_t first, n_vertices, n_reserved;
+} chunk_mesh_range_t;
+
+// generated graphics stuff that doesn't persist between save/load. indexed by chunk id
+static uint32_t _dirty_sections[CHUNKS_MAX]; // bit per section of the chunk that needs remeshing. see CHUNK_SECTION_Y
+static bool _unsaved_chunks[CHUNKS_MAX];     // changed since it was last saved, loaded, or generated
+static bool _mesh_cache_chunks[CHUNKS_MAX];  // loaded from its region file and not edited since, so it may have cached meshes
+static bool _mesh_cache_pending[CHUNKS_MAX]; // saved and waiting for a mesh cache job. see _push_pending_mesh_cache_jobs()
+static int _n_mesh_cache_jobs;               // in flight, or finished and not yet written
+static int _n_mesh_cache_reads;              // mesh jobs in flight that may read a mesh cache file
+static chunk_mesh_range_t _chunk_meshes[CHUNKS_MAX][CHUNK_SECTIONS];
+/* far chunks are drawn with one mesh for the whole chunk at a lower level of detail instead of their sections. a chunk has one or the other - uploading
+either deletes the other, so a chunk keeps drawing what it had until its mesh for the new distance is in */
+static int _chunk_lods[CHUNKS_MAX]; // level of detail wanted for the chunk's distance from the camera. set by chunks_stream()
+static chunk_mesh_range_t _chunk_lod_meshes[CHUNKS_MAX];
+static int _chunk_lod_mesh_levels[CHUNKS_MAX]; // of the LOD mesh uploaded. 0 for none
+static bool _stale_lod_meshes[CHUNKS_MAX];     // voxels or light changed since the LOD mesh was queued
+// meshes are built on worker threads and may finish out of order. each build takes a generation number and older results are dropped
+static uint32_t _chunk_mesh_requested_gen[CHUNKS_MAX];
+static uint32_t _chunk_mesh_uploaded_gen[CHUNKS_MAX];
+static bool _chunk_mesh_job_in_flight[CHUNKS_MAX];
+// what each resident chunk's voxels, light and fluid took when last looked at, and the running total of those plus the vertices reserved for the meshes
+static size_t _chunk_bytes[CHUNKS_MAX];
+static size_t _resident_bytes;
+// mesher scratch memory. one for the main thread and one per worker, indexed by the worker index the pool passes to jobs
+static chunk_mesh_arena_t _main_mesh_arena;
+static chunk_mesh_arena_t* _worker_mesh_arenas;
+static packed_buffer_t _chunk_vertex_buffer;
+static range_alloc_t _chunk_vertex_alloc;
+// built by chunks_draw() each frame. a chunk draws either its LOD mesh or its sections
+static draw_arrays_cmd_t _chunk_draw_cmds[CHUNKS_MAX * CHUNK_SECTIONS];
+static float _chunk_draw_offsets[CHUNKS_MAX * 3]; // translation of each chunk in the draw queue
+static draw_arrays_cmd_t _chunk_cap_cmds[CHUNKS_MAX]; // the section cut by the slice, or the LOD mesh, of each chunk drawn. see chunks_slice_view_mode()
+// faces in each layer of a section and those below it, from chunk_vertex_data_layer_ends(). a section has at most a few thousand faces
+static uint16_t _section_layer_ends[CHUNKS_MAX][CHUNK_SECTIONS][CHUNK_SECTION_Y];
+// which faces of each section are joined through air, worked out when it's meshed. see visibility.h
+static uint16_t _section_connectivity[CHUNKS_MAX][CHUNK_SECTIONS];
+static uint32_t _visible_sections[CHUNKS_MAX]; // bit per section that could be seen from the camera. set by chunks_sort_draw_queue()
+static chunk_visibility_t _visibility;
+static light_engine_t _light;
+static fluid_engine_t _fluid;
+static double _fluid_tick_accum_s; // time not yet simulated
+/* world voxel coords of the voxels changed by the current volume edit or fluid tick, 3 ints each, for light_blocks_changed(). grown as needed and kept
+for the next */
+static int* _volume_edit_xyz;
+static int _volume_edit_max;
+static int _n_fluid_changed; // in _volume_edit_xyz by the current fluid tick
+static shader_t _voxel_shader;
+static int _voxel_shader_u_slice_y, _voxel_shader_u_cap;
+static texture_t _array_texture;
+#define VOXEL_PALETTE_N 8
+static uint8_t _palette_rgb[VOXEL_PALETTE_N][3]; // average colour of each palette texture, for exported meshes
+
+// unpacks the 8-byte vertices from chunk_gen_vertex_data(). bit layout must match the VOXEL_VPACKED_* defines in chunk.h
+// corner * 2 - 1 gives the same chunk-space position that the float vertex buffers used to carry
+#define VOXEL_VPACKED_GLSL \
+  "in uvec2 a_vpacked;\n" \
+  "const vec3 face_normals[6] = vec3[6]( vec3( -1.0, 0.0, 0.0 ), vec3( 1.0, 0.0, 0.0 ), vec3( 0.0, -1.0, 0.0 ), vec3( 0.0, 1.0, 0.0 ),\n" \
+  "  vec3( 0.0, 0.0, -1.0 ), vec3( 0.0, 0.0, 1.0 ) );\n" \
+  "vec3 unpack_vp() {\n" \
+  "  uvec3 corner = uvec3( a_vpacked.x & 31u, ( a_vpacked.x >> 5u ) & 511u, ( a_vpacked.x >> 14u ) & 31u );\n" \
+  "  return vec3( corner ) * 2.0 - 1.0;\n" \
+  "}\n" \
+  "uint unpack_face() { return ( a_vpacked.y >> 4u ) & 7u; }\n" \
+  "vec2 unpack_light() { return vec2( ( a_vpacked.x >> 24u ) & 15u, ( a_vpacked.x >> 28u ) & 15u ) / 15.0; }\n" \
+  "vec2 unpack_st() { return vec2( ( a_vpacked.x >> 19u ) & 31u, ( a_vpacked.y >> 7u ) & 511u ); }\n" \
+  "uint unpack_quad_ao() { return a_vpacked.y >> 16u; }\n"
+
+// struct of world state that would be saved/loaded from a file
+typedef struct chunks_world_t {
+  chunk_t _chunks[CHUNKS_MAX]; // indexed by chunk id ie slot in the cache
+  chunk_cache_t cache;
+  chunk_quadtree_t quadtree; // the same resident chunks, by position. see chunks_sort_draw_queue()
+  char world_name[256];     // prefix of region file names
+  int centre_cx, centre_cz; // chunk the camera was in at the last chunks_stream()
+  int radius;               // in chunks
+  size_t memory_budget;
+  uint32_t seed;
+  chunk_mesher_t mesher;
+  bool chunks_created;
+  bool slice_view_mode;
+  int slice_y; // layers from here up are hidden in slice view
+} chunks_world_t;
+
+static chunks_world_t _g_chunks_world = {
+  .mesher = CHUNK_MESHER_GREEDY, .radius = CHUNKS_DEFAULT_RADIUS, .memory_budget = CHUNKS_DEFAULT_MEMORY_BUDGET, .slice_y = CHUNK_Y / 2 };
+
+// rounds towards negative infinity, unlike /, so that eg chunk -1 is in region -1
+static int _floor_div( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); }
+
+static bool _is_chunk_id_resident( int chunk_id ) {
+  return chunk_id >= 0 && chunk_id < CHUNKS_MAX && _g_chunks_world.cache.slots && _g_chunks_world.cache.slots[chunk_id].in_use;
+}
+
+/* RETURNS the id of the resident chunk next to chunk_id in direction 0-3 ( -x,+x,-z,+z ) or diagonal to it in 4-7 ( -x-z,+x-z,-x+z,+x+z ), like
+chunk_neighbours_t, or -1 if it isn't resident */
+static int _adjacent_chunk_id( int chunk_id, int direction ) {
+  const int dx[8]                = { -1, 1, 0, 0, -1, 1, -1, 1 };
+  const int dz[8]                = { 0, 0, -1, 1, -1, -1, 1, 1 };
+  const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[chunk_id];
+  return chunk_cache_find( &_g_chunks_world.cache, slot->cx + dx[direction], slot->cz + dz[direction] );
+}
+
+// NULL for chunks that aren't resident, which mesh like the edge of the world until they are
+static chunk_neighbours_t _chunk_neighbours( int chunk_id ) {
+  assert( _is_chunk_id_resident( chunk_id ) );
+
+  chunk_neighbours_t neighbours = ( chunk_neighbours_t ){ .adjacent = { NULL } };
+  for ( int i = 0; i < 4; i++ ) {
+    const int adjacent_id = _adjacent_chunk_id( chunk_id, i );
+    const int diagonal_id = _adjacent_chunk_id( chunk_id, 4 + i );
+    if ( adjacent_id >= 0 ) { neighbours.adjacent[i] = &_g_chunks_world._chunks[adjacent_id]; }
+    if ( diagonal_id >= 0 ) { neighbours.diagonal[i] = &_g_chunks_world._chunks[diagonal_id]; }
   }
+  return neighbours;
+}
 
-  return cube;
+// call whenever a chunk's arrays may have been allocated, freed, compressed or decompressed. 0 once it's evicted
+static void _update_chunk_bytes( int chunk_id ) {
+  const size_t n_bytes   = _g_chunks_world.cache.slots[chunk_id].in_use ? chunk_resident_bytes( &_g_chunks_world._chunks[chunk_id] ) : 0;
+  _resident_bytes        = _resident_bytes - _chunk_bytes[chunk_id] + n_bytes;
+  _chunk_bytes[chunk_id] = n_bytes;
 }
-#endif
 
-static bool _set_block_type_in_chunk( chunk_t* chunk, int x, int y, int z, block_type_t type ) {
-  assert( chunk && chunk->voxels );
+// anything that changes a section's mesh changes the chunk's LOD mesh too. edits and light can allocate or decompress the chunk's arrays
+static void _mark_sections_dirty( int chunk_id, uint32_t section_mask ) {
+  _update_chunk_bytes( chunk_id );
+  _dirty_sections[chunk_id] |= section_mask;
+  if ( section_mask ) { _stale_lod_meshes[chunk_id] = true; }
+}
 
-  bool changed = false;
+// the diagonal ones too, whose ambient occlusion reads this chunk's corner columns
+static void _mark_adjacent_chunks_dirty( int chunk_id, uint32_t section_mask ) {
+  for ( int i = 0; i < 8; i++ ) {
+    const int adjacent_id = _adjacent_chunk_id( chunk_id, i );
+    if ( adjacent_id >= 0 ) { _mark_sections_dirty( adjacent_id, section_mask ); }
+  }
+}
 
-  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return changed; }
+static chunk_t* _light_chunk_at( int cx, int cz, void* user_ptr ) {
+  (void)user_ptr;
+  const int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+  return chunk_id >= 0 ? &_g_chunks_world._chunks[chunk_id] : NULL;
+}
 
-  int idx = CHUNK_X * CHUNK_Z * y + CHUNK_X * z + x;
+static void _light_sections_changed( int cx, int cz, uint32_t section_mask, void* user_ptr ) {
+  (void)user_ptr;
+  const int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+  if ( chunk_id >= 0 ) { _mark_sections_dirty( chunk_id, section_mask ); }
+}
 
-  block_type_t prev_type = chunk->voxels[idx].type;
-  if ( prev_type == type ) { return changed; } // no change!
-  if ( prev_type == BLOCK_TYPE_AIR && type != BLOCK_TYPE_AIR ) { chunk->n_non_air_voxels++; }
-  if ( prev_type != BLOCK_TYPE_AIR && type == BLOCK_TYPE_AIR ) {
-    assert( chunk->n_non_air_voxels > 0 );
-    chunk->n_non_air_voxels--;
+// writes world voxel x,y,z to entry i of _volume_edit_xyz
+static void _record_changed_voxel( int i, int x, int y, int z ) {
+  if ( i >= _volume_edit_max ) {
+    _volume_edit_max = _volume_edit_max ? _volume_edit_max * 2 : 4096;
+    _volume_edit_xyz = realloc( _volume_edit_xyz, _volume_edit_max * 3 * sizeof( int ) );
+    assert( _volume_edit_xyz );
   }
-  chunk->voxels[idx].type = type;
+  _volume_edit_xyz[i * 3]     = x;
+  _volume_edit_xyz[i * 3 + 1] = y;
+  _volume_edit_xyz[i * 3 + 2] = z;
+}
 
-  int prev_height = chunk->heightmap[CHUNK_X * z + x];
-  if ( y > prev_height && type != BLOCK_TYPE_AIR ) { // higher than before
-    chunk->heightmap[CHUNK_X * z + x] = y;
-  } else if ( y == prev_height && type == BLOCK_TYPE_AIR ) { // lowering
-    for ( int yy = y; yy >= 0; yy-- ) {
-      int idx = CHUNK_X * CHUNK_Z * yy + CHUNK_X * z + x;
-      if ( chunk->voxels[idx].type != BLOCK_TYPE_AIR ) {
-        chunk->heightmap[CHUNK_X * z + x] = yy;
-        break;
-      }
-    }
+/* marks the sections around voxels edited in layers min_y to max_y, within columns min_x..max_x and min_z..max_z of the chunk, dirty. only the sections
+around the edit are remeshed, plus any the light engine reports as changed */
+static void _mark_edited( int chunk_id, int min_x, int min_z, int max_x, int max_z, int min_y, int max_y ) {
+  const uint32_t sections = chunk_sections_changed_by_edit( min_y, min_y, max_y );
+  _mark_sections_dirty( chunk_id, sections );
+  _unsaved_chunks[chunk_id]    = true;
+  _mesh_cache_chunks[chunk_id] = false;
+  // a voxel on the border can hide or reveal a face in the chunk next door, and one in a corner column can shade a corner of a face diagonally across
+  const bool on_border[8] = { 0 == min_x, CHUNK_X - 1 == max_x, 0 == min_z, CHUNK_Z - 1 == max_z, 0 == min_x && 0 == min_z,
+    CHUNK_X - 1 == max_x && 0 == min_z, 0 == min_x && CHUNK_Z - 1 == max_z, CHUNK_X - 1 == max_x && CHUNK_Z - 1 == max_z };
+  for ( int i = 0; i < 8; i++ ) {
+    const int adjacent_id = on_border[i] ? _adjacent_chunk_id( chunk_id, i ) : -1;
+    if ( adjacent_id >= 0 ) { _mark_sections_dirty( adjacent_id, sections ); }
   }
+}
 
-  assert( chunk->n_non_air_voxels <= CHUNK_X * CHUNK_Y * CHUNK_Z );
+// light is updated for the whole tick's changes at once, after it
+static void _fluid_block_changed( int x, int y, int z, void* user_ptr ) {
+  (void)user_ptr;
+  const int cx       = _floor_div( x, CHUNK_X ), cz = _floor_div( z, CHUNK_Z );
+  const int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+  assert( chunk_id >= 0 ); // the sim only changes voxels in loaded chunks
+  const int local_x = x - cx * CHUNK_X, local_z = z - cz * CHUNK_Z;
+  _mark_edited( chunk_id, local_x, local_z, local_x, local_z, y, y );
+  _record_changed_voxel( _n_fluid_changed++, x, y, z );
+}
 
-  changed = true;
-  return changed;
+/* keeps the last region file used open, since chunks are loaded and saved in runs next to each other.
+if the file is missing and not being created then region_open_existing() fails and the chunk isn't in a region yet
+the region's mesh cache file is opened alongside it the first time it's needed */
+typedef struct region_cursor_t {
+  region_t region;
+  bool open;
+  region_t meshes;
+  bool meshes_open, meshes_tried;
+} region_cursor_t;
+
+static void _region_cursor_close( region_cursor_t* cursor ) {
+  if ( cursor->open ) { region_close( &cursor->region ); }
+  if ( cursor->meshes_open ) { region_close( &cursor->meshes ); }
+  cursor->open = cursor->meshes_open = cursor->meshes_tried = false;
 }
 
-static bool _get_block_type_in_chunk( const chunk_t* chunk, int x, int y, int z, block_type_t* block_type ) {
-  assert( chunk && chunk->voxels && block_type );
-  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return false; }
+// RETURNS false if the region file for chunk cx,cz doesn't exist and create_if_missing is false, or couldn't be opened
+static bool _region_cursor_seek( region_cursor_t* cursor, int cx, int cz, bool create_if_missing, int* local_x, int* local_z ) {
+  const int rx = _floor_div( cx, REGION_CHUNKS_W );
+  const int rz = _floor_div( cz, REGION_CHUNKS_W );
+  *local_x     = cx - rx * REGION_CHUNKS_W;
+  *local_z     = cz - rz * REGION_CHUNKS_W;
+  if ( cursor->open && cursor->region.region_x == rx && cursor->region.region_z == rz ) { return true; }
+
+  _region_cursor_close( cursor );
+  char filename[512];
+  snprintf( filename, sizeof( filename ), "%s.%i.%i.region", _g_chunks_world.world_name, rx, rz );
+  cursor->open = create_if_missing ? region_open( filename, rx, rz, &cursor->region ) : region_open_existing( filename, rx, rz, &cursor->region );
+  return cursor->open;
+}
 
-  int idx     = CHUNK_X * CHUNK_Z * y + CHUNK_X * z + x;
-  *block_type = chunk->voxels[idx].type;
-  return true;
+/* the mesh cache file of the region the cursor was last sought to. a missing one is only looked for once per region
+RETURNS NULL if it doesn't exist and create_if_missing is false, or couldn't be opened */
+static region_t* _region_cursor_meshes( region_cursor_t* cursor, bool create_if_missing ) {
+  assert( cursor->open );
+  if ( cursor->meshes_open ) { return &cursor->meshes; }
+  if ( cursor->meshes_tried && !create_if_missing ) { return NULL; }
+
+  const int rx = cursor->region.region_x, rz = cursor->region.region_z;
+  char filename[512];
+  snprintf( filename, sizeof( filename ), "%s.%i.%i.meshes", _g_chunks_world.world_name, rx, rz );
+  cursor->meshes_open  = create_if_missing ? region_open( filename, rx, rz, &cursor->meshes ) : region_open_existing( filename, rx, rz, &cursor->meshes );
+  cursor->meshes_tried = true;
+  return cursor->meshes_open ? &cursor->meshes : NULL;
 }
 
-static bool _is_voxel_above_surface( const chunk_t* chunk, int x, int y, int z ) {
-  assert( chunk && chunk->voxels );
-  // edges of chunk will be lit by sunlight
-  if ( x < 0 || x >= CHUNK_X || y < 0 || y >= CHUNK_Y || z < 0 || z >= CHUNK_Z ) { return true; }
+static chunk_t _generate_chunk( int cx, int cz ) { return chunk_generate( _g_chunks_world.seed, cx, cz ); }
 
-  int idx    = CHUNK_X * z + x;
-  int height = chunk->heightmap[idx];
-  if ( y > height ) { return true; }
-  return false;
+// layers covered by one section, for chunk_gen_vertex_data()
+static void _section_layers( int section, int* from_y_inclusive, int* to_y_exclusive ) {
+  *from_y_inclusive = section * CHUNK_SECTION_Y;
+  *to_y_exclusive   = *from_y_inclusive + CHUNK_SECTION_Y;
 }
 
-static bool _is_voxel_face_exposed_to_sun( const chunk_t* chunk, int x, int y, int z, int face_idx ) {
-  assert( chunk && chunk->voxels );
-
-  switch ( face_idx ) {
-  case 0: return _is_voxel_above_surface( chunk, x - 1, y, z );
-  case 1: return _is_voxel_above_surface( chunk, x + 1, y, z );
-  case 2: return _is_voxel_above_surface( chunk, x, y - 1, z );
-  case 3: return _is_voxel_above_surface( chunk, x, y + 1, z );
-  case 4: return _is_voxel_above_surface( chunk, x, y, z - 1 );
-  case 5: return _is_voxel_above_surface( chunk, x, y, z + 1 );
-  default: assert( false ); break;
+/* meshes every section of the chunk at full detail on the main thread. vertex_data is indexed by section and views the main arena, so it's only valid
+until the arena is next used */
+static void _mesh_chunk_sections( int chunk_id, const chunk_neighbours_t* neighbours, chunk_vertex_data_t* vertex_data, uint16_t* connectivity ) {
+  size_t first_vertex[CHUNK_SECTIONS];
+  chunk_mesh_arena_reset( &_main_mesh_arena );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    int from_y = 0, to_y = 0;
+    _section_layers( section, &from_y, &to_y );
+    first_vertex[section] = _main_mesh_arena.n_vertices;
+    chunk_gen_vertex_data_in_arena( &_main_mesh_arena, &_g_chunks_world._chunks[chunk_id], neighbours, from_y, to_y, _g_chunks_world.mesher );
+    connectivity[section] = chunk_section_connectivity( &_g_chunks_world._chunks[chunk_id], section );
+  }
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const size_t end     = section < CHUNK_SECTIONS - 1 ? first_vertex[section + 1] : _main_mesh_arena.n_vertices;
+    vertex_data[section] = chunk_mesh_arena_vertex_data( &_main_mesh_arena, first_vertex[section], end - first_vertex[section] );
   }
-  return false;
 }
 
-// TODO ifdef write_heightmap img
-// PARAMS
-// - hm_dims - square heightmap so use width or height in pixels here
-static chunk_t _chunk_generate( const uint8_t* heightmap, int hm_dims, int x_offset, int z_offset ) {
-  assert( heightmap );
+/* makes chunk cx,cz resident, from its region file if it was saved or else generated
+RETURNS the new chunk id or -1 if the cache is full */
+static int _load_chunk( int cx, int cz, region_cursor_t* cursor ) {
+  const int chunk_id = chunk_cache_insert( &_g_chunks_world.cache, cx, cz );
+  if ( chunk_id < 0 ) { return -1; }
+  chunk_quadtree_insert( &_g_chunks_world.quadtree, cx, cz, chunk_id );
+
+  chunk_t* chunk = &_g_chunks_world._chunks[chunk_id];
+  int local_x = 0, local_z = 0;
+  bool loaded = _region_cursor_seek( cursor, cx, cz, false, &local_x, &local_z ) && region_has_chunk( &cursor->region, local_x, local_z ) &&
+                region_load_chunk( &cursor->region, local_x, local_z, chunk );
+  if ( !loaded ) { *chunk = _generate_chunk( cx, cz ); }
+
+  _mark_sections_dirty( chunk_id, ALL_SECTIONS_MASK );
+  _unsaved_chunks[chunk_id]    = false;
+  _mesh_cache_chunks[chunk_id] = loaded;
+  // until it's meshed, assume you can see through every section
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { _section_connectivity[chunk_id][section] = CHUNK_SECTION_ALL_CONNECTED; }
+  // faces of the neighbours on the shared border were meshed as the edge of the world
+  _mark_adjacent_chunks_dirty( chunk_id, ALL_SECTIONS_MASK );
+  light_chunk_loaded( &_light, cx, cz );
+  fluid_chunk_loaded( &_fluid, cx, cz );
+  _update_chunk_bytes( chunk_id );
+  return chunk_id;
+}
 
+/* the worker meshes a private copy of the chunk and the border columns of its neighbours, so the main thread is free to keep editing voxels while the job runs.
+edits made meanwhile mark the chunk dirty again and it is re-queued once this job is done */
+typedef struct chunk_mesh_job_t {
+  int chunk_id;
+  uint32_t generation;
+  uint32_t section_mask; // sections to mesh
+  int lod;               // if not 0 the whole chunk is meshed at this level of detail instead, into vertex_data[0]
+  chunk_mesher_t mesher;
+  bool cache_only; // for the mesh cache blob of chunk cx,cz rather than to upload. see _push_mesh_cache_job()
+  bool from_cache; // try chunk cx,cz's mesh cache blob before meshing it. see _read_cached_meshes()
+  int cx, cz;
+  uint64_t cache_key;
   chunk_t chunk;
-  memset( &chunk, 0, sizeof( chunk_t ) );
-  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
-  assert( chunk.voxels );
-
-  for ( int z = 0; z < CHUNK_Z; z++ ) {
-    for ( int x = 0; x < CHUNK_X; x++ ) {
-      // uint8_t height = _noisei( x, z, CHUNK_Y - 1 ); // TODO add position of chunk to x and y for continuous/infinite map
-
-      int xx                       = x_offset + x;
-      int zz                       = z_offset + z;
-      int idx                      = hm_dims * zz + xx; // uses offsets and width/height of map
-      const int underground_height = 16;
-      const int heightmap_sample   = heightmap[idx]; // uint8_t to int to avoid overflow when adding a hm sample of 255 to underground height > 0
+  chunk_t adjacent[4];
+  chunk_t diagonal[4];
+  chunk_neighbours_t neighbours;
+  // output. the worker's arena is reused by its next job, so the vertices are copied out of it into one exactly-sized buffer for the whole job
+  uint32_t* packed_ptr;
+  uint8_t* blob; // instead of packed_ptr when the meshes came from the mesh cache
+  chunk_vertex_data_t vertex_data[CHUNK_SECTIONS]; // views into packed_ptr. only the sections in section_mask are set
+  uint16_t connectivity[CHUNK_SECTIONS];           // only the sections in section_mask are set
+} chunk_mesh_job_t;
+
+static chunk_mesh_job_t* _finished_mesh_cache_jobs[CHUNKS_MAX_MESH_CACHE_JOBS]; // waiting for their blobs to be written
+static int _n_finished_mesh_cache_jobs;
+
+/* on a worker, so neither hashing the chunk nor reading the blob holds up the frame. the mesh cache file gets its own handle here. the main thread
+doesn't write blobs while these jobs are in flight, see _write_finished_mesh_cache_jobs()
+RETURNS true if the blob matched the chunk and its neighbours as copied, with vertex_data and connectivity pointing into job->blob */
+static bool _read_cached_meshes( chunk_mesh_job_t* job ) {
+  const int rx = _floor_div( job->cx, REGION_CHUNKS_W );
+  const int rz = _floor_div( job->cz, REGION_CHUNKS_W );
+  char filename[512];
+  snprintf( filename, sizeof( filename ), "%s.%i.%i.meshes", _g_chunks_world.world_name, rx, rz );
+  region_t meshes;
+  if ( !region_open_existing( filename, rx, rz, &meshes ) ) { return false; }
+  const uint64_t key = mesh_cache_key( &job->chunk, &job->neighbours, job->mesher );
+  const bool hit = mesh_cache_read( &meshes, job->cx - rx * REGION_CHUNKS_W, job->cz - rz * REGION_CHUNKS_W, key, &job->blob, job->vertex_data, job->connectivity );
+  region_close( &meshes );
+  return hit;
+}
 
-      uint8_t height = CLAMP( heightmap_sample + underground_height, 1, CHUNK_Y - 1 ); // -1 because chunk_y is 256 which would wrap around to 0 in a uint8
+static void _chunk_mesh_job_fn( int worker_idx, void* args ) {
+  chunk_mesh_job_t* job     = (chunk_mesh_job_t*)args;
+  chunk_mesh_arena_t* arena = &_worker_mesh_arenas[worker_idx];
+  // a miss is meshed here in the same job, as usual
+  if ( job->from_cache && _read_cached_meshes( job ) ) { return; }
+  // every voxel of the sections is visited so decompress it here on the worker. neighbours are only read along the border and stay compressed
+  chunk_decompress( &job->chunk );
+  chunk_mesh_arena_reset( arena );
+  size_t first_vertex[CHUNK_SECTIONS + 1];
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    first_vertex[section] = arena->n_vertices;
+    if ( job->lod && 0 == section ) { chunk_gen_lod_vertex_data_in_arena( arena, &job->chunk, &job->neighbours, job->lod ); }
+    if ( !( job->section_mask & ( 1u << section ) ) ) { continue; }
+    int from_y = 0, to_y = 0;
+    _section_layers( section, &from_y, &to_y );
+    chunk_gen_vertex_data_in_arena( arena, &job->chunk, &job->neighbours, from_y, to_y, job->mesher );
+    job->connectivity[section] = chunk_section_connectivity( &job->chunk, section );
+  }
+  first_vertex[CHUNK_SECTIONS] = arena->n_vertices;
+  if ( job->cache_only ) { job->cache_key = mesh_cache_key( &job->chunk, &job->neighbours, job->mesher ); }
+
+  const size_t n_bytes = arena->n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t );
+  job->packed_ptr      = malloc( n_bytes > 0 ? n_bytes : 1 );
+  assert( job->packed_ptr );
+  memcpy( job->packed_ptr, arena->packed_ptr, n_bytes );
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    const size_t n_vertices   = first_vertex[section + 1] - first_vertex[section];
+    job->vertex_data[section] = ( chunk_vertex_data_t ){ .packed_ptr = &job->packed_ptr[first_vertex[section] * VOXEL_VPACKED_COMPS],
+      .n_vertices                                                    = n_vertices,
+      .n_vpacked_comps                                               = VOXEL_VPACKED_COMPS,
+      .vpacked_buffer_sz                                             = n_vertices * VOXEL_VPACKED_COMPS * sizeof( uint32_t ) };
+  }
+}
 
-      _set_block_type_in_chunk( &chunk, x, height, z, BLOCK_TYPE_GRASS );
-      _set_block_type_in_chunk( &chunk, x, height - 1, z, BLOCK_TYPE_DIRT );
-      for ( int y = height - 2; y > 0; y-- ) { _set_block_type_in_chunk( &chunk, x, y, z, BLOCK_TYPE_STONE ); }
-      _set_block_type_in_chunk( &chunk, x, 0, z, BLOCK_TYPE_CRUST );
-    } // x
-  }   // z
+static void _free_chunk_mesh_job( chunk_mesh_job_t* job ) {
+  free( job->packed_ptr );
+  free( job->blob );
+  chunk_free( &job->chunk );
+  for ( int i = 0; i < 4; i++ ) {
+    if ( job->neighbours.adjacent[i] ) { chunk_free( &job->adjacent[i] ); }
+    if ( job->neighbours.diagonal[i] ) { chunk_free( &job->diagonal[i] ); }
+  }
+  free( job );
+}
 
-  return chunk;
+// RETURNS a job with private copies of the chunk and the parts of its resident neighbours it's meshed against. the caller sets what to mesh
+static chunk_mesh_job_t* _alloc_chunk_mesh_job( int chunk_id ) {
+  const chunk_neighbours_t live_neighbours = _chunk_neighbours( chunk_id );
+
+  chunk_mesh_job_t* job = calloc( 1, sizeof( chunk_mesh_job_t ) );
+  assert( job );
+  job->chunk_id = chunk_id;
+  job->mesher   = _g_chunks_world.mesher;
+  job->chunk    = chunk_copy( &_g_chunks_world._chunks[chunk_id] );
+  // meshing only reads the neighbours' columns along the border, and the corner column of the diagonal ones, so that's all that's copied
+  const int border_min_x[4] = { CHUNK_X - 1, 0, 0, 0 }, border_max_x[4] = { CHUNK_X - 1, 0, CHUNK_X - 1, CHUNK_X - 1 };
+  const int border_min_z[4] = { 0, 0, CHUNK_Z - 1, 0 }, border_max_z[4] = { CHUNK_Z - 1, CHUNK_Z - 1, CHUNK_Z - 1, 0 };
+  const int corner_x[4] = { CHUNK_X - 1, 0, CHUNK_X - 1, 0 }, corner_z[4] = { CHUNK_Z - 1, CHUNK_Z - 1, 0, 0 };
+  for ( int i = 0; i < 4; i++ ) {
+    if ( live_neighbours.adjacent[i] ) {
+      job->adjacent[i]            = chunk_copy_columns( live_neighbours.adjacent[i], border_min_x[i], border_min_z[i], border_max_x[i], border_max_z[i] );
+      job->neighbours.adjacent[i] = &job->adjacent[i];
+    }
+    if ( live_neighbours.diagonal[i] ) {
+      job->diagonal[i]            = chunk_copy_columns( live_neighbours.diagonal[i], corner_x[i], corner_z[i], corner_x[i], corner_z[i] );
+      job->neighbours.diagonal[i] = &job->diagonal[i];
+    }
+  }
+  return job;
 }
 
-#if 0
-static chunk_t _chunk_generate_flat() {
-  chunk_t chunk;
+// runs on the main thread from worker_pool_update(). the blob is written with the others that finished by _write_finished_mesh_cache_jobs()
+static void _mesh_cache_job_finished_cb( const char* name, void* args ) {
+  (void)name;
+  assert( _n_finished_mesh_cache_jobs < CHUNKS_MAX_MESH_CACHE_JOBS );
+  _finished_mesh_cache_jobs[_n_finished_mesh_cache_jobs++] = (chunk_mesh_job_t*)args;
+}
 
-  memset( &chunk, 0, sizeof( chunk_t ) );
-  chunk.voxels = calloc( CHUNK_X * CHUNK_Y * CHUNK_Z, sizeof( voxel_t ) );
-  assert( chunk.voxels );
+static int _compare_job_regions( const void* a, const void* b ) {
+  const chunk_mesh_job_t* job_a = *(chunk_mesh_job_t* const*)a;
+  const chunk_mesh_job_t* job_b = *(chunk_mesh_job_t* const*)b;
+  const int rx_a = _floor_div( job_a->cx, REGION_CHUNKS_W ), rz_a = _floor_div( job_a->cz, REGION_CHUNKS_W );
+  const int rx_b = _floor_div( job_b->cx, REGION_CHUNKS_W ), rz_b = _floor_div( job_b->cz, REGION_CHUNKS_W );
+  if ( rz_a != rz_b ) { return rz_a < rz_b ? -1 : 1; }
+  return rx_a < rx_b ? -1 : rx_a > rx_b;
+}
 
-  for ( int z = 0; z < CHUNK_Z; z++ ) {
-    for ( int x = 0; x < CHUNK_X; x++ ) {
-      uint8_t height = 0;
-      _set_block_type_in_chunk( &chunk, x, height, z, BLOCK_TYPE_CRUST );
-    } // x
-  }   // z
+/* writes the blobs of the mesh cache jobs that have finished, grouped by region so that each region's files are opened once. the chunks may have been
+evicted since, so this goes by the chunk coords the jobs were made with. waits while a worker may be reading a mesh cache file, see
+_read_cached_meshes() */
+static void _write_finished_mesh_cache_jobs() {
+  if ( 0 == _n_finished_mesh_cache_jobs || _n_mesh_cache_reads > 0 ) { return; }
+
+  qsort( _finished_mesh_cache_jobs, _n_finished_mesh_cache_jobs, sizeof( chunk_mesh_job_t* ), _compare_job_regions );
+  region_cursor_t cursor = ( region_cursor_t ){ .open = false };
+  for ( int i = 0; i < _n_finished_mesh_cache_jobs; i++ ) {
+    chunk_mesh_job_t* job = _finished_mesh_cache_jobs[i];
+    int local_x = 0, local_z = 0;
+    region_t* meshes = _region_cursor_seek( &cursor, job->cx, job->cz, false, &local_x, &local_z ) ? _region_cursor_meshes( &cursor, true ) : NULL;
+    if ( !meshes || !mesh_cache_write( meshes, local_x, local_z, job->cache_key, job->vertex_data, job->connectivity ) ) {
+      fprintf( stderr, "WARNING: could not write the meshes of chunk %i,%i to its region's mesh cache\n", job->cx, job->cz );
+    }
+    _free_chunk_mesh_job( job );
+  }
+  _region_cursor_close( &cursor );
+  assert( _n_mesh_cache_jobs >= _n_finished_mesh_cache_jobs );
+  _n_mesh_cache_jobs -= _n_finished_mesh_cache_jobs;
+  _n_finished_mesh_cache_jobs = 0;
+}
 
-  return chunk;
+/* meshes every section of the chunk on a worker for its mesh cache blob, which is written when the job comes back. the meshes are made against the
+neighbours resident now. if they're different when the chunk is next loaded the key won't match and it's meshed as usual
+RETURNS false if CHUNKS_MAX_MESH_CACHE_JOBS are already in flight or the queue is full. the chunk stays pending */
+static bool _push_mesh_cache_job( int chunk_id ) {
+  if ( _n_mesh_cache_jobs >= CHUNKS_MAX_MESH_CACHE_JOBS ) { return false; }
+
+  const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[chunk_id];
+  chunk_mesh_job_t* job          = _alloc_chunk_mesh_job( chunk_id );
+  job->section_mask              = ALL_SECTIONS_MASK;
+  job->cache_only                = true;
+  job->cx                        = slot->cx;
+  job->cz                        = slot->cz;
+
+  job_description_t job_description = ( job_description_t ){
+    .job_function_ptr = _chunk_mesh_job_fn, .job_function_args = job, .on_finished_cb = _mesh_cache_job_finished_cb };
+  snprintf( job_description.name, sizeof( job_description.name ), "cache chunk %i", chunk_id );
+  if ( !worker_pool_push_job( job_description ) ) {
+    _free_chunk_mesh_job( job );
+    return false;
+  }
+  _mesh_cache_pending[chunk_id] = false;
+  _n_mesh_cache_jobs++;
+  return true;
 }
 
-static bool chunk_write_heightmap( const char* filename, const chunk_t* chunk ) {
-  assert( filename && chunk && chunk->voxels );
-  uint8_t* img = malloc( CHUNK_X * CHUNK_Z * 3 );
-  for ( int z = 0; z < CHUNK_Z; z++ ) {
-    for ( int x = 0; x < CHUNK_X; x++ ) {
-      img[( CHUNK_X * z + x ) * 3] = img[( CHUNK_X * z + x ) * 3 + 1] = img[( CHUNK_X * z + x ) * 3 + 2] = chunk->heightmap[CHUNK_X * z + x];
+/* called once a frame, after the chunks' own mesh jobs are queued. a chunk edited again since it was saved is dropped, as its blob would be for voxels
+that aren't on disk. its next save makes it pending again */
+static void _push_pending_mesh_cache_jobs() {
+  for ( int i = 0; i < CHUNKS_MAX && _n_mesh_cache_jobs < CHUNKS_MAX_MESH_CACHE_JOBS; i++ ) {
+    if ( !_mesh_cache_pending[i] ) { continue; }
+    if ( _unsaved_chunks[i] ) {
+      _mesh_cache_pending[i] = false;
+      continue;
     }
+    if ( !_push_mesh_cache_job( i ) ) { break; } // queue full. try again next frame
   }
-  bool result = (bool)apg_tga_write_file( filename, img, CHUNK_X, CHUNK_Z, 3 );
-  free( img );
-  return result;
-}
-#endif
-
-static void chunk_free( chunk_t* chunk ) {
-  assert( chunk && chunk->voxels );
-
-  free( chunk->voxels );
-  memset( chunk, 0, sizeof( chunk_t ) );
-}
-
-static void _memcpy_face_palidx( block_type_t block_type, uint32_t* dest ) {
-  assert( dest );
-
-  uint32_t palidx = 0;
-  switch ( block_type ) {
-  case BLOCK_TYPE_CRUST: {
-    palidx = palette_crust;
-  } break;
-  case BLOCK_TYPE_GRASS: {
-    palidx = palette_grass;
-  } break;
-  case BLOCK_TYPE_DIRT: {
-    palidx = palette_dirt;
-  } break;
-  case BLOCK_TYPE_STONE: {
-    palidx = palette_stone;
-  } break;
-  default: {
-    assert( false );
-  } break;
-  }
-  // per the 6 vertices in this face
-  for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { *( dest + v ) = palidx; }
-}
-
-static void _memcpy_face_picking( int x, int y, int z, int face_idx, float* dest, size_t curr_float, size_t max_floats ) {
-  uint32_t a    = z * CHUNK_X + x; // up 0-255 (16*16). to retrieve: z= a/CHUNK_X, x=a%CHUNK_X (integer rounding maths)
-  uint32_t b    = y;               // up 0-255
-  uint32_t c    = face_idx;        // up 0-5
-  float buff[3] = { a / 255.0f, b / 255.0f, c / 255.0f };
-  // per the 6 vertices in this face
-  assert( curr_float + VOXEL_VPICKING_COMPS * VOXEL_FACE_VERTS < max_floats );
-  for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { memcpy( &dest[curr_float + v * VOXEL_VPICKING_COMPS], buff, sizeof( float ) * VOXEL_VPICKING_COMPS ); }
-}
-
-static void _memcpy_face_texcoords( const chunk_t* chunk, float* dest, size_t curr_float, size_t max_floats ) {
-  assert( chunk );
-
-  const float buff[] = { 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0 };
-  assert( curr_float + VOXEL_VT_COMPS * VOXEL_FACE_VERTS < max_floats );
-  memcpy( &dest[curr_float], buff, sizeof( float ) * VOXEL_VT_COMPS * VOXEL_FACE_VERTS );
-}
-
-static void _memcpy_face_normals( const chunk_t* chunk, int x, int y, int z, int face_idx, float* dest, size_t curr_float, size_t max_floats ) {
-  assert( chunk );
-
-  float buff[4] = { 0, 0, 0, 0 };
-  switch ( face_idx ) {
-  case 0: buff[0] = -1.0f; break;
-  case 1: buff[0] = 1.0f; break;
-  case 2: buff[1] = -1.0f; break;
-  case 3: buff[1] = 1.0f; break;
-  case 4: buff[2] = -1.0f; break;
-  case 5: buff[2] = 1.0f; break;
-  default: assert( false ); break;
+}
+
+// a failure to cache the meshes only loses the cache so it doesn't fail the save
+static bool _save_chunk( int chunk_id, region_cursor_t* cursor ) {
+  const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[chunk_id];
+  int local_x = 0, local_z = 0;
+  if ( !_region_cursor_seek( cursor, slot->cx, slot->cz, true, &local_x, &local_z ) ) { return false; }
+  if ( !region_save_chunk( &cursor->region, local_x, local_z, &_g_chunks_world._chunks[chunk_id] ) ) { return false; }
+  _unsaved_chunks[chunk_id]     = false;
+  _mesh_cache_pending[chunk_id] = true;
+  return true;
+}
+
+// RETURNS where the vertices went in the shared vertex buffer, which grows if they don't fit
+static chunk_mesh_range_t _upload_mesh_range( const chunk_vertex_data_t* vertex_data ) {
+  assert( vertex_data->n_vertices > 0 && VOXEL_VPACKED_COMPS == vertex_data->n_vpacked_comps );
+
+  chunk_mesh_range_t range = ( chunk_mesh_range_t ){ .n_vertices = (uint32_t)vertex_data->n_vertices };
+  range.n_reserved         = ( range.n_vertices + CHUNKS_VERTEX_GRANULE - 1 ) / CHUNKS_VERTEX_GRANULE * CHUNKS_VERTEX_GRANULE;
+  while ( !range_alloc_reserve( &_chunk_vertex_alloc, range.n_reserved, &range.first ) ) {
+    const uint32_t capacity = _chunk_vertex_alloc.capacity * 2;
+    resize_packed_buffer( &_chunk_vertex_buffer, capacity );
+    range_alloc_grow( &_chunk_vertex_alloc, capacity );
   }
-  bool sunlit = _is_voxel_face_exposed_to_sun( chunk, x, y, z, face_idx );
-  if ( sunlit ) { buff[3] = 1.0f; }
-  assert( curr_float + VOXEL_VN_COMPS * VOXEL_FACE_VERTS < max_floats );
-  for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { memcpy( &dest[curr_float + v * VOXEL_VN_COMPS], buff, sizeof( float ) * VOXEL_VN_COMPS ); }
-}
-
-static chunk_vertex_data_t chunk_gen_vertex_data( const chunk_t* chunk, int from_y_inclusive, int to_y_exclusive ) {
-  assert( chunk );
-  assert( from_y_inclusive >= 0 && to_y_exclusive <= CHUNK_Y );
-
-  chunk_vertex_data_t data = ( chunk_vertex_data_t ){
-    .n_vp_comps = VOXEL_VP_COMPS, .n_vt_comps = VOXEL_VT_COMPS, .n_vpicking_comps = VOXEL_VPICKING_COMPS, .n_vn_comps = VOXEL_VN_COMPS, .n_vpalidx_comps = VOXEL_VPALIDX_COMPS
-  };
-  data.vp_buffer_sz       = VOXEL_CUBE_VP_BYTES * chunk->n_non_air_voxels;
-  data.vn_buffer_sz       = VOXEL_CUBE_VN_BYTES * chunk->n_non_air_voxels;
-  data.vt_buffer_sz       = VOXEL_CUBE_VT_BYTES * chunk->n_non_air_voxels;
-  data.vpicking_buffer_sz = VOXEL_CUBE_VPICKING_BYTES * chunk->n_non_air_voxels;
-  data.vpalidx_buffer_sz  = VOXEL_CUBE_VPALIDX_BYTES * chunk->n_non_air_voxels;
-  data.positions_ptr      = malloc( data.vp_buffer_sz );
-  assert( data.positions_ptr );
-  data.palette_indices_ptr = malloc( data.vpalidx_buffer_sz );
-  assert( data.palette_indices_ptr );
-  data.picking_ptr = malloc( data.vpicking_buffer_sz );
-  assert( data.picking_ptr );
-  data.texcoords_ptr = malloc( data.vt_buffer_sz );
-  assert( data.texcoords_ptr );
-  data.normals_ptr = malloc( data.vn_buffer_sz );
-  assert( data.normals_ptr );
-
-  uint32_t total_vp_floats  = 0;
-  uint32_t total_vt_floats  = 0;
-  uint32_t total_vn_floats  = 0;
-  uint32_t total_palindices = 0;
-
-  for ( int y = from_y_inclusive; y < to_y_exclusive; y++ ) {
-    for ( int z = 0; z < CHUNK_Z; z++ ) {
-      for ( int x = 0; x < CHUNK_X; x++ ) {
-        block_type_t our_block_type = 0;
-        bool ret                    = _get_block_type_in_chunk( chunk, x, y, z, &our_block_type );
-        int floats_added_this_block = 0;
-        assert( ret );
-        if ( our_block_type == BLOCK_TYPE_AIR ) { continue; }
-        assert( total_vp_floats < VOXEL_CUBE_VP_FLOATS * chunk->n_non_air_voxels );
-
-        {
-          // clang-format off
-          int xs[6]             = { -1,  1,  0,  0,  0,  0 };
-          int ys[6]             = {  0,  0, -1,  1,  0,  0 };
-          int zs[6]             = {  0,  0,  0,  0, -1,  1 };
-          // clang-format on
-          const float* faces[6] = { _west_face, _east_face, _bottom_face, _top_face, _north_face, _south_face };
-          block_type_t neighbour_block_type;
-          for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
-            bool ret = _get_block_type_in_chunk( chunk, x + xs[face_idx], y + ys[face_idx], z + zs[face_idx], &neighbour_block_type );
-            // if face is valid then add one face's worth of vertex data to the buffer
-            if ( !ret || neighbour_block_type == BLOCK_TYPE_AIR ) {
-              memcpy( &data.positions_ptr[total_vp_floats + floats_added_this_block], faces[face_idx], VOXEL_FACE_VP_BYTES );
-              _memcpy_face_palidx( our_block_type, &data.palette_indices_ptr[total_palindices] );
-              _memcpy_face_picking( x, y, z, face_idx, data.picking_ptr, total_vp_floats + floats_added_this_block, VOXEL_CUBE_VPICKING_FLOATS * chunk->n_non_air_voxels );
-              _memcpy_face_texcoords( chunk, data.texcoords_ptr, total_vt_floats, VOXEL_CUBE_VT_FLOATS * chunk->n_non_air_voxels );
-              _memcpy_face_normals( chunk, x, y, z, face_idx, data.normals_ptr, total_vn_floats, VOXEL_CUBE_VN_FLOATS * chunk->n_non_air_voxels );
-              floats_added_this_block += VOXEL_FACE_VP_FLOATS;
-              total_vt_floats += VOXEL_FACE_VT_FLOATS;
-              total_vn_floats += VOXEL_FACE_VN_FLOATS;
-              total_palindices += VOXEL_FACE_VPALIDX_UINTS;
-            }
-          }
-        }
+  update_packed_buffer( &_chunk_vertex_buffer, range.first, vertex_data->packed_ptr, range.n_vertices );
+  _resident_bytes += range.n_reserved * VOXEL_VPACKED_COMPS * sizeof( uint32_t );
+  return range;
+}
 
-        // assumes xyz positions are first three bytes per vertex
-        for ( int i = 0; i < floats_added_this_block; i += 3 ) {
-          data.positions_ptr[total_vp_floats + i + 0] += x * 2.0f;
-          data.positions_ptr[total_vp_floats + i + 1] += y * 2.0f;
-          data.positions_ptr[total_vp_floats + i + 2] += z * 2.0f;
-        }
-        total_vp_floats += floats_added_this_block;
-      } // endfor x
-    }   // endfor z
-  }     // endfor y
-
-  data.n_vp_comps         = VOXEL_VP_COMPS;
-  data.n_vertices         = total_vp_floats / VOXEL_VP_COMPS;
-  data.vp_buffer_sz       = total_vp_floats * sizeof( float );
-  data.vt_buffer_sz       = total_vt_floats * sizeof( float );
-  data.vn_buffer_sz       = total_vn_floats * sizeof( float );
-  data.vpicking_buffer_sz = total_vp_floats * sizeof( float ); // NOTE(Anton) same as vp
-  data.vpalidx_buffer_sz  = total_palindices * sizeof( uint32_t );
-  // TODO(Anton) add a tmp var to check for realloc success for each
-  data.positions_ptr = realloc( data.positions_ptr, data.vp_buffer_sz );
-  assert( data.positions_ptr );
-  data.palette_indices_ptr = realloc( data.palette_indices_ptr, data.vpalidx_buffer_sz );
-  assert( data.palette_indices_ptr );
-  data.picking_ptr = realloc( data.picking_ptr, data.vpicking_buffer_sz );
-  assert( data.picking_ptr );
-  data.texcoords_ptr = realloc( data.texcoords_ptr, data.vt_buffer_sz );
-  assert( data.texcoords_ptr );
-  data.normals_ptr = realloc( data.normals_ptr, data.vn_buffer_sz );
-  assert( data.normals_ptr );
-
-  return data;
-}
-
-static void chunk_free_vertex_data( chunk_vertex_data_t* chunk_vertex_data ) {
-  assert( chunk_vertex_data && chunk_vertex_data->positions_ptr );
-
-  free( chunk_vertex_data->positions_ptr );
-  free( chunk_vertex_data->palette_indices_ptr );
-  free( chunk_vertex_data->picking_ptr );
-  free( chunk_vertex_data->texcoords_ptr );
-  free( chunk_vertex_data->normals_ptr );
-  memset( chunk_vertex_data, 0, sizeof( chunk_vertex_data_t ) );
+static void _release_mesh_range( chunk_mesh_range_t* range ) {
+  if ( range->n_reserved ) { range_alloc_release( &_chunk_vertex_alloc, range->first, range->n_reserved ); }
+  _resident_bytes -= range->n_reserved * VOXEL_VPACKED_COMPS * sizeof( uint32_t );
+  *range = ( chunk_mesh_range_t ){ .n_reserved = 0 };
 }
 
-/*-------------------------------------------------CHUNKS ORGANISATION-----------------------------------------------------*/
+static void _delete_section_meshes( int chunk_id ) {
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) { _release_mesh_range( &_chunk_meshes[chunk_id][section] ); }
+}
 
-// total number of chunks
-#define CHUNKS_N 256
-#define VOXEL_SCALE 0.2f
+static void _delete_lod_mesh( int chunk_id ) {
+  _release_mesh_range( &_chunk_lod_meshes[chunk_id] );
+  _chunk_lod_mesh_levels[chunk_id] = 0;
+}
 
-// generated graphics stuff that doesn't persist between save/load
-static bool _dirty_chunks[CHUNKS_N];
-static mesh_t _chunk_meshes[CHUNKS_N];
-static mat4 _chunks_M[CHUNKS_N];
-static shader_t _voxel_shader;
-static shader_t _colour_picking_shader;
-static texture_t _array_texture;
+static void _delete_chunk_meshes( int chunk_id ) {
+  _delete_section_meshes( chunk_id );
+  _delete_lod_mesh( chunk_id );
+}
 
-// struct of world state that would be saved/loaded from a file
-typedef struct chunks_world_t {
-  chunk_t _chunks[CHUNKS_N];
-  int _chunks_w, _chunks_h;
-  uint32_t seed;
-  bool chunks_created;
-  bool slice_view_mode;
-} chunks_world_t;
+// RETURNS false, and keeps the chunk, if it had unsaved changes that couldn't be saved
+static bool _evict_chunk( int chunk_id, region_cursor_t* cursor ) {
+  assert( _is_chunk_id_resident( chunk_id ) && !_chunk_mesh_job_in_flight[chunk_id] );
 
-static chunks_world_t _g_chunks_world;
+  if ( _unsaved_chunks[chunk_id] && !_save_chunk( chunk_id, cursor ) ) {
+    fprintf( stderr, "ERROR: could not save chunk %i to its region file. keeping it resident\n", chunk_id );
+    return false;
+  }
+  // last chance to cache its meshes, if there's room for the job. if not it's just meshed as usual when it's next loaded
+  if ( _mesh_cache_pending[chunk_id] ) { _push_mesh_cache_job( chunk_id ); }
+  _mesh_cache_pending[chunk_id] = false;
+  _mark_adjacent_chunks_dirty( chunk_id, ALL_SECTIONS_MASK );
+  _delete_chunk_meshes( chunk_id );
+  chunk_free( &_g_chunks_world._chunks[chunk_id] );
+  _dirty_sections[chunk_id]           = 0;
+  _mesh_cache_chunks[chunk_id]        = false;
+  _stale_lod_meshes[chunk_id]         = false;
+  _chunk_lods[chunk_id]               = 0;
+  _visible_sections[chunk_id]         = 0;
+  _chunk_mesh_requested_gen[chunk_id] = 0;
+  _chunk_mesh_uploaded_gen[chunk_id]  = 0;
+  chunk_quadtree_remove( &_g_chunks_world.quadtree, _g_chunks_world.cache.slots[chunk_id].cx, _g_chunks_world.cache.slots[chunk_id].cz );
+  chunk_cache_remove( &_g_chunks_world.cache, chunk_id );
+  _update_chunk_bytes( chunk_id );
+  return true;
+}
 
-bool chunks_create( uint32_t seed, uint32_t chunks_wide, uint32_t chunks_deep ) {
-  assert( chunks_wide == chunks_deep ); // current limitation
+static bool _is_chunk_in_radius( int cx, int cz ) {
+  const int dx = cx - _g_chunks_world.centre_cx, dz = cz - _g_chunks_world.centre_cz;
+  return dx * dx + dz * dz <= _g_chunks_world.radius * _g_chunks_world.radius;
+}
 
-  if ( _g_chunks_world.chunks_created ) { return false; } // free first
+// chunks being meshed are kept, since the job's result is uploaded by chunk id. chunks in view are kept so they don't reload straight away
+static bool _can_evict_chunk( int chunk_id, void* user_ptr ) {
+  (void)user_ptr;
+  const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[chunk_id];
+  return !_chunk_mesh_job_in_flight[chunk_id] && !_is_chunk_in_radius( slot->cx, slot->cz );
+}
 
-  _g_chunks_world._chunks_w = chunks_wide;
-  _g_chunks_world._chunks_h = chunks_deep;
-  _g_chunks_world.seed      = seed;
+// RETURNS the level of detail for a chunk dx,dz chunks from the camera's chunk. see CHUNKS_LOD_DIST
+static int _chunk_lod_for_dist( int dx, int dz ) {
+  int lod = 0;
+  for ( int dist = CHUNKS_LOD_DIST; lod < CHUNK_LOD_LEVELS - 1 && dx * dx + dz * dz > dist * dist; dist *= 2 ) { lod++; }
+  return lod;
+}
 
-  dsquare_heightmap_t dshm;
-  {
-    srand( seed );
-    assert( CHUNK_X == CHUNK_Z );
-    const int default_height     = 63;
-    const int noise_scale        = 64;
-    const int feature_spread     = 64;
-    const int feature_max_height = 64;
-    dshm                         = dsquare_heightmap_alloc( CHUNK_X * _g_chunks_world._chunks_w, default_height );
-    dsquare_heightmap_gen( &dshm, noise_scale, feature_spread, feature_max_height );
-  }
-
-  for ( int cz = 0; cz < _g_chunks_world._chunks_h; cz++ ) {
-    for ( int cx = 0; cx < _g_chunks_world._chunks_w; cx++ ) {
-      const int idx                = cz * _g_chunks_world._chunks_w + cx;
-      _g_chunks_world._chunks[idx] = _chunk_generate( dshm.filtered_heightmap, dshm.w, cx * CHUNK_X, cz * CHUNK_Z );
-      {
-        chunk_vertex_data_t vertex_data = chunk_gen_vertex_data( &_g_chunks_world._chunks[idx], 0, CHUNK_Y );
-        _chunk_meshes[idx]              = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr,
-          vertex_data.n_vpalidx_comps, vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.texcoords_ptr, vertex_data.n_vt_comps,
-          vertex_data.normals_ptr, vertex_data.n_vn_comps, NULL, 0, vertex_data.n_vertices );
-        chunk_free_vertex_data( &vertex_data );
+/* chunks in full detail range are the ones edited, lit and flowed through, so they're kept as voxel arrays for constant time reads.
+farther ones only need their runs */
+static void _set_chunk_lod( int chunk_id, int lod ) {
+  _chunk_lods[chunk_id] = lod;
+  if ( 0 == lod ) {
+    chunk_decompress( &_g_chunks_world._chunks[chunk_id] );
+  } else {
+    chunk_compress( &_g_chunks_world._chunks[chunk_id] );
+  }
+  _update_chunk_bytes( chunk_id );
+}
+
+// after the camera moves into another chunk. only the chunks whose distance puts them in another ring change
+static void _update_chunk_lods() {
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[i];
+    if ( !slot->in_use ) { continue; }
+    const int lod = _chunk_lod_for_dist( slot->cx - _g_chunks_world.centre_cx, slot->cz - _g_chunks_world.centre_cz );
+    if ( lod != _chunk_lods[i] ) { _set_chunk_lod( i, lod ); }
+  }
+}
+
+/* touches every chunk in the radius around the centre chunk, loading up to max_loads missing ones, going outwards in rings so the nearest come first.
+then evicts least recently used chunks outside the radius until back under the memory budget */
+static void _stream_chunks( int max_loads ) {
+  region_cursor_t cursor = ( region_cursor_t ){ .open = false };
+  const int radius       = _g_chunks_world.radius;
+  int n_loads            = 0;
+  for ( int ring = 0; ring <= radius; ring++ ) {
+    for ( int dz = -ring; dz <= ring; dz++ ) {
+      // only the edge of each square ring
+      const int dx_step = ( dz == -ring || dz == ring ) ? 1 : 2 * ring;
+      for ( int dx = -ring; dx <= ring; dx += dx_step ) {
+        const int cx = _g_chunks_world.centre_cx + dx, cz = _g_chunks_world.centre_cz + dz;
+        if ( !_is_chunk_in_radius( cx, cz ) ) { continue; }
+        int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+        if ( chunk_id >= 0 ) {
+          chunk_cache_touch( &_g_chunks_world.cache, chunk_id );
+          continue;
+        }
+        if ( n_loads >= max_loads ) { continue; }
+        if ( _g_chunks_world.cache.n_free == 0 ) {
+          const int lru_id = chunk_cache_lru_slot( &_g_chunks_world.cache, _can_evict_chunk, NULL );
+          if ( lru_id < 0 || !_evict_chunk( lru_id, &cursor ) ) { continue; }
+        }
+        chunk_id = _load_chunk( cx, cz, &cursor );
+        assert( chunk_id >= 0 );
+        _set_chunk_lod( chunk_id, _chunk_lod_for_dist( dx, dz ) );
+        n_loads++;
       }
-      _chunks_M[idx] = translate_mat4( ( vec3 ){ .x = cx * CHUNK_X * VOXEL_SCALE, .z = cz * CHUNK_Z * VOXEL_SCALE } );
     }
   }
 
+  while ( _resident_bytes > _g_chunks_world.memory_budget ) {
+    const int lru_id = chunk_cache_lru_slot( &_g_chunks_world.cache, _can_evict_chunk, NULL );
+    if ( lru_id < 0 || !_evict_chunk( lru_id, &cursor ) ) { break; }
+  }
+  _region_cursor_close( &cursor );
+}
+
+bool chunks_create( uint32_t seed, const char* world_name ) {
+  assert( world_name );
+
+  if ( _g_chunks_world.chunks_created ) { return false; } // free first
+
+  _g_chunks_world.seed = seed;
+  snprintf( _g_chunks_world.world_name, sizeof( _g_chunks_world.world_name ), "%s", world_name );
+  _g_chunks_world.cache     = chunk_cache_alloc( CHUNKS_MAX );
+  _g_chunks_world.quadtree  = chunk_quadtree_alloc( CHUNKS_MAX );
+  _g_chunks_world.centre_cx = 0;
+  _g_chunks_world.centre_cz = 0;
+  _light                    = ( light_engine_t ){ .chunk_at = _light_chunk_at, .sections_changed = _light_sections_changed };
+  _fluid                    = ( fluid_engine_t ){ .chunk_at = _light_chunk_at, .block_changed = _fluid_block_changed };
+  _fluid_tick_accum_s       = 0.0;
+
+  _chunk_vertex_buffer = create_packed_buffer( VOXEL_VPACKED_COMPS, CHUNKS_VERTEX_BUFFER_START );
+  _chunk_vertex_alloc  = range_alloc_create( CHUNKS_VERTEX_BUFFER_START );
+  worker_pool_init();
+  _worker_mesh_arenas = calloc( worker_pool_n_workers(), sizeof( chunk_mesh_arena_t ) );
+  assert( _worker_mesh_arenas );
+  /* block here until the chunks around the origin drawn at full detail are loaded and meshed rather than showing an empty world for the first few frames.
+  the rings further out stream in over the next few frames, nearest first */
+  _stream_chunks( ( 2 * CHUNKS_LOD_DIST + 1 ) * ( 2 * CHUNKS_LOD_DIST + 1 ) );
+  do {
+    chunks_update_dirty_chunk_meshes();
+    worker_pool_wait();
+  } while ( worker_pool_n_jobs_outstanding() > 0 );
+
   {
     const char vert_shader_str[] = {
       "#version 410\n"
-      "in vec3 a_vp;\n"
-      "in vec2 a_vt;\n"
-      "in vec4 a_vn;\n"
-      "in uint a_vpal_idx;\n"
-      "uniform mat4 u_P, u_V, u_M;\n"
+      VOXEL_VPACKED_GLSL
+      "in vec3 a_draw_offset;\n" // the chunk's position. see draw_packed_buffer()
+      "uniform mat4 u_P, u_V;\n"
+      "uniform float u_slice_y;\n"
       "out vec2 v_st;\n"
       "out vec4 v_n;\n"
       "out vec3 v_p_eye;\n"
+      "out float v_block_light;\n"
       "flat out uint v_vpal_idx;\n"
+      "flat out uint v_quad_ao;\n"
+      "flat out vec2 v_quad_size;\n" // the last vertex of each triangle is the quad's far corner
       "void main () {\n"
-      "  v_vpal_idx = a_vpal_idx;\n"
-      "  v_st = a_vt;\n"
-      "  v_n.xyz = (u_M * vec4( a_vn.xyz, 0.0 )).xyz;\n"
-      "  v_n.w = a_vn.w;\n"
-      "  vec4 p_wor = u_M * vec4( a_vp * 0.1, 1.0 );\n"
+      "  v_vpal_idx = a_vpacked.y & 15u;\n"
+      "  v_st = unpack_st();\n"
+      "  v_quad_ao = unpack_quad_ao();\n"
+      "  v_quad_size = v_st;\n"
+      "  v_n.xyz = face_normals[unpack_face()];\n"
+      "  vec2 light = unpack_light();\n"
+      "  v_n.w = light.x;\n"
+      "  v_block_light = light.y;\n"
+      "  vec4 p_wor = vec4( unpack_vp() * 0.1 + a_draw_offset, 1.0 );\n"
       "  v_p_eye =  ( u_V * p_wor ).xyz;\n"
       "  gl_Position = u_P * vec4( v_p_eye, 1.0 );\n"
-      // "  gl_ClipDistance[0] = dot( p_wor, vec4( 0.0, -1.0, 0.0, 5.0 ) );\n" // okay if below 10
-      // "  gl_ClipDistance[1] = dot( p_wor, vec4( 0.0, 1.0, 0.0, -2.0 ) );\n" // okay if above 2
+      "  gl_ClipDistance[0] = u_slice_y - p_wor.y;\n" // walls merged up through the slice. see chunks_slice_view_mode()
+      "  gl_ClipDistance[1] = 1.0;\n"                 // enabled by start_gl() but not used here
       "}\n"
     };
-    // heightmap 0 or 1 factor is stored in normal's w channel. used to disable sunlight for rooms/caves/overhangs (assumes sun is always _directly_ overhead,
-    // pointing down)
+    // sky light 0 to 1 is stored in normal's w channel. dims sunlight in rooms/caves/overhangs by how far the light had to spread in from the open sky.
+    // each level the light spreads is 20% darker. block light from lamps is added on top, and doesn't depend on facing the sun
+    // baked ambient occlusion darkens all of it in creases and corners, down to 40% in a corner boxed in on both sides. it's interpolated between the
+    // corners of the voxel face under the fragment, whatever size the quad is. see VOXEL_QUAD_AO_EDGES_SHIFT in chunk.h
     const char frag_shader_str[] = {
       "#version 410\n"
       "in vec2 v_st;\n"
       "in vec4 v_n;\n"
       "in vec3 v_p_eye;\n"
+      "in float v_block_light;\n"
       "flat in uint v_vpal_idx;\n"
+      "flat in uint v_quad_ao;\n"
+      "flat in vec2 v_quad_size;\n"
       "uniform sampler2DArray u_palette_texture;\n"
       "uniform vec3 u_fwd;\n"
+      "uniform float u_cap;\n"
       "out vec4 o_frag_colour;\n"
       "vec3 sun_rgb = vec3( 1.0, 1.0, 1.0 );\n"
       "vec3 fwd_rgb = vec3( 1.0, 1.0, 1.0 );\n"
       "vec3 fog_rgb = vec3( 0.5, 0.5, 0.9 );\n"
+      "vec3 lamp_rgb = vec3( 1.0, 0.8, 0.5 );\n"
+      "float quad_ao_at( vec2 p ) {\n" // 0 to 1 at a corner of a voxel face of the quad, in texcoords
+      "  bvec2 lo = equal( p, vec2( 0.0 ) ), hi = equal( p, v_quad_size );\n"
+      "  bool s_edge = lo.x || hi.x, t_edge = lo.y || hi.y;\n"
+      "  uint shift = 16u;\n"
+      "  if ( s_edge && t_edge ) {\n"
+      "    shift = 2u * ( uint( hi.x ) + 2u * uint( hi.y ) );\n"
+      "  } else if ( s_edge ) {\n"
+      "    shift = 8u + 2u * uint( hi.x );\n"
+      "  } else if ( t_edge ) {\n"
+      "    shift = 12u + 2u * uint( hi.y );\n"
+      "  }\n"
+      "  return float( ( ( v_quad_ao | 0x30000u ) >> shift ) & 3u ) / 3.0;\n" // corners inside the quad are never occluded
+      "}\n"
       "void main () {\n"
       "  vec3 texel_rgb    = texture( u_palette_texture, vec3( v_st.s, 1.0 - v_st.t, v_vpal_idx ) ).rgb;\n"
       "  float fog_fac      = clamp( v_p_eye.z * v_p_eye.z / 500.0, 0.0, 1.0 );\n"
+      "  if ( u_cap > 0.0 ) {\n" // flat and dark so the cut reads as the inside of the ground
+      "    o_frag_colour = vec4( mix( texel_rgb * 0.35, fog_rgb, fog_fac ), 1.0 );\n"
+      "    return;\n"
+      "  }\n"
       "  vec3 col           = pow( texel_rgb, vec3( 2.2 ) ); \n" // tga image load is linear colour space already w/o gamma
       "  float sun_dp       = clamp( dot( normalize( v_n.xyz ), normalize( -vec3( -0.3, -1.0, 0.2 ) ) ), 0.0 , 1.0 );\n"
       "  float fwd_dp       = clamp( dot( normalize( v_n.xyz ), -u_fwd ), 0.0, 1.0 );\n"
-      "  float outdoors_fac = v_n.w;\n"
-      "  o_frag_colour      = vec4(sun_rgb * col * sun_dp * outdoors_fac * 0.9 + (fwd_dp * 0.75 + 0.25) * col * 0.1, 1.0f );\n"
+      "  float outdoors_fac = v_n.w > 0.0 ? pow( 0.8, 15.0 - v_n.w * 15.0 ) : 0.0;\n"
+      "  float lamp_fac     = v_block_light > 0.0 ? pow( 0.8, 15.0 - v_block_light * 15.0 ) : 0.0;\n"
+      "  vec2 cell          = clamp( floor( v_st ), vec2( 0.0 ), v_quad_size - 1.0 );\n"
+      "  vec2 f             = v_st - cell;\n"
+      "  float ao           = mix( mix( quad_ao_at( cell ), quad_ao_at( cell + vec2( 1.0, 0.0 ) ), f.x ),\n"
+      "    mix( quad_ao_at( cell + vec2( 0.0, 1.0 ) ), quad_ao_at( cell + vec2( 1.0, 1.0 ) ), f.x ), f.y );\n"
+      "  float ao_fac       = 0.4 + 0.6 * ao;\n"
+      "  o_frag_colour      = vec4(sun_rgb * col * sun_dp * outdoors_fac * 0.9 + (fwd_dp * 0.75 + 0.25) * col * 0.1 + lamp_rgb * col * lamp_fac * 0.8, 1.0f );\n"
+      "  o_frag_colour.rgb *= ao_fac;\n"
       "  o_frag_colour.rgb  = pow( o_frag_colour.rgb, vec3( 1.0 / 2.2 ) );\n"
       "  o_frag_colour.rgb  = mix(o_frag_colour.rgb, fog_rgb, fog_fac);\n"
       "}\n"
     };
     // NOTE(Anton) fog calc after rgb because colour is trying to match gl clear colour
-    _voxel_shader = create_shader_program_from_strings( vert_shader_str, frag_shader_str );
+    _voxel_shader           = create_shader_program_from_strings( vert_shader_str, frag_shader_str );
+    _voxel_shader_u_slice_y = uniform_loc( _voxel_shader, "u_slice_y" );
+    _voxel_shader_u_cap     = uniform_loc( _voxel_shader, "u_cap" );
   }
 
-  {
-    const char vert_shader_str[] = {
-      "#version 410\n"
-      "in vec3 a_vp;\n"
-      "in vec3 a_vpicking;\n"
-      "uniform mat4 u_P, u_V, u_M;\n"
-      "out vec3 v_vpicking;\n"
-      "void main () {\n"
-      "  v_vpicking = a_vpicking;\n"
-      "  gl_Position = u_P * u_V * u_M * vec4( a_vp * 0.1, 1.0 );\n"
-      "}\n"
-    };
-    const char frag_shader_str[] = {
-      "#version 410\n"
-      "in vec3 v_vpicking;\n"
-      "uniform float u_chunk_id;\n"
-      "out vec4 o_frag_colour;\n"
-      "void main () {\n"
-      "  o_frag_colour = vec4( v_vpicking, u_chunk_id );\n"
-      "}\n"
-    };
-    _colour_picking_shader = create_shader_program_from_strings( vert_shader_str, frag_shader_str );
-  }
 
   {
-    const char images[16][256] = { "textures/grass.png", "textures/slab.png", "textures/side_grass.png", "textures/hersk-export.png" };
-    GLsizei layerCount         = 4;
+    const char images[16][256] = { "textures/grass.png", "textures/slab.png", "textures/side_grass.png", "textures/hersk-export.png", "textures/floor_stone.png",
+      "textures/floor_grass.png", "textures/slab.png", "textures/slab.png" };
+    // multiplies each texture's colour, 255 for as it is. water and lava are the slab texture tinted, rather than shipping more images
+    const uint8_t tints[VOXEL_PALETTE_N][3] = { { 255, 255, 255 }, { 255, 255, 255 }, { 255, 255, 255 }, { 255, 255, 255 }, { 255, 255, 255 },
+      { 255, 255, 255 }, { 60, 110, 255 }, { 255, 110, 30 } };
+    GLsizei layerCount         = VOXEL_PALETTE_N;
     GLsizei mipLevelCount      = 5;
 
     _array_texture = ( texture_t ){ .handle_gl = 0, .w = 16, .h = 16, .n_channels = 3, .srgb = false, .is_depth = false, .is_array = true };
@@ -613,16 +848,23 @@ bool chunks_create( uint32_t seed, uint32_t chunks_wide, uint32_t chunks_deep )
     // allocate memory for all layers
     glTexStorage3D( GL_TEXTURE_2D_ARRAY, mipLevelCount, GL_RGB8, _array_texture.w, _array_texture.h, layerCount ); // 8?
     glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    // repeat so that greedy-merged faces with texcoords running 0..w can tile one texture per voxel
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT );
     for ( int i = 0; i < layerCount; i++ ) {
       int w, h, n;
       uint8_t* img = stbi_load( images[i], &w, &h, &n, 3 );
       if ( !img ) { return false; }
       assert( img );
       assert( w == _array_texture.w && h == _array_texture.h );
+      for ( int p = 0; p < w * h * 3; p++ ) { img[p] = (uint8_t)( img[p] * tints[i][p % 3] / 255 ); }
 
       glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, w, h, 1, GL_RGB, GL_UNSIGNED_BYTE, img ); // note that 'depth' param must be 1
+      for ( int c = 0; c < 3; c++ ) {
+        uint32_t sum = 0;
+        for ( int p = 0; p < w * h; p++ ) { sum += img[p * 3 + c]; }
+        _palette_rgb[i][c] = (uint8_t)( sum / ( w * h ) );
+      }
       free( img );
     }
     // once all textures loaded at mip 0 - generate other mipmaps
@@ -631,8 +873,6 @@ bool chunks_create( uint32_t seed, uint32_t chunks_wide, uint32_t chunks_deep )
     glGenerateMipmap( GL_TEXTURE_2D_ARRAY );
     glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
   }
-
-  dsquare_heightmap_free( &dshm );
   _g_chunks_world.chunks_created = true;
 
   return true;
@@ -642,52 +882,131 @@ bool chunks_free() {
   assert( _g_chunks_world.chunks_created );
   if ( !_g_chunks_world.chunks_created ) { return false; }
 
+  // let any mesh jobs still running finish so that their memory is released. saved chunks still waiting to be cached get their jobs now, as no frame
+  // is waiting on them
+  do {
+    _push_pending_mesh_cache_jobs();
+    worker_pool_wait();
+    worker_pool_update();
+    _write_finished_mesh_cache_jobs();
+  } while ( _n_mesh_cache_jobs > 0 );
+  for ( int i = 0; i < worker_pool_n_workers(); i++ ) { chunk_mesh_arena_free( &_worker_mesh_arenas[i] ); }
+  free( _worker_mesh_arenas );
+  _worker_mesh_arenas = NULL;
+  worker_pool_free();
+  chunk_mesh_arena_free( &_main_mesh_arena );
+
   delete_shader_program( &_voxel_shader );
-  delete_shader_program( &_colour_picking_shader );
   delete_texture( &_array_texture );
 
-  for ( int i = 0; i < CHUNKS_N; i++ ) {
+  // unsaved changes are dropped, same as quitting without a chunks_save()
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    if ( !_g_chunks_world.cache.slots[i].in_use ) { continue; }
     chunk_free( &_g_chunks_world._chunks[i] );
-    delete_mesh( &_chunk_meshes[i] );
+    _delete_chunk_meshes( i );
   }
+  delete_packed_buffer( &_chunk_vertex_buffer );
+  range_alloc_free( &_chunk_vertex_alloc );
+  chunk_cache_free( &_g_chunks_world.cache );
+  chunk_quadtree_free( &_g_chunks_world.quadtree );
+  chunk_visibility_free( &_visibility );
+  light_engine_free( &_light );
+  fluid_engine_free( &_fluid );
+  free( _volume_edit_xyz );
+  _volume_edit_xyz = NULL;
+  _volume_edit_max = 0;
+  memset( _dirty_sections, 0, sizeof( _dirty_sections ) );
+  memset( _stale_lod_meshes, 0, sizeof( _stale_lod_meshes ) );
+  memset( _chunk_lods, 0, sizeof( _chunk_lods ) );
+  memset( _unsaved_chunks, 0, sizeof( _unsaved_chunks ) );
+  memset( _mesh_cache_chunks, 0, sizeof( _mesh_cache_chunks ) );
+  memset( _mesh_cache_pending, 0, sizeof( _mesh_cache_pending ) );
+  memset( _chunk_mesh_requested_gen, 0, sizeof( _chunk_mesh_requested_gen ) );
+  memset( _chunk_mesh_uploaded_gen, 0, sizeof( _chunk_mesh_uploaded_gen ) );
+  memset( _visible_sections, 0, sizeof( _visible_sections ) );
+  memset( _chunk_bytes, 0, sizeof( _chunk_bytes ) );
+  _resident_bytes                = 0;
   _g_chunks_world.chunks_created = false;
 
   return true;
 }
 
 typedef struct chunk_queue_item_t {
-  float sqdist;    // used as key in sorting
-  int idx;         // index into chunks arrays
-  vec3 mins, maxs; // used in frustum culling
+  float sqdist; // from the camera, in world units
+  int idx;      // index into chunks arrays
 } chunk_queue_item_t;
 
-static chunk_queue_item_t _chunk_draw_queue[CHUNKS_N];
+static chunk_queue_item_t _chunk_draw_queue[CHUNKS_MAX]; // nearest first
+static int _n_chunks_in_draw_queue;
+// chunks in the frustum nearest first, from the quadtree. scratch for chunks_sort_draw_queue()
+static int _chunks_in_frustum[CHUNKS_MAX];
+static float _chunks_in_frustum_sqdists[CHUNKS_MAX];
 
-static int _chunk_cmp( const void* a, const void* b ) {
-  chunk_queue_item_t* ptr_a = (chunk_queue_item_t*)a;
-  chunk_queue_item_t* ptr_b = (chunk_queue_item_t*)b;
-  return (int)( ptr_a->sqdist - ptr_b->sqdist );
+static int _visibility_chunk_id_at( int cx, int cz, void* user_ptr ) {
+  (void)user_ptr;
+  return chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+}
+
+static bool _visibility_is_section_in_frustum( int cx, int sy, int cz, void* user_ptr ) {
+  (void)user_ptr;
+  // voxel x spans world x - 0.5 to x + 0.5 voxels. see unpack_vp()
+  const vec3 mins = ( vec3 ){ ( cx * CHUNK_X - 0.5f ) * VOXEL_SCALE, ( sy * CHUNK_SECTION_Y - 0.5f ) * VOXEL_SCALE, ( cz * CHUNK_Z - 0.5f ) * VOXEL_SCALE };
+  const vec3 maxs = ( vec3 ){ mins.x + CHUNK_X * VOXEL_SCALE, mins.y + CHUNK_SECTION_Y * VOXEL_SCALE, mins.z + CHUNK_Z * VOXEL_SCALE };
+  return is_aabb_in_frustum( mins, maxs );
+}
+
+static bool _quadtree_is_area_in_frustum( int cx, int cz, int size, void* user_ptr ) {
+  (void)user_ptr;
+  const vec3 mins = ( vec3 ){ ( cx * CHUNK_X - 0.5f ) * VOXEL_SCALE, -0.5f * VOXEL_SCALE, ( cz * CHUNK_Z - 0.5f ) * VOXEL_SCALE };
+  const vec3 maxs = ( vec3 ){ mins.x + size * CHUNK_X * VOXEL_SCALE, mins.y + CHUNK_Y * VOXEL_SCALE, mins.z + size * CHUNK_Z * VOXEL_SCALE };
+  return is_aabb_in_frustum( mins, maxs );
 }
 
 void chunks_sort_draw_queue( vec3 cam_pos ) {
-  // sort chunks by distance from camera - render closest first
-  for ( int i = 0; i < CHUNKS_N; i++ ) {
-    _chunk_draw_queue[i].idx = i;
-    int chunk_x              = i % _g_chunks_world._chunks_w;
-    int chunk_z              = i / _g_chunks_world._chunks_w;
-    vec2 cam_centre          = ( vec2 ){ .x = cam_pos.x, .y = cam_pos.z };
-    vec2 chunk_centre =
-      ( vec2 ){ .x = chunk_x * CHUNK_X * VOXEL_SCALE + CHUNK_X * VOXEL_SCALE * 0.5f, .y = chunk_z * CHUNK_Z * VOXEL_SCALE + CHUNK_Z * VOXEL_SCALE * 0.5f };
-    _chunk_draw_queue[i].sqdist = length2_vec2( sub_vec2_vec2( cam_centre, chunk_centre ) );
-    _chunk_draw_queue[i].mins   = ( vec3 ){ chunk_centre.x - CHUNK_X * VOXEL_SCALE * 0.5f, 0.0f, chunk_centre.y - CHUNK_Z * VOXEL_SCALE * 0.5f };
-    _chunk_draw_queue[i].maxs = ( vec3 ){ chunk_centre.x + CHUNK_X * VOXEL_SCALE * 0.5f, CHUNK_Y * VOXEL_SCALE, chunk_centre.y + CHUNK_Z * VOXEL_SCALE * 0.5f };
+  // which sections could be seen from the camera's section through the air between them, within the frustum
+  const chunk_visibility_query_t query = ( chunk_visibility_query_t ){ .cam_cx = (int)floorf( cam_pos.x / ( CHUNK_X * VOXEL_SCALE ) + 0.5f / CHUNK_X ),
+    .cam_sy                                                                   = (int)floorf( cam_pos.y / ( CHUNK_SECTION_Y * VOXEL_SCALE ) + 0.5f / CHUNK_SECTION_Y ),
+    .cam_cz                                                                   = (int)floorf( cam_pos.z / ( CHUNK_Z * VOXEL_SCALE ) + 0.5f / CHUNK_Z ),
+    .n_chunk_ids                                                              = CHUNKS_MAX,
+    .chunk_id_at                                                              = _visibility_chunk_id_at,
+    .is_section_in_view                                                       = _visibility_is_section_in_frustum,
+    .connectivity                                                             = _section_connectivity[0] };
+  const bool searched = chunk_cache_find( &_g_chunks_world.cache, query.cam_cx, query.cam_cz ) >= 0;
+  if ( searched ) {
+    chunk_visibility_search( &_visibility, &query, _visible_sections );
+  } else {
+    // camera's chunk isn't streamed in yet so there's nowhere to search from. fall back to the frustum, below
+    memset( _visible_sections, 0, sizeof( _visible_sections ) );
+  }
+
+  /* chunks whose area is in the frustum come out of the quadtree nearest first, out to the view radius, so the queue needs no sorting and chunks
+  far outside the frustum are rejected a whole quadtree node at a time. distances are to chunk centres, in chunk units */
+  const float chunk_w                         = CHUNK_X * VOXEL_SCALE;
+  const chunk_quadtree_query_t quadtree_query = ( chunk_quadtree_query_t ){ .cam_cx = cam_pos.x / chunk_w,
+    .cam_cz                                                                         = cam_pos.z / ( CHUNK_Z * VOXEL_SCALE ),
+    .max_sqdist                                                                     = (float)( _g_chunks_world.radius * _g_chunks_world.radius ),
+    .is_area_in_view                                                                = _quadtree_is_area_in_frustum };
+  const int n_in_frustum = chunk_quadtree_front_to_back(
+    &_g_chunks_world.quadtree, &quadtree_query, _chunks_in_frustum, _chunks_in_frustum_sqdists, CHUNKS_MAX );
+
+  _n_chunks_in_draw_queue = 0;
+  for ( int i = 0; i < n_in_frustum; i++ ) {
+    const int chunk_id = _chunks_in_frustum[i];
+    if ( !searched ) {
+      for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+        if ( _visibility_is_section_in_frustum( _g_chunks_world.cache.slots[chunk_id].cx, section, _g_chunks_world.cache.slots[chunk_id].cz, NULL ) ) {
+          _visible_sections[chunk_id] |= 1u << section;
+        }
+      }
+    }
+    if ( !_visible_sections[chunk_id] ) { continue; }
+    _chunk_draw_queue[_n_chunks_in_draw_queue++] = ( chunk_queue_item_t ){ .sqdist = _chunks_in_frustum_sqdists[i] * chunk_w * chunk_w, .idx = chunk_id };
   }
-  qsort( _chunk_draw_queue, CHUNKS_N, sizeof( chunk_queue_item_t ), _chunk_cmp );
 }
 
 static int _chunks_drawn;
-static int _chunks_max_drawn        = 128;
-static int _chunks_max_visible_dist = 10;
+// nearest chunks are drawn first, so when over budget it's the furthest that are left out
+static size_t _chunks_max_drawn_vertices = 1024 * 1024;
 
 int chunks_get_drawn_count() { return _chunks_drawn; }
 
@@ -695,65 +1014,119 @@ void chunks_draw( vec3 cam_fwd, mat4 P, mat4 V ) {
   assert( _g_chunks_world.chunks_created );
   if ( !_g_chunks_world.chunks_created ) { return; }
 
-  _chunks_drawn        = 0;
-  const float max_dist = (float)_chunks_max_visible_dist * 16 * VOXEL_SCALE;
+  _chunks_drawn           = 0;
+  size_t n_vertices_drawn = 0;
+  int n_cmds = 0, n_offsets = 0, n_cap_cmds = 0;
+  const float max_dist = (float)_g_chunks_world.radius * CHUNK_X * VOXEL_SCALE;
+  const bool slicing   = _g_chunks_world.slice_view_mode && _g_chunks_world.slice_y < CHUNK_Y;
+  const int slice_y    = slicing ? _g_chunks_world.slice_y : CHUNK_Y;
 
   uniform3f( _voxel_shader, _voxel_shader.u_fwd, cam_fwd.x, cam_fwd.y, cam_fwd.z );
-  for ( int i = 0; i < CHUNKS_N; i++ ) {
+  for ( int i = 0; i < _n_chunks_in_draw_queue; i++ ) {
     int idx = _chunk_draw_queue[i].idx;
-    if ( _chunk_draw_queue[i].sqdist > max_dist * max_dist ) { return; }
-    if ( !is_aabb_in_frustum( _chunk_draw_queue[i].mins, _chunk_draw_queue[i].maxs ) ) { continue; }
-    draw_mesh( _voxel_shader, P, V, _chunks_M[idx], _chunk_meshes[idx].vao, _chunk_meshes[idx].n_vertices, &_array_texture, 1 );
+    if ( _chunk_draw_queue[i].sqdist > max_dist * max_dist ) { break; }
+    const int first_cmd                = n_cmds;
+    size_t n_vertices                  = 0;
+    const chunk_mesh_range_t* lod_mesh = &_chunk_lod_meshes[idx];
+    if ( lod_mesh->n_vertices ) {
+      // not split into sections, so it's drawn whole if any section is visible
+      // and isn't sorted by layer, so in slice view the shader's clipping does all of the cutting
+      _chunk_draw_cmds[n_cmds++] =
+        ( draw_arrays_cmd_t ){ .count = lod_mesh->n_vertices, .instance_count = 1, .first = lod_mesh->first, .base_instance = n_offsets };
+      if ( slicing ) { _chunk_cap_cmds[n_cap_cmds++] = _chunk_draw_cmds[n_cmds - 1]; }
+      n_vertices = lod_mesh->n_vertices;
+    }
+    for ( int section = 0; section < CHUNK_SECTIONS && section * CHUNK_SECTION_Y < slice_y; section++ ) {
+      const chunk_mesh_range_t* mesh = &_chunk_meshes[idx][section];
+      if ( !mesh->n_vertices || !( _visible_sections[idx] & ( 1u << section ) ) ) { continue; }
+      uint32_t count = mesh->n_vertices;
+      // the slice cuts this section. draw the faces of the layers below it
+      const int n_layers_below = slice_y - section * CHUNK_SECTION_Y;
+      if ( n_layers_below < CHUNK_SECTION_Y ) { count = _section_layer_ends[idx][section][n_layers_below - 1] * VOXEL_FACE_VERTS; }
+      if ( !count ) { continue; }
+      _chunk_draw_cmds[n_cmds++] = ( draw_arrays_cmd_t ){ .count = count, .instance_count = 1, .first = mesh->first, .base_instance = n_offsets };
+      if ( n_layers_below < CHUNK_SECTION_Y ) { _chunk_cap_cmds[n_cap_cmds++] = _chunk_draw_cmds[n_cmds - 1]; }
+      n_vertices += count;
+    }
+    if ( n_cmds == first_cmd ) { continue; }
+    _chunk_draw_offsets[n_offsets * 3 + 0] = _g_chunks_world.cache.slots[idx].cx * CHUNK_X * VOXEL_SCALE;
+    _chunk_draw_offsets[n_offsets * 3 + 1] = 0.0f;
+    _chunk_draw_offsets[n_offsets * 3 + 2] = _g_chunks_world.cache.slots[idx].cz * CHUNK_Z * VOXEL_SCALE;
+    n_offsets++;
     _chunks_drawn++;
-    if ( _chunks_drawn >= _chunks_max_drawn ) { return; }
+    n_vertices_drawn += n_vertices;
+    if ( n_vertices_drawn >= _chunks_max_drawn_vertices ) { break; }
   }
+  // voxel x spans world x - 0.5 to x + 0.5 voxels, so layer y starts at y - 0.5. a little over, so the tops of the layer under it aren't clipped
+  const float slice_world_y = slicing ? ( slice_y - 0.49f ) * VOXEL_SCALE : 1e9f;
+  uniform1f( _voxel_shader, _voxel_shader_u_slice_y, slice_world_y );
+  uniform1f( _voxel_shader, _voxel_shader_u_cap, 0.0f );
+  draw_packed_buffer( _voxel_shader, P, V, &_chunk_vertex_buffer, _chunk_draw_cmds, n_cmds, _chunk_draw_offsets, n_offsets, &_array_texture, 1 );
+  if ( n_cap_cmds > 0 ) {
+    // looking down through the slice into the ground you see the inside of the surfaces around it - their back faces
+    glCullFace( GL_FRONT );
+    uniform1f( _voxel_shader, _voxel_shader_u_cap, 1.0f );
+    draw_packed_buffer( _voxel_shader, P, V, &_chunk_vertex_buffer, _chunk_cap_cmds, n_cap_cmds, _chunk_draw_offsets, n_offsets, &_array_texture, 1 );
+    glCullFace( GL_BACK );
+  }
+}
+
+static const chunk_t* _raycast_chunk_at( int cx, int cz, int* chunk_id, void* user_ptr ) {
+  (void)user_ptr;
+  *chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+  return *chunk_id >= 0 ? &_g_chunks_world._chunks[*chunk_id] : NULL;
 }
 
-void chunks_draw_colour_picking( mat4 offcentre_P, mat4 V ) {
+bool chunks_raycast( vec3 origin, vec3 dir, float max_dist, int* chunk_id, int* x, int* y, int* z, int* face ) {
+  assert( chunk_id && x && y && z && face );
   assert( _g_chunks_world.chunks_created );
-  if ( !_g_chunks_world.chunks_created ) { return; }
+  if ( !_g_chunks_world.chunks_created ) { return false; }
 
-  int local_chunks_drawn = 0; // needs to be a separate var from the one in chunks_draw
-  const float max_dist   = (float)_chunks_max_visible_dist * 16 * VOXEL_SCALE;
+  // voxel x spans world x - 0.5 to x + 0.5 voxels. see unpack_vp()
+  const vec3 origin_vox = ( vec3 ){ origin.x / VOXEL_SCALE + 0.5f, origin.y / VOXEL_SCALE + 0.5f, origin.z / VOXEL_SCALE + 0.5f };
+  voxel_raycast_hit_t hit;
+  if ( !voxel_raycast( origin_vox, dir, max_dist / VOXEL_SCALE, _raycast_chunk_at, NULL, &hit ) ) { return false; }
+  *chunk_id = hit.chunk_id;
+  *x        = hit.x;
+  *y        = hit.y;
+  *z        = hit.z;
+  *face     = hit.face_idx;
+  return true;
+}
 
-  for ( uint32_t i = 0; i < CHUNKS_N; i++ ) {
-    int idx = _chunk_draw_queue[i].idx;
-    if ( _chunk_draw_queue[i].sqdist > max_dist * max_dist ) { return; }
-    if ( !is_aabb_in_frustum( _chunk_draw_queue[i].mins, _chunk_draw_queue[i].maxs ) ) { continue; }
-    uniform1f( _colour_picking_shader, _colour_picking_shader.u_chunk_id, (float)idx / 255.0f );
-    draw_mesh( _colour_picking_shader, offcentre_P, V, _chunks_M[idx], _chunk_meshes[idx].vao, _chunk_meshes[idx].n_vertices, NULL, 0 );
-    if ( local_chunks_drawn >= _chunks_max_drawn ) { return; }
-    local_chunks_drawn++;
-  }
-}
-
-bool chunks_picked_colour_to_voxel_idx( uint8_t r, uint8_t g, uint8_t b, uint8_t a, int* x, int* y, int* z, int* face, int* chunk_id ) {
-  if ( b > 5 ) { return false; }
-  *x        = (int)r % CHUNK_X;
-  *y        = (int)g;
-  *z        = (int)r / CHUNK_X;
-  *face     = (int)b;
-  *chunk_id = (int)a;
-  assert( *chunk_id >= 0 && *chunk_id < CHUNKS_N );
+bool chunks_get_chunk_coords( int chunk_id, int* cx, int* cz ) {
+  assert( cx && cz );
+  if ( !_is_chunk_id_resident( chunk_id ) ) { return false; }
+  *cx = _g_chunks_world.cache.slots[chunk_id].cx;
+  *cz = _g_chunks_world.cache.slots[chunk_id].cz;
   return true;
 }
 
+int chunks_get_chunk_id( int cx, int cz ) { return chunk_cache_find( &_g_chunks_world.cache, cx, cz ); }
+
 bool chunks_get_block_type_in_chunk( int chunk_id, int x, int y, int z, block_type_t* block_type ) {
-  assert( chunk_id >= 0 && chunk_id < CHUNKS_N );
+  assert( _is_chunk_id_resident( chunk_id ) );
 
-  bool ret = _get_block_type_in_chunk( &_g_chunks_world._chunks[chunk_id], x, y, z, block_type );
+  bool ret = get_block_type_in_chunk( &_g_chunks_world._chunks[chunk_id], x, y, z, block_type );
   return ret;
 }
 
 bool chunks_set_block_type_in_chunk( int chunk_id, int x, int y, int z, block_type_t block_type ) {
-  assert( chunk_id >= 0 && chunk_id < CHUNKS_N );
+  assert( _is_chunk_id_resident( chunk_id ) );
+
+  chunk_t* chunk = &_g_chunks_world._chunks[chunk_id];
+  bool ret       = set_block_type_in_chunk( chunk, x, y, z, block_type );
+  if ( !ret ) { return ret; }
 
-  bool ret = _set_block_type_in_chunk( &_g_chunks_world._chunks[chunk_id], x, y, z, block_type );
+  _mark_edited( chunk_id, x, z, x, z, y, y );
+  const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[chunk_id];
+  light_block_changed( &_light, slot->cx * CHUNK_X + x, y, slot->cz * CHUNK_Z + z );
+  fluid_block_changed( &_fluid, slot->cx * CHUNK_X + x, y, slot->cz * CHUNK_Z + z );
   return ret;
 }
 
 bool chunks_create_block_on_face( int picked_chunk_id, int picked_x, int picked_y, int picked_z, int picked_face, block_type_t type ) {
-  assert( picked_chunk_id >= 0 && picked_chunk_id < CHUNKS_N );
+  assert( _is_chunk_id_resident( picked_chunk_id ) );
 
   int xx = picked_x, yy = picked_y, zz = picked_z;
   switch ( picked_face ) {
@@ -766,54 +1139,473 @@ bool chunks_create_block_on_face( int picked_chunk_id, int picked_x, int picked_
   default: assert( false ); break;
   }
 
-  int chunk_x = picked_chunk_id % _g_chunks_world._chunks_w;
-  int chunk_z = picked_chunk_id / _g_chunks_world._chunks_w;
+  int chunk_x = _g_chunks_world.cache.slots[picked_chunk_id].cx;
+  int chunk_z = _g_chunks_world.cache.slots[picked_chunk_id].cz;
 
   if ( xx < 0 ) {
-    assert( chunk_x > 0 );
     xx = 15;
     chunk_x--;
   }
   if ( xx > 15 ) {
-    assert( chunk_x < _g_chunks_world._chunks_w );
     xx = 0;
     chunk_x++;
   }
   if ( zz < 0 ) {
-    assert( chunk_z > 0 );
     zz = 15;
     chunk_z--;
   }
   if ( zz > 15 ) {
-    assert( chunk_z < _g_chunks_world._chunks_h );
     zz = 0;
     chunk_z++;
   }
-  const int chunk_id_to_modify = chunk_z * _g_chunks_world._chunks_w + chunk_x;
+  const int chunk_id_to_modify = chunk_cache_find( &_g_chunks_world.cache, chunk_x, chunk_z );
+  if ( chunk_id_to_modify < 0 ) { return false; } // next door chunk isn't resident
   bool changed                 = chunks_set_block_type_in_chunk( chunk_id_to_modify, xx, yy, zz, type );
-  if ( changed ) { _dirty_chunks[chunk_id_to_modify] = true; }
   return changed;
 }
 
+/* a volume edit's shape. RETURNS the type world voxel x,y,z becomes, or BLOCK_TYPE_N to leave it as it is */
+typedef block_type_t ( *volume_shape_fn_t )( int x, int y, int z, const void* args );
+
+typedef struct volume_shape_t {
+  int centre[3];     // sphere centre, or the voxel a cylinder stands on
+  int radius_sq;     // of a sphere or cylinder, in voxels squared
+  int top_y;         // of a cylinder, inclusive
+  block_type_t type; // for box, sphere, and cylinder
+  const chunks_clipboard_t* clipboard;
+  int paste_origin[3]; // world voxel the clipboard's lowest corner goes to
+  bool skip_air;       // for paste
+} volume_shape_t;
+
+static block_type_t _box_shape( int x, int y, int z, const void* args ) {
+  (void)x;
+  (void)y;
+  (void)z;
+  return ( (const volume_shape_t*)args )->type;
+}
+
+static block_type_t _sphere_shape( int x, int y, int z, const void* args ) {
+  const volume_shape_t* shape = (const volume_shape_t*)args;
+  const int dx = x - shape->centre[0], dy = y - shape->centre[1], dz = z - shape->centre[2];
+  return dx * dx + dy * dy + dz * dz <= shape->radius_sq ? shape->type : BLOCK_TYPE_N;
+}
+
+static block_type_t _cylinder_shape( int x, int y, int z, const void* args ) {
+  const volume_shape_t* shape = (const volume_shape_t*)args;
+  const int dx = x - shape->centre[0], dz = z - shape->centre[2];
+  return y >= shape->centre[1] && y <= shape->top_y && dx * dx + dz * dz <= shape->radius_sq ? shape->type : BLOCK_TYPE_N;
+}
+
+static block_type_t _paste_shape( int x, int y, int z, const void* args ) {
+  const volume_shape_t* shape        = (const volume_shape_t*)args;
+  const chunks_clipboard_t* clipboard = shape->clipboard;
+  const int cx = x - shape->paste_origin[0], cy = y - shape->paste_origin[1], cz = z - shape->paste_origin[2];
+  const block_type_t type             = (block_type_t)clipboard->types[( cy * clipboard->d + cz ) * clipboard->w + cx];
+  return BLOCK_TYPE_AIR == type && shape->skip_air ? BLOCK_TYPE_N : type;
+}
+
+/* changes the voxels of the box min..max, in world voxel coords, to what shape_fn says, in one pass over each resident chunk it covers. the heightmap
+is kept up to date by set_block_type_in_chunk() as it goes, which is cheap for whole columns. then light is updated for every changed voxel at once, and
+each chunk's sections marked dirty once
+RETURNS the number of voxels changed */
+static int _edit_volume( const int* min, const int* max, volume_shape_fn_t shape_fn, const void* args ) {
+  const int min_y = min[1] > 0 ? min[1] : 0, max_y = max[1] < CHUNK_Y - 1 ? max[1] : CHUNK_Y - 1;
+  if ( min_y > max_y || min[0] > max[0] || min[2] > max[2] ) { return 0; }
+
+  int n_changed = 0;
+  for ( int cz = _floor_div( min[2], CHUNK_Z ); cz <= _floor_div( max[2], CHUNK_Z ); cz++ ) {
+    for ( int cx = _floor_div( min[0], CHUNK_X ); cx <= _floor_div( max[0], CHUNK_X ); cx++ ) {
+      const int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+      if ( chunk_id < 0 ) { continue; } // not resident. left alone
+      chunk_t* chunk   = &_g_chunks_world._chunks[chunk_id];
+      // the part of the box in this chunk, in its voxel coords
+      const int from_x = min[0] - cx * CHUNK_X > 0 ? min[0] - cx * CHUNK_X : 0;
+      const int from_z = min[2] - cz * CHUNK_Z > 0 ? min[2] - cz * CHUNK_Z : 0;
+      const int to_x   = max[0] - cx * CHUNK_X < CHUNK_X - 1 ? max[0] - cx * CHUNK_X : CHUNK_X - 1;
+      const int to_z   = max[2] - cz * CHUNK_Z < CHUNK_Z - 1 ? max[2] - cz * CHUNK_Z : CHUNK_Z - 1;
+      // bounds of the voxels changed in this chunk
+      int changed_min[3] = { CHUNK_X, CHUNK_Y, CHUNK_Z }, changed_max[3] = { -1, -1, -1 };
+      for ( int z = from_z; z <= to_z; z++ ) {
+        for ( int x = from_x; x <= to_x; x++ ) {
+          for ( int y = min_y; y <= max_y; y++ ) {
+            const int wx = cx * CHUNK_X + x, wz = cz * CHUNK_Z + z;
+            const block_type_t type = shape_fn( wx, y, wz, args );
+            if ( BLOCK_TYPE_N == type || !set_block_type_in_chunk( chunk, x, y, z, type ) ) { continue; }
+            _record_changed_voxel( n_changed++, wx, y, wz );
+            const int xyz[3] = { x, y, z };
+            for ( int i = 0; i < 3; i++ ) {
+              changed_min[i] = xyz[i] < changed_min[i] ? xyz[i] : changed_min[i];
+              changed_max[i] = xyz[i] > changed_max[i] ? xyz[i] : changed_max[i];
+            }
+          }
+        }
+      }
+      if ( changed_max[1] >= 0 ) { _mark_edited( chunk_id, changed_min[0], changed_min[2], changed_max[0], changed_max[2], changed_min[1], changed_max[1] ); }
+    }
+  }
+  light_blocks_changed( &_light, _volume_edit_xyz, n_changed );
+  fluid_blocks_changed( &_fluid, _volume_edit_xyz, n_changed );
+  return n_changed;
+}
+
+// sorts a box's corners into its lowest and highest
+static void _box_bounds( int x0, int y0, int z0, int x1, int y1, int z1, int* min, int* max ) {
+  min[0] = x0 < x1 ? x0 : x1;
+  min[1] = y0 < y1 ? y0 : y1;
+  min[2] = z0 < z1 ? z0 : z1;
+  max[0] = x0 > x1 ? x0 : x1;
+  max[1] = y0 > y1 ? y0 : y1;
+  max[2] = z0 > z1 ? z0 : z1;
+}
+
+int chunks_fill_box( int x0, int y0, int z0, int x1, int y1, int z1, block_type_t type ) {
+  assert( _g_chunks_world.chunks_created && type < BLOCK_TYPE_N );
+
+  int min[3], max[3];
+  _box_bounds( x0, y0, z0, x1, y1, z1, min, max );
+  const volume_shape_t shape = ( volume_shape_t ){ .type = type };
+  return _edit_volume( min, max, _box_shape, &shape );
+}
+
+int chunks_fill_sphere( int x, int y, int z, int radius, block_type_t type ) {
+  assert( _g_chunks_world.chunks_created && type < BLOCK_TYPE_N && radius >= 0 );
+
+  const int min[3]            = { x - radius, y - radius, z - radius }, max[3] = { x + radius, y + radius, z + radius };
+  const volume_shape_t shape = ( volume_shape_t ){ .centre = { x, y, z }, .radius_sq = radius * radius, .type = type };
+  return _edit_volume( min, max, _sphere_shape, &shape );
+}
+
+int chunks_fill_cylinder( int x, int y, int z, int radius, int height, block_type_t type ) {
+  assert( _g_chunks_world.chunks_created && type < BLOCK_TYPE_N && radius >= 0 );
+
+  if ( height <= 0 ) { return 0; }
+  const int min[3]            = { x - radius, y, z - radius }, max[3] = { x + radius, y + height - 1, z + radius };
+  const volume_shape_t shape = ( volume_shape_t ){ .centre = { x, y, z }, .radius_sq = radius * radius, .top_y = y + height - 1, .type = type };
+  return _edit_volume( min, max, _cylinder_shape, &shape );
+}
+
+bool chunks_copy_box( int x0, int y0, int z0, int x1, int y1, int z1, chunks_clipboard_t* clipboard ) {
+  assert( _g_chunks_world.chunks_created && clipboard );
+
+  int min[3], max[3];
+  _box_bounds( x0, y0, z0, x1, y1, z1, min, max );
+  clipboard->w     = max[0] - min[0] + 1;
+  clipboard->h     = max[1] - min[1] + 1;
+  clipboard->d     = max[2] - min[2] + 1;
+  clipboard->types = calloc( (size_t)clipboard->w * clipboard->h * clipboard->d, 1 ); // air
+  assert( clipboard->types );
+
+  // the chunk is looked up again only when a row crosses into the next one
+  bool all_resident = true;
+  int cached_cx = _floor_div( min[0], CHUNK_X ), cached_cz = _floor_div( min[2], CHUNK_Z );
+  int chunk_id = chunk_cache_find( &_g_chunks_world.cache, cached_cx, cached_cz );
+  for ( int y = min[1]; y <= max[1]; y++ ) {
+    for ( int z = min[2]; z <= max[2]; z++ ) {
+      for ( int x = min[0]; x <= max[0]; x++ ) {
+        if ( y < 0 || y >= CHUNK_Y ) { continue; } // above and below the world is air
+        const int cx = _floor_div( x, CHUNK_X ), cz = _floor_div( z, CHUNK_Z );
+        if ( cx != cached_cx || cz != cached_cz ) {
+          chunk_id  = chunk_cache_find( &_g_chunks_world.cache, cx, cz );
+          cached_cx = cx;
+          cached_cz = cz;
+        }
+        if ( chunk_id < 0 ) {
+          all_resident = false;
+          continue;
+        }
+        block_type_t type = BLOCK_TYPE_AIR;
+        get_block_type_in_chunk( &_g_chunks_world._chunks[chunk_id], x - cx * CHUNK_X, y, z - cz * CHUNK_Z, &type );
+        clipboard->types[( ( y - min[1] ) * clipboard->d + ( z - min[2] ) ) * clipboard->w + ( x - min[0] )] = (uint8_t)type;
+      }
+    }
+  }
+  return all_resident;
+}
+
+int chunks_paste( const chunks_clipboard_t* clipboard, int x, int y, int z, bool skip_air ) {
+  assert( _g_chunks_world.chunks_created && clipboard && clipboard->types );
+
+  const int min[3]            = { x, y, z }, max[3] = { x + clipboard->w - 1, y + clipboard->h - 1, z + clipboard->d - 1 };
+  const volume_shape_t shape = ( volume_shape_t ){ .clipboard = clipboard, .paste_origin = { x, y, z }, .skip_air = skip_air };
+  return _edit_volume( min, max, _paste_shape, &shape );
+}
+
+void chunks_clipboard_free( chunks_clipboard_t* clipboard ) {
+  assert( clipboard );
+  free( clipboard->types );
+  *clipboard = ( chunks_clipboard_t ){ .w = 0 };
+}
+
+/* swaps in new meshes for the sections of a chunk in section_mask. vertex_data is indexed by section. the old meshes stay drawn right up until this point.
+a newer generation of a chunk always covers at least the sections of older ones still in flight, since only one job per chunk runs at a time and the
+synchronous path meshes every section */
+static void _upload_chunk_mesh(
+  int chunk_id, uint32_t generation, uint32_t section_mask, const chunk_vertex_data_t* vertex_data, const uint16_t* connectivity ) {
+  if ( generation <= _chunk_mesh_uploaded_gen[chunk_id] ) { return; } // a newer mesh is already in
+
+  for ( int section = 0; section < CHUNK_SECTIONS; section++ ) {
+    if ( !( section_mask & ( 1u << section ) ) ) { continue; }
+    _section_connectivity[chunk_id][section] = connectivity[section];
+    chunk_mesh_range_t* mesh                 = &_chunk_meshes[chunk_id][section];
+    _release_mesh_range( mesh );
+    if ( vertex_data[section].n_vertices > 0 ) { *mesh = _upload_mesh_range( &vertex_data[section] ); }
+    uint32_t layer_ends[CHUNK_SECTION_Y];
+    chunk_vertex_data_layer_ends( &vertex_data[section], section * CHUNK_SECTION_Y, CHUNK_SECTION_Y, layer_ends );
+    assert( layer_ends[CHUNK_SECTION_Y - 1] / VOXEL_FACE_VERTS <= UINT16_MAX );
+    for ( int layer = 0; layer < CHUNK_SECTION_Y; layer++ ) {
+      _section_layer_ends[chunk_id][section][layer] = (uint16_t)( layer_ends[layer] / VOXEL_FACE_VERTS );
+    }
+  }
+  _chunk_mesh_uploaded_gen[chunk_id] = generation;
+  _delete_lod_mesh( chunk_id );
+}
+
+/* swaps in a new LOD mesh for the chunk and drops its section meshes, which are remeshed when it comes back into full detail range.
+generations are shared with the section meshes, so whichever was queued last wins */
+static void _upload_chunk_lod_mesh( int chunk_id, uint32_t generation, int lod, const chunk_vertex_data_t* vertex_data ) {
+  if ( generation <= _chunk_mesh_uploaded_gen[chunk_id] ) { return; }
+
+  _delete_lod_mesh( chunk_id );
+  if ( vertex_data->n_vertices > 0 ) { _chunk_lod_meshes[chunk_id] = _upload_mesh_range( vertex_data ); }
+  _chunk_lod_mesh_levels[chunk_id]   = lod;
+  _chunk_mesh_uploaded_gen[chunk_id] = generation;
+  _delete_section_meshes( chunk_id );
+  _dirty_sections[chunk_id] = ALL_SECTIONS_MASK;
+}
+
 void chunks_update_chunk_mesh( int chunk_id ) {
-  assert( chunk_id >= 0 && chunk_id < CHUNKS_N );
+  assert( _is_chunk_id_resident( chunk_id ) );
+
+  uint32_t generation           = ++_chunk_mesh_requested_gen[chunk_id];
+  chunk_neighbours_t neighbours = _chunk_neighbours( chunk_id );
+  chunk_vertex_data_t vertex_data[CHUNK_SECTIONS];
+  uint16_t connectivity[CHUNK_SECTIONS];
+  // uploaded straight from the arena
+  _mesh_chunk_sections( chunk_id, &neighbours, vertex_data, connectivity );
+  _upload_chunk_mesh( chunk_id, generation, ALL_SECTIONS_MASK, vertex_data, connectivity );
+
+  _dirty_sections[chunk_id] = 0;
+}
+
+// runs on the main thread from worker_pool_update()
+static void _chunk_mesh_job_finished_cb( const char* name, void* args ) {
+  (void)name;
+  chunk_mesh_job_t* job = (chunk_mesh_job_t*)args;
+
+  if ( job->lod ) {
+    _upload_chunk_lod_mesh( job->chunk_id, job->generation, job->lod, &job->vertex_data[0] );
+  } else {
+    _upload_chunk_mesh( job->chunk_id, job->generation, job->section_mask, job->vertex_data, job->connectivity );
+  }
+  _chunk_mesh_job_in_flight[job->chunk_id] = false;
+  if ( job->from_cache ) {
+    assert( _n_mesh_cache_reads > 0 );
+    _n_mesh_cache_reads--;
+  }
 
-  // TODO(Anton) reuse a scratch buffer to avoid mallocs
-  chunk_vertex_data_t vertex_data = chunk_gen_vertex_data( &_g_chunks_world._chunks[chunk_id], 0, CHUNK_Y ); // TODO(Anton) also only load the changed slices
-  // TODO(Anton) and reuse the previous VBOs
-  delete_mesh( &_chunk_meshes[chunk_id] );
-  _chunk_meshes[chunk_id] = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr,
-    vertex_data.n_vpalidx_comps, vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.texcoords_ptr, vertex_data.n_vt_comps,
-    vertex_data.normals_ptr, vertex_data.n_vn_comps, NULL, 0, vertex_data.n_vertices );
-  chunk_free_vertex_data( &vertex_data );
+  _free_chunk_mesh_job( job );
+}
 
-  _dirty_chunks[chunk_id] = false;
+/* lod 0 meshes the chunk's dirty sections. otherwise the whole chunk at that level of detail. from_cache is for all the sections at lod 0, which its
+region's mesh cache may already have */
+static bool _push_chunk_mesh_job( int chunk_id, int lod, bool from_cache ) {
+  assert( !from_cache || ( 0 == lod && ALL_SECTIONS_MASK == _dirty_sections[chunk_id] ) );
+  chunk_mesh_job_t* job = _alloc_chunk_mesh_job( chunk_id );
+  job->generation       = ++_chunk_mesh_requested_gen[chunk_id];
+  job->section_mask     = lod ? 0 : _dirty_sections[chunk_id];
+  job->lod              = lod;
+  job->from_cache       = from_cache;
+  job->cx               = _g_chunks_world.cache.slots[chunk_id].cx;
+  job->cz               = _g_chunks_world.cache.slots[chunk_id].cz;
+
+  job_description_t job_description = ( job_description_t ){
+    .job_function_ptr = _chunk_mesh_job_fn, .job_function_args = job, .on_finished_cb = _chunk_mesh_job_finished_cb };
+  snprintf( job_description.name, sizeof( job_description.name ), "mesh chunk %i", chunk_id );
+  if ( !worker_pool_push_job( job_description ) ) {
+    _free_chunk_mesh_job( job );
+    return false;
+  }
+  _chunk_mesh_job_in_flight[chunk_id] = true;
+  if ( from_cache ) { _n_mesh_cache_reads++; }
+  // the job has its own copy, so a far chunk can go back to its compressed form until the next edit
+  if ( _chunk_lods[chunk_id] > 0 ) {
+    chunk_compress( &_g_chunks_world._chunks[chunk_id] );
+    _update_chunk_bytes( chunk_id );
+  }
+  return true;
 }
 
 void chunks_update_dirty_chunk_meshes() {
-  for ( int i = 0; i < CHUNKS_N; i++ ) {
-    if ( _dirty_chunks[i] ) { chunks_update_chunk_mesh( i ); }
+  // upload anything the workers have finished since last time
+  worker_pool_update();
+  _write_finished_mesh_cache_jobs();
+
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    // one job per chunk at a time. if it's edited again meanwhile it stays dirty and is queued when the current job comes back
+    if ( !_g_chunks_world.cache.slots[i].in_use || _chunk_mesh_job_in_flight[i] ) { continue; }
+    const int lod = _chunk_lods[i];
+    if ( lod > 0 ) {
+      // far chunks skip their sections and only keep the LOD mesh for their distance up to date
+      if ( !_stale_lod_meshes[i] && _chunk_lod_mesh_levels[i] == lod ) { continue; }
+      if ( !_push_chunk_mesh_job( i, lod, false ) ) { break; } // queue full. try again next call
+      _stale_lod_meshes[i] = false;
+    } else {
+      if ( !_dirty_sections[i] ) { continue; }
+      // a chunk that's loaded, or back in full detail range, needs every section, which is when saved meshes can stand in for the lot
+      const bool from_cache = _mesh_cache_chunks[i] && ALL_SECTIONS_MASK == _dirty_sections[i];
+      // blobs waiting to be written go first, once the reads in flight are done, so that a stream of loads can't hold them back for good
+      if ( from_cache && _n_finished_mesh_cache_jobs > 0 ) { continue; }
+      if ( !_push_chunk_mesh_job( i, 0, from_cache ) ) { break; }
+      _dirty_sections[i] = 0;
+    }
+  }
+  _push_pending_mesh_cache_jobs();
+}
+
+void chunks_stream( vec3 cam_pos ) {
+  assert( _g_chunks_world.chunks_created );
+  if ( !_g_chunks_world.chunks_created ) { return; }
+
+  const int centre_cx = (int)floorf( cam_pos.x / ( CHUNK_X * VOXEL_SCALE ) );
+  const int centre_cz = (int)floorf( cam_pos.z / ( CHUNK_Z * VOXEL_SCALE ) );
+  // called every frame, but levels of detail only change when the camera crosses into another chunk. chunks loaded meanwhile get theirs as they load
+  if ( centre_cx != _g_chunks_world.centre_cx || centre_cz != _g_chunks_world.centre_cz ) {
+    _g_chunks_world.centre_cx = centre_cx;
+    _g_chunks_world.centre_cz = centre_cz;
+    _update_chunk_lods();
+  }
+  _stream_chunks( CHUNKS_MAX_LOADS_PER_STREAM );
+}
+
+void chunks_set_view_radius( int radius_chunks ) {
+  // the whole radius must fit in the cache with room to spare for chunks on their way out
+  assert( radius_chunks >= 0 && ( 2 * radius_chunks + 1 ) * ( 2 * radius_chunks + 1 ) <= CHUNKS_MAX / 2 );
+  _g_chunks_world.radius = radius_chunks;
+}
+
+void chunks_set_memory_budget( size_t n_bytes ) { _g_chunks_world.memory_budget = n_bytes; }
+
+int chunks_get_resident_count() { return _g_chunks_world.cache.n_used; }
+
+void chunks_update_fluids( double elapsed_s ) {
+  assert( _g_chunks_world.chunks_created );
+  if ( !_g_chunks_world.chunks_created ) { return; }
+
+  const double tick_s = 1.0 / CHUNKS_FLUID_TICK_HZ;
+  _fluid_tick_accum_s += elapsed_s;
+  // dropping time a long frame couldn't catch up on just slows the flow down for a moment
+  if ( _fluid_tick_accum_s > tick_s * CHUNKS_FLUID_MAX_TICKS_PER_UPDATE ) { _fluid_tick_accum_s = tick_s * CHUNKS_FLUID_MAX_TICKS_PER_UPDATE; }
+  _n_fluid_changed = 0;
+  while ( _fluid_tick_accum_s >= tick_s ) {
+    _fluid_tick_accum_s -= tick_s;
+    fluid_tick( &_fluid, CHUNKS_FLUID_MAX_UPDATES_PER_TICK );
   }
+  // sections were marked dirty by _fluid_block_changed() as the blocks changed
+  light_blocks_changed( &_light, _volume_edit_xyz, _n_fluid_changed );
+}
+
+int chunks_get_fluid_queued_count() { return _fluid.n_queued; }
+
+bool chunks_save() {
+  assert( _g_chunks_world.chunks_created );
+  if ( !_g_chunks_world.chunks_created ) { return false; }
+
+  region_cursor_t cursor = ( region_cursor_t ){ .open = false };
+  int n_saved            = 0;
+  bool ret               = true;
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    if ( !_g_chunks_world.cache.slots[i].in_use || !_unsaved_chunks[i] ) { continue; }
+    if ( !_save_chunk( i, &cursor ) ) {
+      ret = false;
+      continue;
+    }
+    n_saved++;
+  }
+  _region_cursor_close( &cursor );
+  printf( "saved %i chunks to `%s.*.region`\n", n_saved, _g_chunks_world.world_name );
+
+  return ret;
+}
+
+bool chunks_export( const char* filename, mesh_export_format_t format ) {
+  assert( _g_chunks_world.chunks_created && filename );
+  if ( !_g_chunks_world.chunks_created ) { return false; }
+
+  mesh_export_t exporter;
+  if ( !mesh_export_begin( &exporter, filename, format, &_palette_rgb[0][0], VOXEL_PALETTE_N, VOXEL_SCALE ) ) { return false; }
+  int n_exported = 0;
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[i];
+    if ( !slot->in_use ) { continue; }
+    // meshed into the main thread's arena and written straight out, one chunk at a time
+    const chunk_neighbours_t neighbours = _chunk_neighbours( i );
+    chunk_mesh_arena_reset( &_main_mesh_arena );
+    chunk_vertex_data_t vertex_data =
+      chunk_gen_vertex_data_in_arena( &_main_mesh_arena, &_g_chunks_world._chunks[i], &neighbours, 0, CHUNK_Y, CHUNK_MESHER_GREEDY );
+    // voxel centres are on whole voxels, the same as chunks_draw()
+    if ( !mesh_export_chunk( &exporter, &vertex_data, slot->cx * CHUNK_X - 0.5f, -0.5f, slot->cz * CHUNK_Z - 0.5f ) ) { break; }
+    n_exported++;
+  }
+  const bool ret = mesh_export_end( &exporter );
+  printf( "exported %i chunks to `%s`\n", n_exported, filename );
+  return ret;
+}
+
+bool chunks_load() {
+  assert( _g_chunks_world.chunks_created );
+  if ( !_g_chunks_world.chunks_created ) { return false; }
+
+  region_cursor_t cursor = ( region_cursor_t ){ .open = false };
+  bool ret               = true;
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    const chunk_cache_slot_t* slot = &_g_chunks_world.cache.slots[i];
+    if ( !slot->in_use ) { continue; }
+    int local_x = 0, local_z = 0;
+    chunk_t chunk;
+    const bool in_region =
+      _region_cursor_seek( &cursor, slot->cx, slot->cz, false, &local_x, &local_z ) && region_has_chunk( &cursor.region, local_x, local_z );
+    if ( in_region ) {
+      if ( !region_load_chunk( &cursor.region, local_x, local_z, &chunk ) ) {
+        ret = false;
+        continue;
+      }
+    } else if ( _unsaved_chunks[i] ) {
+      chunk = _generate_chunk( slot->cx, slot->cz ); // never saved, so back to how it was generated
+    } else {
+      continue;
+    }
+    // any mesh jobs in flight have their own copies of the voxels so it's safe to swap these out
+    chunk_free( &_g_chunks_world._chunks[i] );
+    _g_chunks_world._chunks[i] = chunk;
+    _mesh_cache_chunks[i]      = in_region;
+    _unsaved_chunks[i]         = false;
+    _set_chunk_lod( i, _chunk_lods[i] ); // loaded chunks come back compressed
+    _mark_sections_dirty( i, ALL_SECTIONS_MASK );
+    // neighbouring faces may have changed too
+    _mark_adjacent_chunks_dirty( i, ALL_SECTIONS_MASK );
+    light_chunk_reloaded( &_light, slot->cx, slot->cz );
+    fluid_chunk_loaded( &_fluid, slot->cx, slot->cz );
+  }
+  _region_cursor_close( &cursor );
+
+  return ret;
 }
 
 void chunks_slice_view_mode( bool enable ) { _g_chunks_world.slice_view_mode = enable; }
+
+bool chunks_is_slice_view_mode() { return _g_chunks_world.slice_view_mode; }
+
+void chunks_set_slice_height( int y ) { _g_chunks_world.slice_y = CLAMP( y, 1, CHUNK_Y ); }
+
+int chunks_get_slice_height() { return _g_chunks_world.slice_y; }
+
+void chunks_greedy_meshing_mode( bool enable ) {
+  chunk_mesher_t mesher = enable ? CHUNK_MESHER_GREEDY : CHUNK_MESHER_PER_FACE;
+  if ( mesher == _g_chunks_world.mesher ) { return; }
+  _g_chunks_world.mesher = mesher;
+  for ( int i = 0; i < CHUNKS_MAX; i++ ) {
+    if ( _g_chunks_world.cache.slots[i].in_use ) { _dirty_sections[i] = ALL_SECTIONS_MASK; }
+  }
+}
+
+bool chunks_is_greedy_meshing_mode() { return CHUNK_MESHER_GREEDY == _g_chunks_world.mesher; }
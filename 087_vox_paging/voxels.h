@@ -1,52 +1,66 @@
-/* TODO
-
-* slice view mode
-* frustum culling
-* world save/load
-  save format
-  -chunk dims
-  -n chunks w,h
-  -m voxels in chunk
-  -m voxel types
-  -m voxels in chunk...
-  load
-  -deserialise into structs
-  -similar to create() function otherwise
-  -still need to regen model matrices, textures, etc.
-*/
-
 #pragma once
 
 #include "apg_maths.h"
+#include "chunk.h"
+#include "mesh_export.h"
 #include <stdbool.h>
 #include <stdint.h>
 
-typedef enum block_type_t { BLOCK_TYPE_AIR = 0, BLOCK_TYPE_CRUST, BLOCK_TYPE_GRASS, BLOCK_TYPE_DIRT, BLOCK_TYPE_STONE } block_type_t;
-
-bool chunks_create( uint32_t seed, uint32_t chunks_wide, uint32_t chunks_deep );
+/* the world has no fixed size. chunks are streamed in around the camera - see chunks_stream(). edited chunks are paged out to region files named
+`<world_name>.<rx>.<rz>.region` when they're evicted, and paged back in from there when they come into range again */
+bool chunks_create( uint32_t seed, const char* world_name );
 
 bool chunks_free();
 
-/* call before chunks_draw() to depth sort the chunks. should improve performance by reducing overdraw */
+/* call before chunks_draw(), after re_extract_frustum_planes(). works out which chunk sections could be seen from the camera, searching out from the
+camera's section through air and within the frustum, so sections hidden underground or behind hills aren't drawn - see visibility.h.
+then depth sorts the chunks with any sections left to draw. should improve performance by reducing overdraw */
 void chunks_sort_draw_queue( vec3 cam_pos );
 
 void chunks_draw( vec3 cam_fwd, mat4 P, mat4 V );
 
-/* draw all visible chunks to a colour picking framebuffer. work out the pixel x,y under the mouse.
-get its RGBA from the framebuffer at (x,y) then call chunks_picked_colour_to_voxel_idx() to get the voxel index of a particular pixel */
-void chunks_draw_colour_picking( mat4 offcentre_P, mat4 V );
-
 int chunks_get_drawn_count();
 
-/* if b channel for face is > 5 then colour was not a voxel and function will return false */
-bool chunks_picked_colour_to_voxel_idx( uint8_t r, uint8_t g, uint8_t b, uint8_t a, int* x, int* y, int* z, int* face, int* chunk_id );
+/* finds the first solid voxel along a ray, on the CPU from the resident chunks' voxels. for picking the voxel under the mouse, cast from the camera
+along the mouse direction. origin and max_dist are in world units. dir needn't be normalised. see raycast.h
+RETURNS false if nothing solid was hit within max_dist. otherwise the chunk id, voxel in the chunk, and face the ray went in through 0-5 */
+bool chunks_raycast( vec3 origin, vec3 dir, float max_dist, int* chunk_id, int* x, int* y, int* z, int* face );
+
+/* call once per update tick, before chunks_update_dirty_chunk_meshes(). touches the chunks within the view radius of the camera, loads or generates
+a few that aren't resident yet, then evicts the least recently used chunks outside the radius until resident chunks fit the memory budget.
+edited chunks are saved to their region file as they are evicted */
+void chunks_stream( vec3 cam_pos );
+
+/* radius, in chunks, of the circle around the camera kept resident and drawn. all but the nearest few chunks are drawn with level of detail meshes,
+so this can be several times further than full detail meshes alone would allow - see chunk_gen_lod_vertex_data_in_arena() */
+void chunks_set_view_radius( int radius_chunks );
+
+/* soft limit on memory used by resident chunks' voxels. chunks within the view radius are never evicted to meet it */
+void chunks_set_memory_budget( size_t n_bytes );
+
+int chunks_get_resident_count();
+
+/* call once per update tick, before chunks_stream(). runs the fluid sim at a fixed tick rate for elapsed_s seconds of game time, then updates light
+around the blocks it changed and marks their sections dirty, like a volume edit. see fluid.h */
+void chunks_update_fluids( double elapsed_s );
+
+// fluid cells waiting for an update, for stats. 0 when all the fluid has settled
+int chunks_get_fluid_queued_count();
+
+/* a chunk id is a slot in the chunk cache, so it's only valid while that chunk is resident - don't hold onto one across chunks_stream() calls.
+RETURNS false if chunk_id isn't resident */
+bool chunks_get_chunk_coords( int chunk_id, int* cx, int* cz );
+
+// RETURNS the id of resident chunk cx,cz, or -1 if it isn't resident
+int chunks_get_chunk_id( int cx, int cz );
 
 /*
 block_type must not be NULL and chunk_id must be valid
 RETURNS false if xyz is out of bounds */
 bool chunks_get_block_type_in_chunk( int chunk_id, int x, int y, int z, block_type_t* block_type );
 
-/*
+/* marks the sections of the chunk around the edit dirty, and the same sections of any neighbouring chunk that shares the changed voxel's border, so call
+chunks_update_dirty_chunk_meshes() afterwards. see chunk_sections_changed_by_edit()
 RETURNS
 - true if block was changed
 - false if no change was required since type is the same as before
@@ -55,12 +69,71 @@ bool chunks_set_block_type_in_chunk( int chunk_id, int x, int y, int z, block_ty
 
 bool chunks_create_block_on_face( int picked_chunk_id, int picked_x, int picked_y, int picked_z, int picked_face, block_type_t type );
 
-/* explicitly update one chunk. sometimes useful during world creation. normally just call chunks_update_dirty_chunk_meshes()
-PERFORMANCE WARNING: current impl calls malloc() and free() */
+/* volume edits, in world voxel coords - world voxel x is cx * CHUNK_X + the voxel's x in chunk cx, likewise for z. they span chunk borders.
+voxels in chunks that aren't resident, or above or below the world, are left alone. every voxel is changed in one pass, then light is updated for all
+of them at once and each section touched is marked dirty once, so a big brush stroke costs one remesh per section rather than one per voxel.
+call chunks_update_dirty_chunk_meshes() afterwards. BLOCK_TYPE_AIR clears
+RETURNS the number of voxels changed */
+
+// box between corner voxels x0,y0,z0 and x1,y1,z1 inclusive, in any order
+int chunks_fill_box( int x0, int y0, int z0, int x1, int y1, int z1, block_type_t type );
+
+// voxels whose centres are within radius of the centre of voxel x,y,z
+int chunks_fill_sphere( int x, int y, int z, int radius, block_type_t type );
+
+// upright cylinder, height voxels tall, standing on voxel x,y,z
+int chunks_fill_cylinder( int x, int y, int z, int radius, int height, block_type_t type );
+
+// block types copied from the world. x then z then y, like chunk voxels
+typedef struct chunks_clipboard_t {
+  int w, h, d;
+  uint8_t* types;
+} chunks_clipboard_t;
+
+/* copies the box between corner voxels x0,y0,z0 and x1,y1,z1 inclusive. call chunks_clipboard_free() afterwards
+RETURNS false if any of it wasn't resident, in which case that part is copied as air */
+bool chunks_copy_box( int x0, int y0, int z0, int x1, int y1, int z1, chunks_clipboard_t* clipboard );
+
+/* a volume edit writing the clipboard with its lowest corner at voxel x,y,z. if skip_air then air in the clipboard leaves the voxel under it alone,
+so that pasting a shape doesn't carve out a box around it */
+int chunks_paste( const chunks_clipboard_t* clipboard, int x, int y, int z, bool skip_air );
+
+void chunks_clipboard_free( chunks_clipboard_t* clipboard );
+
+/* explicitly update one chunk right now on the calling thread. normally just call chunks_update_dirty_chunk_meshes()
+meshes into a reusable scratch arena and uploads straight from it, so it only allocates while the arena is still growing */
 void chunks_update_chunk_mesh( int chunk_id );
 
-/* call once per update tick to regenerate geometry for any chunks that were modified since last call
-calls chunks_update_chunk_mesh() */
+/* call once per update tick. queues chunks that were modified since last call to be meshed on the worker threads, and uploads any meshes that
+the workers have finished. chunks keep drawing their previous mesh until the new one is uploaded, so this never waits on meshing */
 void chunks_update_dirty_chunk_meshes();
 
+/* saves every resident chunk changed since the last save into its region file. only those chunks' payloads are written - see region.h
+RETURNS false on a file error */
+bool chunks_save();
+
+/* reverts resident chunks to their saved state - chunks that were never saved are regenerated. marks the reverted chunks dirty
+RETURNS false if a chunk in a region file was corrupt */
+bool chunks_load();
+
+/* writes every resident chunk, greedy meshed at full detail, to filename as a binary PLY or GLB - see mesh_export.h. one chunk is meshed and written
+at a time, so the world is never in memory as one big mesh. colours are the average colour of each block type's texture
+RETURNS false on a file error */
+bool chunks_export( const char* filename, mesh_export_format_t format );
+
+/* slice view hides every layer from the slice height up, to look into caves and under overhangs from above. where the slice cuts into the ground
+it's capped in a flat colour. faces are meshed in layer order, so slicing only changes how much of each mesh is drawn and nothing is remeshed */
 void chunks_slice_view_mode( bool enable );
+
+bool chunks_is_slice_view_mode();
+
+// layer y and those above it are hidden in slice view. clamped to 1..CHUNK_Y
+void chunks_set_slice_height( int y );
+
+int chunks_get_slice_height();
+
+/* switch between greedy-merged faces (default) and one quad per voxel face. all chunks are marked dirty on a change so call
+chunks_update_dirty_chunk_meshes() afterwards */
+void chunks_greedy_meshing_mode( bool enable );
+
+bool chunks_is_greedy_meshing_mode();